@@ -0,0 +1,105 @@
+/*
+ * Archive.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_ARCHIVE_H_
+#define INCLUDE_ARCHIVE_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <istream>
+#include <fstream>
+#include <mutex>
+
+#include "FilePath.h"
+#include "SrscFile.h"
+
+#define OD_ARCHIVE_FILENAME "opendrakan.odpk"
+
+namespace od
+{
+
+    /**
+     * @brief Single-file package of all database and level containers below an engine root.
+     *
+     * Layout (little endian):
+     *  - header: magic 'ODPK', u32 version, u32 entry count, u64 index offset
+     *  - file payloads, each starting on a page boundary so they can be used straight from a memory mapping
+     *  - index: per file its path relative to the archive's directory (lower case, '/' separated), u64 offset,
+     *    u32 stored size, u32 size, u32 flags and, for SRSC containers, the container's version and directory
+     *
+     * The archive is memory mapped if the platform allows it. Compressed payloads (zlib, fastest level) are inflated
+     * into memory whenever they are opened.
+     *
+     * Lookups are case-insensitive, so paths need not be passed through FilePath::adjustCase() first.
+     */
+    class Archive
+    {
+    public:
+
+        struct Entry
+        {
+            std::string path;
+            uint64_t offset;
+            uint32_t storedSize;
+            uint32_t size;
+            uint32_t flags;
+            uint16_t srscVersion;
+            std::vector<SrscFile::DirEntry> srscDirectory;
+        };
+
+        static const uint32_t FLAG_COMPRESSED = 1;
+        static const uint32_t FLAG_SRSC = 2;
+
+        Archive(const FilePath &archivePath);
+        Archive(const Archive &a) = delete;
+        ~Archive();
+
+        inline const FilePath &getArchivePath() const { return mArchivePath; }
+        inline size_t getEntryCount() const { return mEntries.size(); }
+
+        /**
+         * @brief Returns the archive entry for the given file or nullptr if it is not part of the archive.
+         */
+        const Entry *findEntry(const FilePath &path) const;
+
+        /**
+         * @brief Opens a stream over the given file's contents, or returns nullptr if it is not part of the archive.
+         */
+        std::unique_ptr<std::istream> openFile(const FilePath &path);
+
+        /**
+         * @brief Opens the given SRSC container using the directory stored in the archive index. Returns nullptr
+         * if it is not part of the archive.
+         */
+        std::unique_ptr<SrscFile> openSrscFile(const FilePath &path);
+
+        /**
+         * @brief Packs all containers found below \c installDir into a new archive at \c archivePath.
+         */
+        static void build(const FilePath &installDir, const FilePath &archivePath, bool compress);
+
+
+    private:
+
+        std::string _getKey(const FilePath &path) const;
+        std::unique_ptr<std::istream> _openEntry(const Entry &entry);
+
+        FilePath mArchivePath;
+        std::string mRootPrefix;
+        std::ifstream mFile;
+        std::mutex mFileMutex;
+        const char *mMapping;
+        size_t mMappingSize;
+        std::vector<Entry> mEntries;
+        std::unordered_map<std::string, size_t> mEntryIndex;
+    };
+
+}
+
+#endif /* INCLUDE_ARCHIVE_H_ */
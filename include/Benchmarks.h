@@ -0,0 +1,28 @@
+/*
+ * Benchmarks.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_BENCHMARKS_H_
+#define INCLUDE_BENCHMARKS_H_
+
+#include <string>
+#include <ostream>
+
+namespace od
+{
+
+    /**
+     * @brief Runs the named micro benchmark and prints it's results to \c out.
+     *
+     * Throws NotFoundException if there is no benchmark with the given name.
+     */
+    void runBenchmark(const std::string &name, std::ostream &out);
+
+    void listBenchmarks(std::ostream &out);
+
+}
+
+#endif /* INCLUDE_BENCHMARKS_H_ */
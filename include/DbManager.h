@@ -12,6 +12,7 @@
 #include <memory>
 
 #include "FilePath.h"
+#include "Archive.h"
 
 namespace od
 {
@@ -27,6 +28,22 @@ namespace od
 		~DbManager();
 
 		inline Engine &getEngine() { return mEngine; }
+		inline Archive *getArchive() { return mArchive.get(); }
+
+		/**
+		 * @brief Mounts a packed archive. From then on, files found in the archive are read from it instead of from disk.
+		 */
+		void mountArchive(const FilePath &archivePath);
+
+		/**
+		 * @brief Opens the given file from the mounted archive, or from disk if it's not packed. Returns nullptr if it exists in neither.
+		 */
+		std::unique_ptr<std::istream> openFile(const FilePath &path);
+
+		/**
+		 * @brief Like openFile(), but opens an SRSC container.
+		 */
+		std::unique_ptr<SrscFile> openSrscFile(const FilePath &path);
 
 		bool isDbLoaded(const FilePath &dbFilePath) const;
 
@@ -38,13 +55,22 @@ namespace od
          */
 		Database &loadDb(const FilePath &dbFilePath, size_t dependencyDepth = 0);
 
+		/**
+		 * @brief Returns the loaded database with the given path. Throws NotFoundException if it is not loaded.
+		 */
 		Database &getDb(const FilePath &dbFilePath);
 
+		/**
+		 * @brief Returns the loaded database with the given path, or nullptr if it is not loaded.
+		 */
+		Database *findDb(const FilePath &dbFilePath);
+
 
 	private:
 
 		Engine &mEngine;
 		std::vector<std::shared_ptr<Database>> mRiotDbs;
+		std::unique_ptr<Archive> mArchive;
 	};
 
 }
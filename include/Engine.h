@@ -15,7 +15,10 @@
 #include "DbManager.h"
 #include "ShaderManager.h"
 #include "InputManager.h"
+#include "UpdateScheduler.h"
+#include "TimerWheel.h"
 #include "light/LightManager.h"
+#include "audio/SoundMixer.h"
 #include "Level.h"
 
 namespace od
@@ -39,15 +42,31 @@ namespace od
 		inline const FilePath &getEngineRootDir() const { return mEngineRootDir; }
 		inline DbManager &getDbManager() { return mDbManager; }
 		inline ShaderManager &getShaderManager() { return mShaderManager; }
+		inline UpdateScheduler &getUpdateScheduler() { return mUpdateScheduler; }
+		inline TimerWheel &getTimerWheel() { return mTimerWheel; }
 		inline GuiManager &getGuiManager() { return *mGuiManager; }
 		inline LightManager &getLightManager() { return *mLightManager; }
+		inline SoundMixer &getSoundMixer() { return *mSoundMixer; }
 		inline Level &getLevel() { return *mLevel; } // FIXME: throw if no level present
 		inline Player *getPlayer() { return mPlayer; }
         inline void setPlayer(Player *p) { mPlayer = p; }
 		inline void setCamera(Camera *cam) { mCamera = cam; }
 		inline Camera *getCamera() { return mCamera; }
+		inline osg::Group *getRootNode() { return mRootNode; }
 		inline double getMaxFrameRate() const { return mMaxFrameRate; }
 		inline void setMaxFrameRate(double fps) { mMaxFrameRate = fps; } // 0 for no cap
+		inline bool getBakeShadows() const { return mBakeShadows; }
+		inline void setBakeShadows(bool b) { mBakeShadows = b; } // whether static lights cast shadows on layers
+		inline size_t getLayerTileSize() const { return mLayerTileSize; }
+		inline void setLayerTileSize(size_t cells) { mLayerTileSize = cells; } // 0 builds every layer as one piece
+		inline float getLayerLodPixelError() const { return mLayerLodPixelError; }
+		inline void setLayerLodPixelError(float pixels) { mLayerLodPixelError = pixels; } // 0 always draws layers at full detail
+		inline float getModelAutoLodDistance() const { return mModelAutoLodDistance; }
+		inline void setModelAutoLodDistance(float radii) { mModelAutoLodDistance = radii; } // 0 disables generated model LODs
+		inline bool getCompactVertexFormat() const { return mCompactVertexFormat; }
+		inline void setCompactVertexFormat(bool b) { mCompactVertexFormat = b; } // whether models use quantized vertex attributes
+		inline size_t getStatsDumpFrame() const { return mStatsDumpFrame; }
+		inline void setStatsDumpFrame(size_t frame) { mStatsDumpFrame = frame; } // 0 runs until the window is closed
 
 		void setUp();
 		void run();
@@ -56,12 +75,16 @@ namespace od
 	private:
 
 		void _findEngineRoot(const std::string &rrcFileName);
+		void _dumpStats();
 
 		DbManager mDbManager;
 		ShaderManager mShaderManager;
+		UpdateScheduler mUpdateScheduler;
+		TimerWheel mTimerWheel;
 		osg::ref_ptr<InputManager> mInputManager;
 		std::unique_ptr<GuiManager> mGuiManager;
 		std::unique_ptr<LightManager> mLightManager;
+		std::unique_ptr<SoundMixer> mSoundMixer;
 		FilePath mInitialLevelFile;
 		FilePath mEngineRootDir;
 		std::unique_ptr<Level> mLevel;
@@ -71,6 +94,12 @@ namespace od
 		Camera *mCamera;
 		Player *mPlayer;
 		double mMaxFrameRate;
+		bool mBakeShadows;
+		size_t mLayerTileSize;
+		float mLayerLodPixelError;
+		float mModelAutoLodDistance;
+		bool mCompactVertexFormat;
+		size_t mStatsDumpFrame;
 		bool mSetUp;
 	};
 
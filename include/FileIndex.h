@@ -0,0 +1,80 @@
+/*
+ * FileIndex.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_FILEINDEX_H_
+#define INCLUDE_FILEINDEX_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace od
+{
+
+    /**
+     * @brief Process-wide, lazily populated index of directory listings used for case-insensitive path resolution.
+     *
+     * Each directory is listed at most once, when a path through it is first resolved. After that, resolving a path
+     * costs one hash lookup per component and no syscalls. Paths are indexed by their roots as given (the current
+     * working dir "." for relative paths), so relative paths become stale if the working dir changes.
+     *
+     * The index does not notice changes to the file system. Call invalidate() after creating or deleting files that
+     * are later looked up through FilePath::exists() or FilePath::adjustCase().
+     */
+    class FileIndex
+    {
+    public:
+
+        enum class Resolution
+        {
+            Found,     ///< every component exists
+            NotFound,  ///< some component does not exist in a directory we could list
+            Unknown    ///< some directory on the way could not be listed
+        };
+
+        FileIndex();
+        FileIndex(const FileIndex &i) = delete;
+
+        /**
+         * @brief Replaces each component in \c components with it's name as found in the file system, ignoring case.
+         *
+         * Components that could not be found are kept as-is. \c root is the path the components are relative to,
+         * e.g. "/" or ".".
+         */
+        Resolution resolve(const std::string &root, std::vector<std::string> &components);
+
+        /**
+         * @brief Drops all cached directory listings.
+         */
+        void invalidate();
+
+        static FileIndex &getSingleton();
+
+
+    private:
+
+        struct Node
+        {
+            Node(const std::string &name);
+
+            std::string realName;
+            bool listed;
+            bool listable;
+            std::unordered_map<std::string, std::unique_ptr<Node>> children; // key is name folded to lower case
+        };
+
+        void _list(Node &node, const std::string &hostPath);
+
+        std::mutex mMutex;
+        std::unordered_map<std::string, std::unique_ptr<Node>> mRoots;
+    };
+
+}
+
+#endif /* INCLUDE_FILEINDEX_H_ */
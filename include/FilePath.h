@@ -90,8 +90,9 @@ namespace od
 		/**
 		 * @brief Returns true if the represented file exists, false if not.
 		 *
-		 * This will check for file existence by trying to open that file in read mode. If that fails (for whatever
-		 * reason, insufficient permissions included), false will be returned.
+		 * This is answered from the FileIndex where possible. If the index can't tell, this will check for file
+		 * existence by trying to open that file in read mode. If that fails (for whatever reason, insufficient
+		 * permissions included), false will be returned.
 		 */
 		bool exists() const;
 
@@ -109,6 +110,8 @@ namespace od
 		 * If a part of the path can't be accessed (either because it does not exist or because of insufficient
 		 * permissions, that part of the path is kept as-is.
 		 *
+		 * Directory listings are taken from the FileIndex, so each directory is only read once per process.
+		 *
 		 * On Windows this returns an exact copy without chaning anything right now.
 		 */
 		FilePath adjustCase() const;
@@ -119,6 +122,7 @@ namespace od
 	private:
 
 		void _parsePath(const std::string &path);
+		std::string _getIndexRoot() const;
 		std::string _buildHostPath() const;
 
 		std::string mOriginalPath;
@@ -9,10 +9,12 @@
 #define INCLUDE_GEODEBUILDER_H_
 
 #include <vector>
+#include <map>
 #include <osg/Vec3f>
 #include <osg/Vec4f>
 #include <osg/Vec4i>
 #include <osg/Geode>
+#include <osg/Texture2D>
 
 #include "db/Asset.h"
 
@@ -38,12 +40,29 @@ namespace od
 		float vertexWeight;
 	};
 
+	/**
+	 * Joints used by one skinned geometry, in the order its bone indices refer to them. Attached to the geometry as user data.
+	 */
+	class BonePalette : public osg::Referenced
+	{
+	public:
+
+	    std::vector<int32_t> jointIndices;
+	};
+
 	/**
 	 * Class for constructing geodes from Riot engine model data. It splits models into multiple segments
 	 * with only one texture per segment. VBOs are shared among all segments and vertices are reused where possible.
 	 * Automatically generates normals and duplicates vertices if neccessary.
 	 *
+	 * Skinned segments are further split so each one references at most OD_MAX_BONE_COUNT bones. Every such segment gets a
+	 * BonePalette and a "bones" uniform of just that many matrices, which SkeletonAnimationPlayer fills per object.
+	 *
 	 * Construction is O(n*log(n)).
+	 *
+	 * With the compact vertex format enabled, normals are stored as bytes, UVs as fixed point shorts and bone indices and
+	 * weights as bytes. Only positions stay float. All of these are converted by the GL on fetch, except for the UVs, whose
+	 * scale is applied through texture matrix 0. Shaders used with built geometry must thus transform texture coordinates.
 	 */
 	class GeodeBuilder
 	{
@@ -59,9 +78,13 @@ namespace od
 		void setPolygonVector(std::vector<Polygon>::iterator begin, std::vector<Polygon>::iterator end);
 		void setBoneAffectionVector(std::vector<BoneAffection>::iterator begin, std::vector<BoneAffection>::iterator end);
 		void setClampTextures(bool b) { mClampTextures = b; }
+		void setCompactVertexFormat(bool b) { mCompactVertexFormat = b; }
 
 		void build(osg::Geode *geode);
 
+		/// Texture objects created during build(), one per texture ref. Geometries using the same texture share them.
+		inline const std::map<AssetRef, osg::ref_ptr<osg::Texture2D>> &getTextures() const { return mTextures; }
+
 
 	private:
 
@@ -70,11 +93,14 @@ namespace od
 			size_t vertexIndices[3];
 			osg::Vec2f uvCoords[3];
 			AssetRef texture;
+			size_t palette;
 		};
 
 		void _buildNormals();
 		void _makeIndicesUniqueAndGenerateUvs();
 		void _disambiguateAndGenerateUvs();
+		void _splitBonePalettes();
+		void _compactVertexData();
 
 		std::string mModelName;
 		AssetProvider &mAssetProvider;
@@ -88,7 +114,17 @@ namespace od
 		osg::ref_ptr<osg::Vec4Array> mBoneIndices; // NOTE: this was an unsigned int vector before. turns out OSG somehow fails
 												   //  to upload that to the shader. or maybe the shader can't handle it. anyhow
 												   //  it took me like 10 hours to debug that shit. don't change it!
+		// what actually ends up in the VBO. either the arrays above or their compact versions
+		osg::ref_ptr<osg::Array> mNormalData;
+		osg::ref_ptr<osg::Array> mUvData;
+		osg::ref_ptr<osg::Array> mBoneWeightData;
+		osg::ref_ptr<osg::Array> mBoneIndexData;
+		osg::ref_ptr<osg::StateAttribute> mUvScale;
+		std::vector<osg::ref_ptr<BonePalette>> mBonePalettes;
+		std::map<AssetRef, osg::ref_ptr<osg::Texture2D>> mTextures;
+
 		bool mClampTextures;
+		bool mCompactVertexFormat;
 		bool mSmoothNormals;
 		bool mNormalsFromCcw;
 		std::vector<Triangle> mTriangles;
@@ -0,0 +1,166 @@
+/*
+ * InstanceManager.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_INSTANCEMANAGER_H_
+#define INCLUDE_INSTANCEMANAGER_H_
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <ostream>
+#include <cstdint>
+#include <osg/Group>
+#include <osg/Geode>
+#include <osg/Image>
+#include <osg/Texture2D>
+#include <osg/Program>
+#include <osg/Uniform>
+#include <osg/Polytope>
+
+#include "UpdateScheduler.h"
+
+namespace od
+{
+
+    class LightManager;
+
+    typedef uint32_t InstanceId;
+
+    /**
+     * @brief Draws many copies of the same static model with instanced draw calls.
+     *
+     * Instances are grouped by the model node they show. Each group keeps the transforms and light colors of it's
+     * instances in a float texture and sorts the instances into spatially compact ranges. A range is drawn with one
+     * instanced draw call per drawable of the LOD level chosen for it, so a forest of a thousand trees costs a few dozen
+     * draw calls instead of a few thousand.
+     *
+     * Ranges are culled against the view frustum on the CPU before OSG traverses them. Groups are only rebuilt in
+     * updateGroups() after instances were added or removed, so instances are meant for objects that don't move.
+     */
+    class InstanceManager : public Updatable
+    {
+    public:
+
+        static const InstanceId INVALID_INSTANCE = 0;
+
+        struct Stats
+        {
+            size_t groupCount;
+            size_t instanceCount;
+            size_t rangeCount;
+            size_t instancedDrawCalls;   ///< draw calls needed if all ranges are visible at their most detailed LOD
+            size_t uninstancedDrawCalls; ///< draw calls the same instances would need if drawn one by one
+            size_t visibleRanges;        ///< ranges that passed culling since the last update
+            size_t visibleInstances;
+        };
+
+        InstanceManager(osg::Group *parent);
+        InstanceManager(const InstanceManager &) = delete;
+        ~InstanceManager();
+
+        inline const Stats &getStats() const { return mStats; }
+
+        /// Without a light manager, instances are drawn fully lit. Set before adding instances.
+        inline void setLightManager(LightManager *lightManager) { mLightManager = lightManager; }
+
+        /**
+         * @brief Sets the program used for drawing instances. It needs to fetch per-instance data as in instanced_vertex.glsl.
+         */
+        void setProgram(osg::Program *program);
+
+        InstanceId addInstance(osg::Node *model, const osg::Matrix &transform);
+        void removeInstance(InstanceId id);
+        bool isInstance(InstanceId id) const;
+
+        /**
+         * @brief Rebuilds groups whose instances changed and refreshes instance light colors if the lights changed.
+         */
+        void updateGroups();
+
+        /**
+         * @brief Culls the ranges of all groups against \c frustum, given in world space. Returns number of visible ranges.
+         *
+         * Rendering does this per group during the cull traversal. This is for checking culling without a viewer.
+         */
+        size_t cull(osg::Polytope &frustum);
+
+        void dumpStats(std::ostream &out) const;
+
+        // implement Updatable
+        virtual void update(double simTime, double relTime) override;
+
+
+    private:
+
+        friend class InstanceGroupCullCallback;
+
+        struct Instance
+        {
+            InstanceId id;
+            osg::Matrix transform;
+            osg::BoundingSphere bound; // world space
+            osg::Vec4 lightColor;
+        };
+
+        struct Range
+        {
+            size_t first;
+            size_t count;
+            osg::BoundingSphere bound;
+            osg::ref_ptr<osg::Node> node;
+            bool visible;
+        };
+
+        struct LodLevel
+        {
+            osg::ref_ptr<osg::Geode> geode;
+            float minDistance;
+            float maxDistance;
+        };
+
+        struct Group
+        {
+            osg::ref_ptr<osg::Node> model;
+            std::vector<LodLevel> lods;
+            std::vector<Instance> instances;
+            std::vector<Range> ranges;
+            osg::ref_ptr<osg::Group> node;
+            osg::ref_ptr<osg::Image> instanceData;
+            osg::ref_ptr<osg::Texture2D> instanceTexture;
+            osg::ref_ptr<osg::Uniform> instanceDataHeight;
+            bool dirty;
+        };
+
+        struct Location
+        {
+            int32_t group; // -1 for unused IDs
+            uint32_t index;
+        };
+
+        size_t _createGroup(osg::Node *model);
+        void _rebuildGroup(Group &group);
+        void _writeInstanceData(Group &group, size_t index);
+        void _sampleLights(Group &group, LightManager &lightManager);
+        size_t _cullGroup(Group &group, osg::Polytope &frustum);
+        osg::ref_ptr<osg::Node> _makeRangeNode(Group &group, const Range &range);
+        void _updateStats();
+
+        osg::ref_ptr<osg::Group> mParent;
+        osg::ref_ptr<osg::Group> mRoot;
+        osg::ref_ptr<osg::Program> mProgram;
+        LightManager *mLightManager;
+        std::vector<std::unique_ptr<Group>> mGroups;
+        std::unordered_map<osg::Node*, std::vector<size_t>> mGroupsByModel;
+        std::vector<Location> mLocations; // indexed by instance ID
+        std::vector<InstanceId> mFreeIds;
+        uint32_t mLightGeneration;
+        Stats mStats;
+    };
+
+}
+
+#endif /* INCLUDE_INSTANCEMANAGER_H_ */
@@ -9,10 +9,12 @@
 #define LAYER_H_
 
 #include <memory>
+#include <map>
 #include <osg/Group>
 #include <osg/PositionAttitudeTransform>
 #include <osg/Geode>
-#include <osg/Light>
+#include <osg/Geometry>
+#include <osg/Texture2D>
 #include <BulletCollision/CollisionShapes/btTriangleMesh.h>
 #include <BulletCollision/CollisionShapes/btCollisionShape.h>
 
@@ -23,6 +25,7 @@
 namespace od
 {
     class Level;
+    class LightBaker;
 
     class Layer : public osg::PositionAttitudeTransform
     {
@@ -48,16 +51,42 @@ namespace od
 
         void loadDefinition(DataReader &dr);
         void loadPolyData(DataReader &dr);
+
+        /**
+         * @brief Builds the layer's drawables.
+         *
+         * Unless tiling is disabled in the engine, the layer is split into square tiles of cells with one geode each,
+         * so the cull traversal can reject the parts of a big layer that are out of view. All tiles share one vertex array.
+         * Tiles get reduced resolution levels for distant viewing unless layer LOD is disabled in the engine.
+         */
         void buildGeometry();
+
+        /**
+         * @brief Bakes this layer's ambient and directional light as well as the baker's point lights into vertex colors.
+         *
+         * Needs to be called after buildGeometry(). Until then, the layer is rendered fully lit.
+         */
+        void bakeLighting(LightBaker &baker);
+
         btCollisionShape *getCollisionShape();
 
         inline uint32_t getId() const { return mId; };
         inline std::string getName() const { return mLayerName; };
         inline std::vector<uint32_t> &getVisibleLayers() { return mVisibleLayers; };
+        inline uint32_t getWidth() const { return mWidth; }
+        inline uint32_t getHeight() const { return mHeight; }
         inline uint32_t getOriginX() const { return mOriginX; }
         inline uint32_t getOriginZ() const { return mOriginZ; }
         inline float getWorldHeightWu() const { return mWorldHeightWu; }
         inline float getWorldHeightLu() const { return OD_WORLD_SCALE * mWorldHeightWu; }
+        inline size_t getTileCount() const { return mTileGeodes.size(); }
+        inline osg::Vec4 getLightColor() const { return mLightColor; }
+        inline osg::Vec4 getAmbientColor() const { return mAmbientColor; }
+
+        /**
+         * @brief Returns the normalized direction towards this layer's directional light, in world space.
+         */
+        osg::Vec3f getLightDirection() const;
 
 
     private:
@@ -76,6 +105,9 @@ namespace od
             float heightOffsetLu;
         };
 
+        void _splitIntoTiles(osg::Geode *layerGeode, size_t tileSize);
+        void _buildLod(osg::Geode *layerGeode, const std::map<AssetRef, osg::ref_ptr<osg::Texture2D>> &textures, size_t tileSize, float pixelError, std::vector<osg::ref_ptr<osg::Node>> &tileNodes);
+
         Level              	   &mLevel;
         uint32_t                mId;
         uint32_t                mWidth;
@@ -96,8 +128,10 @@ namespace od
         std::vector<Vertex> mVertices;
         std::vector<Cell>   mCells;
         size_t mVisibleTriangles;
-        osg::ref_ptr<osg::Geode> mLayerGeode;
-        osg::ref_ptr<osg::Light> mLayerLight;
+        std::vector<osg::ref_ptr<osg::Geode>> mTileGeodes; // full detail
+        osg::ref_ptr<osg::Vec3Array> mLodVertices;
+        osg::ref_ptr<osg::Vec3Array> mLodNormals;
+        std::vector<osg::ref_ptr<osg::Geometry>> mLodGeometries;
 
         std::unique_ptr<btTriangleMesh> mBulletMesh;
         std::unique_ptr<btCollisionShape> mCollisionShape;
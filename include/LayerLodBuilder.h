@@ -0,0 +1,166 @@
+/*
+ * LayerLodBuilder.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_LAYERLODBUILDER_H_
+#define INCLUDE_LAYERLODBUILDER_H_
+
+#include <vector>
+#include <map>
+#include <tuple>
+#include <osg/Vec2f>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/StateSet>
+#include <osg/Texture2D>
+
+#include "db/Asset.h"
+
+namespace od
+{
+
+    class AssetProvider;
+
+    /**
+     * @brief Builds reduced resolution versions of layer tiles and switches between them based on screen-space error.
+     *
+     * Level n of a tile replaces aligned blocks of up to 2^n x 2^n cells with two triangles. Since every cell maps it's
+     * texture once, only blocks whose cells all use the same texture with the same orientation can be merged. The
+     * texture is then repeated across the block. Blocks containing holes are never merged, so holes stay holes at
+     * every level.
+     *
+     * Cracks between patches of different resolution, inside a tile or between neighbouring tiles, are covered with
+     * skirts hanging off the patch edges. Each level's switch distance is derived from the largest height deviation
+     * it introduces, so the error stays below the configured number of pixels on screen.
+     */
+    class LayerLodBuilder
+    {
+    public:
+
+        struct Cell
+        {
+            AssetRef leftTexture;
+            AssetRef rightTexture;
+            osg::Vec2f uvs[4]; // at corners a, b, c, d, see Layer::buildGeometry()
+            bool divBackslash;
+        };
+
+        struct Stats
+        {
+            size_t tileCount;
+            size_t maxLevelCount;
+            size_t fullDetailTriangles;
+            size_t coarsestTriangles; ///< triangles of all tiles at their coarsest level, including skirts
+            size_t skirtTriangles;
+        };
+
+        LayerLodBuilder(const std::string &layerName, AssetProvider &assetProvider, size_t width, size_t height);
+
+        inline void setCeiling(bool b) { mCeiling = b; }
+        inline void setDoubleSided(bool b) { mDoubleSided = b; }
+        inline void setPixelError(float pixels) { mPixelError = pixels; }
+        inline const Stats &getStats() const { return mStats; }
+
+        void setHeightVector(std::vector<float>::iterator begin, std::vector<float>::iterator end);
+        void setCellVector(std::vector<Cell>::iterator begin, std::vector<Cell>::iterator end);
+
+        /**
+         * @brief Sets the smooth normals of the full detail layer, indexed like the height grid. Only the first
+         * (width+1)*(height+1) normals are used.
+         */
+        void setGridNormals(osg::Vec3Array *normals);
+
+        /**
+         * @brief Sets the texture objects of the full detail layer, so reduced levels don't upload the same textures
+         * again. Textures not found here are created by the builder.
+         *
+         * Merged blocks repeat their texture once per cell, so these textures are switched to repeat wrapping.
+         */
+        void setTextures(const std::map<AssetRef, osg::ref_ptr<osg::Texture2D>> &textures);
+
+        /**
+         * @brief Builds LOD nodes for all tiles.
+         *
+         * \c tileGeodes must contain the full detail geode of every tile in row-major order, nullptr for empty tiles.
+         * Skirts covering cracks towards neighbouring tiles are added to these. \c tileNodes receives the node to use
+         * in place of each geode. This is an osg::LOD if the tile has reduced levels, otherwise the geode itself.
+         */
+        void build(size_t tileSize, const std::vector<osg::ref_ptr<osg::Geode>> &tileGeodes, std::vector<osg::ref_ptr<osg::Node>> &tileNodes);
+
+        /// All geometries created by the builder. They use the arrays below instead of those of the full detail geometry.
+        inline const std::vector<osg::ref_ptr<osg::Geometry>> &getGeometries() const { return mGeometries; }
+        inline osg::Vec3Array *getVertexArray() { return mVertices; }
+        inline osg::Vec3Array *getNormalArray() { return mNormals; }
+
+
+    private:
+
+        typedef std::map<AssetRef, std::vector<uint32_t>> IndexMap; // indices per texture
+
+        struct Tile
+        {
+            size_t x;
+            size_t z;
+            size_t width;
+            size_t height;
+            std::vector<float> levelErrors;
+        };
+
+        struct PendingMesh
+        {
+            osg::ref_ptr<osg::Geode> geode;
+            IndexMap indices;
+        };
+
+        enum Edge
+        {
+            EDGE_TOP,
+            EDGE_RIGHT,
+            EDGE_BOTTOM,
+            EDGE_LEFT
+        };
+
+        bool _isMergeable(size_t cellX, size_t cellZ, size_t size);
+        float _blockError(size_t cellX, size_t cellZ, size_t size);
+        const AssetRef &_edgeTexture(size_t cellX, size_t cellZ, Edge edge);
+        int _levelAt(const Tile &tile, int64_t cellX, int64_t cellZ, size_t level);
+        uint32_t _getVertex(size_t gridX, size_t gridZ, const osg::Vec2f &uv, bool skirt);
+        void _addTriangle(std::vector<uint32_t> &indices, uint32_t a, uint32_t b, uint32_t c);
+        void _addSkirt(IndexMap &indices, const AssetRef &texture, size_t x0, size_t z0, size_t x1, size_t z1, const osg::Vec2f &uv0, const osg::Vec2f &uv1);
+        void _buildCell(IndexMap &indices, size_t cellX, size_t cellZ);
+        void _buildBlock(IndexMap &indices, size_t cellX, size_t cellZ, size_t size);
+        void _buildLevel(const Tile &tile, size_t level, IndexMap &indices);
+        void _buildTileBorderSkirts(const Tile &tile, IndexMap &indices);
+        osg::StateSet *_getStateSet(const AssetRef &texture);
+        size_t _countTriangles(const IndexMap &indices);
+
+        std::string mLayerName;
+        AssetProvider &mAssetProvider;
+        size_t mWidth;
+        size_t mHeight;
+        bool mCeiling;
+        bool mDoubleSided;
+        float mPixelError;
+        float mSkirtDepth;
+        std::vector<float> mHeights;
+        std::vector<Cell> mCells;
+        std::vector<uint8_t> mMergeLevels; // per cell, level of the largest mergeable block containing it
+        osg::ref_ptr<osg::Vec3Array> mGridNormals;
+
+        osg::ref_ptr<osg::Vec3Array> mVertices;
+        osg::ref_ptr<osg::Vec3Array> mNormals;
+        osg::ref_ptr<osg::Vec2Array> mUvCoords;
+        osg::ref_ptr<osg::Vec4Array> mColors;
+        std::map<std::tuple<size_t, float, float, bool>, uint32_t> mVertexMap;
+        std::map<AssetRef, osg::ref_ptr<osg::Texture2D>> mTextures;
+        std::map<AssetRef, osg::ref_ptr<osg::StateSet>> mStateSets;
+        std::vector<osg::ref_ptr<osg::Geometry>> mGeometries;
+        Stats mStats;
+    };
+
+}
+
+#endif /* INCLUDE_LAYERLODBUILDER_H_ */
@@ -0,0 +1,90 @@
+/*
+ * LayerVisibility.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_LAYERVISIBILITY_H_
+#define INCLUDE_LAYERVISIBILITY_H_
+
+#include <vector>
+#include <ostream>
+#include <osg/Vec3f>
+#include <osg/ref_ptr>
+
+namespace od
+{
+
+    class Level;
+    class Layer;
+
+    /**
+     * @brief Potentially visible set culling for layers.
+     *
+     * Every layer stores a list of layers that are visible from it, as authored in the editor. This determines
+     * which layer the observer is currently above and hides all layers not in that layer's visible set, so the
+     * cull traversal never even has to look at them.
+     */
+    class LayerVisibility
+    {
+    public:
+
+        struct Stats
+        {
+            size_t framesEvaluated;
+            size_t layerSwitches;
+            size_t raycastMisses;     // frames where the downward ray hit no layer
+            size_t unknownLayerHits;  // frames where the downward ray hit a layer not managed by this
+            size_t pointTestFallbacks; // frames where current layer was found via bounds test after a miss
+            size_t visibleLayersSum;   // sum over all frames, for averaging
+            size_t visibleLayers;      // in last frame
+            size_t hiddenLayers;       // in last frame
+        };
+
+        LayerVisibility(Level &level);
+
+        inline bool isEnabled() const { return mEnabled; }
+        inline Layer *getCurrentLayer() { return mCurrentLayer; }
+        inline const Stats &getStats() const { return mStats; }
+
+        /**
+         * @brief Resolves the visible layer lists of all given layers. Call once after all layers are loaded.
+         */
+        void init(const std::vector<osg::ref_ptr<Layer>> &layers);
+
+        /**
+         * @brief Enables or disables culling. When disabled, all layers are visible.
+         */
+        void setEnabled(bool b);
+
+        void update(const osg::Vec3f &eyePoint);
+
+        void resetStats();
+        void dumpStats(std::ostream &out) const;
+
+
+    private:
+
+        struct LayerEntry
+        {
+            Layer *layer;
+            std::vector<size_t> visibleSet; // indices into mLayerEntries, always including the layer itself
+        };
+
+        size_t _findCurrentLayer(const osg::Vec3f &eyePoint);
+        void _applyVisibleSet(size_t entryIndex);
+        void _showAll();
+
+        Level &mLevel;
+        bool mEnabled;
+        std::vector<LayerEntry> mLayerEntries;
+        std::vector<bool> mVisibilityScratch;
+        size_t mCurrentEntry;
+        Layer *mCurrentLayer;
+        Stats mStats;
+    };
+
+}
+
+#endif /* INCLUDE_LAYERVISIBILITY_H_ */
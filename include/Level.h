@@ -16,6 +16,7 @@
 #include <map>
 #include <memory>
 #include <deque>
+#include <unordered_map>
 
 #include <osg/Group>
 #include <osg/Geode>
@@ -28,6 +29,11 @@
 #include "TextureAtlas.h"
 #include "Layer.h"
 #include "physics/PhysicsManager.h"
+#include "ObjectStreamer.h"
+#include "LayerVisibility.h"
+#include "MessageDispatcher.h"
+#include "InstanceManager.h"
+#include "anim/CpuSkinner.h"
 
 namespace od
 {
@@ -44,32 +50,63 @@ namespace od
         inline FilePath getFilePath() const { return mLevelPath; }
         inline Engine &getEngine() { return mEngine; }
         inline PhysicsManager &getPhysicsManager() { return mPhysicsManager; }
+        inline ObjectStreamer &getObjectStreamer() { return mObjectStreamer; }
+        inline LayerVisibility &getLayerVisibility() { return mLayerVisibility; }
+        inline MessageDispatcher &getMessageDispatcher() { return mMessageDispatcher; }
+        inline InstanceManager &getInstanceManager() { return mInstanceManager; }
+        inline CpuSkinner &getCpuSkinner() { return mCpuSkinner; }
+        inline const std::vector<LevelObject*> &getSkinnedObjects() const { return mSkinnedObjects; }
 
         void loadLevel();
-        void spawnAllObjects();
+
+        /**
+         * @brief Spawns all objects with SpawnStrategy::Always and hands those with WhenInSight to the object streamer.
+         */
+        void spawnObjects();
         void requestLevelObjectDestruction(LevelObject *obj);
         Layer *getLayerById(uint32_t id);
         Layer *getLayerByIndex(uint16_t index);
 
         void update();
 
+        /**
+         * @brief Skins \c obj on the CPU every frame from now on. \c obj must have a skinning instance.
+         *
+         * Skinned objects are tested with their deformed mesh by the PhysicsManager's raycasts.
+         */
+        void addSkinnedObject(LevelObject &obj);
+        void removeSkinnedObject(LevelObject &obj);
+
         LevelObject &getLevelObjectByIndex(uint16_t index);
 
         // implement AssetProvider
-        virtual Texture   *getTextureByRef(const AssetRef &ref) override;
-        virtual Class     *getClassByRef(const AssetRef &ref) override;
-        virtual Model     *getModelByRef(const AssetRef &ref) override;
-        virtual Sequence  *getSequenceByRef(const AssetRef &ref) override;
-        virtual Animation *getAnimationByRef(const AssetRef &ref) override;
-        virtual Sound     *getSoundByRef(const AssetRef &ref) override;
+        virtual Texture   *findTextureByRef(const AssetRef &ref) override;
+        virtual Class     *findClassByRef(const AssetRef &ref) override;
+        virtual Model     *findModelByRef(const AssetRef &ref) override;
+        virtual Sequence  *findSequenceByRef(const AssetRef &ref) override;
+        virtual Animation *findAnimationByRef(const AssetRef &ref) override;
+        virtual Sound     *findSoundByRef(const AssetRef &ref) override;
 
 
     private:
 
+        // key is dbIndex << 16 | assetId
+        template <typename _AssetType>
+        using AssetCache = std::unordered_map<uint32_t, osg::ref_ptr<_AssetType>>;
+
+        /**
+         * Resolves a reference via the dense dependency table and the database's typed factory. Resolved assets are
+         * cached for the lifetime of the level, so repeated lookups of the same ref are a single hash lookup. Returns
+         * nullptr if the dependency, it's container or the asset does not exist.
+         */
+        template <typename _AssetType>
+        _AssetType *_findAssetByRef(const AssetRef &ref, AssetCache<_AssetType> &cache);
+
         void _loadNameAndDeps(SrscFile &file);
         void _loadLayers(SrscFile &file);
         void _loadLayerGroups(SrscFile &file);
         void _loadObjects(SrscFile &file);
+        void _bakeLayerLighting();
 
 
         FilePath mLevelPath;
@@ -79,7 +116,13 @@ namespace od
         std::string mLevelName;
         uint32_t mMaxWidth;
         uint32_t mMaxHeight;
-        std::map<uint16_t, DbRefWrapper> mDependencyMap;
+        std::vector<Database*> mDependencies; // indexed by dbIndex. nullptr for unused indices
+        AssetCache<Texture> mTextureCache;
+        AssetCache<Class> mClassCache;
+        AssetCache<Model> mModelCache;
+        AssetCache<Sequence> mSequenceCache;
+        AssetCache<Animation> mAnimationCache;
+        AssetCache<Sound> mSoundCache;
         std::vector<osg::ref_ptr<Layer>> mLayers;
         std::vector<osg::ref_ptr<LevelObject>> mLevelObjects;
         osg::ref_ptr<osg::Group> mLevelRootNode;
@@ -87,6 +130,12 @@ namespace od
         osg::ref_ptr<osg::Group> mObjectGroup;
         osg::ref_ptr<osg::Light> mSunLight;
 		PhysicsManager mPhysicsManager;
+		ObjectStreamer mObjectStreamer;
+		LayerVisibility mLayerVisibility;
+		MessageDispatcher mMessageDispatcher;
+		InstanceManager mInstanceManager;
+		CpuSkinner mCpuSkinner;
+		std::vector<LevelObject*> mSkinnedObjects;
 
 		std::deque<osg::ref_ptr<LevelObject>> mDestructionQueue;
     };
@@ -17,7 +17,10 @@
 
 #include "db/Class.h"
 #include "anim/SkeletonAnimationPlayer.h"
+#include "anim/CpuSkinner.h"
 #include "rfl/RflMessage.h"
+#include "UpdateScheduler.h"
+#include "InstanceManager.h"
 
 namespace od
 {
@@ -42,7 +45,7 @@ namespace od
         Always
     };
 
-    class LevelObject : public osg::Group, public btMotionState
+    class LevelObject : public osg::Group, public btMotionState, public Updatable
     {
     public:
 
@@ -58,16 +61,19 @@ namespace od
         inline osg::Quat getRotation() const { return mTransform->getAttitude(); }
         inline osg::PositionAttitudeTransform *getPositionAttitudeTransform() { return mTransform; }
         inline osg::Group *getSkeletonRoot() { return mSkeletonRoot; }
+        inline Layer *getLightingLayer() { return mLightingLayer; }
         inline LevelObjectState getState() const { return mState; }
+        inline SpawnStrategy getSpawnStrategy() const { return mSpawnStrategy; }
         inline void setSpawnStrategy(SpawnStrategy s) { mSpawnStrategy = s; }
         inline const std::vector<osg::ref_ptr<LevelObject>> &getLinkedObjects() const { return mLinkedObjects; }
         inline bool isVisible() const { return mIsVisible; }
+        inline bool isInstanced() const { return mInstanceId != InstanceManager::INVALID_INSTANCE; }
+        inline CpuSkinner::Instance *getSkinningInstance() { return mSkinningInstance; }
 
         void loadFromRecord(DataReader dr);
         void spawned();
         void despawned();
         void destroyed();
-        void update(double simTime, double relTime);
         void messageReceived(LevelObject &sender, odRfl::RflMessage message);
 
         void setPosition(const osg::Vec3f &v);
@@ -114,17 +120,44 @@ namespace od
         /**
          * @brief Enables or disables the RFL update hook.
          *
-         * Do not disable the update callback by calling this method from the update hook itself! Doing so messes with
-         * OSG's update traversal and will likely cause it to segfault.
+         * The hook is run by the engine's UpdateScheduler in the RFL phase. It is safe to call this from within the hook.
          */
         void setEnableRflUpdateHook(bool enableHook);
+
+        /**
+         * @brief Sets how often the RFL update hook is called.
+         *
+         * If the hook is disabled, the tier is remembered and applied once it gets enabled.
+         */
+        void setUpdateTier(UpdateTier tier);
+
+        /**
+         * @brief Posts \c message to all linked objects. Messages are delivered in the messaging phase, not immediately.
+         */
         void messageAllLinkedObjects(odRfl::RflMessage message);
         void requestDestruction();
 
+        /**
+         * @brief Skins this object on the CPU with the bone matrices computed by \c player, while it is spawned.
+         *
+         * The skinned mesh replaces the bind pose bounds of the object's skinned drawables, so the object is culled by where
+         * the animation actually moved it's vertices, and is what the PhysicsManager's raycasts hit. Only works on objects
+         * with a skeleton.
+         */
+        void enableCpuSkinning(SkeletonAnimationPlayer &player);
+
+        /**
+         * @brief Called by the level after every skinning pass. Marks the bounds of the skinned drawables as dirty.
+         */
+        void skinningUpdated();
+
         // override osg::Group
         virtual const char *libraryName() const override { return "od";    }
         virtual const char *className()   const override { return "LevelObject"; }
 
+        // implement Updatable
+        virtual void update(double simTime, double relTime) override;
+
         // implement btMotionState
         virtual void getWorldTransform(btTransform& worldTrans) const override;
         virtual void setWorldTransform(const btTransform& worldTrans) override;
@@ -135,6 +168,9 @@ namespace od
         void _attachmentTargetPositionUpdated();
         void _detachAllAttachedObjects();
         void _setVisible(bool b); // just so we can switch visibility internally without producing logs everytime
+        bool _canBeInstanced();
+        void _stopInstancing();
+        void _makeDynamic(); // takes object out of instancing so it can be moved or hidden on it's own
 
 
         Level &mLevel;
@@ -164,7 +200,12 @@ namespace od
         bool mIgnoreAttachmentRotation;
         std::list<osg::ref_ptr<od::LevelObject>> mAttachedObjects;
 
-        osg::ref_ptr<osg::NodeCallback> mUpdateCallback;
+        bool mRflUpdateHookEnabled;
+        UpdateTier mUpdateTier;
+        InstanceId mInstanceId;
+
+        osg::ref_ptr<CpuSkinner::Instance> mSkinningInstance;
+        std::vector<osg::ref_ptr<osg::Drawable>> mSkinnedDrawables;
     };
 
 }
@@ -12,6 +12,9 @@
 #include <sstream>
 #include <string>
 #include <vector>
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 //namespace od
 //{
@@ -19,27 +22,37 @@
 
     class Logger;
 
+    class AsyncLogWriter;
+
+    /**
+     * @brief Collects one log message and hands it to the Logger once the statement ends.
+     *
+     * A proxy for a level that the logger would discard is inert: it does not touch any buffer and all insertions
+     * are no-ops, so disabled log statements cost no formatting. Formatting happens in a per-thread buffer.
+     */
     class LoggerStreamProxy
 	{
     	friend class Logger;
 
 	public:
 
+		LoggerStreamProxy(LoggerStreamProxy &&p);
+		LoggerStreamProxy(const LoggerStreamProxy &p) = delete;
 		~LoggerStreamProxy();
 
+		inline bool isEnabled() const { return mBuffer != nullptr; }
+
 		template <typename T>
-		LoggerStreamProxy operator<<(const T &t);
+		LoggerStreamProxy &operator<<(const T &t);
 
 
 	private:
 
-		LoggerStreamProxy(Logger &l);
-		LoggerStreamProxy(LoggerStreamProxy &p);
-		LoggerStreamProxy(LoggerStreamProxy &&p);
-
+		LoggerStreamProxy(Logger *l, int level); // pass nullptr as logger to create an inert proxy
 
-		Logger &mLogger;
-		bool mIWasCopied;
+		Logger *mLogger;
+		int mLevel;
+		std::ostringstream *mBuffer;
 	};
 
 
@@ -47,6 +60,7 @@
 	class Logger
 	{
     	friend class LoggerStreamProxy;
+    	friend class AsyncLogWriter;
 
 	public:
 
@@ -62,15 +76,44 @@
 
 
 		Logger(LogLevel outputLogLevel, std::ostream *stream = &std::cout);
+		~Logger();
 
 		void log(const std::string &msg, LogLevel level);
 
+		/**
+		 * @brief Returns true if messages of the given level would produce any output.
+		 *
+		 * This is a single relaxed atomic load and can be used to guard expensive preparation of log messages.
+		 */
+		inline bool isLevelEnabled(LogLevel level) const { return level <= mOutputLogLevel.load(std::memory_order_relaxed); }
+
         void setEnableTimestamp(bool ts);
         void setOutputLogLevel(LogLevel level);
         void setOutputStream(std::ostream *s);
         void setChildLogger(Logger *l);
         void addListener(ILoggerListener *listener);
         void removeListener(ILoggerListener *listener);
+
+        /**
+         * @brief Enables or disables writing log messages on a background thread.
+         *
+         * When enabled, log() only pushes the message into a lock-free ring buffer and returns. If the buffer is full,
+         * the message is dropped and counted. Output, child loggers and listeners are then serviced on the writer thread.
+         * Disabling the writer flushes all pending messages first.
+         */
+        void setAsync(bool async, size_t queueCapacity = 4096);
+        bool isAsync() const;
+
+        /**
+         * @brief Blocks until all messages pushed so far have been written. No-op for synchronous loggers.
+         */
+        void flush();
+
+        /**
+         * @brief Number of messages dropped because the async queue was full.
+         */
+        inline size_t getDroppedCount() const { return mDroppedCount.load(std::memory_order_relaxed); }
+
         /**
          * Should be 4 characters (looks nice and tidy)
          */
@@ -87,24 +130,28 @@
 		static inline void error(const std::string &msg) { getDefaultLogger().log(msg, LOGLEVEL_ERROR); }
 
 		// default stream getters
-		static LoggerStreamProxy debug();
-		static LoggerStreamProxy verbose();
-		static LoggerStreamProxy info();
-		static LoggerStreamProxy warn();
-		static LoggerStreamProxy error();
+		static inline LoggerStreamProxy debug() { return getDefaultLogger()._makeProxy(LOGLEVEL_DEBUG); }
+		static inline LoggerStreamProxy verbose() { return getDefaultLogger()._makeProxy(LOGLEVEL_VERBOSE); }
+		static inline LoggerStreamProxy info() { return getDefaultLogger()._makeProxy(LOGLEVEL_INFO); }
+		static inline LoggerStreamProxy warn() { return getDefaultLogger()._makeProxy(LOGLEVEL_WARNING); }
+		static inline LoggerStreamProxy error() { return getDefaultLogger()._makeProxy(LOGLEVEL_ERROR); }
 
 
 	private:
 
-		void _flushLogStream();
+		inline LoggerStreamProxy _makeProxy(LogLevel level) { return LoggerStreamProxy(isLevelEnabled(level) ? this : nullptr, level); }
+		void _submit(std::string &&msg, LogLevel level);
+		void _write(const std::string &msg, LogLevel level);
 
 		bool mEnableTimestamp;
 		std::ostream *mStream;
 		Logger *mChildLogger;
 		std::vector<ILoggerListener*> mListeners;
-		LogLevel mStreamLogLevel; // as inserted by the stream operator <<
-		LogLevel mOutputLogLevel;
-		std::ostringstream mStreamBuffer;
+		std::atomic<LogLevel> mStreamLogLevel; // as inserted by the stream operator <<
+		std::atomic<LogLevel> mOutputLogLevel;
+		std::atomic<size_t> mDroppedCount;
+		std::mutex mWriteMutex;
+		std::unique_ptr<AsyncLogWriter> mAsyncWriter;
 
 		static Logger smDefaultLogger;
 
@@ -125,9 +172,12 @@
 
 
 	template <typename T>
-	LoggerStreamProxy LoggerStreamProxy::operator<<(const T &t)
+	LoggerStreamProxy &LoggerStreamProxy::operator<<(const T &t)
 	{
-		mLogger.mStreamBuffer << t;
+		if(mBuffer != nullptr)
+		{
+			*mBuffer << t;
+		}
 
 		return *this;
 	}
@@ -140,9 +190,10 @@
 	template <typename T>
     LoggerStreamProxy Logger::operator<<(const T &t)
 	{
-		mStreamBuffer << t;
+		LoggerStreamProxy p = _makeProxy(mStreamLogLevel.load(std::memory_order_relaxed));
+		p << t;
 
-		return LoggerStreamProxy(*this);
+		return p;
 	}
 //}
 
@@ -0,0 +1,131 @@
+/*
+ * MeshSimplifier.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_MESHSIMPLIFIER_H_
+#define INCLUDE_MESHSIMPLIFIER_H_
+
+#include <vector>
+#include <string>
+#include <queue>
+#include <functional>
+#include <osg/Vec2f>
+#include <osg/Vec3f>
+
+#include "GeodeBuilder.h"
+
+namespace od
+{
+
+    /**
+     * @brief Reduces the triangle count of Riot engine meshes using quadric error metrics.
+     *
+     * Takes the same vertex, polygon and bone affection vectors as the GeodeBuilder and produces smaller versions of
+     * them that can be fed right back into one. Edges are collapsed onto one of their vertices in order of the
+     * smallest quadric error, so no new vertices are created.
+     *
+     * Vertices on the border of the mesh, on UV seams and on texture boundaries are never removed, so textures stay
+     * in place and holes don't grow. Vertices are only collapsed onto vertices with similar bone weights, and
+     * collapses that would flip a triangle or fold the mesh over itself are rejected.
+     *
+     * Simplification can be continued with smaller targets to create a series of LODs. Each step is O(n*log(n)).
+     */
+    class MeshSimplifier
+    {
+    public:
+
+        MeshSimplifier(const std::string &modelName);
+
+        void setVertexVector(std::vector<osg::Vec3f>::iterator begin, std::vector<osg::Vec3f>::iterator end);
+        void setPolygonVector(std::vector<Polygon>::iterator begin, std::vector<Polygon>::iterator end);
+        void setBoneAffectionVector(std::vector<BoneAffection>::iterator begin, std::vector<BoneAffection>::iterator end);
+
+        /**
+         * @brief Collapses edges until at most \c targetTriangles triangles remain or no more edges can be collapsed.
+         *
+         * Needs vertices and polygons to be set. May be called again with a smaller target to continue.
+         */
+        void simplify(size_t targetTriangles);
+
+        inline size_t getTriangleCount() const { return mTriangleCount; }
+        inline size_t getOriginalTriangleCount() const { return mOriginalTriangleCount; }
+
+        /// Upper bound of the distance between the simplified and the original surface, in model units.
+        float getError() const;
+
+        /**
+         * @brief Writes the current state of the mesh. Only vertices that are still in use are written and indices are
+         * adjusted accordingly.
+         */
+        void getResult(std::vector<osg::Vec3f> &vertices, std::vector<Polygon> &polygons, std::vector<BoneAffection> &boneAffections);
+
+
+    private:
+
+        struct Quadric
+        {
+            Quadric();
+            Quadric(const osg::Vec3f &normal, float d);
+
+            Quadric &operator+=(const Quadric &q);
+            double evaluate(const osg::Vec3f &v) const;
+
+            double m[10]; // upper triangle of the symmetric 4x4 matrix
+        };
+
+        struct Triangle
+        {
+            size_t vertexIndices[3];
+            osg::Vec2f uvCoords[3];
+            AssetRef texture;
+            bool doubleSided;
+            bool alive;
+        };
+
+        struct Vertex
+        {
+            osg::Vec3f position;
+            Quadric quadric;
+            std::vector<size_t> triangles;
+            std::vector<std::pair<size_t, float>> bones; // sorted by joint
+            uint32_t version;
+            bool alive;
+            bool locked;
+        };
+
+        struct Collapse
+        {
+            double cost;
+            size_t from;
+            size_t to;
+            uint32_t fromVersion;
+            uint32_t toVersion;
+
+            inline bool operator>(const Collapse &c) const { return cost > c.cost; }
+        };
+
+        void _prepare();
+        void _pushCollapses(size_t vertexIndex);
+        void _pushCollapse(size_t from, size_t to);
+        bool _canCollapse(size_t from, size_t to, osg::Vec2f &newUv);
+        bool _bonesCompatible(const Vertex &a, const Vertex &b);
+        void _collapse(size_t from, size_t to, const osg::Vec2f &newUv);
+        void _getNeighbours(size_t vertexIndex, std::vector<size_t> &neighbours);
+
+        std::string mModelName;
+        std::vector<Vertex> mVertices;
+        std::vector<Triangle> mTriangles;
+        std::vector<BoneAffection> mBoneAffections;
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> mCollapses;
+        size_t mTriangleCount;
+        size_t mOriginalTriangleCount;
+        double mMaxCost;
+        bool mPrepared;
+    };
+
+}
+
+#endif /* INCLUDE_MESHSIMPLIFIER_H_ */
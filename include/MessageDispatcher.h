@@ -0,0 +1,96 @@
+/*
+ * MessageDispatcher.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_MESSAGEDISPATCHER_H_
+#define INCLUDE_MESSAGEDISPATCHER_H_
+
+#include <deque>
+#include <cstdint>
+#include <unordered_map>
+#include <ostream>
+#include <osg/ref_ptr>
+
+#include "UpdateScheduler.h"
+#include "rfl/RflMessage.h"
+
+namespace od
+{
+
+    class LevelObject;
+
+    /**
+     * @brief Per-frame queue for RFL messages sent between level objects.
+     *
+     * Messages are not delivered when posted, but in the messaging phase of the UpdateScheduler. Messages posted while
+     * dispatching (e.g. a counter reacting to a timer) are delivered in the next frame, so trigger chains never recurse
+     * and at most a fixed number of messages is delivered per frame.
+     *
+     * If the receiving RFL class allows it, a message is dropped when the same message is the last one still pending for
+     * that receiver. Messages queued in between (e.g. a Hide between two Shows) are never skipped over.
+     */
+    class MessageDispatcher : public Updatable
+    {
+    public:
+
+        struct Stats
+        {
+            size_t dispatchedLastFrame;
+            size_t postedLastFrame;
+            size_t queueDepth;
+            size_t maxQueueDepth;
+            size_t totalDispatched;
+            size_t totalCollapsed;
+        };
+
+        MessageDispatcher(UpdateScheduler &scheduler);
+        ~MessageDispatcher();
+
+        inline size_t getBatchLimit() const { return mBatchLimit; }
+        inline void setBatchLimit(size_t limit) { mBatchLimit = limit; }
+        inline const Stats &getStats() const { return mStats; }
+
+        void post(LevelObject &sender, LevelObject &receiver, odRfl::RflMessage message);
+
+        /**
+         * @brief Drops all pending messages without delivering them.
+         */
+        void clear();
+
+        void dumpStats(std::ostream &out) const;
+
+        // implement Updatable
+        virtual void update(double simTime, double relTime) override;
+
+
+    private:
+
+        struct PendingMessage
+        {
+            osg::ref_ptr<LevelObject> sender;
+            osg::ref_ptr<LevelObject> receiver;
+            odRfl::RflMessage message;
+            uint64_t sequence;
+        };
+
+        struct LastPending
+        {
+            odRfl::RflMessage message;
+            uint64_t sequence;
+        };
+
+        UpdateScheduler &mScheduler;
+        std::deque<PendingMessage> mQueue;
+        std::unordered_map<LevelObject*, LastPending> mLastPending; // most recently queued message per receiver
+        uint64_t mNextSequence;
+        size_t mBatchLimit;
+        size_t mPostedSinceDispatch;
+        Stats mStats;
+    };
+
+}
+
+#endif /* INCLUDE_MESSAGEDISPATCHER_H_ */
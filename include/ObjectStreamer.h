@@ -0,0 +1,117 @@
+/*
+ * ObjectStreamer.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_OBJECTSTREAMER_H_
+#define INCLUDE_OBJECTSTREAMER_H_
+
+#include <vector>
+#include <deque>
+#include <osg/Group>
+#include <osg/Timer>
+
+#include "SpatialGrid.h"
+
+namespace od
+{
+
+    class LevelObject;
+
+    /**
+     * @brief Spawns and despawns level objects with SpawnStrategy::WhenInSight based on their distance to an observer.
+     *
+     * Objects are spawned once they come within the spawn radius and despawned once they leave the (larger) despawn
+     * radius, so objects hovering around the border won't flicker in and out every frame. At most a fixed number of
+     * objects is spawned per frame; the rest stays queued for the following frames.
+     *
+     * Objects within the prefetch radius get their referenced assets loaded ahead of time, again only a few per frame,
+     * so spawning them later does not stall on asset loading.
+     *
+     * Spawned objects beyond the low frequency radius get their RFL update hook moved to the scheduler's low frequency tier.
+     */
+    class ObjectStreamer
+    {
+    public:
+
+        ObjectStreamer(osg::Group *objectGroup);
+        ~ObjectStreamer();
+
+        inline float getSpawnRadius() const { return mSpawnRadius; }
+        inline float getDespawnRadius() const { return mDespawnRadius; }
+        inline float getPrefetchRadius() const { return mPrefetchRadius; }
+        inline float getLowFrequencyRadius() const { return mLowFrequencyRadius; }
+        inline void setLowFrequencyRadius(float r) { mLowFrequencyRadius = r; }
+        inline void setSpawnBudget(size_t b) { mSpawnBudget = b; }
+        inline void setPrefetchBudget(size_t b) { mPrefetchBudget = b; }
+        inline size_t getStreamedObjectCount() const { return mEntries.size(); }
+        inline size_t getSpawnedObjectCount() const { return mSpawnedEntries.size(); }
+        inline size_t getPendingSpawnCount() const { return mSpawnQueue.size(); }
+        inline size_t getTotalSpawnCount() const { return mTotalSpawnCount; }
+        inline size_t getTotalDespawnCount() const { return mTotalDespawnCount; }
+        inline double getMaxSpawnLatency() const { return mMaxSpawnLatency; }
+        inline double getAverageSpawnLatency() const { return (mTotalSpawnCount > 0) ? mSpawnLatencySum/mTotalSpawnCount : 0.0; }
+
+        /**
+         * @brief Sets streaming radii in world units. Despawn and prefetch radii are clamped to be at least the spawn radius.
+         */
+        void setRadii(float spawnRadius, float despawnRadius, float prefetchRadius);
+
+        void addObject(LevelObject *obj);
+
+        /**
+         * @brief Spawns all objects in range of \c observerPosition and despawns those that went out of range.
+         */
+        void update(const osg::Vec3f &observerPosition);
+
+        /**
+         * @brief Immediately spawns every streamed object, ignoring the spawn budget.
+         */
+        void spawnAll();
+
+        void despawnAll();
+
+
+    private:
+
+        struct Entry
+        {
+            osg::ref_ptr<LevelObject> object;
+            osg::Vec3f gridPosition;
+            osg::Timer_t requestTick;
+            bool spawnQueued;
+            bool prefetchQueued;
+            bool prefetched;
+            bool lowFrequency;
+        };
+
+        void _spawn(size_t entryIndex);
+        void _despawn(size_t entryIndex);
+        void _prefetch(size_t entryIndex);
+
+        osg::ref_ptr<osg::Group> mObjectGroup;
+
+        float mSpawnRadius;
+        float mDespawnRadius;
+        float mPrefetchRadius;
+        float mLowFrequencyRadius;
+        size_t mSpawnBudget;
+        size_t mPrefetchBudget;
+
+        std::vector<Entry> mEntries;
+        SpatialGrid<size_t> mGrid;
+        std::vector<size_t> mSpawnedEntries;
+        std::deque<size_t> mSpawnQueue;
+        std::deque<size_t> mPrefetchQueue;
+
+        size_t mTotalSpawnCount;
+        size_t mTotalDespawnCount;
+        double mSpawnLatencySum;
+        double mMaxSpawnLatency;
+    };
+
+}
+
+#endif /* INCLUDE_OBJECTSTREAMER_H_ */
@@ -16,9 +16,34 @@
 #define OD_SHADER_DEFAULT_VERTEX   "default_vertex.glsl"
 #define OD_SHADER_DEFAULT_FRAGMENT "default_fragment.glsl"
 #define OD_SHADER_RIGGED_VERTEX    "rigged_vertex.glsl"
+#define OD_SHADER_INSTANCED_VERTEX "instanced_vertex.glsl"
 
+// comparing RFL field names to those in records is slow. do it for every instance only in debug builds
+#if !defined(NDEBUG) && !defined(OD_RFL_CHECK_FIELD_NAMES)
+#   define OD_RFL_CHECK_FIELD_NAMES
+#endif
+
+// bones per draw call. must match the size of the bones array in the rigging shader. skinned meshes using more bones are split
 #define OD_MAX_BONE_COUNT 64
 #define OD_ATTRIB_INFLUENCE_LOCATION 4
 #define OD_ATTRIB_WEIGHT_LOCATION 5
 
+// model UVs are stored as 16 bit fixed point in the compact vertex format. the number of fractional bits is the largest
+//  in this range that fits all UVs of a model. models with larger UVs than that allows keep float UVs
+#define OD_COMPACT_UV_MAX_FRACTIONAL_BITS 12
+#define OD_COMPACT_UV_MIN_FRACTIONAL_BITS 8
+
+// layers are split into square tiles of this many cells per side so parts of big layers can be culled. 0 disables tiling
+#define OD_LAYER_DEFAULT_TILE_SIZE 16
+
+// reduced layer tile levels are used as long as their height error stays below this many pixels on screen. 0 disables layer LOD
+#define OD_LAYER_DEFAULT_LOD_PIXEL_ERROR 2.0f
+
+// models without authored LODs get up to this many generated ones, each with half the triangles of the one before.
+//  the first one is used beyond the given multiple of the model's bounding radius, each further one at twice the distance
+#define OD_MODEL_AUTO_LOD_COUNT 3
+#define OD_MODEL_DEFAULT_AUTO_LOD_DISTANCE 16.0f
+#define OD_MODEL_AUTO_LOD_MIN_TRIANGLES 64
+#define OD_MODEL_AUTO_LOD_MIN_REDUCTION 0.75
+
 #endif /* INCLUDE_ODDEFINES_H_ */
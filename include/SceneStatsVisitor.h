@@ -0,0 +1,67 @@
+/*
+ * SceneStatsVisitor.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_SCENESTATSVISITOR_H_
+#define INCLUDE_SCENESTATSVISITOR_H_
+
+#include <vector>
+#include <ostream>
+#include <osg/NodeVisitor>
+#include <osg/Geode>
+
+namespace od
+{
+
+    /**
+     * @brief Counts drawables and primitives in a scene graph by how they are rendered.
+     *
+     * The render class of a drawable is determined by the state sets on it's path: drawables in the depth sorted bin
+     * are counted as sorted, drawables with alpha test enabled as alpha tested and everything else as opaque. Only
+     * active children are traversed, so hidden layers and despawned objects don't show up.
+     *
+     * Shared subgraphs are counted once per path, matching the number of draw calls issued for them.
+     */
+    class SceneStatsVisitor : public osg::NodeVisitor
+    {
+    public:
+
+        enum class RenderClass
+        {
+            Opaque,
+            AlphaTested,
+            Sorted,
+            Count
+        };
+
+        struct ClassStats
+        {
+            size_t drawables;
+            size_t primitives;
+        };
+
+        SceneStatsVisitor();
+
+        inline const ClassStats &getStats(RenderClass rc) const { return mStats[static_cast<size_t>(rc)]; }
+
+        void dumpStats(std::ostream &out) const;
+
+        virtual void reset() override;
+        virtual void apply(osg::Node &node) override;
+        virtual void apply(osg::Geode &geode) override;
+
+
+    private:
+
+        RenderClass _classify(const osg::StateSet *ss, RenderClass inherited) const;
+
+        std::vector<RenderClass> mClassStack;
+        ClassStats mStats[static_cast<size_t>(RenderClass::Count)];
+    };
+
+}
+
+#endif /* INCLUDE_SCENESTATSVISITOR_H_ */
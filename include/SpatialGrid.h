@@ -0,0 +1,157 @@
+/*
+ * SpatialGrid.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_SPATIALGRID_H_
+#define INCLUDE_SPATIALGRID_H_
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <osg/Vec3f>
+
+namespace od
+{
+
+    /**
+     * @brief Sparse uniform grid over the horizontal (XZ) plane.
+     *
+     * Items are binned by the cell their position falls into. Only non-empty cells are stored, so this works
+     * for levels of arbitrary extent. Queries return every item in all cells touched by the query area; callers
+     * are expected to do the exact distance check themselves.
+     */
+    template <typename T>
+    class SpatialGrid
+    {
+    public:
+
+        typedef uint64_t CellKey;
+
+        SpatialGrid(float cellSize)
+        : mCellSize(cellSize)
+        , mItemCount(0)
+        {
+        }
+
+        inline float getCellSize() const { return mCellSize; }
+        inline size_t getItemCount() const { return mItemCount; }
+        inline size_t getCellCount() const { return mCells.size(); }
+
+        CellKey getCellKey(const osg::Vec3f &pos) const
+        {
+            return _makeKey(_toCell(pos.x()), _toCell(pos.z()));
+        }
+
+        void insert(const T &item, const osg::Vec3f &pos)
+        {
+            mCells[getCellKey(pos)].push_back(item);
+            ++mItemCount;
+        }
+
+        /**
+         * @brief Removes item from the cell corresponding to \c pos. Returns false if it was not found there.
+         */
+        bool remove(const T &item, const osg::Vec3f &pos)
+        {
+            auto cellIt = mCells.find(getCellKey(pos));
+            if(cellIt == mCells.end())
+            {
+                return false;
+            }
+
+            std::vector<T> &cell = cellIt->second;
+            auto it = std::find(cell.begin(), cell.end(), item);
+            if(it == cell.end())
+            {
+                return false;
+            }
+
+            *it = cell.back();
+            cell.pop_back();
+            --mItemCount;
+
+            if(cell.empty())
+            {
+                mCells.erase(cellIt);
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Moves item between cells if \c oldPos and \c newPos fall into different ones.
+         */
+        void move(const T &item, const osg::Vec3f &oldPos, const osg::Vec3f &newPos)
+        {
+            if(getCellKey(oldPos) == getCellKey(newPos))
+            {
+                return;
+            }
+
+            if(remove(item, oldPos))
+            {
+                insert(item, newPos);
+            }
+        }
+
+        /**
+         * @brief Calls \c f for every item in cells overlapping the square of half-size \c radius around \c center.
+         */
+        template <typename F>
+        void query(const osg::Vec3f &center, float radius, F f) const
+        {
+            int32_t minX = _toCell(center.x() - radius);
+            int32_t maxX = _toCell(center.x() + radius);
+            int32_t minZ = _toCell(center.z() - radius);
+            int32_t maxZ = _toCell(center.z() + radius);
+
+            for(int32_t x = minX; x <= maxX; ++x)
+            {
+                for(int32_t z = minZ; z <= maxZ; ++z)
+                {
+                    auto cellIt = mCells.find(_makeKey(x, z));
+                    if(cellIt == mCells.end())
+                    {
+                        continue;
+                    }
+
+                    for(auto it = cellIt->second.begin(); it != cellIt->second.end(); ++it)
+                    {
+                        f(*it);
+                    }
+                }
+            }
+        }
+
+        void clear()
+        {
+            mCells.clear();
+            mItemCount = 0;
+        }
+
+
+    private:
+
+        inline int32_t _toCell(float v) const
+        {
+            return static_cast<int32_t>(std::floor(v/mCellSize));
+        }
+
+        static inline CellKey _makeKey(int32_t x, int32_t z)
+        {
+            return (static_cast<CellKey>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(z);
+        }
+
+        float mCellSize;
+        size_t mItemCount;
+        std::unordered_map<CellKey, std::vector<T>> mCells;
+    };
+
+}
+
+#endif /* INCLUDE_SPATIALGRID_H_ */
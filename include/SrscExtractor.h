@@ -0,0 +1,78 @@
+/*
+ * SrscExtractor.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_SRSCEXTRACTOR_H_
+#define INCLUDE_SRSCEXTRACTOR_H_
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "SrscFile.h"
+
+namespace od
+{
+
+    class Engine;
+
+    /**
+     * @brief Extracts many records of an SRSC file in parallel.
+     *
+     * Every worker thread opens it's own handle to the file, so no stream is ever shared between threads. Records are
+     * handed out in small batches in file order, which keeps reads mostly sequential and balances load if record sizes
+     * vary wildly (as they do in level files).
+     *
+     * If enabled, textures, sounds and models are converted to PNG, WAV and OBJ files by the workers. Each worker decodes
+     * them with it's own asset factories reading through it's own file handle. Records that can't be converted are
+     * extracted as if conversion was disabled.
+     */
+    class SrscExtractor
+    {
+    public:
+
+        struct Stats
+        {
+            size_t recordCount;
+            size_t convertedCount;
+            size_t threadCount;
+            uint64_t bytesRead;
+            uint64_t bytesWritten;
+            double seconds;
+        };
+
+        /**
+         * The engine is only used to construct the asset factories for conversion. It does not need to be set up.
+         */
+        SrscExtractor(Engine &engine, const FilePath &srscPath, const std::string &prefix, bool extractRaw);
+
+        inline size_t getThreadCount() const { return mThreadCount; }
+        inline bool getConvertAssets() const { return mConvertAssets; }
+        inline void setConvertAssets(bool b) { mConvertAssets = b; }
+
+        /**
+         * @brief Sets the number of worker threads. 0 means one per hardware thread.
+         */
+        void setThreadCount(size_t threadCount);
+
+        Stats extract(const std::vector<SrscFile::DirEntry> &entries);
+
+        static void printStats(const Stats &stats, std::ostream &out);
+
+
+    private:
+
+        Engine &mEngine;
+        FilePath mSrscPath;
+        std::string mPrefix;
+        bool mExtractRaw;
+        bool mConvertAssets;
+        size_t mThreadCount;
+    };
+
+}
+
+#endif /* INCLUDE_SRSCEXTRACTOR_H_ */
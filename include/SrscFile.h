@@ -11,6 +11,7 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <memory>
 
 #include "FilePath.h"
 #include "DataStream.h"
@@ -39,6 +40,14 @@ namespace od
 		typedef std::vector<DirEntry>::iterator DirIterator;
 
 		SrscFile(const FilePath &filePath);
+
+		/**
+		 * @brief Creates an SRSC file reading from \c stream instead of opening \c filePath.
+		 *
+		 * If \c directory is not nullptr, it is used as the file's directory instead of reading the header and
+		 * directory from the stream (e.g. when the directory comes from an archive index).
+		 */
+		SrscFile(const FilePath &filePath, std::unique_ptr<std::istream> stream, uint16_t version = 0, const std::vector<DirEntry> *directory = nullptr);
 		~SrscFile();
 
 		inline const FilePath &getFilePath() const { return mFilePath; }
@@ -69,17 +78,29 @@ namespace od
 		inline std::istream &getStreamForRecordType(SrscRecordType type) { return getStreamForRecord(getDirIteratorByType(static_cast<RecordType>(type))); }
 		inline std::istream &getStreamForRecordTypeId(SrscRecordType type, RecordId id) { return getStreamForRecord(getDirIteratorByTypeId(static_cast<RecordType>(type), id)); }
 
+		/**
+		 * @brief Reads the whole record into \c data using block reads.
+		 */
+		void readRecordData(const DirEntry &dirEntry, std::vector<char> &data);
+
 		void decompressAll(const std::string &prefix, bool extractRaw);
 		void decompressRecord(const std::string &prefix, const DirEntry &dirEntry, bool extractRaw);
 		inline void decompressRecord(const std::string &prefix, const DirIterator &dirIt, bool extractRaw) { decompressRecord(prefix, *dirIt, extractRaw); }
 
+		/**
+		 * @brief Writes record data read via readRecordData() to a file named after the record. Returns the number of bytes written.
+		 *
+		 * If \c extractRaw is false, all zlib streams embedded in the record are written inflated.
+		 */
+		static size_t writeRecordData(const std::string &prefix, const DirEntry &dirEntry, const std::vector<char> &data, bool extractRaw);
+
 
 	protected:
 
 		void _readHeaderAndDirectory();
 
 		FilePath mFilePath;
-		std::ifstream mInputStream;
+		std::unique_ptr<std::istream> mInputStream;
 
 		uint16_t mVersion;
 		uint32_t mDirectoryOffset;
@@ -0,0 +1,106 @@
+/*
+ * TimerWheel.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_TIMERWHEEL_H_
+#define INCLUDE_TIMERWHEEL_H_
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+#include "UpdateScheduler.h"
+
+namespace od
+{
+
+    typedef uint64_t TimerHandle;
+
+    /**
+     * @brief Hierarchical timer wheel for scheduling callbacks at absolute sim times.
+     *
+     * Scheduling and cancelling are O(1). Advancing costs O(1) per elapsed tick plus the number of expired timers,
+     * regardless of how many timers are pending, so dormant timers cost nothing per frame.
+     *
+     * Callbacks are never fired early, but may fire up to one tick late. Callbacks may schedule or cancel timers.
+     */
+    class TimerWheel : public Updatable
+    {
+    public:
+
+        typedef std::function<void()> Callback;
+
+        static const TimerHandle INVALID_HANDLE = 0;
+
+        TimerWheel(double tickLength = 0.01);
+        TimerWheel(const TimerWheel &) = delete;
+
+        inline double getTickLength() const { return mTickLength; }
+        inline double getCurrentTime() const { return mCurrentTick*mTickLength; }
+        inline size_t getPendingCount() const { return mPendingCount; }
+
+        /**
+         * @brief Schedules \c callback to be called once sim time reaches \c simTime.
+         */
+        TimerHandle schedule(double simTime, const Callback &callback);
+
+        /**
+         * @brief Schedules \c callback to be called after \c delay seconds from the time the wheel was last advanced to.
+         */
+        TimerHandle scheduleIn(double delay, const Callback &callback);
+
+        /**
+         * @brief Cancels a pending timer. Returns false if the handle was invalid or the timer already fired.
+         */
+        bool cancel(TimerHandle handle);
+        bool isPending(TimerHandle handle) const;
+
+        void advance(double simTime);
+
+        // implement Updatable
+        virtual void update(double simTime, double relTime) override;
+
+
+    private:
+
+        static const size_t LEVEL_BITS = 6;
+        static const size_t SLOT_COUNT = 1 << LEVEL_BITS;
+        static const size_t SLOT_MASK = SLOT_COUNT - 1;
+        static const size_t LEVEL_COUNT = 4;
+        static const int32_t NO_NODE = -1;
+
+        struct Node
+        {
+            uint64_t expiryTick;
+            Callback callback;
+            uint32_t generation;
+            int32_t prev;
+            int32_t next;
+            int32_t level; // -1 if not linked into any slot
+            uint32_t slot;
+            bool active;
+        };
+
+        uint32_t _allocNode();
+        void _freeNode(uint32_t index);
+        TimerHandle _makeHandle(uint32_t index) const;
+        void _link(uint32_t index);
+        void _unlink(uint32_t index);
+        void _cascade(size_t level, size_t slot);
+
+        double mTickLength;
+        uint64_t mCurrentTick;
+        size_t mPendingCount;
+
+        std::vector<Node> mNodes;
+        std::vector<uint32_t> mFreeNodes;
+        std::vector<TimerHandle> mExpiring; // handles, so a node freed and reused by a callback is not fired in the same batch
+        int32_t mSlots[LEVEL_COUNT][SLOT_COUNT];
+    };
+
+}
+
+#endif /* INCLUDE_TIMERWHEEL_H_ */
@@ -0,0 +1,135 @@
+/*
+ * UpdateScheduler.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_UPDATESCHEDULER_H_
+#define INCLUDE_UPDATESCHEDULER_H_
+
+#include <vector>
+#include <ostream>
+#include <unordered_map>
+#include <osg/Timer>
+
+namespace od
+{
+
+    /**
+     * @brief Phases of a frame's update, executed in the order given here.
+     */
+    enum class UpdatePhase
+    {
+        Input,
+        Timers,
+        Rfl,
+        Messaging,
+        Animation,
+        Physics,
+        Lighting,
+        Camera,
+        Count
+    };
+
+    /**
+     * @brief How often a registered Updatable gets updated.
+     *
+     * LowFrequency updatables are updated at a fixed, reduced rate, with relTime spanning all the time since their
+     * last update. Sleeping updatables stay registered but are skipped until their tier is changed again.
+     */
+    enum class UpdateTier
+    {
+        EveryFrame,
+        LowFrequency,
+        Sleeping
+    };
+
+    class Updatable
+    {
+    public:
+
+        virtual ~Updatable() = default;
+
+        virtual void update(double simTime, double relTime) = 0;
+    };
+
+    /**
+     * @brief Engine-wide scheduler that updates all registered Updatables once per frame, phase by phase.
+     *
+     * Replaces attaching one osg::NodeCallback per updated thing to the scenegraph. Updatables of each phase are
+     * kept in a contiguous array and called in order of registration. It is safe to add, remove or retier updatables
+     * from within an update call. Updatables added during a phase will first be updated in the next frame.
+     */
+    class UpdateScheduler
+    {
+    public:
+
+        struct PhaseStats
+        {
+            size_t registered;
+            size_t updatedLastFrame;
+            double lastFrameTime;  // in ms
+            double totalTime;      // in ms, since last reset
+        };
+
+        UpdateScheduler();
+        UpdateScheduler(const UpdateScheduler &) = delete;
+
+        inline double getLowFrequencyInterval() const { return mLowFrequencyInterval; }
+        inline void setLowFrequencyInterval(double seconds) { mLowFrequencyInterval = seconds; }
+        inline const PhaseStats &getPhaseStats(UpdatePhase phase) const { return mPhases[static_cast<size_t>(phase)].stats; }
+        inline size_t getFrameCount() const { return mFrameCount; }
+
+        void add(Updatable *u, UpdatePhase phase, UpdateTier tier = UpdateTier::EveryFrame);
+        void remove(Updatable *u);
+        bool isRegistered(Updatable *u) const;
+
+        /**
+         * @brief Changes the tier of an already registered Updatable. Does nothing if \c u is not registered.
+         */
+        void setTier(Updatable *u, UpdateTier tier);
+
+        void update(double simTime);
+
+        void resetStats();
+        void dumpStats(std::ostream &out) const;
+
+        static const char *getPhaseName(UpdatePhase phase);
+
+
+    private:
+
+        struct Slot
+        {
+            Updatable *updatable; // nullptr if removed but not yet compacted
+            UpdateTier tier;
+            double lastUpdateTime;
+            bool firstUpdate;
+        };
+
+        struct Phase
+        {
+            std::vector<Slot> slots;
+            bool needsCompaction;
+            PhaseStats stats;
+        };
+
+        struct SlotLocation
+        {
+            size_t phase;
+            size_t index;
+        };
+
+        Slot *_findSlot(Updatable *u);
+        void _compact(size_t phaseIndex);
+
+        Phase mPhases[static_cast<size_t>(UpdatePhase::Count)];
+        std::unordered_map<Updatable*, SlotLocation> mSlotLocations;
+        double mLowFrequencyInterval;
+        size_t mFrameCount;
+    };
+
+}
+
+#endif /* INCLUDE_UPDATESCHEDULER_H_ */
@@ -14,6 +14,7 @@
 #include <osg/PositionAttitudeTransform>
 
 #include "db/Animation.h"
+#include "UpdateScheduler.h"
 
 namespace od
 {
@@ -21,14 +22,16 @@ namespace od
 
 	/**
 	 * Class managing interpolated animation of a single osg::MatrixTransform.
+	 *
+	 * Animators are updated in the animation phase of the UpdateScheduler and sleep while not playing.
 	 */
-	class Animator : public osg::Referenced
+	class Animator : public osg::Referenced, public Updatable
 	{
 	public:
 
 	    typedef std::vector<AnimationKeyframe>::const_iterator KfIterator;
 
-		Animator(osg::MatrixTransform *node);
+		Animator(UpdateScheduler &scheduler, osg::MatrixTransform *node);
 		Animator(const Animator &) = delete;
 		Animator(Animator &) = delete;
 		~Animator();
@@ -42,13 +45,16 @@ namespace od
 		void play(bool looping);
 		void stop();
 
-		void update(double simTime);
+		// implement Updatable
+		virtual void update(double simTime, double relTime) override;
 
 
 	protected:
 
+		void _setPlaying(bool b);
+
+		UpdateScheduler &mScheduler;
 		osg::ref_ptr<osg::MatrixTransform> mNode;
-		osg::ref_ptr<osg::NodeCallback> mUpdateCallback;
 		osg::Matrix mOriginalXform;
 		size_t mKeyframeCount;
 		bool mPlaying;
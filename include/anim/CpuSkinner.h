@@ -0,0 +1,158 @@
+/*
+ * CpuSkinner.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_ANIM_CPUSKINNER_H_
+#define INCLUDE_ANIM_CPUSKINNER_H_
+
+#include <vector>
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+#include <osg/Node>
+#include <osg/Vec3f>
+#include <osg/Vec4f>
+#include <osg/Matrixf>
+#include <osg/BoundingBox>
+
+namespace od
+{
+
+    /**
+     * @brief Skins positions and normals of animated models on the CPU, so hit tests and bounds can use the deformed mesh.
+     *
+     * Does the same as the rigging shader: every vertex is transformed by the weighted sum of it's bone matrices, which
+     * are the ones SkeletonAnimationPlayer computes per object. The inner loop uses SSE2 where available, processing one
+     * vertex per iteration with the matrix rows in registers. Vertices of all instances are split into chunks that are
+     * skinned on multiple threads.
+     *
+     * Skinned positions are in model space, as is the bounding box of each instance. Raycasts need to be transformed
+     * into model space by the caller. The level skins all animated objects with one skinner once per frame.
+     */
+    class CpuSkinner
+    {
+    public:
+
+        /**
+         * @brief Skinning input of one model, extracted once from the skinned geometry built by GeodeBuilder.
+         *
+         * Only the first child of every LOD is used. Works with both the float and the compact vertex format. Shared
+         * between all instances of the model.
+         */
+        class Mesh : public osg::Referenced
+        {
+        public:
+
+            Mesh(osg::Node *model);
+
+            inline size_t getVertexCount() const { return mPositions.size(); }
+            inline size_t getTriangleCount() const { return mIndices.size()/3; }
+            inline size_t getJointCount() const { return mJointCount; }
+            inline const std::vector<uint32_t> &getIndices() const { return mIndices; }
+
+
+        private:
+
+            friend class CpuSkinner;
+
+            std::vector<osg::Vec4f> mPositions; // w is always 1
+            std::vector<osg::Vec4f> mNormals;
+            std::vector<int32_t> mJoints; // 4 per vertex, joints with non-zero weight first
+            std::vector<float> mWeights; // 4 per vertex
+            std::vector<uint8_t> mInfluenceCounts;
+            std::vector<uint32_t> mIndices;
+            size_t mJointCount;
+        };
+
+        /**
+         * @brief One animated object using a Mesh. Holds the bone matrices to use and the skinned result.
+         */
+        class Instance : public osg::Referenced
+        {
+        public:
+
+            Instance(Mesh *mesh);
+
+            /**
+             * @brief Copies the bone matrices to use in the next skin() call, indexed by joint. Missing ones are identity.
+             *
+             * SkeletonAnimationPlayer does this after every update traversal for the instance given to it.
+             */
+            void setBoneMatrices(const std::vector<osg::Matrixf> &matrices);
+
+            inline Mesh *getMesh() { return mMesh; }
+            inline const osg::BoundingBox &getBoundingBox() const { return mBoundingBox; }
+            inline osg::Vec3f getPosition(size_t vertex) const { const osg::Vec4f &p = mPositions[vertex]; return osg::Vec3f(p.x(), p.y(), p.z()); }
+            inline osg::Vec3f getNormal(size_t vertex) const { const osg::Vec4f &n = mNormals[vertex]; return osg::Vec3f(n.x(), n.y(), n.z()); }
+
+            /**
+             * @brief Intersects the segment from \c start to \c end with the skinned triangles.
+             *
+             * On a hit, \c fraction receives the position of the closest hit along the segment and \c normal the normal of
+             * the triangle hit. Needs the instance to be skinned.
+             */
+            bool raycast(const osg::Vec3f &start, const osg::Vec3f &end, float &fraction, osg::Vec3f &normal) const;
+
+
+        private:
+
+            friend class CpuSkinner;
+
+            osg::ref_ptr<Mesh> mMesh;
+            std::vector<osg::Matrixf> mBoneMatrices;
+            std::vector<osg::Vec4f> mPositions;
+            std::vector<osg::Vec4f> mNormals;
+            osg::BoundingBox mBoundingBox;
+        };
+
+        struct Stats
+        {
+            size_t vertexCount;
+            double seconds;
+        };
+
+        CpuSkinner();
+
+        inline const Stats &getStats() const { return mStats; }
+
+        /**
+         * @brief Sets number of threads used per skin() call. 0 uses one thread per hardware thread.
+         */
+        void setThreadCount(size_t threadCount);
+
+        void addInstance(Instance *instance);
+        void removeInstance(Instance *instance);
+
+        /**
+         * @brief Skins all instances with their current bone matrices and updates their bounding boxes.
+         *
+         * Adds to the accumulated stats.
+         */
+        void skin();
+
+        void resetStats();
+
+
+    private:
+
+        struct Chunk
+        {
+            Instance *instance;
+            size_t begin;
+            size_t end;
+            osg::BoundingBox box;
+        };
+
+        static void _skinRange(Chunk &chunk);
+
+        size_t mThreadCount;
+        std::vector<osg::ref_ptr<Instance>> mInstances;
+        std::vector<Chunk> mChunks;
+        Stats mStats;
+    };
+
+}
+
+#endif /* INCLUDE_ANIM_CPUSKINNER_H_ */
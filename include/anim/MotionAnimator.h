@@ -10,6 +10,8 @@
 
 #include <osg/PositionAttitudeTransform>
 
+#include "UpdateScheduler.h"
+
 namespace od
 {
 
@@ -21,11 +23,11 @@ namespace od
 	 * Even particles can be implemented better by using osg's particle system.
 	 * This class will probably get removed soon.
 	 */
-	class MotionAnimator : public osg::Referenced
+	class MotionAnimator : public osg::Referenced, public Updatable
 	{
 	public:
 
-		MotionAnimator(osg::PositionAttitudeTransform *node);
+		MotionAnimator(UpdateScheduler &scheduler, osg::PositionAttitudeTransform *node);
 		MotionAnimator(const MotionAnimator &) = delete;
 		MotionAnimator(MotionAnimator &) = delete;
 		~MotionAnimator();
@@ -38,16 +40,16 @@ namespace od
 		inline void setRotVelocity(osg::Vec3 v) { mRotVelocity = v; }
 		inline osg::Vec3f getRotVelocity() const { return mRotVelocity; }
 
-		void update(double simTime);
+		// implement Updatable
+		virtual void update(double simTime, double relTime) override;
 
 
 	private:
 
+		UpdateScheduler &mScheduler;
 		osg::ref_ptr<osg::PositionAttitudeTransform> mNode;
-		osg::ref_ptr<osg::NodeCallback> mUpdateCallback;
 		osg::Vec3 mVelocity;
 		osg::Vec3 mRotVelocity;
-		double mLastSimTime;
 	};
 
 }
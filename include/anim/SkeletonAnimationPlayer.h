@@ -14,10 +14,10 @@
 #include <osg/MatrixTransform>
 #include <osg/NodeCallback>
 #include <osg/Program>
-#include <osg/Uniform>
 
 #include "anim/AnimationPlayer.h"
 #include "anim/Animator.h"
+#include "anim/CpuSkinner.h"
 #include "db/Animation.h"
 
 namespace od
@@ -25,11 +25,15 @@ namespace od
 
 	class Engine;
 	class TransformAccumulator;
+	class BoneUploadCallback;
 
 	/**
 	 * Extension of AnimationPlayer allowing to load animations from riot database assets and distributing their keyframes
 	 * among the AnimationPlayer's Animator objects. This also manages loading the rigging shader and uploading
 	 * the bone matrices to the GPU.
+	 *
+	 * Bone matrices are uploaded per skinned geometry, only for the bones in the geometry's BonePalette. Those uniforms are
+	 * found in the geometry's state set, so the object must have it's own copies of the model's drawables.
 	 */
 	class SkeletonAnimationPlayer : public AnimationPlayer
 	{
@@ -44,9 +48,22 @@ namespace od
 		SkeletonAnimationPlayer(Engine &engine, osg::Node *objectRoot, osg::Group *skeletonRoot, TransformAccumulator *accumulator);
 		~SkeletonAnimationPlayer();
 
-		inline osg::Uniform *getBoneMatrixArrayUniform() { return mBoneMatrixArray.get(); }
 		inline Animation *getCurrentAnimation() { return mCurrentAnimation; }
 
+		/**
+		 * @brief Returns the skinning matrix of every joint as computed in the last update traversal, indexed by joint.
+		 *
+		 * These are what the rigging shader uses, so they can be fed to a CpuSkinner to get the deformed mesh.
+		 */
+		const std::vector<osg::Matrixf> &getBoneMatrices() const;
+
+		/**
+		 * @brief Hands the bone matrices to \c instance after every update traversal. Pass nullptr to stop.
+		 *
+		 * Skinning the instance is left to the CpuSkinner it was added to.
+		 */
+		void setSkinningInstance(CpuSkinner::Instance *instance);
+
 		void setAnimation(osg::ref_ptr<Animation> anim, double startDelay = 0.0);
 		void play(bool looping);
 		void stop();
@@ -58,10 +75,9 @@ namespace od
 		osg::ref_ptr<osg::Node> mObjectRoot;
 		osg::ref_ptr<osg::Group> mSkeletonRoot;
 		TransformAccumulator *mAccumulator;
-		osg::ref_ptr<osg::Uniform> mBoneMatrixArray;
 		std::vector<osg::ref_ptr<Animator>> mAnimators;
 		osg::ref_ptr<osg::Program> mRiggingProgram;
-		osg::ref_ptr<osg::NodeCallback> mUploadCallback;
+		osg::ref_ptr<BoneUploadCallback> mUploadCallback;
 
 		osg::ref_ptr<Animation> mCurrentAnimation;
 	};
@@ -0,0 +1,80 @@
+/*
+ * AudioSink.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_AUDIO_AUDIOSINK_H_
+#define INCLUDE_AUDIO_AUDIOSINK_H_
+
+#include <fstream>
+#include <cstdint>
+
+#include "FilePath.h"
+
+namespace od
+{
+
+    /**
+     * @brief Interface for output backends of the SoundMixer.
+     *
+     * Sinks receive mono signed 16 bit samples. All methods are called from the mixer thread only.
+     */
+    class AudioSink
+    {
+    public:
+
+        virtual ~AudioSink();
+
+        virtual void open(uint32_t frequency) = 0;
+        virtual void write(const int16_t *samples, size_t sampleCount) = 0;
+        virtual void close();
+
+        /**
+         * @brief Returns true if write() blocks until the device needs more data. If not, the mixer paces itself.
+         */
+        virtual bool isBlocking() const;
+    };
+
+
+    /**
+     * @brief Sink that discards everything. For running headless.
+     */
+    class NullAudioSink : public AudioSink
+    {
+    public:
+
+        virtual void open(uint32_t frequency) override;
+        virtual void write(const int16_t *samples, size_t sampleCount) override;
+    };
+
+
+    /**
+     * @brief Sink that writes everything into a WAV file. For testing the mixer without an audio device.
+     */
+    class WavFileAudioSink : public AudioSink
+    {
+    public:
+
+        WavFileAudioSink(const FilePath &path);
+        virtual ~WavFileAudioSink();
+
+        virtual void open(uint32_t frequency) override;
+        virtual void write(const int16_t *samples, size_t sampleCount) override;
+        virtual void close() override;
+
+
+    private:
+
+        void _writeHeader();
+
+        FilePath mPath;
+        std::ofstream mOut;
+        uint32_t mFrequency;
+        uint32_t mDataSize;
+    };
+
+}
+
+#endif /* INCLUDE_AUDIO_AUDIOSINK_H_ */
@@ -0,0 +1,185 @@
+/*
+ * SoundMixer.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_AUDIO_SOUNDMIXER_H_
+#define INCLUDE_AUDIO_SOUNDMIXER_H_
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <osg/Vec3f>
+#include <osg/ref_ptr>
+
+#include "audio/AudioSink.h"
+#include "db/Sound.h"
+
+namespace od
+{
+
+    typedef uint32_t VoiceHandle;
+
+    /**
+     * @brief Software mixer that mixes a budget of voices into a mono output stream.
+     *
+     * The mixer runs on it's own thread once started. All public methods except mix() are meant to be called from a
+     * single thread (usually the main thread) and never block; they just push commands into a lock-free queue that
+     * the mixer thread processes before each block. If no thread is started, mix() can be called directly to render
+     * audio offline.
+     *
+     * If a voice is started while the voice budget is exhausted, the voice with the lowest priority (the quietest one
+     * among equals) is stolen, unless the new voice is even less important, in which case it is not played at all.
+     */
+    class SoundMixer
+    {
+    public:
+
+        static const VoiceHandle INVALID_VOICE = 0;
+
+        struct VoiceSettings
+        {
+            VoiceSettings();
+
+            float gain;
+            uint32_t priority; // higher is more important
+            bool looping;
+
+            /// if false, the voice is not attenuated by distance to the listener
+            bool positional;
+            osg::Vec3f position;
+            float dropoff;
+        };
+
+        struct Stats
+        {
+            size_t activeVoices;
+            size_t stolenVoices;
+            size_t rejectedVoices;
+            size_t droppedCommands;
+        };
+
+        SoundMixer(std::unique_ptr<AudioSink> sink, uint32_t outputFrequency = 22050, size_t voiceBudget = 32);
+        SoundMixer(const SoundMixer &m) = delete;
+        ~SoundMixer();
+
+        inline uint32_t getOutputFrequency() const { return mOutputFrequency; }
+        inline bool isRunning() const { return mRunning; }
+
+        Stats getStats() const;
+
+        /**
+         * @brief Opens the sink and starts the mixer thread.
+         */
+        void start();
+
+        /**
+         * @brief Stops the mixer thread and closes the sink. Voices keep their state.
+         */
+        void stop();
+
+        /**
+         * @brief Plays a sound at \c position, using the sound's priority, dropoff and looping flag.
+         *
+         * Decodes the sound's PCM data if no one else is holding it right now, so call this from the thread that
+         * loads assets.
+         */
+        VoiceHandle play(Sound &sound, const osg::Vec3f &position, float gain = 1.0f);
+
+        /**
+         * @brief Plays a sound without distance attenuation (e.g. GUI sounds and music).
+         */
+        VoiceHandle playAmbient(Sound &sound, float gain = 1.0f);
+
+        VoiceHandle play(PcmBuffer *buffer, uint32_t frequency, const VoiceSettings &settings);
+
+        void stopVoice(VoiceHandle handle);
+        void stopAllVoices();
+        void setVoicePosition(VoiceHandle handle, const osg::Vec3f &position);
+        void setVoiceGain(VoiceHandle handle, float gain);
+        void setListenerPosition(const osg::Vec3f &position);
+        void setVoiceBudget(size_t budget);
+
+        /**
+         * @brief Processes pending commands and mixes \c sampleCount samples into \c out.
+         *
+         * Called by the mixer thread. Only call this yourself if the mixer is not running.
+         */
+        void mix(int16_t *out, size_t sampleCount);
+
+
+    private:
+
+        enum class CommandType
+        {
+            Play,
+            Stop,
+            StopAll,
+            SetPosition,
+            SetGain,
+            SetListener,
+            SetBudget
+        };
+
+        struct Command
+        {
+            CommandType type;
+            VoiceHandle handle;
+            osg::ref_ptr<PcmBuffer> buffer;
+            uint32_t frequency;
+            VoiceSettings settings;
+            osg::Vec3f position;
+            float gain;
+            size_t budget;
+        };
+
+        struct Voice
+        {
+            VoiceHandle handle;
+            osg::ref_ptr<PcmBuffer> buffer;
+            uint64_t cursor; // 32.32 fixed point sample index
+            uint64_t step; // 32.32 fixed point. source samples per output sample
+            VoiceSettings settings;
+            float currentGain;
+            bool finished;
+        };
+
+        bool _pushCommand(Command &c);
+        void _processCommands();
+        void _startVoice(Command &c);
+        Voice *_findVoice(VoiceHandle handle);
+        float _getTargetGain(const Voice &v) const;
+        size_t _resample(Voice &v, float *out, size_t count);
+        void _mixBlock(int16_t *out, size_t sampleCount);
+        void _threadMain();
+
+        std::unique_ptr<AudioSink> mSink;
+        uint32_t mOutputFrequency;
+        size_t mVoiceBudget;
+        VoiceHandle mNextHandle;
+        size_t mDroppedCommands;
+
+        // single producer, single consumer command ring
+        std::vector<Command> mCommands;
+        std::atomic<size_t> mCommandHead;
+        std::atomic<size_t> mCommandTail;
+
+        // everything below is owned by the mixer thread
+        std::vector<Voice> mVoices;
+        osg::Vec3f mListenerPosition;
+        std::vector<float> mAccumulator;
+        std::vector<float> mScratch;
+        std::atomic<size_t> mActiveVoiceCount;
+        std::atomic<size_t> mStolenVoiceCount;
+        std::atomic<size_t> mRejectedVoiceCount;
+
+        std::atomic<bool> mRunning;
+        std::thread mThread;
+    };
+
+}
+
+#endif /* INCLUDE_AUDIO_SOUNDMIXER_H_ */
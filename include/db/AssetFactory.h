@@ -39,8 +39,16 @@ namespace od
 		inline AssetProvider &getAssetProvider() { return mAssetProvider; }
 		inline SrscFile &getSrscFile() { return mSrscFile; }
 
+		/**
+		 * @brief Returns the asset with the given ID, loading it if it is not cached. Throws NotFoundException if it does not exist.
+		 */
 		osg::ref_ptr<_AssetType> getAsset(RecordId assetId);
 
+		/**
+		 * @brief Like getAsset(), but returns nullptr instead of throwing if the asset does not exist.
+		 */
+		osg::ref_ptr<_AssetType> findAsset(RecordId assetId);
+
 
 	protected:
 
@@ -84,6 +92,19 @@ namespace od
 
 	template <typename _AssetType>
 	osg::ref_ptr<_AssetType> AssetFactory<_AssetType>::getAsset(RecordId assetId)
+	{
+	    osg::ref_ptr<_AssetType> asset = this->findAsset(assetId);
+	    if(asset == nullptr)
+	    {
+	        Logger::error() << AssetTraits<_AssetType>::name() << " " << std::hex << assetId << std::dec << " neither found in cache nor asset container " << mSrscFile.getFilePath().fileStr();
+            throw NotFoundException("Asset not found in cache or asset container");
+	    }
+
+	    return asset;
+	}
+
+	template <typename _AssetType>
+	osg::ref_ptr<_AssetType> AssetFactory<_AssetType>::findAsset(RecordId assetId)
 	{
 		_AssetType *cached = this->_getAssetFromCache(assetId);
 	    if(cached != nullptr)
@@ -95,12 +116,10 @@ namespace od
 	    // not cached. let implementation handle loading
 	    Logger::debug() << AssetTraits<_AssetType>::name() << " " << std::hex << assetId << std::dec << " not found in cache. Loading from container " << mSrscFile.getFilePath().fileStr();
 	    osg::ref_ptr<_AssetType> loaded = this->loadAsset(assetId);
-	    if(loaded == nullptr)
+	    if(loaded != nullptr)
 	    {
-	        Logger::error() << AssetTraits<_AssetType>::name() << " " << std::hex << assetId << std::dec << " neither found in cache nor asset container " << mSrscFile.getFilePath().fileStr();
-            throw NotFoundException("Asset not found in cache or asset container");
+	        this->_addAssetToCache(assetId, loaded.get());
 	    }
-	    this->_addAssetToCache(assetId, loaded.get());
 
 	    return loaded;
 	}
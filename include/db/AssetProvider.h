@@ -32,15 +32,28 @@ namespace od
 		virtual ~AssetProvider() {};
 
 	    /*
-	     * These get assets from this provider or fetch them from a referenced dependency.
+	     * These get assets from this provider or fetch them from a referenced dependency. They return nullptr if the
+	     * referenced dependency, the container for the asset type or the asset itself does not exist. Implementers
+	     * override these for the asset types they can provide.
 	     * Note that these functions transfer ownership. It is vital that their return value is stored in a ref_ptr.
 	     */
-	    virtual Texture   *getTextureByRef(const AssetRef &ref) { throw Exception("Can't provide textures"); }
-	    virtual Class     *getClassByRef(const AssetRef &ref) { throw Exception("Can't provide classes"); }
-	    virtual Model     *getModelByRef(const AssetRef &ref) { throw Exception("Can't provide models"); }
-	    virtual Sequence  *getSequenceByRef(const AssetRef &ref) { throw Exception("Can't provide sequences"); }
-	    virtual Animation *getAnimationByRef(const AssetRef &ref) { throw Exception("Can't provide animations"); }
-	    virtual Sound     *getSoundByRef(const AssetRef &ref) { throw Exception("Can't provide sounds"); }
+	    virtual Texture   *findTextureByRef(const AssetRef &ref) { return nullptr; }
+	    virtual Class     *findClassByRef(const AssetRef &ref) { return nullptr; }
+	    virtual Model     *findModelByRef(const AssetRef &ref) { return nullptr; }
+	    virtual Sequence  *findSequenceByRef(const AssetRef &ref) { return nullptr; }
+	    virtual Animation *findAnimationByRef(const AssetRef &ref) { return nullptr; }
+	    virtual Sound     *findSoundByRef(const AssetRef &ref) { return nullptr; }
+
+	    /*
+	     * Like the find*ByRef() methods, but throw a NotFoundException instead of returning nullptr. Use these where
+	     * a missing asset is an error.
+	     */
+	    Texture   *getTextureByRef(const AssetRef &ref);
+	    Class     *getClassByRef(const AssetRef &ref);
+	    Model     *getModelByRef(const AssetRef &ref);
+	    Sequence  *getSequenceByRef(const AssetRef &ref);
+	    Animation *getAnimationByRef(const AssetRef &ref);
+	    Sound     *getSoundByRef(const AssetRef &ref);
 
 	    /*
 	     * These get assets from this provider without indirection. Override if implementer can load
@@ -57,6 +70,9 @@ namespace od
 	    template <typename _AssetType>
 	    _AssetType *getAssetByRef(const AssetRef &ref);
 
+	    template <typename _AssetType>
+	    _AssetType *findAssetByRef(const AssetRef &ref);
+
 	};
 
 	template<>
@@ -77,6 +93,24 @@ namespace od
 	template<>
     Sound *AssetProvider::getAssetByRef<Sound>(const AssetRef &ref);
 
+	template<>
+    Texture *AssetProvider::findAssetByRef<Texture>(const AssetRef &ref);
+
+	template<>
+    Class *AssetProvider::findAssetByRef<Class>(const AssetRef &ref);
+
+	template<>
+    Model *AssetProvider::findAssetByRef<Model>(const AssetRef &ref);
+
+	template<>
+    Sequence *AssetProvider::findAssetByRef<Sequence>(const AssetRef &ref);
+
+	template<>
+    Animation *AssetProvider::findAssetByRef<Animation>(const AssetRef &ref);
+
+	template<>
+    Sound *AssetProvider::findAssetByRef<Sound>(const AssetRef &ref);
+
 
 }
 
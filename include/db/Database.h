@@ -17,6 +17,7 @@
 
 #include "FilePath.h"
 #include "SrscFile.h"
+#include "DbManager.h"
 #include "Asset.h"
 #include "AssetProvider.h"
 #include "TextureFactory.h"
@@ -52,15 +53,21 @@ namespace od
 		inline AnimationFactory *getAnimationFactory() { return mAnimFactory.get(); }
 		inline SoundFactory *getSoundFactory() { return mSoundFactory.get(); }
 
+		/**
+		 * @brief Typed access to the factory for \c _AssetType. Returns nullptr if this database has no container for that type.
+		 */
+		template <typename _AssetType>
+		AssetFactory<_AssetType> *getAssetFactory();
+
 		void loadDbFileAndDependencies(size_t dependencyDepth);
 
 		// implement AssetProvider
-		virtual Texture   *getTextureByRef(const AssetRef &ref) override;
-        virtual Class     *getClassByRef(const AssetRef &ref) override;
-        virtual Model     *getModelByRef(const AssetRef &ref) override;
-        virtual Sequence  *getSequenceByRef(const AssetRef &ref) override;
-        virtual Animation *getAnimationByRef(const AssetRef &ref) override;
-        virtual Sound     *getSoundByRef(const AssetRef &ref) override;
+		virtual Texture   *findTextureByRef(const AssetRef &ref) override;
+        virtual Class     *findClassByRef(const AssetRef &ref) override;
+        virtual Model     *findModelByRef(const AssetRef &ref) override;
+        virtual Sequence  *findSequenceByRef(const AssetRef &ref) override;
+        virtual Animation *findAnimationByRef(const AssetRef &ref) override;
+        virtual Sound     *findSoundByRef(const AssetRef &ref) override;
 
 	    // override AssetProvider
         virtual Texture   *getTexture(RecordId recordId) override;
@@ -73,6 +80,9 @@ namespace od
 
 	private:
 
+        template <typename _AssetType>
+        _AssetType *_findAssetByRef(const AssetRef &ref);
+
         template <typename T>
         void _tryOpeningAssetContainer(std::unique_ptr<T> &factoryPtr, std::unique_ptr<SrscFile> &containerPtr, const char *extension);
 
@@ -106,9 +116,9 @@ namespace od
     void Database::_tryOpeningAssetContainer(std::unique_ptr<T> &factoryPtr, std::unique_ptr<SrscFile> &containerPtr, const char *extension)
     {
         FilePath path = mDbFilePath.ext(extension);
-        if(path.exists())
+        containerPtr = mDbManager.openSrscFile(path);
+        if(containerPtr != nullptr)
         {
-            containerPtr.reset(new SrscFile(path));
             factoryPtr.reset(new T(*this, *containerPtr));
 
             Logger::verbose() << AssetTraits<typename T::AssetType>::name() << " container of database opened";
@@ -118,6 +128,25 @@ namespace od
             Logger::verbose() << "Database has no " << AssetTraits<typename T::AssetType>::name() << " container";
         }
     }
+
+	template <>
+	inline AssetFactory<Texture> *Database::getAssetFactory<Texture>() { return mTextureFactory.get(); }
+
+	template <>
+	inline AssetFactory<Class> *Database::getAssetFactory<Class>() { return mClassFactory.get(); }
+
+	template <>
+	inline AssetFactory<Model> *Database::getAssetFactory<Model>() { return mModelFactory.get(); }
+
+	template <>
+	inline AssetFactory<Sequence> *Database::getAssetFactory<Sequence>() { return mSequenceFactory.get(); }
+
+	template <>
+	inline AssetFactory<Animation> *Database::getAssetFactory<Animation>() { return mAnimFactory.get(); }
+
+	template <>
+	inline AssetFactory<Sound> *Database::getAssetFactory<Sound>() { return mSoundFactory.get(); }
+
 }
 
 #endif /* INCLUDE_DATABASE_H_ */
@@ -13,11 +13,13 @@
 #include <osg/Vec3>
 #include <osg/Texture2D>
 #include <osg/Group>
+#include <osg/LOD>
 
 #include "physics/ModelBounds.h"
 #include "Asset.h"
 #include "Skeleton.h"
 #include "GeodeBuilder.h"
+#include "anim/CpuSkinner.h"
 
 namespace od
 {
@@ -60,6 +62,16 @@ namespace od
 		inline bool hasBounds() const { return mModelBounds != nullptr; }
 		inline ModelShadingType getShadingType() const { return mShadingType; }
 
+		/**
+		 * @brief Sets distance in multiples of the bounding radius beyond which generated LODs are used. 0 disables them.
+		 *
+		 * Models with at most one authored LOD get simplified LODs generated by buildGeometry() if this is set.
+		 */
+		inline void setAutoLodDistance(float radii) { mAutoLodDistance = radii; }
+
+		/// @brief Whether buildGeometry() quantizes vertex attributes. See GeodeBuilder.
+		inline void setCompactVertexFormat(bool b) { mCompactVertexFormat = b; }
+
 		void loadNameAndShading(ModelFactory &factory, DataReader &&dr);
 		void loadVertices(ModelFactory &factory, DataReader &&dr);
 		void loadTextures(ModelFactory &factory, DataReader &&dr);
@@ -68,6 +80,14 @@ namespace od
 		void loadLodsAndBones(ModelFactory &factory, DataReader &&dr);
 		void buildGeometry();
 
+		/**
+		 * @brief Writes the authored meshes of this model as a Wavefront OBJ file, one object per LOD.
+		 *
+		 * Only needs the loaded records, not the built geometry. Materials are named after the texture refs, but no
+		 * material library is written.
+		 */
+		void exportToObj(const FilePath &path);
+
 		/**
 		 * @brief Returns an axis-aligned bounding box that encapsulates all of this model's meshes and LODs.
 		 *
@@ -75,9 +95,19 @@ namespace od
 		 */
 		inline osg::BoundingBox getCalculatedBoundingBox() { return mCalculatedBoundingBox; }
 
+		/**
+		 * @brief Returns the CPU skinning input of this model, extracting it on first use. Needs built geometry.
+		 *
+		 * Shared by all objects using this model.
+		 */
+		CpuSkinner::Mesh *getCpuSkinningMesh();
+
 
 	private:
 
+		bool _addGeneratedLods(osg::LOD *lodNode, std::vector<osg::Vec3f>::iterator verticesBegin, std::vector<osg::Vec3f>::iterator verticesEnd,
+		        std::vector<Polygon>::iterator polygonsBegin, std::vector<Polygon>::iterator polygonsEnd, std::vector<BoneAffection> *boneAffections);
+
 		std::string mModelName;
 		ModelShadingType mShadingType;
 		bool mBlendWithLandscape;
@@ -94,7 +124,10 @@ namespace od
 		bool mVerticesLoaded;
 		bool mTexturesLoaded;
 		bool mPolygonsLoaded;
+		float mAutoLodDistance;
+		bool mCompactVertexFormat;
 		osg::BoundingBox mCalculatedBoundingBox;
+		osg::ref_ptr<CpuSkinner::Mesh> mCpuSkinningMesh;
 	};
 
 	template <>
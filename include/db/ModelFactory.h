@@ -15,11 +15,25 @@
 namespace od
 {
 
+    class Engine;
+
 	class ModelFactory : public AssetFactory<Model>
 	{
 	public:
 
-		ModelFactory(AssetProvider &ap, SrscFile &modelContainer);
+		/**
+		 * This needs an engine instance for the settings of generated LODs.
+		 */
+		ModelFactory(AssetProvider &ap, SrscFile &modelContainer, Engine &engine);
+
+		inline Engine &getEngine() { return mEngine; }
+
+		/**
+		 * @brief Loads all records of a model without building it's geometry. Returns nullptr if the model does not exist.
+		 *
+		 * The result is not cached. Enough for exporting the model, but can't be rendered.
+		 */
+		osg::ref_ptr<Model> loadModelRecords(RecordId id);
 
 
 	protected:
@@ -27,6 +41,10 @@ namespace od
 		// implement AssetFactory<Model>
 		virtual osg::ref_ptr<Model> loadAsset(RecordId id) override;
 
+
+	private:
+
+		Engine &mEngine;
 	};
 
 }
@@ -9,27 +9,134 @@
 #define INCLUDE_SOUND_H_
 
 #include <vector>
+#include <memory>
+#include <zlib.h>
 #include <osg/Referenced>
+#include <osg/ref_ptr>
+#include <osg/observer_ptr>
 
 #include "Asset.h"
 
 #define OD_SOUND_FLAG_FLUSH_AFTER_PLAYING 	0x04
 #define OD_SOUND_FLAG_PLAY_LOOPING			0x08
 
+// sounds with more decoded PCM data than this should be played via a SoundStream instead of a fully decoded buffer
+#define OD_SOUND_STREAMING_THRESHOLD (1024*1024)
+
 namespace od
 {
 
+    class SoundFactory;
+    class Sound;
+
+    /**
+     * @brief Fully decoded signed 16 bit PCM data of a sound.
+     *
+     * Shared between all users of the same sound and freed once the last user releases it.
+     */
+    class PcmBuffer : public osg::Referenced
+    {
+    public:
+
+        PcmBuffer();
+        PcmBuffer(std::vector<int16_t> &&samples);
+
+        inline const std::vector<int16_t> &getSamples() const { return mSamples; }
+
+
+    private:
+
+        friend class Sound;
+
+        std::vector<int16_t> mSamples;
+    };
+
+    /**
+     * @brief Sequential decoder for a sound's PCM data.
+     *
+     * Decodes the sound chunk by chunk into signed 16 bit samples, inflating compressed sounds on the fly, so large
+     * ambient tracks never have to be held in memory as a whole. The container stream is shared with other readers, so
+     * the stream keeps it's own read position and seeks before every chunk.
+     */
+    class SoundStream
+    {
+    public:
+
+        SoundStream(Sound &sound);
+        SoundStream(const SoundStream &s) = delete;
+        ~SoundStream();
+
+        inline bool isAtEnd() const { return mSamplesLeft == 0; }
+
+        /**
+         * @brief Decodes up to \c maxSamples samples into \c out. Returns the number of samples decoded, which is only
+         * less than \c maxSamples if the end of the sound was reached.
+         */
+        size_t read(int16_t *out, size_t maxSamples);
+
+        void rewind();
+
+
+    private:
+
+        size_t _readBytes(uint8_t *out, size_t maxBytes);
+        size_t _readInput(uint8_t *out, size_t maxBytes);
+
+        osg::ref_ptr<Sound> mSound;
+        size_t mInputOffset;
+        size_t mInputLeft;
+        size_t mSamplesLeft;
+
+        bool mZStreamActive;
+        z_stream mZStream;
+        std::vector<uint8_t> mInputBuffer;
+        std::vector<uint8_t> mByteBuffer;
+    };
+
 	class Sound : public Asset, public osg::Referenced
 	{
 	public:
 
 		Sound(AssetProvider &ap, RecordId id);
 
-		void loadFromRecord(DataReader &dr);
+		inline const std::string &getName() const { return mSoundName; }
+		inline uint32_t getFlags() const { return mFlags; }
+		inline uint16_t getChannels() const { return mChannels; }
+		inline uint16_t getBits() const { return mBits; }
+		inline uint32_t getFrequency() const { return mFrequency; }
+		inline float getDropoff() const { return mDropoff; }
+		inline uint32_t getPriority() const { return mPriority; }
+		inline bool isLooping() const { return mFlags & OD_SOUND_FLAG_PLAY_LOOPING; }
+		inline bool isCompressed() const { return mCompressionLevel != 0; }
+		inline size_t getSampleCount() const { return mDecompressedSize/(mBits/8); }
+
+		/**
+		 * @brief Returns true if this sound is big enough to warrant streaming it via openStream() instead of decoding it at once.
+		 */
+		inline bool isStreamed() const { return getSampleCount()*sizeof(int16_t) > OD_SOUND_STREAMING_THRESHOLD; }
+
+		/**
+		 * @brief Reads the sound's header only. PCM data is decoded on demand by getPcmBuffer() or openStream().
+		 */
+		void loadFromRecord(SoundFactory &factory, const SrscFile::DirEntry &dirEntry);
+
+		/**
+		 * @brief Returns the decoded PCM data, decoding it if no one else is currently holding it.
+		 */
+		osg::ref_ptr<PcmBuffer> getPcmBuffer();
+
+		std::unique_ptr<SoundStream> openStream();
+
+		/**
+		 * @brief Writes the sound as a 16 bit PCM WAV file. Decodes chunk by chunk, so this works for streamed sounds, too.
+		 */
+		void exportToWav(const FilePath &path);
 
 
 	private:
 
+		friend class SoundStream;
+
 		std::string mSoundName;
 		uint32_t	mFlags;
         uint16_t    mChannels;
@@ -38,11 +145,14 @@ namespace od
         uint32_t    mVolume; // no idea how this is encoded
         float       mDropoff; // min 0, max 30
         uint32_t    mPriority; // range 0-10
-        uint32_t    mDecompressedSize;
+        uint32_t    mDecompressedSize; // in bytes
         uint32_t 	mCompressionLevel; // 0 = none, 1 = lowest, 9 = highest
         uint32_t    mCompressedSize; // contains garbage if uncompressed
 
-        std::vector<int16_t> mPcmBuffer;
+        SrscFile *mContainer;
+        SrscFile::DirEntry mDirEntry;
+        size_t mDataOffset; // absolute offset of PCM data in container
+        osg::observer_ptr<PcmBuffer> mPcmBuffer;
 	};
 
 	template <>
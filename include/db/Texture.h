@@ -9,6 +9,7 @@
 #define TEXTURE_H_
 
 #include <osg/Image>
+#include <osg/StateSet>
 
 #include "SrscFile.h"
 #include "Asset.h"
@@ -28,9 +29,27 @@ namespace od
     {
     public:
 
+        /**
+         * @brief Classification of a texture's alpha channel, determined from the decoded pixels.
+         */
+        enum class AlphaMode
+        {
+            Opaque,     ///< all pixels fully opaque
+            Cutout,     ///< only fully opaque or fully transparent pixels, like color-keyed foliage. can be alpha tested
+            Translucent ///< has partially transparent pixels. needs blending and back-to-front sorting
+        };
+
         Texture(AssetProvider &ap, RecordId id);
 
-        inline bool hasAlpha() const { return mHasAlphaChannel; };
+        inline bool hasAlpha() const { return mAlphaMode != AlphaMode::Opaque; };
+        inline AlphaMode getAlphaMode() const { return mAlphaMode; }
+
+        /**
+         * @brief Sets up alpha test or blending on the given state set, depending on the alpha mode of this texture.
+         *
+         * Only translucent textures are put into the depth sorted bin. Opaque textures leave the state set untouched.
+         */
+        void applyAlphaState(osg::StateSet *ss) const;
 
         void loadFromRecord(TextureFactory &factory, DataReader dr);
         void exportToPng(const FilePath &path);
@@ -58,7 +77,7 @@ namespace od
         uint32_t mCompressionLevel;
         uint32_t mCompressedSize;
 
-        bool mHasAlphaChannel;
+        AlphaMode mAlphaMode;
         osg::ref_ptr<Class> mClass;
         std::unique_ptr<odRfl::Material> mMaterial;
     };
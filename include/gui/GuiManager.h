@@ -9,6 +9,8 @@
 #define INCLUDE_GUI_GUIMANAGER_H_
 
 #include <string>
+#include <vector>
+#include <unordered_set>
 
 #include <osgViewer/Viewer>
 
@@ -66,19 +68,31 @@ namespace od
          * Will check whether passed string begins with a localization tag "<0x...>". If not, the string is returned as-is.
          * If it does, the string ID in the tag will be looked up and the localized version of that string returned.
          * If the string ID can not be found in the RRC, the tag will be stripped and the unlocalized string returned.
+         *
+         * The returned reference is either \c s itself or owned by the GuiManager, so this never allocates for strings
+         * found in the RRC. Don't pass temporaries if you intend to keep the reference around.
          */
-        std::string localizeString(const std::string &s);
+        const std::string &localizeString(const std::string &s);
 
         /**
          * @brief Returns the string with the given ID or throws if string can not be found.
          */
-        std::string getStringById(RecordId stringId);
+        const std::string &getStringById(RecordId stringId);
+
+        /**
+         * @brief Looks up the string with the given ID. Returns false and leaves \c str untouched if it can not be found.
+         */
+        bool findStringById(RecordId stringId, std::string &str);
+
+        /**
+         * @brief Looks up the string with the given ID. Returns nullptr if it can not be found.
+         */
+        const std::string *findStringById(RecordId stringId);
 
         void dumpStrings();
-        void dumpTextures();
 
         // implement AssetProvider
-        virtual Texture *getTextureByRef(const AssetRef &ref) override;
+        virtual Texture *findTextureByRef(const AssetRef &ref) override;
         virtual Texture *getTexture(RecordId recordId) override;
 
 
@@ -90,6 +104,11 @@ namespace od
         using AssetProvider::getSequenceByRef;
         using AssetProvider::getAnimationByRef;
         using AssetProvider::getSoundByRef;
+        using AssetProvider::findClassByRef;
+        using AssetProvider::findModelByRef;
+        using AssetProvider::findSequenceByRef;
+        using AssetProvider::findAnimationByRef;
+        using AssetProvider::findSoundByRef;
         using AssetProvider::getClass;
         using AssetProvider::getModel;
         using AssetProvider::getSequence;
@@ -97,6 +116,7 @@ namespace od
         using AssetProvider::getSound;
 
         inline void _decryptString(char * const str, const size_t len);
+        void _loadStrings();
         void _setupGui();
 
         Engine &mEngine;
@@ -117,6 +137,11 @@ namespace od
         osg::Matrix mWidgetToScreenSpaceXform; // FIXME: these are badly named. this goes from widget space to NDC, not screen space
         osg::Matrix mScreenToWidgetSpaceXform;
         osg::ref_ptr<WidgetIntersectVisitor> mWidgetIntersectVisitor;
+
+        // all localized strings are decrypted once on construction. the index maps string IDs to positions in mStrings
+        std::vector<std::string> mStrings;
+        std::vector<int32_t> mStringIndex;
+        std::unordered_set<std::string> mUnlocalizedStrings;
     };
 
 }
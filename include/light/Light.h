@@ -14,6 +14,7 @@ namespace od
 {
 
     class LevelObject;
+    class LightManager;
 
     class Light : public osg::Referenced
     {
@@ -21,17 +22,35 @@ namespace od
 
         Light(LevelObject *obj);
 
-        inline void setDiffuseColor(const osg::Vec4 &color) { mDiffuseColor = color; }
-        inline void setIntensity(float intensity) { mIntensity = intensity; }
-        inline void setRadius(float radius) { mRadius = radius; }
+        inline LevelObject *getLevelObject() { return mLevelObject; }
+        inline const osg::Vec4 &getDiffuseColor() const { return mDiffuseColor; }
+        inline float getIntensity() const { return mIntensity; }
+        inline float getRadius() const { return mRadius; }
+        inline bool isDynamic() const { return mDynamic; }
+
+        inline void setDiffuseColor(const osg::Vec4 &color) { mDiffuseColor = color; mDirty = true; }
+        inline void setIntensity(float intensity) { mIntensity = intensity; mDirty = true; }
+        inline void setRadius(float radius) { mRadius = radius; mDirty = true; }
+
+        /**
+         * @brief Marks this light as moving with it's object. Static lights are only rebinned when their properties change.
+         */
+        inline void setDynamic(bool b) { mDynamic = b; mDirty = true; }
+
+        osg::Vec3f getPosition() const;
 
 
     private:
 
+        friend class LightManager;
+
         osg::ref_ptr<LevelObject> mLevelObject;
         osg::Vec4 mDiffuseColor;
         float mIntensity;
         float mRadius;
+        bool mDynamic;
+        bool mDirty;
+        int32_t mSlot; // index in the light manager, -1 if not managed
 
     };
 
@@ -0,0 +1,116 @@
+/*
+ * LightBaker.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_LIGHT_LIGHTBAKER_H_
+#define INCLUDE_LIGHT_LIGHTBAKER_H_
+
+#include <vector>
+#include <functional>
+#include <osg/Vec3f>
+#include <osg/Vec4>
+#include <osg/Array>
+
+namespace od
+{
+
+    /**
+     * @brief Evaluates static lighting per vertex so it can be stored as vertex colors instead of being computed at runtime.
+     *
+     * A bake sums an ambient term, one directional light and all point lights reaching the vertex, using the same
+     * falloff as the runtime lighting shader. Vertices are split into chunks that are lit on multiple threads.
+     *
+     * If an occlusion test factory is set, point lights are only added for vertices that can see the light. Every worker
+     * thread creates it's own test from the factory, so tests run concurrently without locking as long as each one only
+     * touches it's own state.
+     */
+    class LightBaker
+    {
+    public:
+
+        struct PointLight
+        {
+            osg::Vec3f position;
+            osg::Vec4 color;
+            float intensity;
+            float radius;
+        };
+
+        struct Stats
+        {
+            size_t vertexCount;
+            size_t lightTests;
+            size_t occlusionTests;
+            size_t occludedCount;
+            double seconds;
+        };
+
+        /// Returns true if the segment between the two points is blocked.
+        typedef std::function<bool(const osg::Vec3f &from, const osg::Vec3f &to)> OcclusionTest;
+
+        /// Creates the occlusion test used by one worker thread. Called once per thread and bake.
+        typedef std::function<OcclusionTest()> OcclusionTestFactory;
+
+        LightBaker();
+
+        inline void setAmbientColor(const osg::Vec4 &color) { mAmbientColor = color; }
+        inline void setOcclusionTestFactory(const OcclusionTestFactory &factory) { mOcclusionTestFactory = factory; }
+        inline const Stats &getStats() const { return mStats; }
+
+        /**
+         * @brief Sets number of threads used per bake. 0 uses one thread per hardware thread.
+         */
+        void setThreadCount(size_t threadCount);
+
+        /**
+         * @brief Sets the directional light. \c direction points towards the light and needs not be normalized.
+         */
+        void setDirectionalLight(const osg::Vec3f &direction, const osg::Vec4 &color);
+
+        /**
+         * @brief Makes the directional light fade linearly from full strength at \c start to nothing at \c end.
+         *
+         * Only the distance along the line from \c start to \c end counts. Points are in the same space as the baked
+         * vertices plus the bake offset.
+         */
+        void setDirectionalDropoff(const osg::Vec3f &start, const osg::Vec3f &end);
+        void clearDirectionalDropoff();
+
+        void addPointLight(const PointLight &light);
+        void clearPointLights();
+
+        /**
+         * @brief Lights the given vertices and writes one color per vertex into \c colors.
+         *
+         * \c offset is added to every vertex, so vertices can be passed in the local space of an untransformed layer.
+         * Adds to the accumulated stats.
+         */
+        void bake(const osg::Vec3Array &vertices, const osg::Vec3Array &normals, const osg::Vec3f &offset, osg::Vec4Array &colors);
+
+        void resetStats();
+
+
+    private:
+
+        void _bakeRange(const osg::Vec3Array &vertices, const osg::Vec3Array &normals, const osg::Vec3f &offset,
+                const std::vector<const PointLight*> &lights, const OcclusionTest &occlusionTest, size_t begin, size_t end,
+                osg::Vec4Array &colors, Stats &stats);
+
+        size_t mThreadCount;
+        osg::Vec4 mAmbientColor;
+        osg::Vec3f mLightDirection;
+        osg::Vec4 mLightColor;
+        bool mHasDropoff;
+        osg::Vec3f mDropoffStart;
+        osg::Vec3f mDropoffAxis; // scaled so the dot product with a point relative to start is 1 at the end point
+        std::vector<PointLight> mPointLights;
+        OcclusionTestFactory mOcclusionTestFactory;
+        Stats mStats;
+    };
+
+}
+
+#endif /* INCLUDE_LIGHT_LIGHTBAKER_H_ */
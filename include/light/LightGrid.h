@@ -0,0 +1,96 @@
+/*
+ * LightGrid.h
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#ifndef INCLUDE_LIGHT_LIGHTGRID_H_
+#define INCLUDE_LIGHT_LIGHTGRID_H_
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cmath>
+#include <osg/Vec3f>
+
+namespace od
+{
+
+    /**
+     * @brief Sparse 3D grid binning light spheres for fast "which lights touch this box" queries.
+     *
+     * Every light is stored in each cell its bounding box overlaps. Cells store their lights as separate coordinate
+     * arrays, so the exact sphere-vs-box test runs over contiguous floats and can be vectorized by the compiler.
+     * Lights covering too many cells are kept in a global list that is tested by every query instead.
+     */
+    class LightGrid
+    {
+    public:
+
+        typedef uint32_t LightId;
+
+        LightGrid(float cellSize);
+
+        inline float getCellSize() const { return mCellSize; }
+        inline size_t getCellCount() const { return mCells.size(); }
+
+        /**
+         * @brief Inserts light with the given ID, or moves it if it was already inserted.
+         */
+        void insert(LightId id, const osg::Vec3f &center, float radius);
+        void remove(LightId id);
+        bool contains(LightId id) const;
+
+        /**
+         * @brief Appends the IDs of all lights whose sphere intersects the given box to \c ids, without duplicates.
+         */
+        void query(const osg::Vec3f &boxMin, const osg::Vec3f &boxMax, std::vector<LightId> &ids);
+
+
+    private:
+
+        typedef uint64_t CellKey;
+
+        struct Cell
+        {
+            std::vector<float> x;
+            std::vector<float> y;
+            std::vector<float> z;
+            std::vector<float> radiusSq;
+            std::vector<LightId> ids;
+
+            void add(LightId id, const osg::Vec3f &center, float radius);
+            void remove(LightId id);
+            inline bool empty() const { return ids.empty(); }
+        };
+
+        struct Entry
+        {
+            osg::Vec3f center;
+            float radius;
+            bool inserted;
+            bool global;
+        };
+
+        inline int32_t _toCell(float f) const { return static_cast<int32_t>(std::floor(f/mCellSize)); }
+        static CellKey _makeKey(int32_t x, int32_t y, int32_t z);
+
+        template <typename F>
+        void _forEachCell(const osg::Vec3f &boxMin, const osg::Vec3f &boxMax, const F &f);
+
+        void _testCell(Cell &cell, const osg::Vec3f &boxMin, const osg::Vec3f &boxMax, std::vector<LightId> &ids);
+
+        float mCellSize;
+        std::unordered_map<CellKey, Cell> mCells;
+        Cell mGlobalCell;
+        std::vector<Entry> mEntries;
+
+        std::vector<uint32_t> mStamps;
+        uint32_t mCurrentStamp;
+        std::vector<uint8_t> mHits;
+    };
+
+}
+
+#endif /* INCLUDE_LIGHT_LIGHTGRID_H_ */
@@ -9,30 +9,122 @@
 #define INCLUDE_LIGHT_LIGHTMANAGER_H_
 
 #include <osg/Group>
+#include <osg/Uniform>
 #include <vector>
+#include <ostream>
 
 #include "light/Light.h"
+#include "light/LightGrid.h"
+#include "UpdateScheduler.h"
+
+// must match the array sizes in the default shaders
+#define OD_MAX_LIGHTS_PER_OBJECT 8
 
 namespace od
 {
     class Engine;
     class LevelObject;
+    class Layer;
 
-    class LightManager
+    /**
+     * @brief Assigns point lights to the objects they affect.
+     *
+     * Lights are binned into a LightGrid. Static lights are binned once when their properties change, dynamic ones
+     * every frame. Each frame, every lit object queries the grid with it's bounding box and gets the most relevant
+     * lights published via uniform arrays on it's state set, in the object's local space.
+     *
+     * Lit objects also get the ambient and directional light of their lighting layer, or the default lighting if they
+     * have none. Everything else (e.g. layers, which have their lighting baked) is drawn with full ambient light only.
+     */
+    class LightManager : public Updatable
     {
     public:
 
+        struct Stats
+        {
+            double assignmentTimeMs;
+            size_t litObjectCount;
+            size_t updatedObjectCount;
+
+            /// number of objects per count of affecting lights. last bucket counts objects with more lights than the shader supports
+            size_t lightsPerObject[OD_MAX_LIGHTS_PER_OBJECT + 2];
+        };
+
         LightManager(Engine &engine, osg::Group *sceneRoot);
+        ~LightManager();
+
+        inline const Stats &getStats() const { return mStats; }
+
+        /// Changes whenever a light was moved, changed or removed. Lets users of sampleLight() know when to resample.
+        inline uint32_t getLightGeneration() const { return mLightGeneration; }
 
         Light *addLight(LevelObject *obj);
+        void removeLight(Light *light);
+
+        /**
+         * @brief Makes the given object receive light from the lights around it. Call when object is spawned.
+         */
+        void addLitObject(LevelObject *obj);
+        void removeLitObject(LevelObject *obj);
+
+        /**
+         * @brief Sets ambient and directional light for lit objects without a lighting layer and for instances.
+         *
+         * \c sunDirection points towards the light, in world space.
+         */
+        void setDefaultLighting(const osg::Vec4 &ambientColor, const osg::Vec3f &sunDirection, const osg::Vec4 &sunColor);
+
+        /**
+         * @brief Adds the default lighting uniforms to \c ss. For drawables that are lit in world space, like instances.
+         */
+        void addDefaultLightingUniforms(osg::StateSet *ss);
+
+        /**
+         * @brief Sums the color of all lights reaching \c point, using the shader's falloff but ignoring surface orientation.
+         *
+         * Does not include ambient light. Used for things that can't receive per-object light uniforms, like instances.
+         */
+        osg::Vec4 sampleLight(const osg::Vec3f &point);
+
+        void dumpStats(std::ostream &out) const;
+
+        // implement Updatable
+        virtual void update(double simTime, double relTime) override;
 
 
     private:
 
+        struct LitObject
+        {
+            osg::ref_ptr<LevelObject> object;
+            osg::ref_ptr<osg::Uniform> lightCount;
+            osg::ref_ptr<osg::Uniform> lightPositions;
+            osg::ref_ptr<osg::Uniform> lightColors;
+            osg::ref_ptr<osg::Uniform> ambientColor;
+            osg::ref_ptr<osg::Uniform> sunDirection; // in the object's local space
+            osg::ref_ptr<osg::Uniform> sunColor;
+            osg::ref_ptr<Layer> lightingLayer;
+            std::vector<LightGrid::LightId> lights;
+            osg::Matrix lastWorldMatrix;
+            uint32_t lightGeneration; // of the manager when the uniforms were last written
+        };
+
+        void _assignLights(LitObject &lo, bool force);
+        void _updateDirectionalLight(LitObject &lo, const osg::Matrix &worldToLocal);
+
         Engine &mEngine;
         osg::ref_ptr<osg::Group> mSceneRoot;
-        std::vector<osg::ref_ptr<Light>> mLights;
+        osg::ref_ptr<osg::Uniform> mDefaultAmbientColor;
+        osg::ref_ptr<osg::Uniform> mDefaultSunDirection;
+        osg::ref_ptr<osg::Uniform> mDefaultSunColor;
+        std::vector<osg::ref_ptr<Light>> mLights; // indexed by slot. removed lights leave a nullptr
+        std::vector<int32_t> mFreeSlots;
+        std::vector<LitObject> mLitObjects;
+        LightGrid mGrid;
+        uint32_t mLightGeneration;
+        Stats mStats;
 
+        std::vector<LightGrid::LightId> mCandidates;
     };
 
 }
@@ -9,6 +9,8 @@
 #define INCLUDE_PHYSICS_PHYSICSMANAGER_H_
 
 #include <memory>
+#include <vector>
+#include <map>
 #include <BulletDynamics/Dynamics/btRigidBody.h>
 #include <BulletDynamics/Dynamics/btDynamicsWorld.h>
 #include <BulletDynamics/ConstraintSolver/btConstraintSolver.h>
@@ -20,6 +22,7 @@
 #include <osg/NodeCallback>
 
 #include "physics/DebugDrawer.h"
+#include "UpdateScheduler.h"
 
 namespace od
 {
@@ -42,7 +45,7 @@ namespace od
 
 	struct RaycastResult
     {
-        const btCollisionObject *hitBulletObject;
+        const btCollisionObject *hitBulletObject; // nullptr if the skinned mesh of an animated object was hit
 
         osg::Vec3f hitPoint;
         osg::Vec3f hitNormal;
@@ -54,7 +57,7 @@ namespace od
 
 	typedef std::vector<RaycastResult> RaycastResultArray;
 
-	class PhysicsManager
+	class PhysicsManager : public Updatable
 	{
 	public:
 
@@ -65,11 +68,17 @@ namespace od
 
 		void stepSimulation(double dt);
 
+		// implement Updatable
+		virtual void update(double simTime, double relTime) override;
+
 		bool toggleDebugDraw();
 
 		/**
 		 * Casts a ray into the scene, returning all hit objects sorted by distance from start point.
 		 *
+		 * Objects skinned on the CPU (see Level::addSkinnedObject()) are tested against their animated mesh, so these
+		 * hits don't have a bullet object.
+		 *
 		 * @returns Number of hit objects.
 		 */
 		size_t raycast(const osg::Vec3f &start, const osg::Vec3f &end, RaycastResultArray &results);
@@ -84,6 +93,35 @@ namespace od
             return raycastClosest(start, end, result, exclude, CollisionGroups::OBJECT);
         }
 
+		/**
+		 * @brief Tests segments against the static layer shapes only, without going through the dynamics world.
+		 *
+		 * The broadphase keeps shared traversal state during rayTest(), so the world can't be queried from multiple threads.
+		 * This snapshots the layer bodies and their bounds on construction and only reads their shapes afterwards. Create one
+		 * per thread. Layers must not be added or removed while a tester is in use.
+		 */
+		class LayerRayTester
+		{
+		public:
+
+		    LayerRayTester(PhysicsManager &pm);
+
+		    /// Returns true if the segment hits any layer.
+		    bool hasHit(const osg::Vec3f &start, const osg::Vec3f &end) const;
+
+
+		private:
+
+		    struct LayerBody
+		    {
+		        btCollisionObject *object;
+		        btVector3 aabbMin;
+		        btVector3 aabbMax;
+		    };
+
+		    std::vector<LayerBody> mLayerBodies;
+		};
+
 		btRigidBody *addLayer(Layer &l);
 		void removeLayer(Layer &l);
 		btRigidBody *addObject(LevelObject &o, float mass);
@@ -92,9 +130,11 @@ namespace od
 
 	private:
 
+		/// Tests the segment against the skinned mesh of \c obj. On a hit, fills \c result and \c fraction.
+		bool _raycastSkinnedObject(LevelObject &obj, const osg::Vec3f &start, const osg::Vec3f &end, RaycastResult &result, float &fraction);
+
 		Level &mLevel;
 		osg::ref_ptr<osg::Group> mLevelRoot;
-		osg::ref_ptr<osg::NodeCallback> mTickCallback;
 
 		// order is important! mDynamicsWorld needs to be initialized last and destroyed first
 		std::unique_ptr<btBroadphaseInterface> mBroadphase;
@@ -87,6 +87,11 @@ namespace odRfl
 		inline size_t getClassTypeCount() const { return mRegistrarMap.size(); }
 		RflClassRegistrar &getClassRegistrarById(RflClassId id);
 
+		/**
+		 * @brief Like getClassRegistrarById(), but returns nullptr instead of throwing if the class is not registered.
+		 */
+		RflClassRegistrar *findClassRegistrarById(RflClassId id);
+
 
 		static Rfl &getSingleton();
 
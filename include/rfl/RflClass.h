@@ -44,6 +44,21 @@ namespace odRfl
 		virtual void update(od::LevelObject &obj, double simTime, double relTime);
 		virtual void messageReceived(od::LevelObject &obj, od::LevelObject &sender, RflMessage message);
 		virtual void destroyed(od::LevelObject &obj);
+
+		/**
+		 * Called when a message for this class is posted. If this returns true and an identical message is already
+		 * waiting to be delivered to this class's object, the new one is dropped. Only return true for messages
+		 * where receiving them once or multiple times in a row has the same effect.
+		 */
+		virtual bool allowsMessageCollapsing(RflMessage message) const;
+
+		/**
+		 * Called after an object of this class was spawned. If this returns true, the object's model may be drawn
+		 * instanced together with other objects using the same model. Objects that move, get hidden or enable their
+		 * update hook are taken out of instancing automatically, so only return false for classes that are
+		 * expected to do so constantly.
+		 */
+		virtual bool allowsInstancing() const;
 	};
 
 }
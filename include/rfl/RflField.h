@@ -181,7 +181,23 @@ namespace odRfl
 
         virtual ~RflAssetRef() = default;
 
-        virtual void fetchAssets(od::AssetProvider &ap) = 0;
+        /**
+         * @brief Fetches the referenced assets. Returns false if any of them could not be found.
+         *
+         * Assets that were found are kept even if others are missing.
+         */
+        virtual bool findAssets(od::AssetProvider &ap) = 0;
+
+        /**
+         * @brief Like findAssets(), but throws a NotFoundException if any referenced asset could not be found.
+         */
+        void fetchAssets(od::AssetProvider &ap)
+        {
+            if(!findAssets(ap))
+            {
+                throw od::NotFoundException("Asset referenced by class could not be found");
+            }
+        }
 
     };
 
@@ -203,19 +219,15 @@ namespace odRfl
             dr >> mReference;
         }
 
-	    virtual void fetchAssets(od::AssetProvider &ap) override
+	    virtual bool findAssets(od::AssetProvider &ap) override
 	    {
 	        if(mReferencedAsset == nullptr && !mReference.isNull())
             {
-                try
-                {
-                    mReferencedAsset = ap.getAssetByRef<_AssetType>(mReference);
-
-                }catch(od::NotFoundException &e)
-                {
-                    throw od::NotFoundException("Asset referenced by class could not be found");
-                }
+                mReferencedAsset = ap.findAssetByRef<_AssetType>(mReference);
+                return mReferencedAsset != nullptr;
             }
+
+	        return true;
 	    }
 
         _AssetType *getOrFetchAsset(od::AssetProvider &ap)
@@ -281,21 +293,25 @@ namespace odRfl
             mReferences.shrink_to_fit();
         }
 
-        virtual void fetchAssets(od::AssetProvider &ap) override
+        virtual bool findAssets(od::AssetProvider &ap) override
         {
+            // missing assets are left out, so indices only match the references if everything was found
+            bool allFound = true;
+            mReferencedAssets.clear();
             mReferencedAssets.reserve(mReferences.size());
-            try
+            for(auto it = mReferences.begin(); it != mReferences.end(); ++it)
             {
-                for(auto it = mReferences.begin(); it != mReferences.end(); ++it)
+                osg::ref_ptr<_AssetType> asset = ap.findAssetByRef<_AssetType>(*it);
+                if(asset == nullptr)
                 {
-                    osg::ref_ptr<_AssetType> asset = ap.getAssetByRef<_AssetType>(*it);
-                    mReferencedAssets.push_back(asset);
+                    allFound = false;
+                    continue;
                 }
 
-            }catch(od::NotFoundException &e)
-            {
-                throw od::NotFoundException("Asset referenced by class could not be found");
+                mReferencedAssets.push_back(asset);
             }
+
+            return allFound;
         }
 
         size_t getAssetCount()
@@ -10,11 +10,16 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <istream>
+
+#include "OdDefines.h"
 
 namespace od
 {
     class DataReader;
     class AssetProvider;
+    class MemBuffer;
 }
 
 namespace odRfl
@@ -49,35 +54,59 @@ namespace odRfl
 
 	};
 
+	/**
+	 * Fills an RflClass's fields from a class or object field record.
+	 *
+	 * The record is compiled into a field layout indexed by registration order when it is read, holding the data
+	 * offset and array span of each field. Filling a field is then a direct lookup and a read from a reader over
+	 * the record data that lives as long as the builder.
+	 *
+	 * Types, array flags and names are checked against the RflClass until markLayoutVerified() is called. After that,
+	 * names are only checked in builds defining OD_RFL_CHECK_FIELD_NAMES. A class builder is thus verified
+	 * once and replayed for every further instance of that class.
+	 */
 	class RflClassBuilder : public RflFieldProbe
 	{
 	public:
 
 	    RflClassBuilder();
+	    ~RflClassBuilder();
 
 		void readFieldRecord(od::DataReader &dr, bool isObjectRecord);
 
 		/// Resets internal index counter so this builder can be used to build another class.
 		void resetIndexCounter();
 
+		/// Call after an RflClass has been probed successfully. Skips further sanity checks on that layout.
+		void markLayoutVerified();
+
 		virtual void beginCategory(const char *categoryName) override;
 		virtual void registerField(RflField &field, const char *fieldName) override;
 
 
 	private:
 
+		static const uint32_t NO_FIELD = 0;
+
 		struct FieldEntry
 		{
-			uint32_t fieldType;
+			uint32_t fieldType; // NO_FIELD if record contains no field with this registration index
 			bool isArray;
-			uint16_t index;
-			size_t dataOffset; // offset of entry in mFieldData
-	        std::string fieldName;
+			size_t dataOffset; // offset of value in mFieldData. for arrays, that of the first element
+			uint16_t arrayLength;
+	        std::string fieldName; // only stored if it's going to be checked
 		};
 
-	    std::vector<FieldEntry> mFieldEntries;
+		void _checkField(const FieldEntry &entry, RflField &field, const char *fieldName);
+
+	    std::vector<FieldEntry> mFieldEntries; // indexed by registration index
 	    std::vector<char> mFieldData;
+	    std::unique_ptr<od::MemBuffer> mDataBuffer;
+	    std::unique_ptr<std::istream> mDataStream;
+	    std::unique_ptr<od::DataReader> mDataReader;
 	    size_t mRegistrationIndex;
+	    bool mLayoutVerified;
+	    bool mStoreNames;
 	};
 
 	class RflObjectBuilder : public RflFieldProbe
@@ -23,6 +23,7 @@ namespace odRfl
         virtual void probeFields(RflFieldProbe &probe) override;
         virtual void spawned(od::LevelObject &obj) override;
         virtual void despawned(od::LevelObject &obj) override;
+        virtual bool allowsInstancing() const override;
 
 
     protected:
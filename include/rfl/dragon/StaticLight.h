@@ -22,8 +22,13 @@ namespace odRfl
 
         StaticLight();
 
+        inline osg::Vec4 getColor() const { return mColor.asColorVector(); }
+        inline float getIntensityScaling() const { return mIntensityScaling; }
+        inline float getRadius() const { return mRadius; }
+
         virtual void probeFields(RflFieldProbe &probe) override;
         virtual void spawned(od::LevelObject &obj) override;
+        virtual void despawned(od::LevelObject &obj) override;
 
 
     protected:
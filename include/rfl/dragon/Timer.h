@@ -10,6 +10,7 @@
 
 #include "rfl/RflClass.h"
 #include "rfl/RflField.h"
+#include "TimerWheel.h"
 
 namespace odRfl
 {
@@ -32,7 +33,7 @@ namespace odRfl
         virtual void probeFields(RflFieldProbe &probe) override;
         virtual void loaded(od::Engine &engine, od::LevelObject *obj) override;
         virtual void spawned(od::LevelObject &obj) override;
-        virtual void update(od::LevelObject &obj, double simTime, double relTime) override;
+        virtual void despawned(od::LevelObject &obj) override;
         virtual void messageReceived(od::LevelObject &obj, od::LevelObject &sender, RflMessage message) override;
 
 
@@ -48,9 +49,16 @@ namespace odRfl
 
 	private:
 
+		void _schedule(od::LevelObject &obj);
+		void _unschedule();
+		void _triggered(od::LevelObject &obj);
+
+		od::TimerWheel *mTimerWheel;
+		od::TimerHandle mTimerHandle;
 		bool mGotStartTrigger;
 		bool mTimerRunning;
 		double mTimeElapsed;
+		double mTriggerTime;
 
 	};
 
@@ -8,11 +8,13 @@
 #ifndef INCLUDE_RFL_DRAGON_TRACKINGCAMERA_H_
 #define INCLUDE_RFL_DRAGON_TRACKINGCAMERA_H_
 
+#include <memory>
 #include <osg/Camera>
 
 #include "rfl/RflClass.h"
 #include "rfl/RflField.h"
 #include "Camera.h"
+#include "UpdateScheduler.h"
 
 namespace odRfl
 {
@@ -48,7 +50,7 @@ namespace odRfl
 
 		od::Engine *mEngine;
 		osg::ref_ptr<osg::Camera> mOsgCamera;
-		osg::ref_ptr<osg::NodeCallback> mCamUpdateCallback;
+		std::unique_ptr<od::Updatable> mCamUpdater;
 		osg::ref_ptr<od::LevelObject> mCameraLevelObject;
 	};
 
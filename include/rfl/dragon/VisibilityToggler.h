@@ -30,6 +30,7 @@ namespace odRfl
 
         virtual void loaded(od::Engine &e, od::LevelObject *obj) override;
         virtual void messageReceived(od::LevelObject &obj, od::LevelObject &sender, RflMessage message) override;
+        virtual bool allowsMessageCollapsing(RflMessage message) const override;
 
 
     protected:
@@ -1,70 +1,58 @@
-
-
 #version 120
 
+// must match OD_MAX_LIGHTS_PER_OBJECT
+#define MAX_LIGHTS 8
+
 // output for fragment shader
 varying vec3 vertexNormal;
 varying vec4 vertexColor;
 varying vec2 texCoord;
 
-/*struct gl_LightSourceParameters { 
-    vec4  ambient; 
-    vec4  diffuse; 
-    vec4  specular; 
-    vec4  position; 
-    vec4  halfVector; 
-    vec3  spotDirection; 
-    float  spotExponent; 
-    float  spotCutoff; 
-    float  spotCosCutoff; 
-    float  constantAttenuation; 
-    float  linearAttenuation; 
-    float  quadraticAttenuation; 
-};
+// point lights assigned to this object by the LightManager. positions are in model space, w is the radius
+uniform int lightCount;
+uniform vec4 lightPositions[MAX_LIGHTS];
+uniform vec4 lightColors[MAX_LIGHTS];
 
-uniform gl_LightSourceParameters gl_LightSource[gl_MaxLights]; */
+// light of the object's lighting layer. direction points towards the light, in model space
+uniform vec4 ambientColor;
+uniform vec3 sunDirection;
+uniform vec4 sunColor;
 
-vec4 calcLight(gl_LightSourceParameters light, vec3 vertex_cs, vec3 normal_cs, vec4 vertexColor)
+vec4 calcLight(vec4 lightPosition, vec4 lightColor, vec3 vertex_ms, vec3 normal_ms)
 {  
-    // calculate light direction and distance
-    vec3 lightDir_cs;
-    if(light.position.w == 0.0) // w = 0 means directional light
-    {
-        lightDir_cs = light.position.xyz;
-        
-    }else
-    {
-        lightDir_cs = light.position.xyz - vertex_cs;
-    }
-    float distance = length(lightDir_cs);
-    lightDir_cs = normalize(lightDir_cs);
+    vec3 lightDir_ms = lightPosition.xyz - vertex_ms;
+    float distance = length(lightDir_ms);
+    lightDir_ms = lightDir_ms/max(distance, 0.0001);
     
-    vec4 ambientColor = light.ambient * vertexColor;
+    float cosTheta = clamp(dot(normal_ms, lightDir_ms), 0.0, 1.0);
     
-    float cosTheta = clamp(dot(normal_cs, lightDir_cs), 0.0, 1.0);
-    float attenuation = 1.0/(light.constantAttenuation + 
-                light.linearAttenuation*distance + 
-                light.quadraticAttenuation*distance*distance);
-      
-    vec4 resultColor = ambientColor + vertexColor*cosTheta*attenuation*light.diffuse;
+    // falls off to exactly zero at the radius, so lights outside the assigned range can't pop
+    float attenuation = clamp(1.0 - distance/lightPosition.w, 0.0, 1.0);
+    attenuation *= attenuation;
       
-    return clamp(resultColor, 0.0, 1.0);
+    return lightColor*cosTheta*attenuation;
 }
 
 void main(void)
 {
-    vec3 vertex_cs = (gl_ModelViewMatrix * gl_Vertex).xyz;
-    vec3 normal_cs = normalize(gl_NormalMatrix * gl_Normal); 
+    vec3 vertex_ms = gl_Vertex.xyz;
+    vec3 normal_ms = normalize(gl_Normal); 
 
-    vec4 lightColor = vec4(0.0);
-    for(int i = 0; i < gl_MaxLights; ++i)
+    vec4 lightColor = ambientColor + sunColor*clamp(dot(normal_ms, sunDirection), 0.0, 1.0);
+    for(int i = 0; i < MAX_LIGHTS; ++i)
     {
-        lightColor += calcLight(gl_LightSource[i], vertex_cs, normal_cs, gl_Color);
+        if(i >= lightCount)
+        {
+            break;
+        }
+        
+        lightColor += calcLight(lightPositions[i], lightColors[i], vertex_ms, normal_ms);
     }
-    vertexColor = clamp(lightColor, 0.0, 1.0);
+    vertexColor = clamp(gl_Color*lightColor, 0.0, 1.0);
     
     gl_Position = gl_ProjectionMatrix * gl_ModelViewMatrix * gl_Vertex;
     vertexNormal = gl_NormalMatrix * gl_Normal;
-    texCoord = gl_MultiTexCoord0.xy;
+    texCoord = (gl_TextureMatrix[0] * gl_MultiTexCoord0).xy; // compact UVs are scaled via the texture matrix
 }
 
+
@@ -0,0 +1,46 @@
+#version 120
+#extension GL_ARB_draw_instanced : require
+
+// output for fragment shader
+varying vec3 vertexNormal;
+varying vec4 vertexColor;
+varying vec2 texCoord;
+
+// per-instance data written by the InstanceManager. one row per instance: three rows of the model matrix, then the
+//  color of the point lights reaching the instance
+uniform sampler2D instanceData;
+uniform float instanceDataHeight;
+
+// index of the first instance drawn by the current range
+uniform int instanceOffset;
+
+// default light for objects set by the LightManager. direction points towards the light, in world space
+uniform vec4 ambientColor;
+uniform vec3 sunDirection;
+uniform vec4 sunColor;
+
+vec4 fetchInstanceTexel(float instance, float texel)
+{
+    return texture2DLod(instanceData, vec2((texel + 0.5)/4.0, (instance + 0.5)/instanceDataHeight), 0.0);
+}
+
+void main(void)
+{
+    float instance = float(instanceOffset + gl_InstanceIDARB);
+    vec4 row0 = fetchInstanceTexel(instance, 0.0);
+    vec4 row1 = fetchInstanceTexel(instance, 1.0);
+    vec4 row2 = fetchInstanceTexel(instance, 2.0);
+    vec4 instanceLight = fetchInstanceTexel(instance, 3.0);
+
+    vec4 vertex_ms = vec4(gl_Vertex.xyz, 1.0);
+    vec4 vertex_ws = vec4(dot(row0, vertex_ms), dot(row1, vertex_ms), dot(row2, vertex_ms), 1.0);
+    vec3 normal_ws = vec3(dot(row0.xyz, gl_Normal), dot(row1.xyz, gl_Normal), dot(row2.xyz, gl_Normal));
+
+    vec4 sunLight = sunColor*clamp(dot(normalize(normal_ws), sunDirection), 0.0, 1.0);
+    vertexColor = clamp(gl_Color*(ambientColor + sunLight + vec4(instanceLight.rgb, 0.0)), 0.0, 1.0);
+
+    // instances are drawn from a node in world space, so the modelview matrix is just the view matrix
+    gl_Position = gl_ProjectionMatrix * gl_ModelViewMatrix * vertex_ws;
+    vertexNormal = gl_NormalMatrix * normalize(normal_ws);
+    texCoord = (gl_TextureMatrix[0] * gl_MultiTexCoord0).xy; // compact UVs are scaled via the texture matrix
+}
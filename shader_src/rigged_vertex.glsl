@@ -3,6 +3,7 @@
 
 attribute vec4 influencingBones;
 attribute vec4 vertexWeights;
+// the bone palette of the drawn geometry. must match OD_MAX_BONE_COUNT
 uniform mat4 bones[64];
 
 // output for fragment shader
@@ -30,7 +31,7 @@ void main(void)
     vertexNormal = gl_NormalMatrix * newNormal.xyz;
     
     vertexColor = gl_Color;
-    texCoord = gl_MultiTexCoord0.xy;
+    texCoord = (gl_TextureMatrix[0] * gl_MultiTexCoord0).xy; // compact UVs are scaled via the texture matrix
 }
 
 
@@ -0,0 +1,477 @@
+/*
+ * Archive.cpp
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#include "Archive.h"
+
+#include <algorithm>
+#include <fstream>
+#include <zlib.h>
+
+#include "Exception.h"
+#include "Logger.h"
+#include "DataStream.h"
+#include "StringUtils.h"
+
+#if !defined (__WIN32__)
+extern "C"
+{
+#	include <dirent.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+}
+#endif
+
+#define OD_ARCHIVE_MAGIC        0x4b50444f // 'ODPK' in LE
+#define OD_ARCHIVE_VERSION      1
+#define OD_ARCHIVE_ALIGNMENT    4096
+#define OD_ARCHIVE_HEADER_SIZE  20
+
+namespace od
+{
+
+    /**
+     * Stream over an archive entry. Either reads straight from the archive's mapping or from a buffer it owns.
+     */
+    class ArchiveEntryStream : public std::istream
+    {
+    public:
+
+        ArchiveEntryStream(const char *begin, const char *end)
+        : std::istream(nullptr)
+        , mBuffer(const_cast<char*>(begin), const_cast<char*>(end)) // MemBuffer only ever reads
+        {
+            rdbuf(&mBuffer);
+        }
+
+        ArchiveEntryStream(std::vector<char> &&data)
+        : std::istream(nullptr)
+        , mData(std::move(data))
+        , mBuffer(mData.data(), mData.data() + mData.size())
+        {
+            rdbuf(&mBuffer);
+        }
+
+
+    private:
+
+        std::vector<char> mData;
+        MemBuffer mBuffer;
+    };
+
+
+    static void writeU16(std::ostream &out, uint16_t v)
+    {
+        char b[2] = { char(v & 0xff), char((v >> 8) & 0xff) };
+        out.write(b, sizeof(b));
+    }
+
+    static void writeU32(std::ostream &out, uint32_t v)
+    {
+        writeU16(out, v & 0xffff);
+        writeU16(out, (v >> 16) & 0xffff);
+    }
+
+    static void writeU64(std::ostream &out, uint64_t v)
+    {
+        writeU32(out, v & 0xffffffff);
+        writeU32(out, (v >> 32) & 0xffffffff);
+    }
+
+    static void writeString(std::ostream &out, const std::string &s)
+    {
+        writeU16(out, s.size());
+        out.write(s.data(), s.size());
+    }
+
+    static bool isPackedExtension(const std::string &filename)
+    {
+        static const char *extensions[] = { ".db", ".odb", ".mod", ".adb", ".sdb", ".ssd", ".txd", ".lvl" };
+
+        std::string lowerName = StringUtils::toLower(filename);
+        for(const char *ext : extensions)
+        {
+            if(StringUtils::endsWith(lowerName, ext))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+#if !defined (__WIN32__)
+    static void collectFiles(const std::string &dirPath, const std::string &relativePath, std::vector<std::string> &files)
+    {
+        DIR *dir = opendir(dirPath.c_str());
+        if(dir == NULL)
+        {
+            return;
+        }
+
+        std::vector<std::string> subdirs;
+
+        dirent *entry = readdir(dir);
+        while(entry != NULL)
+        {
+            std::string name(entry->d_name);
+            if(name != "." && name != "..")
+            {
+                std::string fullPath = dirPath + "/" + name;
+                struct stat st;
+                if(stat(fullPath.c_str(), &st) == 0)
+                {
+                    if(S_ISDIR(st.st_mode))
+                    {
+                        subdirs.push_back(name);
+
+                    }else if(S_ISREG(st.st_mode) && isPackedExtension(name))
+                    {
+                        files.push_back(relativePath + name);
+                    }
+                }
+            }
+
+            entry = readdir(dir);
+        }
+
+        closedir(dir);
+
+        for(auto &subdir : subdirs)
+        {
+            collectFiles(dirPath + "/" + subdir, relativePath + subdir + "/", files);
+        }
+    }
+#endif
+
+
+    Archive::Archive(const FilePath &archivePath)
+    : mArchivePath(archivePath)
+    , mMapping(nullptr)
+    , mMappingSize(0)
+    {
+        std::string dirStr = StringUtils::toLower(archivePath.dir().str());
+        std::replace(dirStr.begin(), dirStr.end(), '\\', '/');
+        mRootPrefix = (dirStr == ".") ? "" : (dirStr + "/");
+
+        mFile.open(archivePath.str(), std::ios::in | std::ios::binary);
+        if(mFile.fail())
+        {
+            throw IoException("Could not open archive " + archivePath.str());
+        }
+
+        DataReader dr(mFile);
+
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint64_t indexOffset;
+        dr >> magic
+           >> version
+           >> entryCount
+           >> indexOffset;
+
+        if(magic != OD_ARCHIVE_MAGIC)
+        {
+            throw Exception("Invalid magic number in archive");
+        }
+
+        if(version != OD_ARCHIVE_VERSION)
+        {
+            throw UnsupportedException("Unsupported archive version");
+        }
+
+        dr.seek(indexOffset);
+
+        mEntries.resize(entryCount);
+        for(size_t i = 0; i < entryCount; ++i)
+        {
+            Entry &e = mEntries[i];
+            dr >> e.path
+               >> e.offset
+               >> e.storedSize
+               >> e.size
+               >> e.flags;
+
+            e.srscVersion = 0;
+            if(e.flags & FLAG_SRSC)
+            {
+                uint32_t recordCount;
+                dr >> e.srscVersion
+                   >> recordCount;
+
+                e.srscDirectory.resize(recordCount);
+                for(size_t r = 0; r < recordCount; ++r)
+                {
+                    SrscFile::DirEntry &de = e.srscDirectory[r];
+                    de.index = r;
+                    dr >> de.type
+                       >> de.recordId
+                       >> de.groupId
+                       >> de.dataOffset
+                       >> de.dataSize;
+                }
+            }
+
+            mEntryIndex[e.path] = i;
+        }
+
+#if !defined (__WIN32__)
+        int fd = open(archivePath.str().c_str(), O_RDONLY);
+        if(fd >= 0)
+        {
+            struct stat st;
+            if(fstat(fd, &st) == 0 && st.st_size > 0)
+            {
+                void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if(mapping != MAP_FAILED)
+                {
+                    mMapping = static_cast<const char*>(mapping);
+                    mMappingSize = st.st_size;
+                }
+            }
+
+            close(fd);
+        }
+#endif
+
+        Logger::info() << "Mounted archive " << archivePath.str() << " with " << entryCount << " files" << (mMapping == nullptr ? " (not mapped)" : "");
+    }
+
+    Archive::~Archive()
+    {
+#if !defined (__WIN32__)
+        if(mMapping != nullptr)
+        {
+            munmap(const_cast<char*>(mMapping), mMappingSize);
+        }
+#endif
+    }
+
+    const Archive::Entry *Archive::findEntry(const FilePath &path) const
+    {
+        auto it = mEntryIndex.find(_getKey(path));
+        if(it == mEntryIndex.end())
+        {
+            return nullptr;
+        }
+
+        return &mEntries[it->second];
+    }
+
+    std::unique_ptr<std::istream> Archive::openFile(const FilePath &path)
+    {
+        const Entry *entry = findEntry(path);
+        if(entry == nullptr)
+        {
+            return nullptr;
+        }
+
+        return _openEntry(*entry);
+    }
+
+    std::unique_ptr<SrscFile> Archive::openSrscFile(const FilePath &path)
+    {
+        const Entry *entry = findEntry(path);
+        if(entry == nullptr)
+        {
+            return nullptr;
+        }
+
+        if(!(entry->flags & FLAG_SRSC))
+        {
+            throw Exception("Archive entry " + entry->path + " is not an SRSC container");
+        }
+
+        return std::unique_ptr<SrscFile>(new SrscFile(path, _openEntry(*entry), entry->srscVersion, &entry->srscDirectory));
+    }
+
+    std::string Archive::_getKey(const FilePath &path) const
+    {
+        std::string key = StringUtils::toLower(path.str());
+        std::replace(key.begin(), key.end(), '\\', '/');
+
+        if(!StringUtils::startsWith(key, mRootPrefix))
+        {
+            return "";
+        }
+
+        return key.substr(mRootPrefix.size());
+    }
+
+    std::unique_ptr<std::istream> Archive::_openEntry(const Entry &entry)
+    {
+        if(mMapping != nullptr && !(entry.flags & FLAG_COMPRESSED))
+        {
+            if(entry.offset + entry.size > mMappingSize)
+            {
+                throw IoException("Archive entry " + entry.path + " exceeds archive size");
+            }
+
+            const char *begin = mMapping + entry.offset;
+            return std::unique_ptr<std::istream>(new ArchiveEntryStream(begin, begin + entry.size));
+        }
+
+        std::vector<char> stored(entry.storedSize);
+        if(mMapping != nullptr && entry.offset + entry.storedSize <= mMappingSize)
+        {
+            std::copy(mMapping + entry.offset, mMapping + entry.offset + entry.storedSize, stored.begin());
+
+        }else
+        {
+            std::lock_guard<std::mutex> lock(mFileMutex);
+            mFile.clear();
+            mFile.seekg(entry.offset);
+            mFile.read(stored.data(), stored.size());
+            if(static_cast<size_t>(mFile.gcount()) != stored.size())
+            {
+                throw IoException("Unexpected end of archive while reading " + entry.path);
+            }
+        }
+
+        if(!(entry.flags & FLAG_COMPRESSED))
+        {
+            return std::unique_ptr<std::istream>(new ArchiveEntryStream(std::move(stored)));
+        }
+
+        std::vector<char> inflated(entry.size);
+        uLongf inflatedSize = inflated.size();
+        int result = uncompress(reinterpret_cast<Bytef*>(inflated.data()), &inflatedSize, reinterpret_cast<const Bytef*>(stored.data()), stored.size());
+        if(result != Z_OK || inflatedSize != inflated.size())
+        {
+            throw IoException("Failed to inflate archive entry " + entry.path);
+        }
+
+        return std::unique_ptr<std::istream>(new ArchiveEntryStream(std::move(inflated)));
+    }
+
+    void Archive::build(const FilePath &installDir, const FilePath &archivePath, bool compress)
+    {
+#if defined (__WIN32__)
+        throw UnsupportedException("Building archives is not supported on this platform yet");
+#else
+        std::vector<std::string> files;
+        collectFiles(installDir.str(), "", files);
+        std::sort(files.begin(), files.end());
+
+        Logger::info() << "Packing " << files.size() << " files from " << installDir.str() << " into " << archivePath.str();
+
+        std::ofstream out(archivePath.str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if(out.fail())
+        {
+            throw IoException("Could not create archive " + archivePath.str());
+        }
+
+        // placeholder header. index offset is patched in once we know it
+        writeU32(out, OD_ARCHIVE_MAGIC);
+        writeU32(out, OD_ARCHIVE_VERSION);
+        writeU32(out, files.size());
+        writeU64(out, 0);
+
+        std::vector<Entry> entries;
+        entries.reserve(files.size());
+        uint64_t totalSize = 0;
+        uint64_t totalStored = 0;
+        for(auto &relativePath : files)
+        {
+            FilePath filePath(relativePath, installDir);
+
+            std::ifstream in(filePath.str(), std::ios::in | std::ios::binary);
+            std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            if(in.bad())
+            {
+                throw IoException("Could not read " + filePath.str());
+            }
+
+            Entry e;
+            e.path = StringUtils::toLower(relativePath);
+            e.size = data.size();
+            e.flags = 0;
+            e.srscVersion = 0;
+
+            if(data.size() >= 4 && std::equal(data.begin(), data.begin() + 4, "SRSC"))
+            {
+                SrscFile srsc(filePath);
+                e.flags |= FLAG_SRSC;
+                e.srscVersion = srsc.getVersion();
+                e.srscDirectory = srsc.getDirectory();
+            }
+
+            std::vector<char> compressed;
+            if(compress && !data.empty())
+            {
+                uLongf compressedSize = compressBound(data.size());
+                compressed.resize(compressedSize);
+                int result = compress2(reinterpret_cast<Bytef*>(compressed.data()), &compressedSize,
+                        reinterpret_cast<const Bytef*>(data.data()), data.size(), Z_BEST_SPEED);
+                if(result == Z_OK && compressedSize < data.size())
+                {
+                    compressed.resize(compressedSize);
+                    e.flags |= FLAG_COMPRESSED;
+                }
+            }
+
+            const std::vector<char> &stored = (e.flags & FLAG_COMPRESSED) ? compressed : data;
+
+            // pad up to next page boundary
+            uint64_t pos = out.tellp();
+            uint64_t alignedPos = (pos + OD_ARCHIVE_ALIGNMENT - 1) & ~static_cast<uint64_t>(OD_ARCHIVE_ALIGNMENT - 1);
+            for(; pos < alignedPos; ++pos)
+            {
+                out.put(0);
+            }
+
+            e.offset = alignedPos;
+            e.storedSize = stored.size();
+            out.write(stored.data(), stored.size());
+
+            totalSize += e.size;
+            totalStored += e.storedSize;
+
+            Logger::verbose() << "Packed " << e.path << " (" << e.size << " bytes, " << e.storedSize << " stored)";
+
+            entries.push_back(std::move(e));
+        }
+
+        uint64_t indexOffset = out.tellp();
+        for(auto &e : entries)
+        {
+            writeString(out, e.path);
+            writeU64(out, e.offset);
+            writeU32(out, e.storedSize);
+            writeU32(out, e.size);
+            writeU32(out, e.flags);
+
+            if(e.flags & FLAG_SRSC)
+            {
+                writeU16(out, e.srscVersion);
+                writeU32(out, e.srscDirectory.size());
+                for(auto &de : e.srscDirectory)
+                {
+                    writeU16(out, de.type);
+                    writeU16(out, de.recordId);
+                    writeU16(out, de.groupId);
+                    writeU32(out, de.dataOffset);
+                    writeU32(out, de.dataSize);
+                }
+            }
+        }
+
+        out.seekp(OD_ARCHIVE_HEADER_SIZE - sizeof(uint64_t));
+        writeU64(out, indexOffset);
+
+        if(out.fail())
+        {
+            throw IoException("Error while writing archive " + archivePath.str());
+        }
+
+        Logger::info() << "Archive done. " << totalSize << " bytes of data stored in " << totalStored << " bytes";
+#endif
+    }
+
+}
@@ -0,0 +1,609 @@
+/*
+ * Benchmarks.cpp
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#include "Benchmarks.h"
+
+#include <vector>
+#include <random>
+#include <iomanip>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <algorithm>
+#include <osg/Timer>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/LOD>
+
+#include "Exception.h"
+#include "TimerWheel.h"
+#include "audio/SoundMixer.h"
+#include "light/LightGrid.h"
+#include "InstanceManager.h"
+#include "MeshSimplifier.h"
+#include "GeodeBuilder.h"
+#include "OdDefines.h"
+#include "anim/CpuSkinner.h"
+
+namespace od
+{
+
+    static double _nsPerOp(osg::Timer_t start, osg::Timer_t end, size_t ops)
+    {
+        return (ops > 0) ? osg::Timer::instance()->delta_n(start, end)/ops : 0.0;
+    }
+
+    static void _benchmarkTimers(std::ostream &out)
+    {
+        // per-op cost should stay flat as the number of pending timers grows
+        static const size_t counts[] = { 10000, 100000, 1000000 };
+        static const double maxDelay = 60.0;
+        static const double frameTime = 1.0/60;
+
+        out << std::setw(10) << "timers"
+            << std::setw(16) << "schedule ns/op"
+            << std::setw(16) << "cancel ns/op"
+            << std::setw(16) << "expire ns/op"
+            << std::setw(12) << "frames" << std::endl;
+
+        for(size_t count : counts)
+        {
+            std::mt19937 rng(1234);
+            std::uniform_real_distribution<double> delayDist(0.0, maxDelay);
+
+            TimerWheel wheel;
+            std::vector<TimerHandle> handles;
+            handles.reserve(count);
+            size_t fired = 0;
+            auto callback = [&fired](){ ++fired; };
+
+            osg::Timer_t start = osg::Timer::instance()->tick();
+            for(size_t i = 0; i < count; ++i)
+            {
+                handles.push_back(wheel.schedule(delayDist(rng), callback));
+            }
+            osg::Timer_t end = osg::Timer::instance()->tick();
+            double scheduleNs = _nsPerOp(start, end, count);
+
+            // cancel every tenth timer
+            size_t cancelled = 0;
+            start = osg::Timer::instance()->tick();
+            for(size_t i = 0; i < count; i += 10)
+            {
+                wheel.cancel(handles[i]);
+                ++cancelled;
+            }
+            end = osg::Timer::instance()->tick();
+            double cancelNs = _nsPerOp(start, end, cancelled);
+
+            // advance in frame sized steps like the engine does
+            size_t frames = 0;
+            double simTime = 0.0;
+            start = osg::Timer::instance()->tick();
+            while(wheel.getPendingCount() > 0)
+            {
+                simTime += frameTime;
+                wheel.advance(simTime);
+                ++frames;
+            }
+            end = osg::Timer::instance()->tick();
+            double expireNs = _nsPerOp(start, end, fired);
+
+            out << std::setw(10) << count
+                << std::setw(16) << std::fixed << std::setprecision(1) << scheduleNs
+                << std::setw(16) << cancelNs
+                << std::setw(16) << expireNs
+                << std::setw(12) << frames << std::endl;
+
+            if(fired + cancelled != count)
+            {
+                out << "  ERROR: " << fired << " fired and " << cancelled << " cancelled out of " << count << std::endl;
+            }
+        }
+    }
+
+    static void _benchmarkMixer(std::ostream &out)
+    {
+        static const size_t voiceCounts[] = { 8, 32, 128 };
+        static const uint32_t outputFrequency = 22050;
+        static const size_t blockSize = 512;
+        static const size_t blockCount = 2000; // about 46 seconds of audio
+
+        out << std::setw(10) << "voices"
+            << std::setw(20) << "ns/sample/voice"
+            << std::setw(16) << "realtime x" << std::endl;
+
+        // mix of sounds at native and foreign rates, so both the copy and interpolation paths are covered
+        std::mt19937 rng(1234);
+        std::uniform_int_distribution<int> sampleDist(-20000, 20000);
+        std::vector<osg::ref_ptr<PcmBuffer>> buffers;
+        static const uint32_t frequencies[] = { 22050, 11025, 44100, 8000 };
+        for(size_t i = 0; i < 4; ++i)
+        {
+            std::vector<int16_t> samples(frequencies[i]*2);
+            for(int16_t &s : samples)
+            {
+                s = sampleDist(rng);
+            }
+            buffers.push_back(new PcmBuffer(std::move(samples)));
+        }
+
+        std::vector<int16_t> block(blockSize);
+        for(size_t voiceCount : voiceCounts)
+        {
+            SoundMixer mixer(std::unique_ptr<AudioSink>(new NullAudioSink), outputFrequency, voiceCount);
+            for(size_t i = 0; i < voiceCount; ++i)
+            {
+                SoundMixer::VoiceSettings settings;
+                settings.looping = true;
+                settings.positional = true;
+                settings.position = osg::Vec3f(i, 0, 0);
+                settings.dropoff = 1.0f;
+                mixer.play(buffers[i % buffers.size()], frequencies[i % buffers.size()], settings);
+            }
+
+            osg::Timer_t start = osg::Timer::instance()->tick();
+            for(size_t b = 0; b < blockCount; ++b)
+            {
+                mixer.mix(block.data(), block.size());
+            }
+            osg::Timer_t end = osg::Timer::instance()->tick();
+
+            double seconds = osg::Timer::instance()->delta_s(start, end);
+            double audioSeconds = static_cast<double>(blockSize*blockCount)/outputFrequency;
+
+            out << std::setw(10) << voiceCount
+                << std::setw(20) << std::fixed << std::setprecision(2) << _nsPerOp(start, end, blockSize*blockCount*voiceCount)
+                << std::setw(16) << std::setprecision(1) << audioSeconds/seconds << std::endl;
+
+            if(mixer.getStats().activeVoices != voiceCount)
+            {
+                out << "  ERROR: only " << mixer.getStats().activeVoices << " of " << voiceCount << " voices active" << std::endl;
+            }
+        }
+    }
+
+    static void _benchmarkLights(std::ostream &out)
+    {
+        // torch-lit level of roughly the size of the bigger original levels
+        static const size_t lightCounts[] = { 100, 500, 2000 };
+        static const size_t objectCount = 5000;
+        static const float levelExtent = 256.0f;
+        static const float levelHeight = 32.0f;
+        static const size_t maxBucket = 12;
+
+        out << std::setw(10) << "lights"
+            << std::setw(16) << "insert ns/op"
+            << std::setw(16) << "assign ns/obj"
+            << std::setw(14) << "avg lights" << "   histogram (lights: objects)" << std::endl;
+
+        for(size_t lightCount : lightCounts)
+        {
+            std::mt19937 rng(1234);
+            std::uniform_real_distribution<float> xzDist(0.0f, levelExtent);
+            std::uniform_real_distribution<float> yDist(0.0f, levelHeight);
+            std::uniform_real_distribution<float> radiusDist(2.0f, 8.0f);
+            std::uniform_real_distribution<float> objectSizeDist(0.5f, 3.0f);
+
+            LightGrid grid(8.0f);
+            osg::Timer_t start = osg::Timer::instance()->tick();
+            for(size_t i = 0; i < lightCount; ++i)
+            {
+                grid.insert(i, osg::Vec3f(xzDist(rng), yDist(rng), xzDist(rng)), radiusDist(rng));
+            }
+            osg::Timer_t end = osg::Timer::instance()->tick();
+            double insertNs = _nsPerOp(start, end, lightCount);
+
+            std::vector<osg::Vec3f> objectMin;
+            std::vector<osg::Vec3f> objectMax;
+            for(size_t i = 0; i < objectCount; ++i)
+            {
+                osg::Vec3f center(xzDist(rng), yDist(rng), xzDist(rng));
+                float size = objectSizeDist(rng);
+                objectMin.push_back(center - osg::Vec3f(size, size, size));
+                objectMax.push_back(center + osg::Vec3f(size, size, size));
+            }
+
+            std::vector<size_t> histogram(maxBucket + 1, 0);
+            std::vector<LightGrid::LightId> ids;
+            size_t totalLights = 0;
+            start = osg::Timer::instance()->tick();
+            for(size_t i = 0; i < objectCount; ++i)
+            {
+                ids.clear();
+                grid.query(objectMin[i], objectMax[i], ids);
+                totalLights += ids.size();
+                histogram[std::min(ids.size(), maxBucket)]++;
+            }
+            end = osg::Timer::instance()->tick();
+
+            out << std::setw(10) << lightCount
+                << std::setw(16) << std::fixed << std::setprecision(1) << insertNs
+                << std::setw(16) << _nsPerOp(start, end, objectCount)
+                << std::setw(14) << std::setprecision(2) << static_cast<double>(totalLights)/objectCount << "  ";
+
+            for(size_t b = 0; b <= maxBucket; ++b)
+            {
+                out << " " << b << ((b == maxBucket) ? "+:" : ":") << histogram[b];
+            }
+            out << std::endl;
+        }
+    }
+
+    static osg::ref_ptr<osg::Geode> _makeBenchmarkGeode(size_t drawableCount, size_t trianglesPerDrawable)
+    {
+        osg::ref_ptr<osg::Vec3Array> vertices(new osg::Vec3Array);
+        for(size_t i = 0; i < trianglesPerDrawable*3; ++i)
+        {
+            vertices->push_back(osg::Vec3f(i%3, (i/3)%5, i%7));
+        }
+
+        osg::ref_ptr<osg::Geode> geode(new osg::Geode);
+        for(size_t d = 0; d < drawableCount; ++d)
+        {
+            osg::ref_ptr<osg::Geometry> geometry(new osg::Geometry);
+            geometry->setVertexArray(vertices);
+            geometry->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::TRIANGLES, 0, vertices->size()));
+            geode->addDrawable(geometry);
+        }
+
+        return geode;
+    }
+
+    static void _benchmarkInstancing(std::ostream &out)
+    {
+        // a forested outdoor level. a few tree and rock models, most with LODs and several textures
+        static const size_t instanceCounts[] = { 1000, 5000, 20000 };
+        static const size_t modelCount = 6;
+        static const float levelExtent = 1024.0f;
+        static const size_t viewCount = 64;
+
+        std::vector<osg::ref_ptr<osg::Node>> models;
+        for(size_t m = 0; m < modelCount; ++m)
+        {
+            osg::ref_ptr<osg::Group> model(new osg::Group);
+            if(m%2 == 0)
+            {
+                osg::ref_ptr<osg::LOD> lod(new osg::LOD);
+                lod->addChild(_makeBenchmarkGeode(3, 200), 0.0f, 64.0f);
+                lod->addChild(_makeBenchmarkGeode(2, 40), 64.0f, std::numeric_limits<float>::max());
+                model->addChild(lod);
+
+            }else
+            {
+                model->addChild(_makeBenchmarkGeode(2, 100));
+            }
+            models.push_back(model);
+        }
+
+        out << std::setw(10) << "instances"
+            << std::setw(14) << "add ns/op"
+            << std::setw(14) << "rebuild ms"
+            << std::setw(14) << "cull ns/range"
+            << std::setw(10) << "ranges"
+            << std::setw(14) << "draw calls"
+            << std::setw(14) << "uninstanced"
+            << std::setw(14) << "visible" << std::endl;
+
+        for(size_t instanceCount : instanceCounts)
+        {
+            std::mt19937 rng(1234);
+            std::uniform_real_distribution<float> xzDist(0.0f, levelExtent);
+            std::uniform_real_distribution<float> angleDist(0.0f, 2*M_PI);
+            std::uniform_real_distribution<float> scaleDist(0.8f, 1.5f);
+            std::uniform_int_distribution<size_t> modelDist(0, modelCount - 1);
+
+            InstanceManager manager(nullptr);
+
+            osg::Timer_t start = osg::Timer::instance()->tick();
+            for(size_t i = 0; i < instanceCount; ++i)
+            {
+                osg::Matrix transform = osg::Matrix::scale(osg::Vec3f(1, 1, 1)*scaleDist(rng))
+                        * osg::Matrix::rotate(angleDist(rng), osg::Vec3f(0, 1, 0))
+                        * osg::Matrix::translate(xzDist(rng), 0.0f, xzDist(rng));
+                manager.addInstance(models[modelDist(rng)], transform);
+            }
+            osg::Timer_t end = osg::Timer::instance()->tick();
+            double addNs = _nsPerOp(start, end, instanceCount);
+
+            start = osg::Timer::instance()->tick();
+            manager.updateGroups();
+            end = osg::Timer::instance()->tick();
+            double rebuildMs = osg::Timer::instance()->delta_m(start, end);
+
+            // walk the camera along a circle through the level, looking outwards
+            osg::Matrix projection = osg::Matrix::perspective(60.0, 4.0/3.0, 0.5, 256.0);
+            size_t visibleRanges = 0;
+            start = osg::Timer::instance()->tick();
+            for(size_t v = 0; v < viewCount; ++v)
+            {
+                float angle = 2*M_PI*v/viewCount;
+                osg::Vec3f direction(std::cos(angle), 0.0f, std::sin(angle));
+                osg::Vec3f eye = osg::Vec3f(levelExtent/2, 4.0f, levelExtent/2) + direction*(levelExtent/4);
+                osg::Matrix view = osg::Matrix::lookAt(eye, eye + direction, osg::Vec3f(0, 1, 0));
+
+                osg::Polytope frustum;
+                frustum.setToUnitFrustum();
+                frustum.transformProvidingInverse(view*projection);
+                visibleRanges += manager.cull(frustum);
+            }
+            end = osg::Timer::instance()->tick();
+
+            const InstanceManager::Stats &stats = manager.getStats();
+            out << std::setw(10) << instanceCount
+                << std::setw(14) << std::fixed << std::setprecision(1) << addNs
+                << std::setw(14) << std::setprecision(2) << rebuildMs
+                << std::setw(14) << std::setprecision(1) << _nsPerOp(start, end, viewCount*stats.rangeCount)
+                << std::setw(10) << stats.rangeCount
+                << std::setw(14) << stats.instancedDrawCalls
+                << std::setw(14) << stats.uninstancedDrawCalls
+                << std::setw(13) << std::setprecision(1) << (100.0*visibleRanges)/(viewCount*stats.rangeCount) << "%" << std::endl;
+        }
+    }
+
+    static void _benchmarkSimplify(std::ostream &out)
+    {
+        // unit spheres made of quads, with a UV seam and two textures like many character and prop models
+        static const size_t ringCounts[] = { 16, 32, 64 };
+        static const size_t levelCount = 3;
+
+        out << std::setw(10) << "triangles"
+            << std::setw(8) << "level"
+            << std::setw(12) << "target"
+            << std::setw(12) << "result"
+            << std::setw(12) << "error"
+            << std::setw(16) << "ns/collapse" << std::endl;
+
+        for(size_t rings : ringCounts)
+        {
+            size_t segments = rings*2;
+
+            std::vector<osg::Vec3f> vertices;
+            for(size_t r = 0; r <= rings; ++r)
+            {
+                for(size_t s = 0; s <= segments; ++s)
+                {
+                    float theta = M_PI*r/rings;
+                    float phi = 2*M_PI*s/segments;
+                    vertices.push_back(osg::Vec3f(std::sin(theta)*std::cos(phi), std::cos(theta), std::sin(theta)*std::sin(phi)));
+                }
+            }
+
+            std::vector<Polygon> polygons;
+            for(size_t r = 0; r < rings; ++r)
+            {
+                for(size_t s = 0; s < segments; ++s)
+                {
+                    Polygon poly;
+                    poly.vertexCount = 4;
+                    poly.doubleSided = false;
+                    poly.texture.assetId = (s < segments/2) ? 1 : 2;
+                    poly.vertexIndices[0] = r*(segments+1) + s;
+                    poly.vertexIndices[1] = r*(segments+1) + s + 1;
+                    poly.vertexIndices[2] = (r+1)*(segments+1) + s + 1;
+                    poly.vertexIndices[3] = (r+1)*(segments+1) + s;
+                    poly.uvCoords[0] = osg::Vec2f(float(s)/segments, float(r)/rings);
+                    poly.uvCoords[1] = osg::Vec2f(float(s+1)/segments, float(r)/rings);
+                    poly.uvCoords[2] = osg::Vec2f(float(s+1)/segments, float(r+1)/rings);
+                    poly.uvCoords[3] = osg::Vec2f(float(s)/segments, float(r+1)/rings);
+                    polygons.push_back(poly);
+                }
+            }
+
+            MeshSimplifier simplifier("benchmark sphere");
+            simplifier.setVertexVector(vertices.begin(), vertices.end());
+            simplifier.setPolygonVector(polygons.begin(), polygons.end());
+            size_t originalCount = simplifier.getOriginalTriangleCount();
+
+            for(size_t level = 1; level <= levelCount; ++level)
+            {
+                size_t countBefore = simplifier.getTriangleCount();
+                osg::Timer_t start = osg::Timer::instance()->tick();
+                simplifier.simplify(originalCount >> level);
+                osg::Timer_t end = osg::Timer::instance()->tick();
+
+                out << std::setw(10) << originalCount
+                    << std::setw(8) << level
+                    << std::setw(12) << (originalCount >> level)
+                    << std::setw(12) << simplifier.getTriangleCount()
+                    << std::setw(12) << std::fixed << std::setprecision(4) << simplifier.getError()
+                    << std::setw(16) << std::setprecision(1) << _nsPerOp(start, end, countBefore - simplifier.getTriangleCount()) << std::endl;
+            }
+        }
+    }
+
+    static osg::ref_ptr<osg::Node> _makeBenchmarkCharacter(size_t jointCount, size_t rings, size_t segments)
+    {
+        // a tube along the y axis. each ring is weighted between the two joints nearest to it, like a limb
+        osg::ref_ptr<osg::Vec3Array> vertices(new osg::Vec3Array);
+        osg::ref_ptr<osg::Vec3Array> normals(new osg::Vec3Array);
+        osg::ref_ptr<osg::Vec4Array> boneIndices(new osg::Vec4Array);
+        osg::ref_ptr<osg::Vec4Array> boneWeights(new osg::Vec4Array);
+        for(size_t r = 0; r <= rings; ++r)
+        {
+            float jointPosition = float(r)/rings*(jointCount - 1);
+            size_t joint = std::min<size_t>(jointPosition, jointCount - 2);
+            float blend = jointPosition - joint;
+
+            for(size_t s = 0; s < segments; ++s)
+            {
+                float angle = 2*M_PI*s/segments;
+                osg::Vec3f normal(std::cos(angle), 0, std::sin(angle));
+                vertices->push_back(normal*0.25f + osg::Vec3f(0, jointPosition, 0));
+                normals->push_back(normal);
+                boneIndices->push_back(osg::Vec4f(joint, joint + 1, 0, 0));
+                boneWeights->push_back(osg::Vec4f(1 - blend, blend, 0, 0));
+            }
+        }
+
+        osg::ref_ptr<osg::DrawElementsUInt> indices(new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES));
+        for(size_t r = 0; r < rings; ++r)
+        {
+            for(size_t s = 0; s < segments; ++s)
+            {
+                size_t a = r*segments + s;
+                size_t b = r*segments + (s + 1)%segments;
+                indices->push_back(a);
+                indices->push_back(b + segments);
+                indices->push_back(b);
+                indices->push_back(a);
+                indices->push_back(a + segments);
+                indices->push_back(b + segments);
+            }
+        }
+
+        osg::ref_ptr<BonePalette> palette(new BonePalette);
+        for(size_t j = 0; j < jointCount; ++j)
+        {
+            palette->jointIndices.push_back(j);
+        }
+
+        osg::ref_ptr<osg::Geometry> geometry(new osg::Geometry);
+        geometry->setVertexArray(vertices);
+        geometry->setNormalArray(normals, osg::Array::BIND_PER_VERTEX);
+        geometry->setVertexAttribArray(OD_ATTRIB_INFLUENCE_LOCATION, boneIndices, osg::Array::BIND_PER_VERTEX);
+        geometry->setVertexAttribArray(OD_ATTRIB_WEIGHT_LOCATION, boneWeights, osg::Array::BIND_PER_VERTEX);
+        geometry->addPrimitiveSet(indices);
+        geometry->setUserData(palette);
+
+        osg::ref_ptr<osg::Geode> geode(new osg::Geode);
+        geode->addDrawable(geometry);
+        return geode;
+    }
+
+    static void _benchmarkSkinning(std::ostream &out)
+    {
+        // a crowd of characters with a typical joint count, each in a different pose
+        static const size_t characterCounts[] = { 16, 64, 256 };
+        static const size_t jointCount = 32;
+        static const size_t frameCount = 32;
+        static const size_t raysPerCharacter = 16;
+
+        osg::ref_ptr<CpuSkinner::Mesh> mesh(new CpuSkinner::Mesh(_makeBenchmarkCharacter(jointCount, 96, 24)));
+
+        out << "Character mesh has " << mesh->getVertexCount() << " vertices and " << mesh->getTriangleCount() << " triangles" << std::endl;
+        out << std::setw(12) << "characters"
+            << std::setw(10) << "threads"
+            << std::setw(16) << "Mverts/s"
+            << std::setw(16) << "ns/vertex"
+            << std::setw(14) << "ray ns/op"
+            << std::setw(10) << "hits" << std::endl;
+
+        size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+        for(size_t characterCount : characterCounts)
+        {
+            std::mt19937 rng(1234);
+            std::uniform_real_distribution<float> angleDist(-0.3f, 0.3f);
+
+            std::vector<osg::ref_ptr<CpuSkinner::Instance>> instances;
+            for(size_t c = 0; c < characterCount; ++c)
+            {
+                // bend every joint a bit around it's own position
+                std::vector<osg::Matrixf> matrices(jointCount);
+                osg::Matrixf parent = osg::Matrixf::identity();
+                for(size_t j = 0; j < jointCount; ++j)
+                {
+                    osg::Vec3f pivot(0, j, 0);
+                    osg::Matrixf local = osg::Matrixf::translate(-pivot) * osg::Matrixf::rotate(angleDist(rng), osg::Vec3f(1, 0, 0)) * osg::Matrixf::translate(pivot);
+                    parent = local * parent;
+                    matrices[j] = parent;
+                }
+
+                osg::ref_ptr<CpuSkinner::Instance> instance(new CpuSkinner::Instance(mesh));
+                instance->setBoneMatrices(matrices);
+                instances.push_back(instance);
+            }
+
+            for(size_t threadCount : { size_t(1), maxThreads })
+            {
+                CpuSkinner skinner;
+                skinner.setThreadCount(threadCount);
+                for(auto &instance : instances)
+                {
+                    skinner.addInstance(instance);
+                }
+
+                skinner.skin(); // warm up
+                skinner.resetStats();
+                for(size_t f = 0; f < frameCount; ++f)
+                {
+                    skinner.skin();
+                }
+                const CpuSkinner::Stats &stats = skinner.getStats();
+
+                // shoot rays horizontally through the bounding box of every character
+                std::uniform_real_distribution<float> unitDist(0.0f, 1.0f);
+                size_t rayCount = 0;
+                size_t hits = 0;
+                osg::Timer_t start = osg::Timer::instance()->tick();
+                for(auto &instance : instances)
+                {
+                    const osg::BoundingBox &box = instance->getBoundingBox();
+                    for(size_t r = 0; r < raysPerCharacter; ++r)
+                    {
+                        float y = box.yMin() + unitDist(rng)*(box.yMax() - box.yMin());
+                        float z = box.zMin() + unitDist(rng)*(box.zMax() - box.zMin());
+                        float fraction;
+                        osg::Vec3f normal;
+                        hits += instance->raycast(osg::Vec3f(box.xMin() - 1, y, z), osg::Vec3f(box.xMax() + 1, y, z), fraction, normal) ? 1 : 0;
+                        ++rayCount;
+                    }
+                }
+                osg::Timer_t end = osg::Timer::instance()->tick();
+
+                out << std::setw(12) << characterCount
+                    << std::setw(10) << threadCount
+                    << std::setw(16) << std::fixed << std::setprecision(1) << stats.vertexCount/stats.seconds/1e6
+                    << std::setw(16) << std::setprecision(2) << stats.seconds*1e9/stats.vertexCount
+                    << std::setw(14) << std::setprecision(1) << _nsPerOp(start, end, rayCount)
+                    << std::setw(10) << hits << std::endl;
+            }
+        }
+    }
+
+
+    struct BenchmarkEntry
+    {
+        const char *name;
+        const char *description;
+        void (*function)(std::ostream &out);
+    };
+
+    static const BenchmarkEntry sBenchmarks[] =
+    {
+        { "timers", "Schedule, cancel and expire timers on the TimerWheel", &_benchmarkTimers },
+        { "mixer",  "Mix looping voices with the SoundMixer", &_benchmarkMixer },
+        { "lights", "Assign point lights to objects using the LightGrid", &_benchmarkLights },
+        { "instancing", "Group and cull instances of static models with the InstanceManager", &_benchmarkInstancing },
+        { "simplify", "Generate LODs for a textured sphere using the MeshSimplifier", &_benchmarkSimplify },
+        { "skinning", "Skin and raycast a crowd of animated characters using the CpuSkinner", &_benchmarkSkinning }
+    };
+
+    void runBenchmark(const std::string &name, std::ostream &out)
+    {
+        for(const BenchmarkEntry &b : sBenchmarks)
+        {
+            if(name == b.name)
+            {
+                out << "Running benchmark '" << b.name << "': " << b.description << std::endl;
+                b.function(out);
+                return;
+            }
+        }
+
+        throw NotFoundException("Unknown benchmark '" + name + "'");
+    }
+
+    void listBenchmarks(std::ostream &out)
+    {
+        for(const BenchmarkEntry &b : sBenchmarks)
+        {
+            out << "    " << std::left << std::setw(12) << b.name << std::right << b.description << std::endl;
+        }
+    }
+
+}
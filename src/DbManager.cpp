@@ -8,6 +8,8 @@
 
 #include "DbManager.h"
 
+#include <fstream>
+
 #include "Logger.h"
 #include "db/Database.h"
 #include "StringUtils.h"
@@ -27,9 +29,58 @@ namespace od
     {
     }
 
+    void DbManager::mountArchive(const FilePath &archivePath)
+    {
+        mArchive.reset(new Archive(archivePath));
+    }
+
+    std::unique_ptr<std::istream> DbManager::openFile(const FilePath &path)
+    {
+        if(mArchive != nullptr)
+        {
+            std::unique_ptr<std::istream> packed = mArchive->openFile(path);
+            if(packed != nullptr)
+            {
+                return packed;
+            }
+        }
+
+        if(!path.exists())
+        {
+            return nullptr;
+        }
+
+        std::unique_ptr<std::istream> in(new std::ifstream(path.str(), std::ios::in | std::ios::binary));
+        if(in->fail())
+        {
+            return nullptr;
+        }
+
+        return in;
+    }
+
+    std::unique_ptr<SrscFile> DbManager::openSrscFile(const FilePath &path)
+    {
+        if(mArchive != nullptr)
+        {
+            std::unique_ptr<SrscFile> packed = mArchive->openSrscFile(path);
+            if(packed != nullptr)
+            {
+                return packed;
+            }
+        }
+
+        if(!path.exists())
+        {
+            return nullptr;
+        }
+
+        return std::unique_ptr<SrscFile>(new SrscFile(path));
+    }
+
     bool DbManager::isDbLoaded(const FilePath &dbFilePath) const
     {
-        for(std::shared_ptr<Database> db : mRiotDbs)
+        for(auto &db : mRiotDbs)
         {
         	if(db->getDbFilePath() == dbFilePath)
         	{
@@ -50,14 +101,10 @@ namespace od
     	// force the right extension
     	FilePath actualFilePath = dbFilePath.ext(".db");
 
-    	try
+    	Database *loadedDb = findDb(actualFilePath);
+    	if(loadedDb != nullptr)
     	{
-    	    Database &db = getDb(actualFilePath);
-    	    return db;
-
-    	}catch(NotFoundException &e)
-    	{
-    	    // not loaded -> load
+    	    return *loadedDb;
     	}
 
     	Logger::info() << "Loading database " << dbFilePath.str();
@@ -73,15 +120,26 @@ namespace od
 
     Database &DbManager::getDb(const FilePath &dbFilePath)
     {
-    	for(std::shared_ptr<Database> db : mRiotDbs)
+        Database *db = findDb(dbFilePath);
+        if(db == nullptr)
+        {
+            throw NotFoundException("Database with given path not loaded");
+        }
+
+        return *db;
+    }
+
+    Database *DbManager::findDb(const FilePath &dbFilePath)
+    {
+    	for(auto &db : mRiotDbs)
         {
         	if(db->getDbFilePath() == dbFilePath)
         	{
-        		return *db;
+        		return db.get();
         	}
         }
 
-        throw NotFoundException("Database with given path not loaded");
+        return nullptr;
     }
 
 }
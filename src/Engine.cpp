@@ -8,14 +8,18 @@
 
 #include "Engine.h"
 
+#include <sstream>
+
 #include "Exception.h"
 #include "Logger.h"
+#include "OdDefines.h"
 #include "Level.h"
 #include "LevelObject.h"
 #include "Player.h"
 #include "rfl/Rfl.h"
 #include "gui/GuiManager.h"
 #include "Camera.h"
+#include "SceneStatsVisitor.h"
 
 namespace od
 {
@@ -28,8 +32,15 @@ namespace od
 	, mCamera(nullptr)
 	, mPlayer(nullptr)
 	, mMaxFrameRate(60)
+	, mBakeShadows(true)
+	, mLayerTileSize(OD_LAYER_DEFAULT_TILE_SIZE)
+	, mLayerLodPixelError(OD_LAYER_DEFAULT_LOD_PIXEL_ERROR)
+	, mModelAutoLodDistance(OD_MODEL_DEFAULT_AUTO_LOD_DISTANCE)
+	, mCompactVertexFormat(true)
+	, mStatsDumpFrame(0)
 	, mSetUp(false)
 	{
+	    mUpdateScheduler.add(&mTimerWheel, UpdatePhase::Timers);
 	}
 
 	void Engine::setUp()
@@ -41,6 +52,12 @@ namespace od
 
 	    _findEngineRoot("Dragon.rrc");
 
+	    FilePath archivePath = FilePath(OD_ARCHIVE_FILENAME, mEngineRootDir).adjustCase();
+	    if(archivePath.exists())
+	    {
+	        mDbManager.mountArchive(archivePath);
+	    }
+
 	    mViewer = new osgViewer::Viewer;
         mViewer->realize();
         mViewer->setName("OpenDrakan");
@@ -62,6 +79,10 @@ namespace od
 
 	    mLightManager.reset(new LightManager(*this, mRootNode));
 
+	    // no audio device backend yet. mix into the void so everything upstream of the sink can be exercised
+	    mSoundMixer.reset(new SoundMixer(std::unique_ptr<AudioSink>(new NullAudioSink)));
+	    mSoundMixer->start();
+
 	    mSetUp = true;
 	}
 
@@ -103,7 +124,7 @@ namespace od
 		    mCamera->setOsgCamera(mViewer->getCamera());
 		}
 
-		mLevel->spawnAllObjects();
+		mLevel->spawnObjects();
 
 
 		Logger::verbose() << "Everything set up. Starting main loop";
@@ -112,6 +133,7 @@ namespace od
 		// need to provide our own loop as mViewer->run() installs camera manipulator we don't need
 		double simTime = 0;
 		double frameTime = 0;
+		size_t frameNumber = 0;
 		while(!mViewer->done())
 		{
 			double minFrameTime = (mMaxFrameRate > 0.0) ? (1.0/mMaxFrameRate) : 0.0;
@@ -122,12 +144,26 @@ namespace od
 
 			if(mLevel != nullptr)
 			{
-			    mLevel->update(); // TODO: put in update callback
+			    mLevel->update();
+			}
+
+			mUpdateScheduler.update(simTime);
+
+			if(mCamera != nullptr)
+			{
+			    mSoundMixer->setListenerPosition(mCamera->getEyePoint());
 			}
 
 			mViewer->updateTraversal();
 			mViewer->renderingTraversals();
 
+			++frameNumber;
+			if(mStatsDumpFrame > 0 && frameNumber == mStatsDumpFrame)
+			{
+			    _dumpStats();
+			    mViewer->setDone(true);
+			}
+
 			osg::Timer_t endFrameTick = osg::Timer::instance()->tick();
 			frameTime = osg::Timer::instance()->delta_s(startFrameTick, endFrameTick);
 			simTime += frameTime;
@@ -141,6 +177,23 @@ namespace od
 		Logger::info() << "Shutting down gracefully";
 	}
 
+	void Engine::_dumpStats()
+	{
+	    std::ostringstream stats;
+	    stats << "Stats after " << mStatsDumpFrame << " frames:" << std::endl;
+
+	    if(mLevel != nullptr)
+	    {
+	        mLevel->getLayerVisibility().dumpStats(stats);
+	    }
+
+	    SceneStatsVisitor ssv;
+	    mRootNode->accept(ssv);
+	    ssv.dumpStats(stats);
+
+	    Logger::info() << stats.str();
+	}
+
 	void Engine::_findEngineRoot(const std::string &rrcFileName)
 	{
 	    // ascend in the passed initial level file path until we find a Dragon.rrc
@@ -0,0 +1,135 @@
+/*
+ * FileIndex.cpp
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#include "FileIndex.h"
+
+#include "StringUtils.h"
+#include "Logger.h"
+
+#if !defined (__WIN32__)
+extern "C"
+{
+#	include <dirent.h>
+}
+#endif
+
+namespace od
+{
+
+    FileIndex::Node::Node(const std::string &name)
+    : realName(name)
+    , listed(false)
+    , listable(false)
+    {
+    }
+
+
+    FileIndex::FileIndex()
+    {
+    }
+
+    FileIndex::Resolution FileIndex::resolve(const std::string &root, std::vector<std::string> &components)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        std::unique_ptr<Node> &rootNode = mRoots[root];
+        if(rootNode == nullptr)
+        {
+            rootNode.reset(new Node(root));
+        }
+
+        Resolution result = Resolution::Found;
+        Node *node = rootNode.get();
+        std::string hostPath = root;
+        for(size_t i = 0; i < components.size(); ++i)
+        {
+            if(!node->listed)
+            {
+                _list(*node, hostPath);
+            }
+
+            std::string key = StringUtils::toLower(components[i]);
+            auto it = node->children.find(key);
+            if(it == node->children.end() && node->listable)
+            {
+                // directory is fully known and does not contain this. nothing below it can exist either
+                return Resolution::NotFound;
+            }
+
+            std::unique_ptr<Node> &child = node->children[key];
+            if(child == nullptr)
+            {
+                // can't see what is in this directory. remember the name as given and keep trying below it
+                child.reset(new Node(components[i]));
+                result = Resolution::Unknown;
+            }
+
+            components[i] = child->realName;
+            node = child.get();
+
+            if(!hostPath.empty() && hostPath.back() != '/' && hostPath.back() != '\\')
+            {
+                hostPath += '/';
+            }
+            hostPath += components[i];
+        }
+
+        return result;
+    }
+
+    void FileIndex::invalidate()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        mRoots.clear();
+    }
+
+    void FileIndex::_list(Node &node, const std::string &hostPath)
+    {
+        node.listed = true;
+        node.listable = false;
+
+#if !defined (__WIN32__)
+        DIR *dir = opendir(hostPath.c_str());
+        if(dir == NULL)
+        {
+            return;
+        }
+
+        node.listable = true;
+
+        dirent *entry = readdir(dir);
+        while(entry != NULL)
+        {
+            std::string realName(entry->d_name);
+            if(realName != "." && realName != "..")
+            {
+                // if names only differ in case, keep the first one like readdir reports them
+                std::unique_ptr<Node> &child = node.children[StringUtils::toLower(realName)];
+                if(child == nullptr)
+                {
+                    child.reset(new Node(realName));
+                }
+            }
+
+            entry = readdir(dir);
+        }
+
+        closedir(dir);
+
+        Logger::debug() << "Indexed " << node.children.size() << " entries in directory " << hostPath;
+#endif
+    }
+
+    FileIndex &FileIndex::getSingleton()
+    {
+        static FileIndex index;
+
+        return index;
+    }
+
+}
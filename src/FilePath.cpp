@@ -13,6 +13,7 @@
 
 #include "StringUtils.h"
 #include "Exception.h"
+#include "FileIndex.h"
 
 #if defined (__WIN32__)
 #	define OD_FILEPATH_SEPERATOR	    '\\'
@@ -20,10 +21,6 @@
 #else
 #	define OD_FILEPATH_SEPERATOR	    '/'
 #	define OD_FILEPATH_HOST_STYLE		PathRootStyle::POSIX
-extern "C"
-{
-#	include <dirent.h>
-}
 #endif
 
 namespace od
@@ -108,48 +105,12 @@ namespace od
 	{
 #if defined (__WIN32__)
 		// in a windows environment, paths are case-insensitive, so we don't have to adjust anything.
-		//  this is great, because i don't know whether all windows libcs have a dirent.h and i can't be bothered
-		//  to look up the right way of listing directories on windows right now.
 		return *this;
 #else
 
 		FilePath fp(*this);
 
-		std::string adjustedPath((mRootStyle == PathRootStyle::RELATIVE) ? "." : mRoot);
-
-		for(size_t i = 0; i < fp.mPathComponents.size(); ++i)
-		{
-			if(i > 0)
-			{
-				adjustedPath += OD_FILEPATH_SEPERATOR + fp.mPathComponents[i-1];
-			}
-
-			DIR *dir = opendir(adjustedPath.c_str());
-			if(dir == NULL)
-			{
-				// could not access path. keep this component as-is
-				continue;
-
-			}
-
-			std::string &name = fp.mPathComponents[i];
-
-			dirent *entry = readdir(dir);
-			while(entry != NULL)
-			{
-				std::string realName(entry->d_name);
-
-				if(StringUtils::compareIgnoringCase(realName, name))
-				{
-					fp.mPathComponents[i] = realName;
-					break;
-				}
-
-				entry = readdir(dir);
-			}
-
-			closedir(dir);
-		}
+		FileIndex::getSingleton().resolve(_getIndexRoot(), fp.mPathComponents);
 
 		return fp;
 #endif
@@ -157,6 +118,21 @@ namespace od
 
 	bool FilePath::exists() const
 	{
+#if !defined (__WIN32__)
+		std::vector<std::string> components(mPathComponents);
+		FileIndex::Resolution res = FileIndex::getSingleton().resolve(_getIndexRoot(), components);
+		if(res == FileIndex::Resolution::NotFound)
+		{
+			return false;
+
+		}else if(res == FileIndex::Resolution::Found && components == mPathComponents)
+		{
+			return true;
+		}
+
+		// index can't tell for sure. fall through to asking the file system
+#endif
+
 		// the probably easiest way is to go try and open the file
 		std::ifstream in(this->str(), std::ios::in);
 		return !in.fail();
@@ -241,6 +217,11 @@ namespace od
 		}
 	}
 
+	std::string FilePath::_getIndexRoot() const
+	{
+		return (mRootStyle == PathRootStyle::RELATIVE) ? "." : mRoot;
+	}
+
 	std::string FilePath::_buildHostPath() const
 	{
 		if(mAlreadyBuiltPath)
@@ -8,7 +8,12 @@
 #include "GeodeBuilder.h"
 
 #include <algorithm>
+#include <cmath>
+#include <map>
+#include <limits>
 #include <osg/Geometry>
+#include <osg/TexMat>
+#include <osg/Uniform>
 
 #include "Exception.h"
 #include "OdDefines.h"
@@ -22,6 +27,7 @@ namespace od
 	, mAssetProvider(assetProvider)
 	, mColors(new osg::Vec4Array(1))
 	, mClampTextures(false)
+	, mCompactVertexFormat(false)
 	, mSmoothNormals(true)
 	, mNormalsFromCcw(false)
 	{
@@ -57,6 +63,7 @@ namespace od
 			// the 0 1 2 triangle always appears
 			Triangle tri;
 			tri.texture = it->texture;
+			tri.palette = 0;
 			tri.uvCoords[0] = it->uvCoords[0];
 			tri.uvCoords[1] = it->uvCoords[1];
 			tri.uvCoords[2] = it->uvCoords[2];
@@ -167,55 +174,38 @@ namespace od
 		}
 
 		// sort by texture. most models are already sorted, so this is O(n) most of the time
-		auto pred = [](Triangle &left, Triangle &right){ return left.texture < right.texture; };
-		std::sort(mTriangles.begin(), mTriangles.end(), pred);
+		auto pred = [](const Triangle &left, const Triangle &right){ return left.texture < right.texture; };
+		std::stable_sort(mTriangles.begin(), mTriangles.end(), pred);
 
-		// count number of unique textures
-		AssetRef lastTexture = AssetRef::NULL_REF;
-		size_t textureCount = 0;
+		_splitBonePalettes();
+		_compactVertexData();
+
+		// every run of triangles with the same texture and bone palette becomes one geometry. count the number of triangles
+		//  per geometry. this will allow us to preallocate the IBO array as well as pick between int/short/byte arrays
+		auto sameGeometry = [](const Triangle &left, const Triangle &right){ return left.texture == right.texture && left.palette == right.palette; };
+		std::vector<size_t> triangleCountsPerGeometry;
 		for(auto it = mTriangles.begin(); it != mTriangles.end(); ++it)
-        {
-		    if(lastTexture == AssetRef::NULL_REF || lastTexture != it->texture)
+		{
+		    if(it == mTriangles.begin() || !sameGeometry(*(it-1), *it))
 		    {
-		        lastTexture = it->texture;
-		        ++textureCount;
+		        triangleCountsPerGeometry.push_back(0);
 		    }
-        }
-
-		// count number of triangles per texture.
-        //  this will allow us to preallocate the IBO array as well as pick between int/short/byte arrays
-		lastTexture = AssetRef::NULL_REF;
-		size_t textureIndex = 0;
-        std::vector<size_t> triangleCountsPerTexture(textureCount, 0);
-        for(auto it = mTriangles.begin(); it != mTriangles.end(); ++it)
-        {
-            if(lastTexture == AssetRef::NULL_REF)
-            {
-                lastTexture = it->texture;
-            }
-
-            if(lastTexture != it->texture)
-            {
-                lastTexture = it->texture;
-                textureIndex++;
-            }
 
-            triangleCountsPerTexture[textureIndex]++;
-        }
+		    triangleCountsPerGeometry.back()++;
+		}
 
 		osg::ref_ptr<osg::Geometry> geom;
 		osg::ref_ptr<osg::DrawElements> drawElements;
-		lastTexture = AssetRef::NULL_REF;
-		textureIndex = 0;
+		size_t geometryIndex = 0;
 		for(auto it = mTriangles.begin(); it != mTriangles.end(); ++it)
 		{
-			if(lastTexture != it->texture || geom == nullptr)
+			if(geom == nullptr || !sameGeometry(*(it-1), *it))
 			{
 			    if(geom != nullptr)
 			    {
-			        assert(drawElements->getNumIndices() == triangleCountsPerTexture[textureIndex]*3);
+			        assert(drawElements->getNumIndices() == triangleCountsPerGeometry[geometryIndex]*3);
 
-			        ++textureIndex;
+			        ++geometryIndex;
 			    }
 
 				geom = new osg::Geometry;
@@ -226,20 +216,39 @@ namespace od
 
 				// shared VBOs
 				geom->setVertexArray(mVertices);
-				geom->setNormalArray(mNormals, osg::Array::BIND_PER_VERTEX);
+				geom->setNormalArray(mNormalData, osg::Array::BIND_PER_VERTEX);
 				geom->setColorArray(mColors, osg::Array::BIND_OVERALL);
-				geom->setTexCoordArray(0, mUvCoords);
-				if(mBoneIndices != nullptr && mBoneWeights != nullptr)
+				geom->setTexCoordArray(0, mUvData);
+				if(mBoneIndexData != nullptr && mBoneWeightData != nullptr)
 				{
 					// FIXME: these locations may get inconsistent with what we use in the shader
-					geom->setVertexAttribArray(OD_ATTRIB_INFLUENCE_LOCATION, mBoneIndices, osg::Array::BIND_PER_VERTEX);
-					geom->setVertexAttribArray(OD_ATTRIB_WEIGHT_LOCATION, mBoneWeights, osg::Array::BIND_PER_VERTEX);
+					geom->setVertexAttribArray(OD_ATTRIB_INFLUENCE_LOCATION, mBoneIndexData, osg::Array::BIND_PER_VERTEX);
+					geom->setVertexAttribArray(OD_ATTRIB_WEIGHT_LOCATION, mBoneWeightData, osg::Array::BIND_PER_VERTEX);
+				}
+
+				if(mUvScale != nullptr)
+				{
+				    geom->getOrCreateStateSet()->setTextureAttribute(0, mUvScale);
+				}
+
+				// the bone matrices of the palette are uploaded per object. see SkeletonAnimationPlayer
+				if(!mBonePalettes.empty() && !mBonePalettes[it->palette]->jointIndices.empty())
+				{
+				    BonePalette *palette = mBonePalettes[it->palette];
+				    geom->setUserData(palette);
+
+				    osg::ref_ptr<osg::Uniform> bones(new osg::Uniform(osg::Uniform::FLOAT_MAT4, "bones", palette->jointIndices.size()));
+				    for(size_t i = 0; i < palette->jointIndices.size(); ++i)
+				    {
+				        bones->setElement(i, osg::Matrixf::identity());
+				    }
+				    geom->getOrCreateStateSet()->addUniform(bones);
 				}
 
 				// create unique IBO array. select index size best suited for count of verts to save memory.
 				//  Important! make element size decision based on total vertex count! we share the VBO and need indices
 				//  that can address all vertices, even if we use only part of the vertex array for each geometry
-				size_t vertsForThisTexture = triangleCountsPerTexture[textureIndex] * 3;
+				size_t vertsForThisTexture = triangleCountsPerGeometry[geometryIndex] * 3;
 				if(mVertices->size() <= 0xff)
 				{
 				    osg::ref_ptr<osg::DrawElementsUByte> drawElementsUbyte = new osg::DrawElementsUByte(osg::PrimitiveSet::TRIANGLES);
@@ -261,34 +270,32 @@ namespace od
 				}
 				geom->addPrimitiveSet(drawElements);
 
-				// texture also unique per geometry
+				// texture state unique per geometry, but geometries with the same texture share the texture object
 				if(!it->texture.isNull())
 				{
 					osg::ref_ptr<Texture> textureImage = mAssetProvider.getTextureByRef(it->texture);
 					osg::StateSet *ss = geom->getOrCreateStateSet();
-					if(textureImage->hasAlpha())
-					{
-						ss->setMode(GL_BLEND, osg::StateAttribute::ON);
-						ss->setRenderBinDetails(1, "DepthSortedBin");
-					}
-
-					osg::ref_ptr<osg::Texture2D> texture(new osg::Texture2D(textureImage));
-					if(!mClampTextures)
-					{
-						// this is the default for model textures
-						texture->setWrap(osg::Texture::WRAP_S, osg::Texture::REPEAT);
-						texture->setWrap(osg::Texture::WRAP_T, osg::Texture::REPEAT);
+					textureImage->applyAlphaState(ss);
 
-					}else
+					osg::ref_ptr<osg::Texture2D> &texture = mTextures[it->texture];
+					if(texture == nullptr)
 					{
-						// for layers we should use clamp to border instead
-						texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
-						texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+						texture = new osg::Texture2D(textureImage);
+						if(!mClampTextures)
+						{
+							// this is the default for model textures
+							texture->setWrap(osg::Texture::WRAP_S, osg::Texture::REPEAT);
+							texture->setWrap(osg::Texture::WRAP_T, osg::Texture::REPEAT);
+
+						}else
+						{
+							// for layers we should use clamp to border instead
+							texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+							texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+						}
 					}
 					ss->setTextureAttributeAndModes(0, texture);
 				}
-
-				lastTexture = it->texture;
 			}
 
 			for(size_t vn = 0; vn < 3; ++vn)
@@ -422,5 +429,215 @@ namespace od
 			}
 		}
 	}
+
+	void GeodeBuilder::_splitBonePalettes()
+	{
+	    // the rigging shader can only address OD_MAX_BONE_COUNT bones per draw. walk the triangles of each texture and start
+	    //  a new palette whenever the current one would overflow. vertices used by more than one palette are duplicated, so
+	    //  every vertex can refer to the bones of it's own palette by local index
+
+	    mBonePalettes.clear();
+	    if(mBoneIndices == nullptr || mBoneWeights == nullptr)
+	    {
+	        return;
+	    }
+
+	    std::vector<std::map<size_t, size_t>> localIndices; // joint index -> index in palette, per palette
+	    for(auto it = mTriangles.begin(); it != mTriangles.end(); ++it)
+	    {
+	        std::vector<size_t> joints;
+	        for(size_t vn = 0; vn < 3; ++vn)
+	        {
+	            for(size_t i = 0; i < 4; ++i)
+	            {
+	                if(mBoneWeights->at(it->vertexIndices[vn])[i] > 0)
+	                {
+	                    joints.push_back(mBoneIndices->at(it->vertexIndices[vn])[i]);
+	                }
+	            }
+	        }
+
+	        size_t missingJoints = 0;
+	        if(!localIndices.empty())
+	        {
+	            for(size_t joint : joints)
+	            {
+	                missingJoints += localIndices.back().count(joint) == 0 ? 1 : 0;
+	            }
+	        }
+
+	        if(localIndices.empty() || it->texture != (it-1)->texture || localIndices.back().size() + missingJoints > OD_MAX_BONE_COUNT)
+	        {
+	            localIndices.push_back(std::map<size_t, size_t>());
+	            mBonePalettes.push_back(new BonePalette);
+	        }
+
+	        for(size_t joint : joints)
+	        {
+	            if(localIndices.back().insert(std::make_pair(joint, localIndices.back().size())).second)
+	            {
+	                mBonePalettes.back()->jointIndices.push_back(joint);
+	            }
+	        }
+
+	        it->palette = mBonePalettes.size() - 1;
+	    }
+
+	    static const size_t NO_PALETTE = std::numeric_limits<size_t>::max();
+	    std::vector<size_t> vertexPalettes(mVertices->size(), NO_PALETTE);
+	    std::map<std::pair<size_t, size_t>, size_t> duplicates; // (vertex, palette) -> duplicated vertex
+	    for(auto it = mTriangles.begin(); it != mTriangles.end(); ++it)
+	    {
+	        for(size_t vn = 0; vn < 3; ++vn)
+	        {
+	            size_t &vertIndex = it->vertexIndices[vn];
+
+	            if(vertexPalettes[vertIndex] == NO_PALETTE)
+	            {
+	                vertexPalettes[vertIndex] = it->palette;
+
+	            }else if(vertexPalettes[vertIndex] != it->palette)
+	            {
+	                auto dup = duplicates.find(std::make_pair(vertIndex, it->palette));
+	                if(dup != duplicates.end())
+	                {
+	                    vertIndex = dup->second;
+	                    continue;
+	                }
+
+	                mVertices->push_back(mVertices->at(vertIndex));
+	                mNormals->push_back(mNormals->at(vertIndex));
+	                mUvCoords->push_back(mUvCoords->at(vertIndex));
+	                mBoneIndices->push_back(mBoneIndices->at(vertIndex));
+	                mBoneWeights->push_back(mBoneWeights->at(vertIndex));
+	                vertexPalettes.push_back(it->palette);
+
+	                duplicates[std::make_pair(vertIndex, it->palette)] = mVertices->size() - 1;
+	                vertIndex = mVertices->size() - 1;
+	            }
+	        }
+	    }
+
+	    // now that every vertex belongs to exactly one palette, translate the joint indices
+	    for(size_t v = 0; v < mVertices->size(); ++v)
+	    {
+	        if(vertexPalettes[v] == NO_PALETTE)
+	        {
+	            continue;
+	        }
+
+	        std::map<size_t, size_t> &palette = localIndices[vertexPalettes[v]];
+	        for(size_t i = 0; i < 4; ++i)
+	        {
+	            bool used = mBoneWeights->at(v)[i] > 0;
+	            mBoneIndices->at(v)[i] = used ? palette.at(mBoneIndices->at(v)[i]) : 0;
+	        }
+	    }
+
+	    if(mBonePalettes.size() > 1)
+	    {
+	        Logger::verbose() << "Split skinned mesh '" << mModelName << "' into " << mBonePalettes.size() << " bone palettes, adding "
+	                << duplicates.size() << " vertices";
+	    }
+	}
+
+	void GeodeBuilder::_compactVertexData()
+	{
+	    mNormalData = mNormals;
+	    mUvData = mUvCoords;
+	    mBoneIndexData = mBoneIndices;
+	    mBoneWeightData = mBoneWeights;
+	    mUvScale = nullptr;
+
+	    size_t floatSize = mVertices->getTotalDataSize() + mNormals->getTotalDataSize() + mUvCoords->getTotalDataSize();
+	    if(mBoneIndices != nullptr && mBoneWeights != nullptr)
+	    {
+	        floatSize += mBoneIndices->getTotalDataSize() + mBoneWeights->getTotalDataSize();
+	    }
+
+	    if(!mCompactVertexFormat)
+	    {
+	        return;
+	    }
+
+	    // normals are always normalized by the GL when they are fed as integers
+	    osg::ref_ptr<osg::Vec3bArray> normals(new osg::Vec3bArray(mNormals->size()));
+	    for(size_t i = 0; i < mNormals->size(); ++i)
+	    {
+	        const osg::Vec3f &n = mNormals->at(i);
+	        normals->at(i).set(std::round(n.x()*127), std::round(n.y()*127), std::round(n.z()*127));
+	    }
+	    mNormalData = normals;
+
+	    // model UVs repeat, so they can't be stored normalized. use fixed point with as many fractional bits as fit the
+	    //  largest coordinate. the texture matrix scales them back down. if that leaves too little precision, stay with floats
+	    float maxUv = 0;
+	    for(auto it = mUvCoords->begin(); it != mUvCoords->end(); ++it)
+	    {
+	        maxUv = std::max(maxUv, std::max(std::abs(it->x()), std::abs(it->y())));
+	    }
+	    int fractionalBits = OD_COMPACT_UV_MAX_FRACTIONAL_BITS;
+	    while(fractionalBits >= OD_COMPACT_UV_MIN_FRACTIONAL_BITS && maxUv*(1 << fractionalBits) > 0x7fff)
+	    {
+	        --fractionalBits;
+	    }
+	    if(fractionalBits >= OD_COMPACT_UV_MIN_FRACTIONAL_BITS)
+	    {
+	        float scale = 1 << fractionalBits;
+	        osg::ref_ptr<osg::Vec2sArray> uvs(new osg::Vec2sArray(mUvCoords->size()));
+	        for(size_t i = 0; i < mUvCoords->size(); ++i)
+	        {
+	            const osg::Vec2f &uv = mUvCoords->at(i);
+	            uvs->at(i).set(std::round(uv.x()*scale), std::round(uv.y()*scale));
+	        }
+	        mUvData = uvs;
+	        mUvScale = new osg::TexMat(osg::Matrix::scale(1/scale, 1/scale, 1));
+	    }
+
+	    if(mBoneIndices != nullptr && mBoneWeights != nullptr)
+	    {
+	        // indices are passed unnormalized so the shader receives the same values as with the float array
+	        osg::ref_ptr<osg::Vec4ubArray> indices(new osg::Vec4ubArray(mBoneIndices->size()));
+	        indices->setNormalize(false);
+	        osg::ref_ptr<osg::Vec4ubArray> weights(new osg::Vec4ubArray(mBoneWeights->size()));
+	        weights->setNormalize(true);
+	        for(size_t i = 0; i < mBoneIndices->size(); ++i)
+	        {
+	            const osg::Vec4f &w = mBoneWeights->at(i);
+
+	            // round so the quantized weights add up to the same sum as before. otherwise vertices scale slightly
+	            //  with the bone transform
+	            int quantized[4];
+	            int sum = 0;
+	            size_t largest = 0;
+	            for(size_t j = 0; j < 4; ++j)
+	            {
+	                quantized[j] = std::round(osg::clampBetween(w[j], 0.0f, 1.0f)*255);
+	                sum += quantized[j];
+	                largest = (w[j] > w[largest]) ? j : largest;
+	            }
+	            int targetSum = std::round(osg::clampBetween(w[0] + w[1] + w[2] + w[3], 0.0f, 1.0f)*255);
+	            quantized[largest] = osg::clampBetween(quantized[largest] + targetSum - sum, 0, 255);
+
+	            for(size_t j = 0; j < 4; ++j)
+	            {
+	                indices->at(i)[j] = std::min(mBoneIndices->at(i)[j], 255.0f);
+	                weights->at(i)[j] = quantized[j];
+	            }
+	        }
+	        mBoneIndexData = indices;
+	        mBoneWeightData = weights;
+	    }
+
+	    size_t compactSize = mVertices->getTotalDataSize() + mNormalData->getTotalDataSize() + mUvData->getTotalDataSize();
+	    if(mBoneIndexData != nullptr && mBoneWeightData != nullptr)
+	    {
+	        compactSize += mBoneIndexData->getTotalDataSize() + mBoneWeightData->getTotalDataSize();
+	    }
+
+	    Logger::verbose() << "Vertex data of '" << mModelName << "' takes " << compactSize << " bytes instead of " << floatSize
+	            << " (" << (100*compactSize/std::max(floatSize, size_t(1))) << "%)";
+	}
+}
 }
 
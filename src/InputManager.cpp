@@ -7,9 +7,13 @@
 
 #include "InputManager.h"
 
+#include <sstream>
+
 #include "Engine.h"
 #include "Player.h"
+#include "Logger.h"
 #include "gui/GuiManager.h"
+#include "SceneStatsVisitor.h"
 
 namespace od
 {
@@ -101,6 +105,43 @@ namespace od
 			mEngine.getLevel().getPhysicsManager().toggleDebugDraw();
 			return true;
 
+		case osgGA::GUIEventAdapter::KEY_F4:
+		    {
+		        std::ostringstream stats;
+		        mEngine.getLevel().getLayerVisibility().dumpStats(stats);
+		        Logger::info() << stats.str();
+		    }
+			return true;
+
+		case osgGA::GUIEventAdapter::KEY_F6:
+		    {
+		        std::ostringstream stats;
+		        mEngine.getUpdateScheduler().dumpStats(stats);
+		        mEngine.getLevel().getMessageDispatcher().dumpStats(stats);
+		        Logger::info() << stats.str();
+		    }
+			return true;
+
+		case osgGA::GUIEventAdapter::KEY_F7:
+		    {
+		        SceneStatsVisitor ssv;
+		        mEngine.getRootNode()->accept(ssv);
+
+		        std::ostringstream stats;
+		        ssv.dumpStats(stats);
+		        mEngine.getLevel().getInstanceManager().dumpStats(stats);
+		        mEngine.getLightManager().dumpStats(stats);
+		        Logger::info() << stats.str();
+		    }
+			return true;
+
+		case osgGA::GUIEventAdapter::KEY_F5:
+		    {
+		        LayerVisibility &lv = mEngine.getLevel().getLayerVisibility();
+		        lv.setEnabled(!lv.isEnabled());
+		    }
+			return true;
+
 		default:
 			break;
 		}
@@ -0,0 +1,544 @@
+/*
+ * InstanceManager.cpp
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#include "InstanceManager.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <osg/LOD>
+#include <osg/Geometry>
+#include <osg/NodeCallback>
+#include <osgUtil/CullVisitor>
+
+#include "Exception.h"
+#include "light/LightManager.h"
+
+// one texture row per instance. row height is limited by the maximum texture size, so keep groups well below that
+#define OD_INSTANCE_MAX_PER_GROUP 4096
+
+// 3 texels for the rows of the affine transform, 1 for the light color
+#define OD_INSTANCE_TEXELS 4
+
+// ranges are built from instances in the same grid cell. cells should be about as big as a typical view-frustum-edge
+//  region, so culling can actually reject ranges
+#define OD_INSTANCE_RANGE_CELL_SIZE 32.0f
+#define OD_INSTANCE_MAX_PER_RANGE 64
+
+// texture unit 0 is used by the model textures
+#define OD_INSTANCE_TEXTURE_UNIT 1
+
+namespace od
+{
+
+    /**
+     * @brief Reports a fixed bounding box for an instanced drawable, covering all instances of it's range.
+     */
+    class InstanceRangeBoundCallback : public osg::Drawable::ComputeBoundingBoxCallback
+    {
+    public:
+
+        InstanceRangeBoundCallback(const osg::BoundingBox &box)
+        : mBox(box)
+        {
+        }
+
+        virtual osg::BoundingBox computeBound(const osg::Drawable &drawable) const override
+        {
+            return mBox;
+        }
+
+
+    private:
+
+        osg::BoundingBox mBox;
+    };
+
+
+    class InstanceGroupCullCallback : public osg::NodeCallback
+    {
+    public:
+
+        InstanceGroupCullCallback(InstanceManager &manager, size_t groupIndex)
+        : mManager(manager)
+        , mGroupIndex(groupIndex)
+        {
+        }
+
+        virtual void operator()(osg::Node *node, osg::NodeVisitor *nv) override
+        {
+            osgUtil::CullVisitor *cv = dynamic_cast<osgUtil::CullVisitor*>(nv);
+            if(cv == nullptr)
+            {
+                traverse(node, nv);
+                return;
+            }
+
+            // the group node has no transform above it but the level root, so the current frustum is in world space
+            InstanceManager::Group &group = *mManager.mGroups[mGroupIndex];
+            mManager._cullGroup(group, cv->getCurrentCullingSet().getFrustum());
+
+            for(auto it = group.ranges.begin(); it != group.ranges.end(); ++it)
+            {
+                if(it->visible)
+                {
+                    it->node->accept(*nv);
+                }
+            }
+        }
+
+
+    private:
+
+        InstanceManager &mManager;
+        size_t mGroupIndex;
+    };
+
+
+    const InstanceId InstanceManager::INVALID_INSTANCE;
+
+    InstanceManager::InstanceManager(osg::Group *parent)
+    : mParent(parent)
+    , mRoot(new osg::Group)
+    , mLightManager(nullptr)
+    , mLightGeneration(0)
+    {
+        mRoot->setName("instances");
+        if(mParent != nullptr)
+        {
+            mParent->addChild(mRoot);
+        }
+
+        // ID 0 is INVALID_INSTANCE
+        mLocations.push_back(Location{-1, 0});
+
+        _updateStats();
+        mStats.visibleRanges = 0;
+        mStats.visibleInstances = 0;
+    }
+
+    InstanceManager::~InstanceManager()
+    {
+        if(mParent != nullptr)
+        {
+            mParent->removeChild(mRoot);
+        }
+    }
+
+    void InstanceManager::setProgram(osg::Program *program)
+    {
+        mProgram = program;
+
+        for(auto it = mGroups.begin(); it != mGroups.end(); ++it)
+        {
+            (*it)->node->getOrCreateStateSet()->setAttribute(mProgram, osg::StateAttribute::ON);
+        }
+    }
+
+    InstanceId InstanceManager::addInstance(osg::Node *model, const osg::Matrix &transform)
+    {
+        if(model == nullptr)
+        {
+            throw InvalidArgumentException("Can't instance null model");
+        }
+
+        size_t groupIndex = 0;
+        bool foundGroup = false;
+        std::vector<size_t> &modelGroups = mGroupsByModel[model];
+        for(auto it = modelGroups.begin(); it != modelGroups.end(); ++it)
+        {
+            if(mGroups[*it]->instances.size() < OD_INSTANCE_MAX_PER_GROUP)
+            {
+                groupIndex = *it;
+                foundGroup = true;
+                break;
+            }
+        }
+
+        if(!foundGroup)
+        {
+            groupIndex = _createGroup(model);
+            modelGroups.push_back(groupIndex);
+        }
+
+        InstanceId id;
+        if(!mFreeIds.empty())
+        {
+            id = mFreeIds.back();
+            mFreeIds.pop_back();
+
+        }else
+        {
+            id = mLocations.size();
+            mLocations.push_back(Location{-1, 0});
+        }
+
+        Group &group = *mGroups[groupIndex];
+
+        const osg::BoundingSphere &modelBound = model->getBound();
+        osg::Vec3f scale = transform.getScale();
+        float maxScale = std::max(std::max(scale.x(), scale.y()), scale.z());
+
+        Instance instance;
+        instance.id = id;
+        instance.transform = transform;
+        instance.bound = osg::BoundingSphere(modelBound.center()*transform, modelBound.radius()*maxScale);
+        instance.lightColor = osg::Vec4(0.0, 0.0, 0.0, 0.0);
+        group.instances.push_back(instance);
+        group.dirty = true;
+
+        mLocations[id].group = groupIndex;
+        mLocations[id].index = group.instances.size() - 1;
+
+        return id;
+    }
+
+    void InstanceManager::removeInstance(InstanceId id)
+    {
+        if(!isInstance(id))
+        {
+            return;
+        }
+
+        Location &location = mLocations[id];
+        Group &group = *mGroups[location.group];
+
+        group.instances[location.index] = group.instances.back();
+        mLocations[group.instances[location.index].id].index = location.index;
+        group.instances.pop_back();
+        group.dirty = true;
+
+        location.group = -1;
+        mFreeIds.push_back(id);
+    }
+
+    bool InstanceManager::isInstance(InstanceId id) const
+    {
+        return id != INVALID_INSTANCE && id < mLocations.size() && mLocations[id].group >= 0;
+    }
+
+    void InstanceManager::updateGroups()
+    {
+        bool lightsChanged = (mLightManager != nullptr) && (mLightManager->getLightGeneration() != mLightGeneration);
+        bool anyRebuilt = false;
+
+        for(auto it = mGroups.begin(); it != mGroups.end(); ++it)
+        {
+            Group &group = **it;
+            if(group.dirty)
+            {
+                _rebuildGroup(group);
+                anyRebuilt = true;
+            }
+
+            if(mLightManager != nullptr && (lightsChanged || group.dirty))
+            {
+                _sampleLights(group, *mLightManager);
+            }
+
+            group.dirty = false;
+        }
+
+        if(mLightManager != nullptr)
+        {
+            mLightGeneration = mLightManager->getLightGeneration();
+        }
+
+        if(anyRebuilt)
+        {
+            _updateStats();
+        }
+
+        mStats.visibleRanges = 0;
+        mStats.visibleInstances = 0;
+    }
+
+    size_t InstanceManager::cull(osg::Polytope &frustum)
+    {
+        size_t visibleRanges = 0;
+        for(auto it = mGroups.begin(); it != mGroups.end(); ++it)
+        {
+            visibleRanges += _cullGroup(**it, frustum);
+        }
+
+        return visibleRanges;
+    }
+
+    void InstanceManager::update(double simTime, double relTime)
+    {
+        updateGroups();
+    }
+
+    void InstanceManager::dumpStats(std::ostream &out) const
+    {
+        out << "Instancing stats:" << std::endl
+            << "  groups:               " << mStats.groupCount << std::endl
+            << "  instances:            " << mStats.instanceCount << " in " << mStats.rangeCount << " ranges" << std::endl
+            << "  draw calls:           " << mStats.instancedDrawCalls << " (" << mStats.uninstancedDrawCalls << " without instancing)" << std::endl
+            << "  visible last frame:   " << mStats.visibleInstances << " instances in " << mStats.visibleRanges << " ranges" << std::endl;
+    }
+
+    size_t InstanceManager::_createGroup(osg::Node *model)
+    {
+        std::unique_ptr<Group> group(new Group);
+        group->model = model;
+        group->dirty = true;
+
+        // models are either a single geode or an LOD node with one geode per level. other layouts are drawn at full detail
+        osg::Group *modelGroup = model->asGroup();
+        osg::LOD *lodNode = (modelGroup != nullptr && modelGroup->getNumChildren() == 1) ? dynamic_cast<osg::LOD*>(modelGroup->getChild(0)) : nullptr;
+        if(lodNode != nullptr)
+        {
+            for(size_t i = 0; i < lodNode->getNumChildren(); ++i)
+            {
+                osg::Geode *geode = dynamic_cast<osg::Geode*>(lodNode->getChild(i));
+                if(geode != nullptr)
+                {
+                    group->lods.push_back(LodLevel{geode, lodNode->getMinRange(i), lodNode->getMaxRange(i)});
+                }
+            }
+
+        }else if(dynamic_cast<osg::Geode*>(model) != nullptr)
+        {
+            group->lods.push_back(LodLevel{dynamic_cast<osg::Geode*>(model), 0.0f, std::numeric_limits<float>::max()});
+
+        }else if(modelGroup != nullptr)
+        {
+            for(size_t i = 0; i < modelGroup->getNumChildren(); ++i)
+            {
+                osg::Geode *geode = dynamic_cast<osg::Geode*>(modelGroup->getChild(i));
+                if(geode != nullptr)
+                {
+                    group->lods.push_back(LodLevel{geode, 0.0f, std::numeric_limits<float>::max()});
+                }
+            }
+        }
+
+        // keep the model's state (e.g. it's front face) but add what we need to fetch instance data
+        group->node = new osg::Group;
+        osg::ref_ptr<osg::StateSet> ss = (model->getStateSet() != nullptr) ? new osg::StateSet(*model->getStateSet(), osg::CopyOp::SHALLOW_COPY) : new osg::StateSet;
+        group->node->setStateSet(ss);
+
+        group->instanceData = new osg::Image;
+        group->instanceTexture = new osg::Texture2D(group->instanceData);
+        group->instanceTexture->setInternalFormat(GL_RGBA32F_ARB);
+        group->instanceTexture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::NEAREST);
+        group->instanceTexture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::NEAREST);
+        group->instanceTexture->setResizeNonPowerOfTwoHint(false);
+        group->instanceTexture->setUseHardwareMipMapGeneration(false);
+        ss->setTextureAttribute(OD_INSTANCE_TEXTURE_UNIT, group->instanceTexture);
+        ss->addUniform(new osg::Uniform("instanceData", OD_INSTANCE_TEXTURE_UNIT));
+        group->instanceDataHeight = new osg::Uniform("instanceDataHeight", 1.0f);
+        ss->addUniform(group->instanceDataHeight);
+        if(mProgram != nullptr)
+        {
+            ss->setAttribute(mProgram, osg::StateAttribute::ON);
+        }
+
+        if(mLightManager != nullptr)
+        {
+            // instances are lit in world space, so they can share the default directional light
+            mLightManager->addDefaultLightingUniforms(ss);
+        }
+
+        mGroups.push_back(std::move(group));
+        size_t groupIndex = mGroups.size() - 1;
+        mGroups.back()->node->setCullCallback(new InstanceGroupCullCallback(*this, groupIndex));
+        mRoot->addChild(mGroups.back()->node);
+
+        return groupIndex;
+    }
+
+    void InstanceManager::_rebuildGroup(Group &group)
+    {
+        // sort instances by grid cell, so each range covers a compact area and can be culled as a whole
+        auto cellKey = [](const Instance &i)
+        {
+            int32_t cellX = static_cast<int32_t>(std::floor(i.bound.center().x()/OD_INSTANCE_RANGE_CELL_SIZE));
+            int32_t cellZ = static_cast<int32_t>(std::floor(i.bound.center().z()/OD_INSTANCE_RANGE_CELL_SIZE));
+            return (static_cast<uint64_t>(static_cast<uint32_t>(cellX)) << 32) | static_cast<uint32_t>(cellZ);
+        };
+        std::sort(group.instances.begin(), group.instances.end(),
+                [&cellKey](const Instance &a, const Instance &b){ return cellKey(a) < cellKey(b); });
+
+        for(size_t i = 0; i < group.instances.size(); ++i)
+        {
+            mLocations[group.instances[i].id].index = i;
+        }
+
+        group.ranges.clear();
+        for(size_t i = 0; i < group.instances.size(); ++i)
+        {
+            if(group.ranges.empty()
+                    || group.ranges.back().count >= OD_INSTANCE_MAX_PER_RANGE
+                    || cellKey(group.instances[group.ranges.back().first]) != cellKey(group.instances[i]))
+            {
+                Range range;
+                range.first = i;
+                range.count = 0;
+                range.visible = true;
+                group.ranges.push_back(range);
+            }
+
+            Range &range = group.ranges.back();
+            range.bound.expandBy(group.instances[i].bound);
+            ++range.count;
+        }
+
+        // texture rows are allocated in powers of two so adding a few instances doesn't reallocate every time
+        size_t rows = 1;
+        while(rows < group.instances.size())
+        {
+            rows *= 2;
+        }
+        if(group.instanceData->t() != static_cast<int>(rows))
+        {
+            group.instanceData->allocateImage(OD_INSTANCE_TEXELS, rows, 1, GL_RGBA, GL_FLOAT);
+            std::fill(reinterpret_cast<float*>(group.instanceData->data()),
+                    reinterpret_cast<float*>(group.instanceData->data()) + OD_INSTANCE_TEXELS*4*rows, 0.0f);
+            group.instanceDataHeight->set(static_cast<float>(rows));
+        }
+
+        for(size_t i = 0; i < group.instances.size(); ++i)
+        {
+            _writeInstanceData(group, i);
+        }
+        group.instanceData->dirty();
+
+        group.node->removeChildren(0, group.node->getNumChildren());
+        for(auto it = group.ranges.begin(); it != group.ranges.end(); ++it)
+        {
+            it->node = _makeRangeNode(group, *it);
+            group.node->addChild(it->node);
+        }
+    }
+
+    void InstanceManager::_writeInstanceData(Group &group, size_t index)
+    {
+        const Instance &instance = group.instances[index];
+        float *row = reinterpret_cast<float*>(group.instanceData->data(0, index));
+
+        // OSG matrices transform row vectors. the shader wants the rows of the transposed matrix so it can dot them with
+        //  the vertex. translation ends up in the w components
+        for(size_t r = 0; r < 3; ++r)
+        {
+            for(size_t c = 0; c < 4; ++c)
+            {
+                row[r*4 + c] = instance.transform(c, r);
+            }
+        }
+
+        for(size_t c = 0; c < 4; ++c)
+        {
+            row[3*4 + c] = instance.lightColor[c];
+        }
+    }
+
+    void InstanceManager::_sampleLights(Group &group, LightManager &lightManager)
+    {
+        if(group.instances.empty())
+        {
+            return;
+        }
+
+        for(size_t i = 0; i < group.instances.size(); ++i)
+        {
+            group.instances[i].lightColor = lightManager.sampleLight(group.instances[i].bound.center());
+            _writeInstanceData(group, i);
+        }
+
+        group.instanceData->dirty();
+    }
+
+    size_t InstanceManager::_cullGroup(Group &group, osg::Polytope &frustum)
+    {
+        size_t visibleRanges = 0;
+        for(auto it = group.ranges.begin(); it != group.ranges.end(); ++it)
+        {
+            it->visible = frustum.contains(it->bound);
+            if(it->visible)
+            {
+                ++visibleRanges;
+                mStats.visibleInstances += it->count;
+            }
+        }
+        mStats.visibleRanges += visibleRanges;
+
+        return visibleRanges;
+    }
+
+    osg::ref_ptr<osg::Node> InstanceManager::_makeRangeNode(Group &group, const Range &range)
+    {
+        osg::BoundingBox rangeBox;
+        rangeBox.expandBy(range.bound);
+
+        // all drawables of a range share the range's bounding box, so OSG culls and picks LODs for them as a whole
+        osg::ref_ptr<InstanceRangeBoundCallback> boundCallback(new InstanceRangeBoundCallback(rangeBox));
+
+        osg::ref_ptr<osg::LOD> lodNode(new osg::LOD);
+        lodNode->setRangeMode(osg::LOD::DISTANCE_FROM_EYE_POINT);
+        lodNode->setCenterMode(osg::LOD::USER_DEFINED_CENTER);
+        lodNode->setCenter(range.bound.center());
+        lodNode->setRadius(range.bound.radius());
+        lodNode->getOrCreateStateSet()->addUniform(new osg::Uniform("instanceOffset", static_cast<int>(range.first)));
+
+        for(auto lodIt = group.lods.begin(); lodIt != group.lods.end(); ++lodIt)
+        {
+            osg::ref_ptr<osg::Geode> geode(new osg::Geode);
+            for(size_t i = 0; i < lodIt->geode->getNumDrawables(); ++i)
+            {
+                osg::Geometry *source = lodIt->geode->getDrawable(i)->asGeometry();
+                if(source == nullptr)
+                {
+                    continue;
+                }
+
+                // share arrays and state with the model, but the primitive sets need their own instance count
+                osg::ref_ptr<osg::Geometry> geometry(new osg::Geometry(*source, osg::CopyOp::DEEP_COPY_PRIMITIVES));
+                for(size_t p = 0; p < geometry->getNumPrimitiveSets(); ++p)
+                {
+                    geometry->getPrimitiveSet(p)->setNumInstances(range.count);
+                }
+                geometry->setUseDisplayList(false);
+                geometry->setUseVertexBufferObjects(true);
+                geometry->setComputeBoundingBoxCallback(boundCallback);
+                geometry->dirtyBound();
+                geode->addDrawable(geometry);
+            }
+
+            lodNode->addChild(geode, lodIt->minDistance, lodIt->maxDistance);
+        }
+
+        return lodNode;
+    }
+
+    void InstanceManager::_updateStats()
+    {
+        mStats.groupCount = 0;
+        mStats.instanceCount = 0;
+        mStats.rangeCount = 0;
+        mStats.instancedDrawCalls = 0;
+        mStats.uninstancedDrawCalls = 0;
+
+        for(auto it = mGroups.begin(); it != mGroups.end(); ++it)
+        {
+            Group &group = **it;
+            if(group.instances.empty())
+            {
+                continue;
+            }
+
+            size_t drawables = group.lods.empty() ? 0 : group.lods.front().geode->getNumDrawables();
+            ++mStats.groupCount;
+            mStats.instanceCount += group.instances.size();
+            mStats.rangeCount += group.ranges.size();
+            mStats.instancedDrawCalls += group.ranges.size()*drawables;
+            mStats.uninstancedDrawCalls += group.instances.size()*drawables;
+        }
+    }
+
+}
@@ -9,11 +9,17 @@
 
 #include <osg/Texture2D>
 #include <osg/FrontFace>
+#include <algorithm>
+#include <sstream>
 #include <BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h>
 
 #include "Level.h"
 #include "GeodeBuilder.h"
+#include "LayerLodBuilder.h"
+#include "Engine.h"
+#include "Exception.h"
 #include "NodeMasks.h"
+#include "light/LightBaker.h"
 
 // yeah, i know these are unintuitive at first. but they are kinda shorter
 #define OD_LAYER_FLAG_DIV_BACKSLASH 1
@@ -240,21 +246,247 @@ namespace od
         this->setPosition(osg::Vec3(mOriginX, getWorldHeightLu(), mOriginZ));
         this->setName("layer " + mLayerName);
 
-        mLayerGeode = new osg::Geode;
-        gb.build(mLayerGeode);
-        this->addChild(mLayerGeode);
-
-        mLayerLight = new osg::Light(0);
-        mLayerGeode->getOrCreateStateSet()->setAttribute(mLayerLight, osg::StateAttribute::ON);
-        mLayerLight->setDiffuse(mLightColor);
-        mLayerLight->setAmbient(mAmbientColor);
-        mLayerLight->setConstantAttenuation(1.0); // this gives us a constant light intensity
-        mLayerLight->setLinearAttenuation(0.0);
-        mLayerLight->setQuadraticAttenuation(0.0);
-
-        osg::Vec3 lightPositionHomogeneous(std::cos(mLightDirection), std::sin(mLightAscension), -std::sin(mLightDirection));
-        lightPositionHomogeneous.normalize();
-        mLayerLight->setPosition(osg::Vec4(lightPositionHomogeneous, 0.0)); // w=0 makes this a directional light in homogeneous coords
+        osg::ref_ptr<osg::Geode> layerGeode(new osg::Geode);
+        gb.build(layerGeode);
+
+        size_t tileSize = mLevel.getEngine().getLayerTileSize();
+        float lodPixelError = mLevel.getEngine().getLayerLodPixelError();
+        if(tileSize == 0)
+        {
+            mTileGeodes.push_back(layerGeode);
+
+        }else
+        {
+            _splitIntoTiles(layerGeode, tileSize);
+        }
+
+        std::vector<osg::ref_ptr<osg::Node>> tileNodes(mTileGeodes.begin(), mTileGeodes.end());
+        if(tileSize > 0 && lodPixelError > 0 && mVisibleTriangles > 0)
+        {
+            _buildLod(layerGeode, gb.getTextures(), tileSize, lodPixelError, tileNodes);
+        }
+
+        // tiles containing only holes get no geode
+        mTileGeodes.erase(std::remove(mTileGeodes.begin(), mTileGeodes.end(), nullptr), mTileGeodes.end());
+
+        for(auto it = tileNodes.begin(); it != tileNodes.end(); ++it)
+        {
+            if(*it != nullptr)
+            {
+                this->addChild(*it);
+            }
+        }
+    }
+
+    osg::Vec3f Layer::getLightDirection() const
+    {
+        osg::Vec3f lightDirection(std::cos(mLightDirection), std::sin(mLightAscension), -std::sin(mLightDirection));
+        lightDirection.normalize();
+
+        return lightDirection;
+    }
+
+    void Layer::bakeLighting(LightBaker &baker)
+    {
+        if(mTileGeodes.empty() || mTileGeodes[0]->getNumDrawables() == 0)
+        {
+            return;
+        }
+
+        // all geometries built by the GeodeBuilder share the same vertex and normal arrays, even after splitting into tiles.
+        //  the first drawable of a tile is always one of those, skirts added by the LOD builder come last
+        osg::Geometry *geometry = mTileGeodes[0]->getDrawable(0)->asGeometry();
+        osg::Vec3Array *vertices = dynamic_cast<osg::Vec3Array*>(geometry->getVertexArray());
+        osg::Vec3Array *normals = dynamic_cast<osg::Vec3Array*>(geometry->getNormalArray());
+        if(vertices == nullptr || normals == nullptr)
+        {
+            Logger::warn() << "Layer " << mId << " has no usable vertex or normal array. Not baking lighting";
+            return;
+        }
+
+        baker.setAmbientColor(mAmbientColor);
+        baker.setDirectionalLight(getLightDirection(), mLightColor);
+
+        // the directional light fades out across the layer, starting at the named edge. north is towards -Z, east towards +X
+        osg::Vec3f north(mWidth*0.5f, 0, 0);
+        osg::Vec3f south(mWidth*0.5f, 0, mHeight);
+        osg::Vec3f east(mWidth, 0, mHeight*0.5f);
+        osg::Vec3f west(0, 0, mHeight*0.5f);
+        switch(mLightDropoffType)
+        {
+        case DROPOFF_N2S:
+            baker.setDirectionalDropoff(this->getPosition() + north, this->getPosition() + south);
+            break;
+
+        case DROPOFF_E2W:
+            baker.setDirectionalDropoff(this->getPosition() + east, this->getPosition() + west);
+            break;
+
+        case DROPOFF_S2N:
+            baker.setDirectionalDropoff(this->getPosition() + south, this->getPosition() + north);
+            break;
+
+        case DROPOFF_W2E:
+            baker.setDirectionalDropoff(this->getPosition() + west, this->getPosition() + east);
+            break;
+
+        case DROPOFF_NONE:
+        default:
+            baker.clearDirectionalDropoff();
+            break;
+        }
+
+        osg::ref_ptr<osg::Vec4Array> colors(new osg::Vec4Array);
+        baker.bake(*vertices, *normals, this->getPosition(), *colors);
+
+        for(auto it = mTileGeodes.begin(); it != mTileGeodes.end(); ++it)
+        {
+            for(size_t i = 0; i < (*it)->getNumDrawables(); ++i)
+            {
+                osg::Geometry *geom = (*it)->getDrawable(i)->asGeometry();
+                if(geom != nullptr && geom->getVertexArray() == vertices)
+                {
+                    geom->setColorArray(colors, osg::Array::BIND_PER_VERTEX);
+                }
+            }
+        }
+
+        // reduced levels and skirts have their own arrays
+        if(mLodVertices != nullptr && !mLodVertices->empty())
+        {
+            osg::ref_ptr<osg::Vec4Array> lodColors(new osg::Vec4Array);
+            baker.bake(*mLodVertices, *mLodNormals, this->getPosition(), *lodColors);
+
+            for(auto it = mLodGeometries.begin(); it != mLodGeometries.end(); ++it)
+            {
+                (*it)->setColorArray(lodColors, osg::Array::BIND_PER_VERTEX);
+            }
+        }
+    }
+
+    void Layer::_splitIntoTiles(osg::Geode *layerGeode, size_t tileSize)
+    {
+        size_t tilesX = (mWidth + tileSize - 1)/tileSize;
+        size_t tilesZ = (mHeight + tileSize - 1)/tileSize;
+        mTileGeodes.resize(tilesX*tilesZ);
+
+        // the GeodeBuilder made one geometry per texture. we split each of those into one geometry per tile by distributing
+        //  it's triangles. the copies share vertex arrays and state with the original, only the index arrays are new.
+        //  OSG computes bounds of indexed geometry only from the vertices that are actually referenced, so every tile
+        //  ends up with a tight bounding box.
+        std::vector<osg::ref_ptr<osg::DrawElements>> tileElements(mTileGeodes.size());
+        for(size_t i = 0; i < layerGeode->getNumDrawables(); ++i)
+        {
+            osg::Geometry *geom = layerGeode->getDrawable(i)->asGeometry();
+            osg::Vec3Array *vertices = (geom != nullptr) ? dynamic_cast<osg::Vec3Array*>(geom->getVertexArray()) : nullptr;
+            if(vertices == nullptr || geom->getNumPrimitiveSets() != 1 || geom->getPrimitiveSet(0)->getDrawElements() == nullptr)
+            {
+                throw Exception("Layer geometry has unexpected layout. Can't split into tiles");
+            }
+
+            osg::DrawElements *elements = geom->getPrimitiveSet(0)->getDrawElements();
+            for(size_t n = 0; n + 2 < elements->getNumIndices(); n += 3)
+            {
+                // vertices are in cell units relative to the layer origin. a triangle never spans more than one cell,
+                //  so it's centroid tells us which tile it belongs to
+                osg::Vec3f centroid = (vertices->at(elements->index(n)) + vertices->at(elements->index(n+1)) + vertices->at(elements->index(n+2)))/3.0;
+                size_t tileX = std::min(static_cast<size_t>(std::max(0.0f, centroid.x()))/tileSize, tilesX - 1);
+                size_t tileZ = std::min(static_cast<size_t>(std::max(0.0f, centroid.z()))/tileSize, tilesZ - 1);
+
+                osg::ref_ptr<osg::DrawElements> &target = tileElements[tileZ*tilesX + tileX];
+                if(target == nullptr)
+                {
+                    // same index type as the original, since the shared vertex array still needs to be addressable
+                    target = static_cast<osg::DrawElements*>(elements->cloneType());
+                    target->setMode(elements->getMode());
+                    target->reserveElements(tileSize*tileSize*6);
+                }
+
+                target->addElement(elements->index(n));
+                target->addElement(elements->index(n+1));
+                target->addElement(elements->index(n+2));
+            }
+
+            for(size_t t = 0; t < tileElements.size(); ++t)
+            {
+                if(tileElements[t] == nullptr)
+                {
+                    continue;
+                }
+
+                if(mTileGeodes[t] == nullptr)
+                {
+                    std::ostringstream name;
+                    name << "layer " << mLayerName << " tile " << (t%tilesX) << "," << (t/tilesX);
+                    mTileGeodes[t] = new osg::Geode;
+                    mTileGeodes[t]->setName(name.str());
+                }
+
+                osg::ref_ptr<osg::Geometry> tileGeom(new osg::Geometry(*geom, osg::CopyOp::SHALLOW_COPY));
+                tileGeom->removePrimitiveSet(0, tileGeom->getNumPrimitiveSets());
+                tileGeom->addPrimitiveSet(tileElements[t]);
+                mTileGeodes[t]->addDrawable(tileGeom);
+
+                tileElements[t] = nullptr;
+            }
+        }
+
+        Logger::debug() << "Split layer " << mId << " into " << tilesX << "x" << tilesZ << " tiles of " << tileSize << "x" << tileSize << " cells";
+    }
+
+    void Layer::_buildLod(osg::Geode *layerGeode, const std::map<AssetRef, osg::ref_ptr<osg::Texture2D>> &textures, size_t tileSize, float pixelError, std::vector<osg::ref_ptr<osg::Node>> &tileNodes)
+    {
+        LayerLodBuilder lb("layer " + mLayerName, mLevel, mWidth, mHeight);
+        lb.setCeiling(mType == TYPE_CEILING);
+        lb.setDoubleSided(mType == TYPE_BETWEEN);
+        lb.setPixelError(pixelError);
+
+        std::vector<float> heights;
+        heights.reserve(mVertices.size());
+        for(auto it = mVertices.begin(); it != mVertices.end(); ++it)
+        {
+            heights.push_back(it->heightOffsetLu);
+        }
+        lb.setHeightVector(heights.begin(), heights.end());
+
+        std::vector<LayerLodBuilder::Cell> cells;
+        cells.reserve(mCells.size());
+        for(auto it = mCells.begin(); it != mCells.end(); ++it)
+        {
+            LayerLodBuilder::Cell cell;
+            cell.leftTexture = it->leftTextureRef;
+            cell.rightTexture = it->rightTextureRef;
+            cell.divBackslash = (it->flags & OD_LAYER_FLAG_DIV_BACKSLASH);
+
+            // same as in buildGeometry()
+            cell.uvs[0].set(it->texCoords[0]/0xffff, it->texCoords[1]/0xffff);
+            cell.uvs[1].set(it->texCoords[6]/0xffff, it->texCoords[7]/0xffff);
+            cell.uvs[2].set(it->texCoords[4]/0xffff, it->texCoords[5]/0xffff);
+            cell.uvs[3].set(it->texCoords[2]/0xffff, it->texCoords[3]/0xffff);
+
+            cells.push_back(cell);
+        }
+        lb.setCellVector(cells.begin(), cells.end());
+
+        // the GeodeBuilder keeps grid vertices at their original index and appends duplicates, so it's normals can be
+        //  looked up by grid index
+        if(layerGeode->getNumDrawables() > 0 && layerGeode->getDrawable(0)->asGeometry() != nullptr)
+        {
+            lb.setGridNormals(dynamic_cast<osg::Vec3Array*>(layerGeode->getDrawable(0)->asGeometry()->getNormalArray()));
+        }
+
+        lb.setTextures(textures);
+
+        lb.build(tileSize, mTileGeodes, tileNodes);
+
+        mLodVertices = lb.getVertexArray();
+        mLodNormals = lb.getNormalArray();
+        mLodGeometries = lb.getGeometries();
+
+        const LayerLodBuilder::Stats &stats = lb.getStats();
+        Logger::debug() << "Layer " << mId << " has up to " << stats.maxLevelCount << " LOD levels. "
+                << stats.fullDetailTriangles << " triangles at full detail, " << stats.coarsestTriangles
+                << " at the coarsest levels, " << stats.skirtTriangles << " in skirts";
     }
 
     btCollisionShape *Layer::getCollisionShape()
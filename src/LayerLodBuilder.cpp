@@ -0,0 +1,702 @@
+/*
+ * LayerLodBuilder.cpp
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#include "LayerLodBuilder.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <cmath>
+#include <iterator>
+#include <osg/LOD>
+#include <osg/Texture2D>
+
+#include "Exception.h"
+#include "Logger.h"
+#include "db/AssetProvider.h"
+#include "db/Texture.h"
+
+// skirts must be at least this deep so float imprecision at patch edges can't open cracks on flat ground
+#define OD_LAYER_LOD_MIN_SKIRT_DEPTH 0.1f
+
+namespace od
+{
+
+    LayerLodBuilder::LayerLodBuilder(const std::string &layerName, AssetProvider &assetProvider, size_t width, size_t height)
+    : mLayerName(layerName)
+    , mAssetProvider(assetProvider)
+    , mWidth(width)
+    , mHeight(height)
+    , mCeiling(false)
+    , mDoubleSided(false)
+    , mPixelError(1.0)
+    , mSkirtDepth(OD_LAYER_LOD_MIN_SKIRT_DEPTH)
+    , mVertices(new osg::Vec3Array)
+    , mNormals(new osg::Vec3Array)
+    , mUvCoords(new osg::Vec2Array)
+    , mColors(new osg::Vec4Array(1))
+    {
+        mColors->at(0).set(1.0, 1.0, 1.0, 1.0);
+
+        mStats.tileCount = 0;
+        mStats.maxLevelCount = 0;
+        mStats.fullDetailTriangles = 0;
+        mStats.coarsestTriangles = 0;
+        mStats.skirtTriangles = 0;
+    }
+
+    void LayerLodBuilder::setHeightVector(std::vector<float>::iterator begin, std::vector<float>::iterator end)
+    {
+        if(static_cast<size_t>(end - begin) != (mWidth+1)*(mHeight+1))
+        {
+            throw InvalidArgumentException("Height vector does not match layer size");
+        }
+
+        mHeights.assign(begin, end);
+    }
+
+    void LayerLodBuilder::setCellVector(std::vector<Cell>::iterator begin, std::vector<Cell>::iterator end)
+    {
+        if(static_cast<size_t>(end - begin) != mWidth*mHeight)
+        {
+            throw InvalidArgumentException("Cell vector does not match layer size");
+        }
+
+        mCells.assign(begin, end);
+    }
+
+    void LayerLodBuilder::setGridNormals(osg::Vec3Array *normals)
+    {
+        mGridNormals = normals;
+    }
+
+    void LayerLodBuilder::setTextures(const std::map<AssetRef, osg::ref_ptr<osg::Texture2D>> &textures)
+    {
+        mTextures = textures;
+    }
+
+    void LayerLodBuilder::build(size_t tileSize, const std::vector<osg::ref_ptr<osg::Geode>> &tileGeodes, std::vector<osg::ref_ptr<osg::Node>> &tileNodes)
+    {
+        if(mHeights.empty() || mCells.empty())
+        {
+            throw Exception("Need to set heights and cells before building layer LOD");
+        }
+
+        size_t tilesX = (tileSize > 0) ? (mWidth + tileSize - 1)/tileSize : 0;
+        size_t tilesZ = (tileSize > 0) ? (mHeight + tileSize - 1)/tileSize : 0;
+        if(tileSize == 0 || tileGeodes.size() != tilesX*tilesZ)
+        {
+            throw InvalidArgumentException("Tile geode vector does not match tile size");
+        }
+
+        tileNodes.assign(tileGeodes.begin(), tileGeodes.end());
+
+        size_t maxLevel = 0;
+        while((2u << maxLevel) <= tileSize)
+        {
+            ++maxLevel;
+        }
+
+        // first pass: find mergeable blocks, aligned to the tile they are in, and the error every level introduces.
+        //  we need the largest error of the layer before creating any skirts
+        mMergeLevels.assign(mWidth*mHeight, 0);
+        std::vector<Tile> tiles;
+        tiles.reserve(tilesX*tilesZ);
+        float maxError = 0;
+        bool anyReducedLevels = false;
+        for(size_t t = 0; t < tilesX*tilesZ; ++t)
+        {
+            Tile tile;
+            tile.x = (t%tilesX)*tileSize;
+            tile.z = (t/tilesX)*tileSize;
+            tile.width = std::min(tileSize, mWidth - tile.x);
+            tile.height = std::min(tileSize, mHeight - tile.z);
+
+            for(size_t level = 1; level <= maxLevel; ++level)
+            {
+                size_t size = 1 << level;
+                for(size_t z = tile.z; z + size <= tile.z + tile.height; z += size)
+                {
+                    for(size_t x = tile.x; x + size <= tile.x + tile.width; x += size)
+                    {
+                        // a block can only merge if all four of it's sub-blocks did on the last level
+                        if(mMergeLevels[z*mWidth + x] != level - 1 || !_isMergeable(x, z, size))
+                        {
+                            continue;
+                        }
+
+                        for(size_t cz = z; cz < z + size; ++cz)
+                        {
+                            std::fill(mMergeLevels.begin() + cz*mWidth + x, mMergeLevels.begin() + cz*mWidth + x + size, level);
+                        }
+                    }
+                }
+            }
+
+            tile.levelErrors.push_back(0);
+            for(size_t level = 1; level <= maxLevel; ++level)
+            {
+                bool levelHasNewBlocks = false;
+                float error = tile.levelErrors.back();
+                for(size_t z = tile.z; z < tile.z + tile.height; ++z)
+                {
+                    for(size_t x = tile.x; x < tile.x + tile.width; ++x)
+                    {
+                        size_t blockLevel = std::min<size_t>(mMergeLevels[z*mWidth + x], level);
+                        size_t size = 1 << blockLevel;
+                        if(blockLevel == 0 || (x - tile.x)%size != 0 || (z - tile.z)%size != 0)
+                        {
+                            continue;
+                        }
+
+                        levelHasNewBlocks |= (blockLevel == level);
+                        error = std::max(error, _blockError(x, z, size));
+                    }
+                }
+
+                if(!levelHasNewBlocks)
+                {
+                    // this and all following levels would look exactly like the last one
+                    break;
+                }
+
+                tile.levelErrors.push_back(error);
+                anyReducedLevels = true;
+            }
+
+            maxError = std::max(maxError, tile.levelErrors.back());
+            tiles.push_back(tile);
+        }
+
+        if(!anyReducedLevels)
+        {
+            return;
+        }
+
+        // two patches next to each other may each deviate from the full detail surface in opposite directions
+        mSkirtDepth = std::max(2*maxError, OD_LAYER_LOD_MIN_SKIRT_DEPTH);
+
+        // second pass: build the levels of all tiles. index arrays are only created once we know how many vertices
+        //  there are in total, so we can choose the smallest index type
+        std::vector<PendingMesh> pendingMeshes;
+        for(size_t t = 0; t < tiles.size(); ++t)
+        {
+            const Tile &tile = tiles[t];
+            osg::Geode *tileGeode = tileGeodes[t].get();
+            if(tileGeode == nullptr)
+            {
+                continue;
+            }
+
+            ++mStats.tileCount;
+            mStats.maxLevelCount = std::max(mStats.maxLevelCount, tile.levelErrors.size());
+            size_t tileTriangles = 0;
+            for(size_t i = 0; i < tileGeode->getNumDrawables(); ++i)
+            {
+                osg::Geometry *geom = tileGeode->getDrawable(i)->asGeometry();
+                for(size_t p = 0; geom != nullptr && p < geom->getNumPrimitiveSets(); ++p)
+                {
+                    tileTriangles += geom->getPrimitiveSet(p)->getNumIndices()/3;
+                }
+            }
+            mStats.fullDetailTriangles += tileTriangles;
+
+            // neighbouring tiles might be at a different level. the full detail level needs skirts along the tile border, too
+            PendingMesh fullDetail;
+            fullDetail.geode = tileGeode;
+            _buildTileBorderSkirts(tile, fullDetail.indices);
+            pendingMeshes.push_back(fullDetail);
+
+            size_t levelCount = tile.levelErrors.size();
+            if(levelCount == 1)
+            {
+                mStats.coarsestTriangles += tileTriangles + _countTriangles(fullDetail.indices);
+                continue;
+            }
+
+            // with PIXEL_SIZE_ON_SCREEN, the LOD range is the size of the bounding sphere in pixels. a level is used as long
+            //  as it's error, scaled the same way, stays below the allowed pixel error
+            float radius = tileGeode->getBound().radius();
+            osg::ref_ptr<osg::LOD> lod(new osg::LOD);
+            lod->setRangeMode(osg::LOD::PIXEL_SIZE_ON_SCREEN);
+            lod->setName(tileGeode->getName());
+            for(size_t level = 0; level < levelCount; ++level)
+            {
+                float error = tile.levelErrors[level];
+                float maxRange = (level == 0 || error <= 0) ? std::numeric_limits<float>::max() : mPixelError*radius/error;
+                float minRange = 0;
+                if(level + 1 < levelCount)
+                {
+                    float nextError = tile.levelErrors[level + 1];
+                    minRange = (nextError <= 0) ? std::numeric_limits<float>::max() : mPixelError*radius/nextError;
+                }
+
+                bool isCoarsest = (level + 1 == levelCount);
+                if(minRange >= maxRange && !isCoarsest)
+                {
+                    continue; // the next level is just as good
+                }
+
+                if(level == 0)
+                {
+                    lod->addChild(tileGeode, minRange, maxRange);
+                    continue;
+                }
+
+                std::ostringstream name;
+                name << tileGeode->getName() << " level " << level;
+
+                PendingMesh reduced;
+                reduced.geode = new osg::Geode;
+                reduced.geode->setName(name.str());
+                _buildLevel(tile, level, reduced.indices);
+                pendingMeshes.push_back(reduced);
+
+                lod->addChild(reduced.geode, minRange, maxRange);
+
+                if(isCoarsest)
+                {
+                    mStats.coarsestTriangles += _countTriangles(reduced.indices);
+                }
+            }
+
+            tileNodes[t] = lod;
+        }
+
+        for(auto it = pendingMeshes.begin(); it != pendingMeshes.end(); ++it)
+        {
+            for(auto indexIt = it->indices.begin(); indexIt != it->indices.end(); ++indexIt)
+            {
+                const std::vector<uint32_t> &indices = indexIt->second;
+                if(indices.empty())
+                {
+                    continue;
+                }
+
+                osg::ref_ptr<osg::Geometry> geom(new osg::Geometry);
+                geom->setUseVertexBufferObjects(true);
+                geom->setUseDisplayList(false);
+                geom->setVertexArray(mVertices);
+                geom->setNormalArray(mNormals, osg::Array::BIND_PER_VERTEX);
+                geom->setColorArray(mColors, osg::Array::BIND_OVERALL);
+                geom->setTexCoordArray(0, mUvCoords);
+                geom->setStateSet(_getStateSet(indexIt->first));
+
+                // same as in GeodeBuilder, the index type has to address the whole shared vertex array
+                osg::ref_ptr<osg::DrawElements> drawElements;
+                if(mVertices->size() <= 0xffff)
+                {
+                    drawElements = new osg::DrawElementsUShort(osg::PrimitiveSet::TRIANGLES);
+
+                }else
+                {
+                    drawElements = new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES);
+                }
+                drawElements->reserveElements(indices.size());
+                for(auto index : indices)
+                {
+                    drawElements->addElement(index);
+                }
+                geom->addPrimitiveSet(drawElements);
+
+                it->geode->addDrawable(geom);
+                mGeometries.push_back(geom);
+            }
+        }
+    }
+
+    bool LayerLodBuilder::_isMergeable(size_t cellX, size_t cellZ, size_t size)
+    {
+        if(cellX + size > mWidth || cellZ + size > mHeight)
+        {
+            return false;
+        }
+
+        // the block repeats the texture of it's first cell. only works if both triangles use it, and if the mapping
+        //  is a rotated or mirrored unit square that can be extended linearly across the block
+        const Cell &first = mCells[cellZ*mWidth + cellX];
+        if(first.leftTexture.isNullLayerTexture() || first.leftTexture != first.rightTexture ||
+                first.uvs[3] != first.uvs[1] + first.uvs[2] - first.uvs[0])
+        {
+            return false;
+        }
+
+        for(size_t z = cellZ; z < cellZ + size; ++z)
+        {
+            for(size_t x = cellX; x < cellX + size; ++x)
+            {
+                const Cell &cell = mCells[z*mWidth + x];
+                if(cell.leftTexture != first.leftTexture || cell.rightTexture != first.rightTexture)
+                {
+                    return false;
+                }
+
+                for(size_t i = 0; i < 4; ++i)
+                {
+                    if(cell.uvs[i] != first.uvs[i])
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    float LayerLodBuilder::_blockError(size_t cellX, size_t cellZ, size_t size)
+    {
+        // merged blocks are split along the b-c diagonal, like cells without the backslash flag
+        size_t rowLength = mWidth + 1;
+        float hA = mHeights[cellZ*rowLength + cellX];
+        float hB = mHeights[cellZ*rowLength + cellX + size];
+        float hC = mHeights[(cellZ + size)*rowLength + cellX];
+        float hD = mHeights[(cellZ + size)*rowLength + cellX + size];
+
+        float error = 0;
+        for(size_t j = 0; j <= size; ++j)
+        {
+            for(size_t i = 0; i <= size; ++i)
+            {
+                float interpolated;
+                if(i + j <= size)
+                {
+                    interpolated = hA + (hB - hA)*i/size + (hC - hA)*j/size;
+
+                }else
+                {
+                    interpolated = hD + (hC - hD)*(size - i)/size + (hB - hD)*(size - j)/size;
+                }
+
+                error = std::max(error, std::abs(mHeights[(cellZ + j)*rowLength + cellX + i] - interpolated));
+            }
+        }
+
+        return error;
+    }
+
+    const AssetRef &LayerLodBuilder::_edgeTexture(size_t cellX, size_t cellZ, Edge edge)
+    {
+        // see Layer::buildGeometry() for which triangle contains which corners
+        const Cell &cell = mCells[cellZ*mWidth + cellX];
+        bool left;
+        if(!cell.divBackslash)
+        {
+            left = (edge == EDGE_TOP || edge == EDGE_LEFT);
+
+        }else
+        {
+            left = (edge == EDGE_LEFT || edge == EDGE_BOTTOM);
+        }
+
+        return left ? cell.leftTexture : cell.rightTexture;
+    }
+
+    int LayerLodBuilder::_levelAt(const Tile &tile, int64_t cellX, int64_t cellZ, size_t level)
+    {
+        if(cellX < static_cast<int64_t>(tile.x) || cellX >= static_cast<int64_t>(tile.x + tile.width) ||
+           cellZ < static_cast<int64_t>(tile.z) || cellZ >= static_cast<int64_t>(tile.z + tile.height))
+        {
+            return -1;
+        }
+
+        return std::min<size_t>(mMergeLevels[cellZ*mWidth + cellX], level);
+    }
+
+    uint32_t LayerLodBuilder::_getVertex(size_t gridX, size_t gridZ, const osg::Vec2f &uv, bool skirt)
+    {
+        size_t gridIndex = gridZ*(mWidth + 1) + gridX;
+        auto key = std::make_tuple(gridIndex, uv.x(), uv.y(), skirt);
+        auto it = mVertexMap.find(key);
+        if(it != mVertexMap.end())
+        {
+            return it->second;
+        }
+
+        // skirts hang away from the visible side of the layer
+        float height = mHeights[gridIndex];
+        if(skirt)
+        {
+            height += mCeiling ? mSkirtDepth : -mSkirtDepth;
+        }
+
+        osg::Vec3f normal(0, mCeiling ? -1 : 1, 0);
+        if(mGridNormals != nullptr && gridIndex < mGridNormals->size())
+        {
+            normal = mGridNormals->at(gridIndex);
+        }
+
+        mVertices->push_back(osg::Vec3f(gridX, height, gridZ));
+        mNormals->push_back(normal);
+        mUvCoords->push_back(uv);
+
+        uint32_t index = mVertices->size() - 1;
+        mVertexMap[key] = index;
+
+        return index;
+    }
+
+    void LayerLodBuilder::_addTriangle(std::vector<uint32_t> &indices, uint32_t a, uint32_t b, uint32_t c)
+    {
+        // same winding rules as the full detail layer
+        if(mCeiling)
+        {
+            std::swap(a, b);
+        }
+
+        indices.push_back(a);
+        indices.push_back(b);
+        indices.push_back(c);
+
+        if(mDoubleSided)
+        {
+            indices.push_back(c);
+            indices.push_back(b);
+            indices.push_back(a);
+        }
+    }
+
+    void LayerLodBuilder::_addSkirt(IndexMap &indices, const AssetRef &texture, size_t x0, size_t z0, size_t x1, size_t z1,
+            const osg::Vec2f &uv0, const osg::Vec2f &uv1)
+    {
+        uint32_t top0 = _getVertex(x0, z0, uv0, false);
+        uint32_t top1 = _getVertex(x1, z1, uv1, false);
+        uint32_t bottom0 = _getVertex(x0, z0, uv0, true);
+        uint32_t bottom1 = _getVertex(x1, z1, uv1, true);
+
+        // the crack might be seen from either side, so skirts are always double sided
+        std::vector<uint32_t> &target = indices[texture];
+        uint32_t skirt[] = { top0, top1, bottom1,  top0, bottom1, bottom0,
+                             bottom1, top1, top0,  bottom0, bottom1, top0 };
+        target.insert(target.end(), std::begin(skirt), std::end(skirt));
+
+        mStats.skirtTriangles += 4;
+    }
+
+    void LayerLodBuilder::_buildCell(IndexMap &indices, size_t cellX, size_t cellZ)
+    {
+        const Cell &cell = mCells[cellZ*mWidth + cellX];
+        uint32_t a = _getVertex(cellX,     cellZ,     cell.uvs[0], false);
+        uint32_t b = _getVertex(cellX + 1, cellZ,     cell.uvs[1], false);
+        uint32_t c = _getVertex(cellX,     cellZ + 1, cell.uvs[2], false);
+        uint32_t d = _getVertex(cellX + 1, cellZ + 1, cell.uvs[3], false);
+
+        if(!cell.leftTexture.isNullLayerTexture())
+        {
+            std::vector<uint32_t> &target = indices[cell.leftTexture];
+            if(!cell.divBackslash)
+            {
+                _addTriangle(target, c, b, a);
+
+            }else
+            {
+                _addTriangle(target, a, c, d);
+            }
+        }
+
+        if(!cell.rightTexture.isNullLayerTexture())
+        {
+            std::vector<uint32_t> &target = indices[cell.rightTexture];
+            if(!cell.divBackslash)
+            {
+                _addTriangle(target, c, d, b);
+
+            }else
+            {
+                _addTriangle(target, a, d, b);
+            }
+        }
+    }
+
+    void LayerLodBuilder::_buildBlock(IndexMap &indices, size_t cellX, size_t cellZ, size_t size)
+    {
+        const Cell &cell = mCells[cellZ*mWidth + cellX];
+        osg::Vec2f stepX = (cell.uvs[1] - cell.uvs[0])*size;
+        osg::Vec2f stepZ = (cell.uvs[2] - cell.uvs[0])*size;
+
+        uint32_t a = _getVertex(cellX,        cellZ,        cell.uvs[0], false);
+        uint32_t b = _getVertex(cellX + size, cellZ,        cell.uvs[0] + stepX, false);
+        uint32_t c = _getVertex(cellX,        cellZ + size, cell.uvs[0] + stepZ, false);
+        uint32_t d = _getVertex(cellX + size, cellZ + size, cell.uvs[0] + stepX + stepZ, false);
+
+        std::vector<uint32_t> &target = indices[cell.leftTexture];
+        _addTriangle(target, c, b, a);
+        _addTriangle(target, c, d, b);
+    }
+
+    void LayerLodBuilder::_buildLevel(const Tile &tile, size_t level, IndexMap &indices)
+    {
+        static const int offsets[4][2] = { {0, -1}, {1, 0}, {0, 1}, {-1, 0} }; // indexed by Edge
+        static const Edge opposite[4] = { EDGE_BOTTOM, EDGE_LEFT, EDGE_TOP, EDGE_RIGHT };
+
+        for(size_t z = tile.z; z < tile.z + tile.height; ++z)
+        {
+            for(size_t x = tile.x; x < tile.x + tile.width; ++x)
+            {
+                int blockLevel = _levelAt(tile, x, z, level);
+                size_t size = 1 << blockLevel;
+                if((x - tile.x)%size != 0 || (z - tile.z)%size != 0)
+                {
+                    continue; // not the first cell of it's block
+                }
+
+                if(blockLevel == 0)
+                {
+                    _buildCell(indices, x, z);
+
+                }else
+                {
+                    _buildBlock(indices, x, z, size);
+                }
+
+                // add skirts where the neighbouring patch may have a different resolution. that is any neighbour
+                //  outside the tile, and neighbours inside the tile on another level. two aligned blocks on the same
+                //  level share their edge, so there is no crack between them
+                const Cell &cell = mCells[z*mWidth + x];
+                osg::Vec2f stepX = (cell.uvs[1] - cell.uvs[0])*size;
+                osg::Vec2f stepZ = (cell.uvs[2] - cell.uvs[0])*size;
+                osg::Vec2f corners[4] = { cell.uvs[0], cell.uvs[0] + stepX, cell.uvs[0] + stepZ, cell.uvs[0] + stepX + stepZ };
+                if(blockLevel == 0)
+                {
+                    std::copy(std::begin(cell.uvs), std::end(cell.uvs), std::begin(corners));
+                }
+
+                for(size_t e = 0; e < 4; ++e)
+                {
+                    Edge edge = static_cast<Edge>(e);
+                    const AssetRef &texture = _edgeTexture(x, z, edge);
+                    if(texture.isNullLayerTexture())
+                    {
+                        continue;
+                    }
+
+                    bool needsSkirt = false;
+                    for(size_t n = 0; n < size && !needsSkirt; ++n)
+                    {
+                        // cells along the edge, on the inside of the block
+                        size_t insideX = x + ((edge == EDGE_RIGHT) ? size - 1 : ((edge == EDGE_LEFT) ? 0 : n));
+                        size_t insideZ = z + ((edge == EDGE_BOTTOM) ? size - 1 : ((edge == EDGE_TOP) ? 0 : n));
+                        int64_t neighbourX = static_cast<int64_t>(insideX) + offsets[e][0];
+                        int64_t neighbourZ = static_cast<int64_t>(insideZ) + offsets[e][1];
+                        if(neighbourX < 0 || neighbourX >= static_cast<int64_t>(mWidth) || neighbourZ < 0 || neighbourZ >= static_cast<int64_t>(mHeight))
+                        {
+                            continue; // layer border. nothing to crack against
+                        }
+
+                        if(_edgeTexture(neighbourX, neighbourZ, opposite[e]).isNullLayerTexture())
+                        {
+                            continue; // hole
+                        }
+
+                        int neighbourLevel = _levelAt(tile, neighbourX, neighbourZ, level);
+                        needsSkirt = (neighbourLevel < 0 || neighbourLevel != blockLevel);
+                    }
+
+                    if(!needsSkirt)
+                    {
+                        continue;
+                    }
+
+                    switch(edge)
+                    {
+                    case EDGE_TOP:
+                        _addSkirt(indices, texture, x, z, x + size, z, corners[0], corners[1]);
+                        break;
+
+                    case EDGE_RIGHT:
+                        _addSkirt(indices, texture, x + size, z, x + size, z + size, corners[1], corners[3]);
+                        break;
+
+                    case EDGE_BOTTOM:
+                        _addSkirt(indices, texture, x, z + size, x + size, z + size, corners[2], corners[3]);
+                        break;
+
+                    case EDGE_LEFT:
+                        _addSkirt(indices, texture, x, z, x, z + size, corners[0], corners[2]);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    void LayerLodBuilder::_buildTileBorderSkirts(const Tile &tile, IndexMap &indices)
+    {
+        for(size_t z = tile.z; z < tile.z + tile.height; ++z)
+        {
+            for(size_t x = tile.x; x < tile.x + tile.width; ++x)
+            {
+                const Cell &cell = mCells[z*mWidth + x];
+
+                // only edges towards another tile need skirts. neighbours that are holes have nothing to crack against
+                if(z == tile.z && z > 0 && !_edgeTexture(x, z, EDGE_TOP).isNullLayerTexture() &&
+                        !_edgeTexture(x, z - 1, EDGE_BOTTOM).isNullLayerTexture())
+                {
+                    _addSkirt(indices, _edgeTexture(x, z, EDGE_TOP), x, z, x + 1, z, cell.uvs[0], cell.uvs[1]);
+                }
+
+                if(x + 1 == tile.x + tile.width && x + 1 < mWidth && !_edgeTexture(x, z, EDGE_RIGHT).isNullLayerTexture() &&
+                        !_edgeTexture(x + 1, z, EDGE_LEFT).isNullLayerTexture())
+                {
+                    _addSkirt(indices, _edgeTexture(x, z, EDGE_RIGHT), x + 1, z, x + 1, z + 1, cell.uvs[1], cell.uvs[3]);
+                }
+
+                if(z + 1 == tile.z + tile.height && z + 1 < mHeight && !_edgeTexture(x, z, EDGE_BOTTOM).isNullLayerTexture() &&
+                        !_edgeTexture(x, z + 1, EDGE_TOP).isNullLayerTexture())
+                {
+                    _addSkirt(indices, _edgeTexture(x, z, EDGE_BOTTOM), x, z + 1, x + 1, z + 1, cell.uvs[2], cell.uvs[3]);
+                }
+
+                if(x == tile.x && x > 0 && !_edgeTexture(x, z, EDGE_LEFT).isNullLayerTexture() &&
+                        !_edgeTexture(x - 1, z, EDGE_RIGHT).isNullLayerTexture())
+                {
+                    _addSkirt(indices, _edgeTexture(x, z, EDGE_LEFT), x, z, x, z + 1, cell.uvs[0], cell.uvs[2]);
+                }
+            }
+        }
+    }
+
+    osg::StateSet *LayerLodBuilder::_getStateSet(const AssetRef &texture)
+    {
+        auto it = mStateSets.find(texture);
+        if(it != mStateSets.end())
+        {
+            return it->second.get();
+        }
+
+        osg::ref_ptr<osg::StateSet> ss(new osg::StateSet);
+        osg::ref_ptr<Texture> textureImage = mAssetProvider.getTextureByRef(texture);
+        textureImage->applyAlphaState(ss.get());
+
+        osg::ref_ptr<osg::Texture2D> &tex = mTextures[texture];
+        if(tex == nullptr)
+        {
+            tex = new osg::Texture2D(textureImage);
+        }
+
+        // merged blocks repeat the texture once per cell
+        tex->setWrap(osg::Texture::WRAP_S, osg::Texture::REPEAT);
+        tex->setWrap(osg::Texture::WRAP_T, osg::Texture::REPEAT);
+        ss->setTextureAttributeAndModes(0, tex);
+
+        mStateSets[texture] = ss;
+
+        return ss.get();
+    }
+
+    size_t LayerLodBuilder::_countTriangles(const IndexMap &indices)
+    {
+        size_t count = 0;
+        for(auto it = indices.begin(); it != indices.end(); ++it)
+        {
+            count += it->second.size()/3;
+        }
+
+        return count;
+    }
+
+}
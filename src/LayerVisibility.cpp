@@ -0,0 +1,252 @@
+/*
+ * LayerVisibility.cpp
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#include "LayerVisibility.h"
+
+#include <limits>
+#include <algorithm>
+
+#include "Level.h"
+#include "Layer.h"
+#include "Logger.h"
+#include "NodeMasks.h"
+#include "physics/PhysicsManager.h"
+
+// how far below the eye point we look for a layer to stand on
+#define OD_LAYER_VISIBILITY_RAY_LENGTH 256.0f
+
+namespace od
+{
+
+    static const size_t NO_LAYER = std::numeric_limits<size_t>::max();
+
+    LayerVisibility::LayerVisibility(Level &level)
+    : mLevel(level)
+    , mEnabled(true)
+    , mCurrentEntry(NO_LAYER)
+    , mCurrentLayer(nullptr)
+    {
+        resetStats();
+    }
+
+    void LayerVisibility::init(const std::vector<osg::ref_ptr<Layer>> &layers)
+    {
+        mLayerEntries.clear();
+        mLayerEntries.resize(layers.size());
+        mVisibilityScratch.resize(layers.size());
+        mCurrentEntry = NO_LAYER;
+        mCurrentLayer = nullptr;
+
+        for(size_t i = 0; i < layers.size(); ++i)
+        {
+            mLayerEntries[i].layer = layers[i].get();
+        }
+
+        for(size_t i = 0; i < layers.size(); ++i)
+        {
+            LayerEntry &entry = mLayerEntries[i];
+            entry.visibleSet.push_back(i);
+
+            std::vector<uint32_t> &visibleIds = entry.layer->getVisibleLayers();
+            for(auto it = visibleIds.begin(); it != visibleIds.end(); ++it)
+            {
+                bool found = false;
+                for(size_t j = 0; j < layers.size(); ++j)
+                {
+                    if(layers[j]->getId() == *it)
+                    {
+                        if(j != i)
+                        {
+                            entry.visibleSet.push_back(j);
+                        }
+
+                        found = true;
+                        break;
+                    }
+                }
+
+                if(!found)
+                {
+                    Logger::warn() << "Layer " << entry.layer->getId() << " lists non-existent layer " << *it << " as visible";
+                }
+            }
+        }
+    }
+
+    void LayerVisibility::setEnabled(bool b)
+    {
+        mEnabled = b;
+
+        if(!mEnabled)
+        {
+            _showAll();
+            mCurrentEntry = NO_LAYER;
+            mCurrentLayer = nullptr;
+        }
+
+        Logger::info() << "Layer visibility culling " << (mEnabled ? "enabled" : "disabled");
+    }
+
+    void LayerVisibility::update(const osg::Vec3f &eyePoint)
+    {
+        if(!mEnabled || mLayerEntries.empty())
+        {
+            return;
+        }
+
+        ++mStats.framesEvaluated;
+
+        size_t newEntry = _findCurrentLayer(eyePoint);
+        if(newEntry == NO_LAYER)
+        {
+            // observer is above nothing. if we knew a layer before, keep using that one. otherwise show everything
+            newEntry = mCurrentEntry;
+        }
+
+        if(newEntry != mCurrentEntry)
+        {
+            if(newEntry == NO_LAYER)
+            {
+                _showAll();
+
+            }else
+            {
+                _applyVisibleSet(newEntry);
+            }
+
+            if(mCurrentEntry != NO_LAYER)
+            {
+                ++mStats.layerSwitches;
+            }
+
+            mCurrentEntry = newEntry;
+            mCurrentLayer = (newEntry == NO_LAYER) ? nullptr : mLayerEntries[newEntry].layer;
+        }
+
+        mStats.visibleLayersSum += mStats.visibleLayers;
+    }
+
+    void LayerVisibility::resetStats()
+    {
+        mStats.framesEvaluated = 0;
+        mStats.layerSwitches = 0;
+        mStats.raycastMisses = 0;
+        mStats.unknownLayerHits = 0;
+        mStats.pointTestFallbacks = 0;
+        mStats.visibleLayersSum = 0;
+        mStats.visibleLayers = mLayerEntries.size();
+        mStats.hiddenLayers = 0;
+    }
+
+    void LayerVisibility::dumpStats(std::ostream &out) const
+    {
+        double avgVisible = (mStats.framesEvaluated > 0) ? (double)mStats.visibleLayersSum/mStats.framesEvaluated : 0.0;
+
+        out << "Layer culling stats:" << std::endl
+            << "  culling enabled:       " << (mEnabled ? "yes" : "no") << std::endl
+            << "  layers total:          " << mLayerEntries.size() << std::endl
+            << "  current layer:         ";
+        if(mCurrentLayer != nullptr)
+        {
+            out << mCurrentLayer->getId() << " (" << mCurrentLayer->getName() << ")" << std::endl;
+
+        }else
+        {
+            out << "none" << std::endl;
+        }
+
+        out << "  visible/hidden layers: " << mStats.visibleLayers << "/" << mStats.hiddenLayers << std::endl
+            << "  frames evaluated:      " << mStats.framesEvaluated << std::endl
+            << "  avg. visible layers:   " << avgVisible << std::endl
+            << "  layer switches:        " << mStats.layerSwitches << std::endl
+            << "  raycast misses:        " << mStats.raycastMisses << std::endl
+            << "  unknown layer hits:    " << mStats.unknownLayerHits << std::endl
+            << "  point test fallbacks:  " << mStats.pointTestFallbacks << std::endl;
+    }
+
+    size_t LayerVisibility::_findCurrentLayer(const osg::Vec3f &eyePoint)
+    {
+        RaycastResult result;
+        osg::Vec3f rayEnd = eyePoint - osg::Vec3f(0, OD_LAYER_VISIBILITY_RAY_LENGTH, 0);
+        if(!mLevel.getPhysicsManager().raycastClosestLayer(eyePoint, rayEnd, result))
+        {
+            ++mStats.raycastMisses;
+
+        }else
+        {
+            for(size_t i = 0; i < mLayerEntries.size(); ++i)
+            {
+                if(mLayerEntries[i].layer == result.hitLayer)
+                {
+                    return i;
+                }
+            }
+
+            ++mStats.unknownLayerHits;
+        }
+
+        // ray went through a hole or there is no collision for the layer below. use the highest layer below the eye
+        //  whose bounds contain the eye point instead
+        size_t bestEntry = NO_LAYER;
+        float bestHeight = -std::numeric_limits<float>::infinity();
+        for(size_t i = 0; i < mLayerEntries.size(); ++i)
+        {
+            Layer *l = mLayerEntries[i].layer;
+            float height = l->getWorldHeightLu();
+            if(eyePoint.x() < l->getOriginX() || eyePoint.x() > l->getOriginX() + l->getWidth()
+                || eyePoint.z() < l->getOriginZ() || eyePoint.z() > l->getOriginZ() + l->getHeight()
+                || height > eyePoint.y() || height < bestHeight)
+            {
+                continue;
+            }
+
+            bestEntry = i;
+            bestHeight = height;
+        }
+
+        if(bestEntry != NO_LAYER)
+        {
+            ++mStats.pointTestFallbacks;
+        }
+
+        return bestEntry;
+    }
+
+    void LayerVisibility::_applyVisibleSet(size_t entryIndex)
+    {
+        std::fill(mVisibilityScratch.begin(), mVisibilityScratch.end(), false);
+
+        const std::vector<size_t> &visibleSet = mLayerEntries[entryIndex].visibleSet;
+        for(auto it = visibleSet.begin(); it != visibleSet.end(); ++it)
+        {
+            mVisibilityScratch[*it] = true;
+        }
+
+        mStats.visibleLayers = visibleSet.size();
+        mStats.hiddenLayers = mLayerEntries.size() - visibleSet.size();
+
+        for(size_t i = 0; i < mLayerEntries.size(); ++i)
+        {
+            mLayerEntries[i].layer->setNodeMask(mVisibilityScratch[i] ? NodeMasks::Layer : NodeMasks::Hidden);
+        }
+
+        Logger::debug() << "Observer entered layer " << mLayerEntries[entryIndex].layer->getId()
+                << ". " << mStats.visibleLayers << " layers visible, " << mStats.hiddenLayers << " hidden";
+    }
+
+    void LayerVisibility::_showAll()
+    {
+        for(auto it = mLayerEntries.begin(); it != mLayerEntries.end(); ++it)
+        {
+            it->layer->setNodeMask(NodeMasks::Layer);
+        }
+
+        mStats.visibleLayers = mLayerEntries.size();
+        mStats.hiddenLayers = 0;
+    }
+
+}
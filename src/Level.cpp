@@ -9,6 +9,8 @@
 #include "Level.h"
 
 #include <algorithm>
+#include <map>
+#include <memory>
 #include <osg/Depth>
 
 #include "OdDefines.h"
@@ -19,6 +21,10 @@
 #include "Exception.h"
 #include "Engine.h"
 #include "LevelObject.h"
+#include "Camera.h"
+#include "Player.h"
+#include "light/LightBaker.h"
+#include "rfl/dragon/StaticLight.h"
 
 namespace od
 {
@@ -33,19 +39,38 @@ namespace od
     , mLayerGroup(new osg::Group)
     , mObjectGroup(new osg::Group)
     , mPhysicsManager(*this, levelRootNode)
+    , mObjectStreamer(mObjectGroup)
+    , mLayerVisibility(*this)
+    , mMessageDispatcher(engine.getUpdateScheduler())
+    , mInstanceManager(mObjectGroup)
     {
     	mLevelRootNode->addChild(mLayerGroup);
     	mLevelRootNode->addChild(mObjectGroup);
 
+    	osg::ref_ptr<osg::Shader> instancedShader = mEngine.getShaderManager().loadShader(OD_SHADER_INSTANCED_VERTEX, osg::Shader::VERTEX);
+    	mInstanceManager.setProgram(mEngine.getShaderManager().makeProgram(instancedShader, nullptr));
+    	mInstanceManager.setLightManager(&mEngine.getLightManager());
+
+    	mCpuSkinner.setThreadCount(0);
+
+    	// lighting phase runs after everything that spawns or moves objects, and after the light manager binned this frame's lights
+    	mEngine.getUpdateScheduler().add(&mInstanceManager, UpdatePhase::Lighting);
+
 		mLevelRootNode->getOrCreateStateSet()->setMode(GL_CULL_FACE, osg::StateAttribute::ON);
     }
 
     Level::~Level()
     {
+        mEngine.getUpdateScheduler().remove(&mInstanceManager);
+
     	// despawn all remaining objects
+    	mObjectStreamer.despawnAll();
     	for(auto it = mLevelObjects.begin(); it != mLevelObjects.end(); ++it)
     	{
-    		(*it)->despawned();
+    		if((*it)->getState() == LevelObjectState::Spawned)
+    		{
+    			(*it)->despawned();
+    		}
     	}
 
     	// TODO: this needs a proper mechanism and a map~ we will be doing this on the fly later
@@ -59,24 +84,48 @@ namespace od
     {
         Logger::info() << "Loading level " << mLevelPath.str();
 
-        SrscFile file(mLevelPath);
+        std::unique_ptr<SrscFile> filePtr = mDbManager.openSrscFile(mLevelPath);
+        if(filePtr == nullptr)
+        {
+            throw IoException("Could not open level file " + mLevelPath.str());
+        }
+        SrscFile &file = *filePtr;
 
         _loadNameAndDeps(file);
         _loadLayers(file);
+        mLayerVisibility.init(mLayers);
         //_loadLayerGroups(file); unnecessary, as this is probably just an editor thing
         _loadObjects(file);
+        _bakeLayerLighting();
 
         Logger::info() << "Level loaded successfully";
     }
 
-    void Level::spawnAllObjects()
+    void Level::spawnObjects()
     {
-        Logger::info() << "Spawning all objects for debugging (conditional spawning not implemented yet)";
+        size_t alwaysCount = 0;
         for(auto it = mLevelObjects.begin(); it != mLevelObjects.end(); ++it)
         {
-            mObjectGroup->addChild(*it);
-            (*it)->spawned();
+            switch((*it)->getSpawnStrategy())
+            {
+            case SpawnStrategy::Always:
+                mObjectGroup->addChild(*it);
+                (*it)->spawned();
+                ++alwaysCount;
+                break;
+
+            case SpawnStrategy::WhenInSight:
+                mObjectStreamer.addObject(*it);
+                break;
+
+            case SpawnStrategy::Never:
+            default:
+                break;
+            }
         }
+
+        Logger::verbose() << "Spawned " << alwaysCount << " persistent objects. "
+                << mObjectStreamer.getStreamedObjectCount() << " objects will be spawned when in sight";
     }
 
     void Level::requestLevelObjectDestruction(LevelObject *obj)
@@ -114,108 +163,155 @@ namespace od
             auto it = mDestructionQueue.begin();
             while(it != mDestructionQueue.end())
             {
-                (*it)->despawned();
+                if((*it)->getState() == LevelObjectState::Spawned)
+                {
+                    (*it)->despawned();
+                }
                 (*it)->destroyed();
                 mObjectGroup->removeChild(*it);
 
                 it = mDestructionQueue.erase(it);
             }
         }
-    }
 
-    LevelObject &Level::getLevelObjectByIndex(uint16_t index)
-    {
-        if(index >= mLevelObjects.size())
+        // bone matrices are from the last update traversal, so this matches what was drawn last. done before the
+        //  scheduler runs so physics and RFL code see up-to-date hit meshes and bounds
+        if(!mSkinnedObjects.empty())
         {
-            throw NotFoundException("Level object with given index not found");
+            mCpuSkinner.skin();
+            for(auto it = mSkinnedObjects.begin(); it != mSkinnedObjects.end(); ++it)
+            {
+                (*it)->skinningUpdated();
+            }
         }
 
-        return *mLevelObjects[index];
-    }
+        // stream objects and cull layers around whatever we are looking through. without a camera or player, there is
+        //  no sensible observer position, so fall back to having everything spawned and visible
+        osg::Vec3f observerPosition;
+        if(mEngine.getCamera() != nullptr)
+        {
+            observerPosition = mEngine.getCamera()->getEyePoint();
 
-    // TODO: the following methods look pretty redundant. find clever template interface for them
-    Texture *Level::getTextureByRef(const AssetRef &ref)
-	{
-    	Logger::debug() << "Requested texture " << std::hex << ref.assetId << std::dec << " from level dependency " << ref.dbIndex;
+        }else if(mEngine.getPlayer() != nullptr)
+        {
+            observerPosition = mEngine.getPlayer()->getPosition();
 
-        auto it = mDependencyMap.find(ref.dbIndex);
-        if(it == mDependencyMap.end())
+        }else
         {
-        	Logger::error() << "Database index " << ref.dbIndex << " not found in level dependencies";
-            throw NotFoundException("Can't get texture. Database index not found in level dependencies");
+            if(mObjectStreamer.getSpawnedObjectCount() < mObjectStreamer.getStreamedObjectCount())
+            {
+                mObjectStreamer.spawnAll();
+            }
+
+            return;
         }
 
-        return it->second.get().getTexture(ref.assetId);
+        mObjectStreamer.update(observerPosition);
+        mLayerVisibility.update(observerPosition);
     }
 
-    Model *Level::getModelByRef(const AssetRef &ref)
+    void Level::addSkinnedObject(LevelObject &obj)
     {
-    	Logger::debug() << "Requested model " << std::hex << ref.assetId << std::dec << " from level dependency " << ref.dbIndex;
+        if(obj.getSkinningInstance() == nullptr)
+        {
+            throw InvalidArgumentException("Tried to add object without skinning instance to CPU skinning");
+        }
 
-        auto it = mDependencyMap.find(ref.dbIndex);
-        if(it == mDependencyMap.end())
+        if(std::find(mSkinnedObjects.begin(), mSkinnedObjects.end(), &obj) != mSkinnedObjects.end())
         {
-        	Logger::error() << "Database index " << ref.dbIndex << " not found in level dependencies";
-            throw NotFoundException("Can't get model. Database index not found in level dependencies");
+            return;
         }
 
-        return it->second.get().getModel(ref.assetId);
+        mSkinnedObjects.push_back(&obj);
+        mCpuSkinner.addInstance(obj.getSkinningInstance());
     }
 
-    Class *Level::getClassByRef(const AssetRef &ref)
+    void Level::removeSkinnedObject(LevelObject &obj)
     {
-        Logger::debug() << "Requested class " << std::hex << ref.assetId << std::dec << " from level dependency " << ref.dbIndex;
-
-        auto it = mDependencyMap.find(ref.dbIndex);
-        if(it == mDependencyMap.end())
+        auto it = std::find(mSkinnedObjects.begin(), mSkinnedObjects.end(), &obj);
+        if(it == mSkinnedObjects.end())
         {
-            Logger::error() << "Database index " << ref.dbIndex << " not found in level dependencies";
-            throw NotFoundException("Can't get class. Database index not found in level dependencies");
+            return;
         }
 
-        return it->second.get().getClass(ref.assetId);
+        mSkinnedObjects.erase(it);
+        mCpuSkinner.removeInstance(obj.getSkinningInstance());
     }
 
-    Sequence *Level::getSequenceByRef(const AssetRef &ref)
+    LevelObject &Level::getLevelObjectByIndex(uint16_t index)
     {
-        Logger::debug() << "Requested sequence " << std::hex << ref.assetId << std::dec << " from level dependency " << ref.dbIndex;
-
-        auto it = mDependencyMap.find(ref.dbIndex);
-        if(it == mDependencyMap.end())
+        if(index >= mLevelObjects.size())
         {
-            Logger::error() << "Database index " << ref.dbIndex << " not found in level dependencies";
-            throw NotFoundException("Can't get sequence. Database index not found in level dependencies");
+            throw NotFoundException("Level object with given index not found");
         }
 
-        return it->second.get().getSequence(ref.assetId);
+        return *mLevelObjects[index];
+    }
+
+    Texture *Level::findTextureByRef(const AssetRef &ref)
+	{
+        return _findAssetByRef(ref, mTextureCache);
     }
 
-    Animation *Level::getAnimationByRef(const AssetRef &ref)
+    Model *Level::findModelByRef(const AssetRef &ref)
     {
-    	Logger::debug() << "Requested animation " << std::hex << ref.assetId << std::dec << " from level dependency " << ref.dbIndex;
+        return _findAssetByRef(ref, mModelCache);
+    }
 
-        auto it = mDependencyMap.find(ref.dbIndex);
-        if(it == mDependencyMap.end())
-        {
-            Logger::error() << "Database index " << ref.dbIndex << " not found in level dependencies";
-            throw NotFoundException("Can't get animation. Database index not found in level dependencies");
-        }
+    Class *Level::findClassByRef(const AssetRef &ref)
+    {
+        return _findAssetByRef(ref, mClassCache);
+    }
+
+    Sequence *Level::findSequenceByRef(const AssetRef &ref)
+    {
+        return _findAssetByRef(ref, mSequenceCache);
+    }
+
+    Animation *Level::findAnimationByRef(const AssetRef &ref)
+    {
+        return _findAssetByRef(ref, mAnimationCache);
+    }
 
-        return it->second.get().getAnimation(ref.assetId);
+    Sound *Level::findSoundByRef(const AssetRef &ref)
+    {
+        return _findAssetByRef(ref, mSoundCache);
     }
 
-    Sound *Level::getSoundByRef(const AssetRef &ref)
+    template <typename _AssetType>
+    _AssetType *Level::_findAssetByRef(const AssetRef &ref, AssetCache<_AssetType> &cache)
     {
-        Logger::debug() << "Requested sound " << std::hex << ref.assetId << std::dec << " from level dependency " << ref.dbIndex;
+        uint32_t key = (static_cast<uint32_t>(ref.dbIndex) << 16) | ref.assetId;
+        auto it = cache.find(key);
+        if(it != cache.end())
+        {
+            return it->second.get();
+        }
+
+        Logger::debug() << "Requested " << AssetTraits<_AssetType>::name() << " " << std::hex << ref.assetId << std::dec << " from level dependency " << ref.dbIndex;
+
+        Database *db = (ref.dbIndex < mDependencies.size()) ? mDependencies[ref.dbIndex] : nullptr;
+        if(db == nullptr)
+        {
+            Logger::warn() << "Database index " << ref.dbIndex << " not found in level dependencies";
+            return nullptr;
+        }
+
+        AssetFactory<_AssetType> *factory = db->getAssetFactory<_AssetType>();
+        if(factory == nullptr)
+        {
+            return nullptr;
+        }
 
-        auto it = mDependencyMap.find(ref.dbIndex);
-        if(it == mDependencyMap.end())
+        // misses are not cached. they are rare and the caller usually gives up on them anyway
+        osg::ref_ptr<_AssetType> asset = factory->findAsset(ref.assetId);
+        if(asset == nullptr)
         {
-            Logger::error() << "Database index " << ref.dbIndex << " not found in level dependencies";
-            throw NotFoundException("Can't get sound. Database index not found in level dependencies");
+            return nullptr;
         }
+        cache[key] = asset;
 
-        return it->second.get().getSound(ref.assetId);
+        return asset.get();
     }
 
     void Level::_loadNameAndDeps(SrscFile &file)
@@ -245,7 +341,11 @@ namespace od
 
             Logger::debug() << "Level dependency index " << dbIndex << ": " << dbPath;
 
-            mDependencyMap.insert(std::pair<uint16_t, DbRefWrapper>(dbIndex, db));
+            if(dbIndex >= mDependencies.size())
+            {
+                mDependencies.resize(dbIndex + 1, nullptr);
+            }
+            mDependencies[dbIndex] = &db;
         }
     }
 
@@ -350,16 +450,76 @@ namespace od
     		mLevelObjects[i] = object;
     	}
 
-    	// create directional light so object lighting won't glitch because no light is set for them
-    	osg::ref_ptr<osg::Light> objectLight = new osg::Light(0);
-    	objectLight->setDiffuse(osg::Vec4(224.0/255.0, 223.0/255.0, 201.0/255.0, 1.0));
-    	objectLight->setAmbient(osg::Vec4(50.0/255.0, 50.0/255.0, 50.0/255.0, 1.0));
-    	objectLight->setPosition(osg::Vec4(0.1, 0.9, 0.0, 0.0));
-    	objectLight->setConstantAttenuation(1.0); // this gives us a constant light intensity
-        objectLight->setLinearAttenuation(0.0);
-        objectLight->setQuadraticAttenuation(0.0);
-    	mObjectGroup->getOrCreateStateSet()->setAttribute(objectLight, osg::StateAttribute::ON);
+    	// objects without a lighting layer and instances get the light of the layer most objects are lit by
+    	std::map<Layer*, size_t> lightingLayerUsage;
+    	Layer *defaultLightingLayer = mLayers.empty() ? nullptr : mLayers.front().get();
+    	size_t defaultLightingLayerUsage = 0;
+    	for(auto it = mLevelObjects.begin(); it != mLevelObjects.end(); ++it)
+    	{
+    	    Layer *layer = (*it)->getLightingLayer();
+    	    if(layer == nullptr)
+    	    {
+    	        continue;
+    	    }
+
+    	    size_t usage = ++lightingLayerUsage[layer];
+    	    if(usage > defaultLightingLayerUsage)
+    	    {
+    	        defaultLightingLayer = layer;
+    	        defaultLightingLayerUsage = usage;
+    	    }
+    	}
+
+    	if(defaultLightingLayer != nullptr)
+    	{
+    	    mEngine.getLightManager().setDefaultLighting(defaultLightingLayer->getAmbientColor(),
+    	            defaultLightingLayer->getLightDirection(), defaultLightingLayer->getLightColor());
+    	}
     }
-}
 
+    void Level::_bakeLayerLighting()
+    {
+        Logger::verbose() << "Baking static lights into layers";
+
+        LightBaker baker;
+        baker.setThreadCount(0);
+
+        for(auto it = mLevelObjects.begin(); it != mLevelObjects.end(); ++it)
+        {
+            odRfl::StaticLight *staticLight = dynamic_cast<odRfl::StaticLight*>((*it)->getClassInstance());
+            if(staticLight == nullptr)
+            {
+                continue;
+            }
+
+            LightBaker::PointLight light;
+            light.position = (*it)->getPosition();
+            light.color = staticLight->getColor();
+            light.intensity = staticLight->getIntensityScaling();
+            light.radius = staticLight->getRadius();
+            baker.addPointLight(light);
+        }
+
+        if(mEngine.getBakeShadows())
+        {
+            // the dynamics world can't be raycast from multiple threads. give every bake thread it's own layer tester
+            baker.setOcclusionTestFactory([this]()
+            {
+                std::shared_ptr<PhysicsManager::LayerRayTester> tester = std::make_shared<PhysicsManager::LayerRayTester>(mPhysicsManager);
+                return LightBaker::OcclusionTest([tester](const osg::Vec3f &from, const osg::Vec3f &to)
+                {
+                    return tester->hasHit(from, to);
+                });
+            });
+        }
 
+        for(auto it = mLayers.begin(); it != mLayers.end(); ++it)
+        {
+            (*it)->bakeLighting(baker);
+        }
+
+        const LightBaker::Stats &stats = baker.getStats();
+        Logger::verbose() << "Baked lighting for " << stats.vertexCount << " layer vertices in " << stats.seconds << "s ("
+                << stats.lightTests << " light tests, " << stats.occludedCount << "/" << stats.occlusionTests << " occluded)";
+    }
+}
@@ -8,14 +8,19 @@
 #include "LevelObject.h"
 
 #include <algorithm>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/NodeVisitor>
 
 #include "Level.h"
+#include "Engine.h"
 #include "Layer.h"
 #include "Exception.h"
 #include "OdDefines.h"
 #include "NodeMasks.h"
 #include "rfl/RflClass.h"
 #include "physics/BulletAdapter.h"
+#include "GeodeBuilder.h"
 
 #define OD_OBJECT_FLAG_VISIBLE 0x001
 #define OD_OBJECT_FLAG_SCALED  0x100
@@ -23,44 +28,61 @@
 namespace od
 {
 
-    class LevelObjectUpdateCallback : public osg::NodeCallback
+    /**
+     * @brief Makes a skinned drawable report the bounds of the CPU skinned mesh instead of those of it's bind pose.
+     */
+    class SkinnedBoundsCallback : public osg::Drawable::ComputeBoundingBoxCallback
     {
-        public:
+    public:
 
-        LevelObjectUpdateCallback(LevelObject &obj)
-        : mLevelObject(obj)
-        , mLastSimTime(0)
-        , mFirstUpdate(true)
+        SkinnedBoundsCallback(CpuSkinner::Instance *instance, const osg::BoundingBox &bindPoseBox)
+        : mInstance(instance)
+        , mBindPoseBox(bindPoseBox)
         {
         }
 
-        virtual void operator()(osg::Node* node, osg::NodeVisitor* nv)
+        virtual osg::BoundingBox computeBound(const osg::Drawable &drawable) const override
         {
-            const osg::FrameStamp *fs = nv->getFrameStamp();
-            double simTime = 0;
-            if(fs != nullptr)
-            {
-                if(mFirstUpdate)
-                {
-                    mLastSimTime = fs->getSimulationTime();
-                    mFirstUpdate = false;
-                }
+            // the box covers the whole mesh, not just this drawable. that's fine for culling and saves a box per drawable
+            const osg::BoundingBox &box = mInstance->getBoundingBox();
+            return box.valid() ? box : mBindPoseBox;
+        }
 
-                simTime = fs->getSimulationTime();
-            }
 
-            mLevelObject.update(simTime, simTime - mLastSimTime);
+    private:
 
-            mLastSimTime = simTime;
+        osg::ref_ptr<CpuSkinner::Instance> mInstance;
+        osg::BoundingBox mBindPoseBox;
+    };
 
-            traverse(node, nv);
+
+
+    class CollectSkinnedDrawablesVisitor : public osg::NodeVisitor
+    {
+    public:
+
+        CollectSkinnedDrawablesVisitor(std::vector<osg::ref_ptr<osg::Drawable>> &drawables)
+        : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+        , mDrawables(drawables)
+        {
         }
 
+        virtual void apply(osg::Geode &node)
+        {
+            for(size_t i = 0; i < node.getNumDrawables(); ++i)
+            {
+                osg::Drawable *drawable = node.getDrawable(i);
+                if(dynamic_cast<BonePalette*>(drawable->getUserData()) != nullptr)
+                {
+                    mDrawables.push_back(drawable);
+                }
+            }
+        }
+
+
     private:
 
-        LevelObject &mLevelObject;
-        double mLastSimTime;
-        bool mFirstUpdate;
+        std::vector<osg::ref_ptr<osg::Drawable>> &mDrawables;
     };
 
 
@@ -76,6 +98,9 @@ namespace od
     , mSpawnStrategy(SpawnStrategy::WhenInSight)
     , mIsVisible(true)
     , mIgnoreAttachmentRotation(true)
+    , mRflUpdateHookEnabled(false)
+    , mUpdateTier(UpdateTier::EveryFrame)
+    , mInstanceId(InstanceManager::INVALID_INSTANCE)
     {
         this->setNodeMask(NodeMasks::Object);
     }
@@ -89,6 +114,8 @@ namespace od
 
             despawned();
         }
+
+        setEnableRflUpdateHook(false);
     }
 
     void LevelObject::loadFromRecord(DataReader dr)
@@ -153,15 +180,23 @@ namespace od
         // TODO: We could probably put this into the spawning method, along with delaying model loading of classes to when getModel() is called
         if(mClass->hasModel())
         {
-            mTransform->addChild(mClass->getModel());
             this->addChild(mTransform);
 
             // if model defines a skeleton, create an instance of that skeleton for this object
             if(mClass->getModel()->getSkeletonBuilder() != nullptr)
             {
+                // skinned geometry holds the bone matrices of it's palette in it's state set. give this object it's own
+                //  copies of those. vertex data and textures are still shared with the model
+                osg::CopyOp copyOp(osg::CopyOp::DEEP_COPY_NODES | osg::CopyOp::DEEP_COPY_DRAWABLES | osg::CopyOp::DEEP_COPY_STATESETS | osg::CopyOp::DEEP_COPY_UNIFORMS);
+                mTransform->addChild(new osg::Group(*mClass->getModel(), copyOp));
+
                 mSkeletonRoot = new osg::Group;
                 mClass->getModel()->getSkeletonBuilder()->build(mSkeletonRoot);
                 mTransform->addChild(mSkeletonRoot);
+
+            }else
+            {
+                mTransform->addChild(mClass->getModel());
             }
         }
 
@@ -186,6 +221,11 @@ namespace od
             mRflClassInstance->spawned(*this);
         }
 
+        if(mSkinningInstance != nullptr)
+        {
+            mLevel.addSkinnedObject(*this);
+        }
+
         // build vector of linked object pointers from the stored indices if we haven't done that yet
         if(mLinkedObjects.size() != mLinks.size())
         {
@@ -198,6 +238,18 @@ namespace od
             }
         }
 
+        if(_canBeInstanced())
+        {
+            osg::Matrix worldMatrix;
+            mTransform->computeLocalToWorldMatrix(worldMatrix, nullptr);
+            mInstanceId = mLevel.getInstanceManager().addInstance(mClass->getModel(), worldMatrix);
+            mTransform->removeChild(mClass->getModel());
+
+        }else if(mClass != nullptr && mClass->hasModel())
+        {
+            mLevel.getEngine().getLightManager().addLitObject(this);
+        }
+
         Logger::debug() << "Object " << getObjectId() << " spawned";
 
         mState = LevelObjectState::Spawned;
@@ -210,6 +262,10 @@ namespace od
             mRflClassInstance->despawned(*this);
         }
 
+        _stopInstancing();
+        mLevel.getEngine().getLightManager().removeLitObject(this);
+        mLevel.removeSkinnedObject(*this);
+
         Logger::debug() << "Object " << getObjectId() << " despawned";
 
         // detach this from any object it may be attached to, and detach all objects attached to this
@@ -248,7 +304,7 @@ namespace od
             return;
         }
 
-        Logger::verbose() << "Object " << getObjectId() << " received message '" << message << "' from " << sender.getObjectId();
+        Logger::debug() << "Object " << getObjectId() << " received message '" << message << "' from " << sender.getObjectId();
 
         if(mRflClassInstance != nullptr)
         {
@@ -258,6 +314,7 @@ namespace od
 
     void LevelObject::setPosition(const osg::Vec3f &v)
     {
+        _makeDynamic();
         mTransform->setPosition(v);
 
         for(auto it = mAttachedObjects.begin(); it != mAttachedObjects.end(); ++it)
@@ -268,6 +325,7 @@ namespace od
 
     void LevelObject::setRotation(const osg::Quat &q)
     {
+        _makeDynamic();
         mTransform->setAttitude(q);
 
         for(auto it = mAttachedObjects.begin(); it != mAttachedObjects.end(); ++it)
@@ -337,33 +395,43 @@ namespace od
 
     void LevelObject::setEnableRflUpdateHook(bool enableHook)
     {
+        if(enableHook == mRflUpdateHookEnabled)
+        {
+            return;
+        }
+
+        UpdateScheduler &scheduler = mLevel.getEngine().getUpdateScheduler();
         if(enableHook)
         {
-            if(mUpdateCallback != nullptr)
-            {
-                return;
-            }
+            scheduler.add(this, UpdatePhase::Rfl, mUpdateTier);
 
-            mUpdateCallback = new LevelObjectUpdateCallback(*this);
-            this->addUpdateCallback(mUpdateCallback);
+            // an updating object can change in ways we don't see here, like it's appearance. it can't stay in a batch
+            _makeDynamic();
 
         }else
         {
-            if(mUpdateCallback == nullptr)
-            {
-                return;
-            }
+            scheduler.remove(this);
+        }
 
-            this->removeUpdateCallback(mUpdateCallback);
-            mUpdateCallback = nullptr;
+        mRflUpdateHookEnabled = enableHook;
+    }
+
+    void LevelObject::setUpdateTier(UpdateTier tier)
+    {
+        mUpdateTier = tier;
+
+        if(mRflUpdateHookEnabled)
+        {
+            mLevel.getEngine().getUpdateScheduler().setTier(this, tier);
         }
     }
 
     void LevelObject::messageAllLinkedObjects(odRfl::RflMessage message)
     {
+        MessageDispatcher &dispatcher = mLevel.getMessageDispatcher();
         for(auto it = mLinkedObjects.begin(); it != mLinkedObjects.end(); ++it)
         {
-            (*it)->messageReceived(*this, message);
+            dispatcher.post(*this, **it, message);
         }
     }
 
@@ -372,6 +440,47 @@ namespace od
         mLevel.requestLevelObjectDestruction(this);
     }
 
+    void LevelObject::enableCpuSkinning(SkeletonAnimationPlayer &player)
+    {
+        if(mSkeletonRoot == nullptr)
+        {
+            throw Exception("Tried to enable CPU skinning on object without skeleton");
+        }
+
+        if(mSkinningInstance != nullptr)
+        {
+            return;
+        }
+
+        mSkinningInstance = new CpuSkinner::Instance(mClass->getModel()->getCpuSkinningMesh());
+        player.setSkinningInstance(mSkinningInstance);
+
+        // our skinned drawables are copies made in loadFromRecord, so we can change their bounds without affecting the model
+        CollectSkinnedDrawablesVisitor csdv(mSkinnedDrawables);
+        mTransform->accept(csdv);
+        for(auto it = mSkinnedDrawables.begin(); it != mSkinnedDrawables.end(); ++it)
+        {
+            osg::BoundingBox bindPoseBox = (*it)->getBoundingBox();
+            (*it)->setComputeBoundingBoxCallback(new SkinnedBoundsCallback(mSkinningInstance, bindPoseBox));
+            (*it)->dirtyBound();
+        }
+
+        // RFL classes usually do this in their spawned hook, which runs before we register for skinning in spawned()
+        if(mState == LevelObjectState::Spawned)
+        {
+            mLevel.addSkinnedObject(*this);
+        }
+    }
+
+    void LevelObject::skinningUpdated()
+    {
+        // dirtying a drawable dirties all it's parents, so the bound of this object follows
+        for(auto it = mSkinnedDrawables.begin(); it != mSkinnedDrawables.end(); ++it)
+        {
+            (*it)->dirtyBound();
+        }
+    }
+
     void LevelObject::getWorldTransform(btTransform& worldTrans) const
     {
         worldTrans = BulletAdapter::makeBulletTransform(getPosition(), getRotation());
@@ -425,6 +534,11 @@ namespace od
 
     void LevelObject::_setVisible(bool v)
     {
+        if(!v)
+        {
+            _makeDynamic();
+        }
+
         mIsVisible = v;
 
         if(mTransform != nullptr)
@@ -433,8 +547,47 @@ namespace od
         }
     }
 
-}
+    bool LevelObject::_canBeInstanced()
+    {
+        if(mClass == nullptr || !mClass->hasModel() || mSkeletonRoot != nullptr)
+        {
+            return false;
+        }
+
+        // anything that is hidden, attached or updates itself is likely to move or change soon
+        if(!mIsVisible || mAttachmentTarget != nullptr || !mAttachedObjects.empty() || mRflUpdateHookEnabled)
+        {
+            return false;
+        }
+
+        return mRflClassInstance == nullptr || mRflClassInstance->allowsInstancing();
+    }
+
+    void LevelObject::_stopInstancing()
+    {
+        if(mInstanceId == InstanceManager::INVALID_INSTANCE)
+        {
+            return;
+        }
+
+        mLevel.getInstanceManager().removeInstance(mInstanceId);
+        mInstanceId = InstanceManager::INVALID_INSTANCE;
+        mTransform->addChild(mClass->getModel());
+    }
+
+    void LevelObject::_makeDynamic()
+    {
+        if(mInstanceId == InstanceManager::INVALID_INSTANCE)
+        {
+            return;
+        }
 
+        Logger::debug() << "Object " << getObjectId() << " changed while instanced. Drawing it on it's own from now on";
 
+        _stopInstancing();
+        mLevel.getEngine().getLightManager().addLitObject(this);
+    }
+
+}
 
 
@@ -1,15 +1,11 @@
-/*
- * Logger.cpp
- *
- *  Created on: Nov 18, 2015
- *      Author: zalasus
- */
-
 #include "Logger.h"
 
 #include <ctime>
 #include <algorithm>
 #include <cassert>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
 
 #include "Exception.h"
 
@@ -28,43 +24,287 @@
 		return timeString;
 	}
 
+
+	/*
+	 * Formatting buffers are per thread and reused. We keep a small stack of them so that a log statement
+	 * whose arguments log something themselves does not garble the outer message.
+	 */
+	struct ThreadLogBuffers
+	{
+	    std::vector<std::unique_ptr<std::ostringstream>> buffers;
+	    size_t depth = 0;
+	};
+
+	static thread_local ThreadLogBuffers tlLogBuffers;
+
+	static std::ostringstream *acquireThreadLogBuffer()
+	{
+	    if(tlLogBuffers.depth == tlLogBuffers.buffers.size())
+	    {
+	        tlLogBuffers.buffers.emplace_back(new std::ostringstream);
+	    }
+
+	    return tlLogBuffers.buffers[tlLogBuffers.depth++].get();
+	}
+
+	static void releaseThreadLogBuffer(std::ostringstream *buffer)
+	{
+	    buffer->str("");
+	    buffer->clear();
+	    --tlLogBuffers.depth;
+	}
+
+
+
+	/**
+	 * Bounded multi-producer/single-consumer ring of log records plus the thread consuming it. Producers claim cells
+	 * via CAS on the enqueue position and publish them through the cell's sequence number, so pushing never locks.
+	 */
+	class AsyncLogWriter
+	{
+	public:
+
+	    AsyncLogWriter(Logger &logger, size_t capacity)
+	    : mLogger(logger)
+	    , mEnqueuePos(0)
+	    , mDequeuePos(0)
+	    , mPushedCount(0)
+	    , mWrittenCount(0)
+	    , mStop(false)
+	    {
+	        size_t roundedCapacity = 2;
+	        while(roundedCapacity < capacity)
+	        {
+	            roundedCapacity <<= 1;
+	        }
+
+	        mCells.reset(new Cell[roundedCapacity]);
+	        mMask = roundedCapacity - 1;
+	        for(size_t i = 0; i < roundedCapacity; ++i)
+	        {
+	            mCells[i].sequence.store(i, std::memory_order_relaxed);
+	        }
+
+	        mThread = std::thread(&AsyncLogWriter::_run, this);
+	    }
+
+	    ~AsyncLogWriter()
+	    {
+	        mStop.store(true);
+	        mWakeCondition.notify_one();
+	        mThread.join();
+	    }
+
+	    bool push(std::string &&msg, Logger::LogLevel level)
+	    {
+	        Cell *cell;
+	        size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+	        for(;;)
+	        {
+	            cell = &mCells[pos & mMask];
+	            size_t seq = cell->sequence.load(std::memory_order_acquire);
+	            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+	            if(diff == 0)
+	            {
+	                if(mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+	                {
+	                    break;
+	                }
+
+	            }else if(diff < 0)
+	            {
+	                return false; // full
+
+	            }else
+	            {
+	                pos = mEnqueuePos.load(std::memory_order_relaxed);
+	            }
+	        }
+
+	        cell->message = std::move(msg);
+	        cell->level = level;
+	        cell->sequence.store(pos + 1, std::memory_order_release);
+
+	        mPushedCount.fetch_add(1, std::memory_order_release);
+	        mWakeCondition.notify_one();
+
+	        return true;
+	    }
+
+	    void flush()
+	    {
+	        if(std::this_thread::get_id() == mThread.get_id())
+	        {
+	            return; // a listener flushing from the writer thread would wait for itself
+	        }
+
+	        size_t target = mPushedCount.load(std::memory_order_acquire);
+	        std::unique_lock<std::mutex> lock(mWakeMutex);
+	        while(mWrittenCount.load(std::memory_order_acquire) < target)
+	        {
+	            mWakeCondition.notify_one();
+	            mFlushedCondition.wait_for(lock, std::chrono::milliseconds(10));
+	        }
+	    }
+
+
+	private:
+
+	    struct Cell
+	    {
+	        std::atomic<size_t> sequence;
+	        Logger::LogLevel level;
+	        std::string message;
+	    };
+
+	    bool _pop(std::string &msg, Logger::LogLevel &level)
+	    {
+	        Cell *cell = &mCells[mDequeuePos & mMask];
+	        size_t seq = cell->sequence.load(std::memory_order_acquire);
+	        if(seq != mDequeuePos + 1)
+	        {
+	            return false;
+	        }
+
+	        msg = std::move(cell->message);
+	        level = cell->level;
+	        cell->sequence.store(mDequeuePos + mMask + 1, std::memory_order_release);
+	        ++mDequeuePos;
+
+	        return true;
+	    }
+
+	    void _run()
+	    {
+	        std::string msg;
+	        Logger::LogLevel level;
+	        size_t reportedDrops = 0;
+
+	        for(;;)
+	        {
+	            bool stopping = mStop.load();
+
+	            while(_pop(msg, level))
+	            {
+	                mLogger._write(msg, level);
+	                mWrittenCount.fetch_add(1, std::memory_order_release);
+	            }
+
+	            size_t drops = mLogger.getDroppedCount();
+	            if(drops != reportedDrops)
+	            {
+	                std::ostringstream ss;
+	                ss << "Log queue overflowed. Dropped " << (drops - reportedDrops) << " messages";
+	                mLogger._write(ss.str(), Logger::LOGLEVEL_WARNING);
+	                reportedDrops = drops;
+	            }
+
+	            std::unique_lock<std::mutex> lock(mWakeMutex);
+	            mFlushedCondition.notify_all();
+
+	            if(stopping)
+	            {
+	                break; // we checked the flag before draining, so nothing pushed before the stop request is lost
+	            }
+
+	            mWakeCondition.wait_for(lock, std::chrono::milliseconds(10));
+	        }
+	    }
+
+	    Logger &mLogger;
+	    std::unique_ptr<Cell[]> mCells;
+	    size_t mMask;
+	    std::atomic<size_t> mEnqueuePos;
+	    size_t mDequeuePos; // only touched by writer thread
+	    std::atomic<size_t> mPushedCount;
+	    std::atomic<size_t> mWrittenCount;
+	    std::atomic<bool> mStop;
+	    std::mutex mWakeMutex;
+	    std::condition_variable mWakeCondition;
+	    std::condition_variable mFlushedCondition;
+	    std::thread mThread;
+	};
+
+
+
 	Logger::Logger(LogLevel outputLogLevel, std::ostream *stream)
 	: mEnableTimestamp(false)
 	, mStream(stream)
 	, mChildLogger(nullptr)
 	, mStreamLogLevel(LOGLEVEL_INFO)
 	, mOutputLogLevel(outputLogLevel)
+	, mDroppedCount(0)
 	{
 	}
 
+	Logger::~Logger()
+	{
+	    // writes out everything that is still queued
+	    mAsyncWriter.reset();
+	}
+
 	void Logger::log(const std::string &msg, LogLevel level)
 	{
-		if(level > mOutputLogLevel)
+		if(!isLevelEnabled(level))
 		{
 			return;
 		}
 
-	    if(mChildLogger != nullptr)
+		_submit(std::string(msg), level);
+	}
+
+	void Logger::_submit(std::string &&msg, LogLevel level)
+	{
+	    if(mAsyncWriter == nullptr)
 	    {
-	        mChildLogger->log(msg, level);
-	    }
+	        _write(msg, level);
 
-	    if(mStream == nullptr || !mStream->good())
+	    }else if(!mAsyncWriter->push(std::move(msg), level))
 	    {
-	        return;
+	        // queue is full. never lose warnings or errors, even if that means writing them out of order
+	        if(level <= LOGLEVEL_WARNING)
+	        {
+	            _write(msg, level);
+
+	        }else
+	        {
+	            mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+	        }
 	    }
+	}
+
+	void Logger::_write(const std::string &msg, LogLevel level)
+	{
+	    std::vector<ILoggerListener*> listeners;
 
-	    if(mEnableTimestamp)
 	    {
-	        *mStream << "[" << getTimestamp() << "]";
+	        std::lock_guard<std::mutex> lock(mWriteMutex);
+
+	        if(mChildLogger != nullptr)
+	        {
+	            mChildLogger->log(msg, level);
+	        }
+
+	        if(mStream == nullptr || !mStream->good())
+	        {
+	            return;
+	        }
+
+	        if(mEnableTimestamp)
+	        {
+	            *mStream << "[" << getTimestamp() << "]";
+	        }
+
+	        *mStream << "[" << getLabelForLevel(level) << "] " << msg << std::endl;
+
+	        listeners = mListeners;
 	    }
 
-        *mStream << "[" << getLabelForLevel(level) << "] " << msg << std::endl;
-        
-        for(uint32_t i = 0; i < mListeners.size(); ++i)
-        {
-            mListeners[i]->onLog(msg, level);
-        }
+	    // listeners may log themselves, which would deadlock on the write mutex if we still held it
+	    for(uint32_t i = 0; i < listeners.size(); ++i)
+	    {
+	        listeners[i]->onLog(msg, level);
+	    }
 	}
 
     void Logger::setEnableTimestamp(bool ts)
@@ -86,6 +326,30 @@
     {
         mChildLogger = l;
     }
+
+    void Logger::setAsync(bool async, size_t queueCapacity)
+    {
+        // not safe against concurrent logging. meant to be called once at startup/shutdown
+        mAsyncWriter.reset();
+
+        if(async)
+        {
+            mAsyncWriter.reset(new AsyncLogWriter(*this, queueCapacity));
+        }
+    }
+
+    bool Logger::isAsync() const
+    {
+        return mAsyncWriter != nullptr;
+    }
+
+    void Logger::flush()
+    {
+        if(mAsyncWriter != nullptr)
+        {
+            mAsyncWriter->flush();
+        }
+    }
     
     std::string Logger::getLabelForLevel(LogLevel level)
     {
@@ -114,14 +378,16 @@
     void Logger::addListener(ILoggerListener *listener)
     {
         assert(listener != nullptr);
-        
+
+        std::lock_guard<std::mutex> lock(mWriteMutex);
         mListeners.push_back(listener);
     }
     
     void Logger::removeListener(ILoggerListener *listener)
     {
         assert(listener != nullptr);
-        
+
+        std::lock_guard<std::mutex> lock(mWriteMutex);
         std::vector<ILoggerListener*>::iterator it = std::find(mListeners.begin(), mListeners.end(), listener);
         
         if(it != mListeners.end())
@@ -140,90 +406,37 @@
     template <>
     LoggerStreamProxy Logger::operator<< <Logger::LogLevel>(const Logger::LogLevel &t)
 	{
-		mStreamLogLevel = t;
+		mStreamLogLevel.store(t, std::memory_order_relaxed);
 
-		LoggerStreamProxy p(*this);
-		return p;
+		return _makeProxy(t);
 	}
 
-    LoggerStreamProxy Logger::info()
-    {
-    	getDefaultLogger().mStreamLogLevel = LOGLEVEL_INFO;
-
-    	LoggerStreamProxy p(getDefaultLogger());
-    	return p;
-    }
-
-	LoggerStreamProxy Logger::warn()
-    {
-    	getDefaultLogger().mStreamLogLevel = LOGLEVEL_WARNING;
-
-    	LoggerStreamProxy p(getDefaultLogger());
-    	return p;
-    }
-
-	LoggerStreamProxy Logger::error()
-    {
-    	getDefaultLogger().mStreamLogLevel = LOGLEVEL_ERROR;
-
-    	LoggerStreamProxy p(getDefaultLogger());
-    	return p;
-    }
-
-	LoggerStreamProxy Logger::verbose()
-    {
-    	getDefaultLogger().mStreamLogLevel = LOGLEVEL_VERBOSE;
-
-    	LoggerStreamProxy p(getDefaultLogger());
-    	return p;
-    }
-
-	LoggerStreamProxy Logger::debug()
-    {
-    	getDefaultLogger().mStreamLogLevel = LOGLEVEL_DEBUG;
-
-    	LoggerStreamProxy p(getDefaultLogger());
-    	return p;
-    }
-
-    void Logger::_flushLogStream()
-    {
-    	log(mStreamBuffer.str(), mStreamLogLevel);
-    	mStreamBuffer.str("");
-    }
-
-
-
-    LoggerStreamProxy::~LoggerStreamProxy()
-    {
-    	// if this proxy was not copied, like what would happen if it was the last to be returned by
-    	//  a statement like Logger << "foo" << 42 << "bar"; it has to notify it's associated Logger
-    	//  to flush all stream output
-    	if(!mIWasCopied)
-    	{
-    		mLogger._flushLogStream();
-    	}
-    }
-
-    LoggerStreamProxy::LoggerStreamProxy(LoggerStreamProxy &p)
-	: mLogger(p.mLogger)
-	, mIWasCopied(false)
+    LoggerStreamProxy::LoggerStreamProxy(Logger *l, int level)
+	: mLogger(l)
+	, mLevel(level)
+	, mBuffer((l != nullptr) ? acquireThreadLogBuffer() : nullptr)
 	{
-		p.mIWasCopied = true;
 	}
 
 	LoggerStreamProxy::LoggerStreamProxy(LoggerStreamProxy &&p)
 	: mLogger(p.mLogger)
-	, mIWasCopied(false)
+	, mLevel(p.mLevel)
+	, mBuffer(p.mBuffer)
 	{
-		p.mIWasCopied = true;
+		p.mLogger = nullptr;
+		p.mBuffer = nullptr;
 	}
 
-	LoggerStreamProxy::LoggerStreamProxy(Logger &l)
-	: mLogger(l)
-	, mIWasCopied(false)
-	{
-	}
+    LoggerStreamProxy::~LoggerStreamProxy()
+    {
+    	// only the last proxy of a statement like Logger::info() << "foo" << 42; still holds the buffer
+    	if(mBuffer != nullptr)
+    	{
+    		std::string msg = mBuffer->str();
+    		releaseThreadLogBuffer(mBuffer);
+    		mLogger->_submit(std::move(msg), static_cast<Logger::LogLevel>(mLevel));
+    	}
+    }
 
 
 
@@ -20,6 +20,10 @@
 #include "SrscRecordTypes.h"
 #include "rfl/RflField.h"
 #include "gui/GuiManager.h"
+#include "Benchmarks.h"
+#include "Archive.h"
+#include "SrscExtractor.h"
+#include "OdDefines.h"
 
 
 static void srscStat(od::SrscFile &file)
@@ -186,16 +190,30 @@ void printUsage()
 		<< "Options:" << std::endl
 		<< "    -o <path>  Output path (default './out/')" << std::endl
 		<< "    -x         Extract raw records" << std::endl
-		<< "    -t         Extract as a texture" << std::endl
+		<< "    -d         Inflate compressed data in records extracted with -x" << std::endl
+		<< "    -e         Convert textures, sounds and models extracted with -x to PNG, WAV and OBJ" << std::endl
+		<< "    -j <n>     Number of threads used by -x, -t and -r (default: one per core)" << std::endl
+		<< "    -t         Extract textures of passed database as PNG" << std::endl
 		<< "    -i <id>    Limit extraction to records with ID <id>" << std::endl
 		<< "    -s         Print SRSC statistics" << std::endl
 		<< "    -c         Create class statistics" << std::endl
 		<< "    -r         Extract textures and strings from passed Dragon.rrc" << std::endl
+		<< "    -a         Pack databases and levels in passed install directory into " OD_ARCHIVE_FILENAME << std::endl
+		<< "    -z         Compress files packed with -a" << std::endl
+		<< "    -n         Don't cast shadows when baking static lights into layers" << std::endl
+		<< "    -l <n>     Split layers into tiles of <n> by <n> cells for culling. 0 disables (default: " << OD_LAYER_DEFAULT_TILE_SIZE << ")" << std::endl
+		<< "    -m <r>     Distance in model radii beyond which generated model LODs are used. 0 disables (default: " << OD_MODEL_DEFAULT_AUTO_LOD_DISTANCE << ")" << std::endl
+		<< "    -f         Store model vertex attributes as floats instead of quantizing them" << std::endl
+		<< "    -g <px>    Maximum screen-space error of reduced layer detail in pixels. 0 disables (default: " << OD_LAYER_DEFAULT_LOD_PIXEL_ERROR << ")" << std::endl
+		<< "    -p <n>     Print layer culling and scene statistics after <n> frames and exit" << std::endl
 		<< "    -v         Increase verbosity of logger" << std::endl
+		<< "    -b <name>  Run the named micro benchmark and exit" << std::endl
 		<< "    -h         Display this message and exit" << std::endl
 		<< "If no option is given, the file is loaded as a level." << std::endl
 		<< "If no file and no options are given, the default intro level is loaded." << std::endl
-		<< std::endl;
+		<< "Available benchmarks:" << std::endl;
+	od::listBenchmarks(std::cout);
+	std::cout << std::endl;
 }
 
 int main(int argc, char **argv)
@@ -204,13 +222,25 @@ int main(int argc, char **argv)
 	std::string filename;
 	std::string outputPath = "out/";
 	bool extract = false;
+	bool extractRaw = true;
+	bool extractConvert = false;
+	size_t extractThreads = 0;
 	bool texture = false;
 	bool stat = false;
 	bool classStat = false;
 	bool rrcExtract = false;
+	bool buildArchive = false;
+	bool compressArchive = false;
+	bool bakeShadows = true;
+	size_t layerTileSize = OD_LAYER_DEFAULT_TILE_SIZE;
+	float layerLodPixelError = OD_LAYER_DEFAULT_LOD_PIXEL_ERROR;
+	float modelAutoLodDistance = OD_MODEL_DEFAULT_AUTO_LOD_DISTANCE;
+	bool compactVertexFormat = true;
+	size_t statsDumpFrame = 0;
+	std::string benchmarkName;
 	uint16_t extractRecordId = 0;
 	int c;
-	while((c = getopt(argc, argv, "i:o:txscvhr")) != -1)
+	while((c = getopt(argc, argv, "i:o:txscvhrb:azdj:nl:g:m:fp:e")) != -1)
 	{
 		switch(c)
 		{
@@ -257,6 +287,94 @@ int main(int argc, char **argv)
 		    rrcExtract = true;
 		    break;
 
+		case 'b':
+		    benchmarkName = std::string(optarg);
+		    break;
+
+		case 'a':
+		    buildArchive = true;
+		    break;
+
+		case 'z':
+		    compressArchive = true;
+		    break;
+
+		case 'd':
+		    extractRaw = false;
+		    break;
+
+		case 'e':
+		    extractConvert = true;
+		    break;
+
+		case 'j':
+		    {
+		        std::istringstream iss(optarg);
+		        iss >> extractThreads;
+		        if(iss.fail())
+		        {
+		            std::cout << "Argument to -j must be a number" << std::endl;
+		            return 1;
+		        }
+		    }
+		    break;
+
+		case 'n':
+		    bakeShadows = false;
+		    break;
+
+		case 'l':
+		    {
+		        std::istringstream iss(optarg);
+		        iss >> layerTileSize;
+		        if(iss.fail())
+		        {
+		            std::cout << "Argument to -l must be a number" << std::endl;
+		            return 1;
+		        }
+		    }
+		    break;
+
+		case 'g':
+		    {
+		        std::istringstream iss(optarg);
+		        iss >> layerLodPixelError;
+		        if(iss.fail() || layerLodPixelError < 0)
+		        {
+		            std::cout << "Argument to -g must be a non-negative number" << std::endl;
+		            return 1;
+		        }
+		    }
+		    break;
+
+		case 'm':
+		    {
+		        std::istringstream iss(optarg);
+		        iss >> modelAutoLodDistance;
+		        if(iss.fail() || modelAutoLodDistance < 0)
+		        {
+		            std::cout << "Argument to -m must be a non-negative number" << std::endl;
+		            return 1;
+		        }
+		    }
+		    break;
+
+		case 'f':
+		    compactVertexFormat = false;
+		    break;
+
+		case 'p':
+		    {
+		        std::istringstream iss(optarg);
+		        iss >> statsDumpFrame;
+		        if(iss.fail() || statsDumpFrame == 0)
+		        {
+		            std::cout << "Argument to -p must be a positive number" << std::endl;
+		            return 1;
+		        }
+		    }
+		    break;
+
 		case 'h':
 			printUsage();
 			return 0;
@@ -270,6 +388,30 @@ int main(int argc, char **argv)
 			{
 				std::cerr << "Option -o requires a valid path argument" << std::endl;
 
+			}else if(optopt == 'j')
+			{
+				std::cerr << "Option -j requires a thread count" << std::endl;
+
+			}else if(optopt == 'm')
+			{
+				std::cerr << "Option -m requires a distance in model radii" << std::endl;
+
+			}else if(optopt == 'g')
+			{
+				std::cerr << "Option -g requires a pixel error" << std::endl;
+
+			}else if(optopt == 'l')
+			{
+				std::cerr << "Option -l requires a tile size in cells" << std::endl;
+
+			}else if(optopt == 'p')
+			{
+				std::cerr << "Option -p requires a frame count" << std::endl;
+
+			}else if(optopt == 'b')
+			{
+				std::cerr << "Option -b requires a benchmark name" << std::endl;
+
 			}else
 			{
 				std::cout << "Unknown option -" << optopt << std::endl;
@@ -279,7 +421,7 @@ int main(int argc, char **argv)
 		}
 	}
 
-	if((stat || extract || texture || classStat || rrcExtract) && (optind >= argc))
+	if((stat || extract || texture || classStat || rrcExtract || buildArchive) && (optind >= argc))
 	{
 		std::cout << "Need at least a file argument." << std::endl;
 		printUsage();
@@ -295,7 +437,16 @@ int main(int argc, char **argv)
 	{
 		Logger::getDefaultLogger().setOutputLogLevel(logLevel);
 
-		if(stat)
+		if(!benchmarkName.empty())
+		{
+		    od::runBenchmark(benchmarkName, std::cout);
+
+		}else if(buildArchive)
+		{
+		    od::FilePath installDir(filename);
+		    od::Archive::build(installDir, od::FilePath(OD_ARCHIVE_FILENAME, installDir), compressArchive);
+
+		}else if(stat)
 		{
 		    od::SrscFile srscFile(filename);
 
@@ -305,41 +456,54 @@ int main(int argc, char **argv)
         {
 			od::SrscFile srscFile(filename);
 
+			std::vector<od::SrscFile::DirEntry> entries;
 			if(extractRecordId > 0)
 			{
 				std::cout << "Extracting all records with ID " << std::hex << extractRecordId << std::dec << " to " << outputPath << std::endl;
 
-				od::SrscFile::DirIterator dirIt = srscFile.getDirIteratorById(extractRecordId);
-				while(dirIt != srscFile.getDirectoryEnd())
+				for(const od::SrscFile::DirEntry &entry : srscFile.getDirectory())
 				{
-					srscFile.decompressRecord(outputPath, dirIt, true);
-
-					dirIt = srscFile.getDirIteratorById(extractRecordId, dirIt+1);
+					if(entry.recordId == extractRecordId)
+					{
+						entries.push_back(entry);
+					}
 				}
 
 			}else
 			{
-				srscFile.decompressAll(outputPath, true);
-
 				std::cout << "Extracting all records to " << outputPath << std::endl;
+
+				entries = srscFile.getDirectory();
 			}
 
+			od::Engine engine;
+			od::SrscExtractor extractor(engine, srscFile.getFilePath(), outputPath, extractRaw);
+			extractor.setThreadCount(extractThreads);
+			extractor.setConvertAssets(extractConvert);
+			od::SrscExtractor::Stats extractStats = extractor.extract(entries);
+			od::SrscExtractor::printStats(extractStats, std::cout);
+
         }else if(texture)
         {
-            od::Engine engine;
-        	od::DbManager dbm(engine);
-        	od::Database &db = dbm.loadDb(filename);
+            od::SrscFile txdFile(od::FilePath(filename).ext(".txd").adjustCase());
 
-        	od::AssetRef ref;
-        	ref.assetId = extractRecordId;
-        	ref.dbIndex = 0;
-
-        	osg::ref_ptr<od::Texture> tex = db.getTextureByRef(ref);
+            std::vector<od::SrscFile::DirEntry> entries;
+            for(const od::SrscFile::DirEntry &entry : txdFile.getDirectory())
+            {
+                if(entry.type == static_cast<od::RecordType>(od::SrscRecordType::TEXTURE) && (extractRecordId == 0 || entry.recordId == extractRecordId))
+                {
+                    entries.push_back(entry);
+                }
+            }
 
-			std::ostringstream ss;
-			ss << outputPath << "texture" << extractRecordId << ".png";
+            std::cout << "Exporting " << entries.size() << " textures to " << outputPath << std::endl;
 
-        	tex->exportToPng(ss.str());
+            od::Engine engine;
+            od::SrscExtractor extractor(engine, txdFile.getFilePath(), outputPath, extractRaw);
+            extractor.setThreadCount(extractThreads);
+            extractor.setConvertAssets(true);
+            od::SrscExtractor::Stats extractStats = extractor.extract(entries);
+            od::SrscExtractor::printStats(extractStats, std::cout);
 
 		}else if(classStat)
         {
@@ -359,15 +523,38 @@ int main(int argc, char **argv)
                 engine.setInitialLevelFile(filename);
             }
 
-            engine.setUp();
-            od::GuiManager &gm = engine.getGuiManager();
+            od::SrscFile rrcFile(filename);
+            std::vector<od::SrscFile::DirEntry> entries;
+            for(const od::SrscFile::DirEntry &entry : rrcFile.getDirectory())
+            {
+                if(entry.type == static_cast<od::RecordType>(od::SrscRecordType::TEXTURE))
+                {
+                    entries.push_back(entry);
+                }
+            }
+
+            od::SrscExtractor extractor(engine, rrcFile.getFilePath(), "out/gui_", true);
+            extractor.setThreadCount(extractThreads);
+            extractor.setConvertAssets(true);
+            od::SrscExtractor::Stats extractStats = extractor.extract(entries);
+            od::SrscExtractor::printStats(extractStats, std::cout);
 
-            gm.dumpTextures();
-            gm.dumpStrings();
+            engine.setUp();
+            engine.getGuiManager().dumpStrings();
 
         }else
 		{
+		    // the tools above print their results to stdout, which must not interleave with log lines written later.
+		    //  only the engine logs enough from the frame loop to benefit from a writer thread
+		    Logger::getDefaultLogger().setAsync(true);
+
 		    od::Engine engine;
+		    engine.setBakeShadows(bakeShadows);
+		    engine.setLayerTileSize(layerTileSize);
+		    engine.setLayerLodPixelError(layerLodPixelError);
+		    engine.setModelAutoLodDistance(modelAutoLodDistance);
+		    engine.setCompactVertexFormat(compactVertexFormat);
+		    engine.setStatsDumpFrame(statsDumpFrame);
 
 		    if(!filename.empty())
 		    {
@@ -380,6 +567,7 @@ int main(int argc, char **argv)
 
 	}catch(std::exception &e)
 	{
+		Logger::getDefaultLogger().flush();
 		std::cerr << "Error: " << e.what() << std::endl;
 		return 1;
 	}
@@ -0,0 +1,549 @@
+/*
+ * MeshSimplifier.cpp
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <iterator>
+
+#include "Exception.h"
+#include "Logger.h"
+
+// collapses may not tilt a remaining triangle further than this (cosine of the angle). catches flips and slivers
+#define OD_SIMPLIFY_MIN_NORMAL_DOT 0.2f
+
+// vertices only collapse onto vertices whose bone weights differ by no more than this per joint
+#define OD_SIMPLIFY_MAX_WEIGHT_DELTA 0.1f
+
+namespace od
+{
+
+    MeshSimplifier::Quadric::Quadric()
+    {
+        std::fill(std::begin(m), std::end(m), 0.0);
+    }
+
+    MeshSimplifier::Quadric::Quadric(const osg::Vec3f &normal, float d)
+    {
+        double a = normal.x();
+        double b = normal.y();
+        double c = normal.z();
+
+        m[0] = a*a; m[1] = a*b; m[2] = a*c; m[3] = a*d;
+                    m[4] = b*b; m[5] = b*c; m[6] = b*d;
+                                m[7] = c*c; m[8] = c*d;
+                                            m[9] = static_cast<double>(d)*d;
+    }
+
+    MeshSimplifier::Quadric &MeshSimplifier::Quadric::operator+=(const Quadric &q)
+    {
+        for(size_t i = 0; i < 10; ++i)
+        {
+            m[i] += q.m[i];
+        }
+
+        return *this;
+    }
+
+    double MeshSimplifier::Quadric::evaluate(const osg::Vec3f &v) const
+    {
+        double x = v.x();
+        double y = v.y();
+        double z = v.z();
+
+        return    m[0]*x*x + 2*m[1]*x*y + 2*m[2]*x*z + 2*m[3]*x
+                + m[4]*y*y + 2*m[5]*y*z + 2*m[6]*y
+                + m[7]*z*z + 2*m[8]*z
+                + m[9];
+    }
+
+    MeshSimplifier::MeshSimplifier(const std::string &modelName)
+    : mModelName(modelName)
+    , mTriangleCount(0)
+    , mOriginalTriangleCount(0)
+    , mMaxCost(0)
+    , mPrepared(false)
+    {
+    }
+
+    void MeshSimplifier::setVertexVector(std::vector<osg::Vec3f>::iterator begin, std::vector<osg::Vec3f>::iterator end)
+    {
+        if(mPrepared)
+        {
+            throw Exception("Can't change vertices after simplification started");
+        }
+
+        mVertices.clear();
+        mVertices.reserve(end - begin);
+        for(auto it = begin; it != end; ++it)
+        {
+            Vertex v;
+            v.position = *it;
+            v.version = 0;
+            v.alive = true;
+            v.locked = false;
+            mVertices.push_back(v);
+        }
+    }
+
+    void MeshSimplifier::setPolygonVector(std::vector<Polygon>::iterator begin, std::vector<Polygon>::iterator end)
+    {
+        if(mPrepared)
+        {
+            throw Exception("Can't change polygons after simplification started");
+        }
+
+        // split quads the same way the GeodeBuilder does. double sided polygons stay one triangle with a flag so the
+        //  two sides can't be collapsed independently
+        mTriangles.clear();
+        mTriangles.reserve(end - begin);
+        for(auto it = begin; it != end; ++it)
+        {
+            if(it->vertexCount != 3 && it->vertexCount != 4)
+            {
+                throw UnsupportedException("Only triangle or quad polygons supported");
+            }
+
+            Triangle tri;
+            tri.texture = it->texture;
+            tri.doubleSided = it->doubleSided;
+            tri.alive = true;
+            for(size_t i = 0; i < 3; ++i)
+            {
+                tri.vertexIndices[i] = it->vertexIndices[i];
+                tri.uvCoords[i] = it->uvCoords[i];
+            }
+            mTriangles.push_back(tri);
+
+            if(it->vertexCount == 4)
+            {
+                static const size_t quadCorners[3] = { 0, 2, 3 };
+                for(size_t i = 0; i < 3; ++i)
+                {
+                    tri.vertexIndices[i] = it->vertexIndices[quadCorners[i]];
+                    tri.uvCoords[i] = it->uvCoords[quadCorners[i]];
+                }
+                mTriangles.push_back(tri);
+            }
+        }
+
+        mOriginalTriangleCount = mTriangles.size();
+        mTriangleCount = mTriangles.size();
+    }
+
+    void MeshSimplifier::setBoneAffectionVector(std::vector<BoneAffection>::iterator begin, std::vector<BoneAffection>::iterator end)
+    {
+        if(mPrepared)
+        {
+            throw Exception("Can't change bone affections after simplification started");
+        }
+
+        mBoneAffections.assign(begin, end);
+    }
+
+    void MeshSimplifier::simplify(size_t targetTriangles)
+    {
+        if(!mPrepared)
+        {
+            _prepare();
+        }
+
+        while(mTriangleCount > targetTriangles && !mCollapses.empty())
+        {
+            Collapse collapse = mCollapses.top();
+            mCollapses.pop();
+
+            Vertex &from = mVertices[collapse.from];
+            Vertex &to = mVertices[collapse.to];
+            if(!from.alive || !to.alive || from.version != collapse.fromVersion || to.version != collapse.toVersion)
+            {
+                continue; // outdated
+            }
+
+            osg::Vec2f newUv;
+            if(!_canCollapse(collapse.from, collapse.to, newUv))
+            {
+                continue;
+            }
+
+            _collapse(collapse.from, collapse.to, newUv);
+            mMaxCost = std::max(mMaxCost, collapse.cost);
+
+            _pushCollapses(collapse.to);
+        }
+    }
+
+    float MeshSimplifier::getError() const
+    {
+        // the quadric sums the squared distances to the planes of all original triangles merged into a vertex
+        return std::sqrt(std::max(0.0, mMaxCost));
+    }
+
+    void MeshSimplifier::getResult(std::vector<osg::Vec3f> &vertices, std::vector<Polygon> &polygons, std::vector<BoneAffection> &boneAffections)
+    {
+        vertices.clear();
+        polygons.clear();
+        boneAffections.clear();
+
+        std::vector<size_t> newIndices(mVertices.size(), std::numeric_limits<size_t>::max());
+        for(auto it = mTriangles.begin(); it != mTriangles.end(); ++it)
+        {
+            if(!it->alive)
+            {
+                continue;
+            }
+
+            Polygon poly;
+            poly.vertexCount = 3;
+            poly.texture = it->texture;
+            poly.doubleSided = it->doubleSided;
+            for(size_t i = 0; i < 3; ++i)
+            {
+                size_t &newIndex = newIndices[it->vertexIndices[i]];
+                if(newIndex == std::numeric_limits<size_t>::max())
+                {
+                    newIndex = vertices.size();
+                    vertices.push_back(mVertices[it->vertexIndices[i]].position);
+                }
+
+                poly.vertexIndices[i] = newIndex;
+                poly.uvCoords[i] = it->uvCoords[i];
+            }
+
+            polygons.push_back(poly);
+        }
+
+        for(auto it = mBoneAffections.begin(); it != mBoneAffections.end(); ++it)
+        {
+            if(it->vertexIndex < newIndices.size() && newIndices[it->vertexIndex] != std::numeric_limits<size_t>::max())
+            {
+                BoneAffection affection = *it;
+                affection.vertexIndex = newIndices[it->vertexIndex];
+                boneAffections.push_back(affection);
+            }
+        }
+    }
+
+    void MeshSimplifier::_prepare()
+    {
+        mPrepared = true;
+
+        for(size_t t = 0; t < mTriangles.size(); ++t)
+        {
+            Triangle &tri = mTriangles[t];
+            for(size_t i = 0; i < 3; ++i)
+            {
+                if(tri.vertexIndices[i] >= mVertices.size())
+                {
+                    Logger::error() << "Vertex index of polygon out of bounds in model '" << mModelName << "'";
+                    throw Exception("Vertex index of polygon out of bounds");
+                }
+            }
+
+            const osg::Vec3f &p0 = mVertices[tri.vertexIndices[0]].position;
+            const osg::Vec3f &p1 = mVertices[tri.vertexIndices[1]].position;
+            const osg::Vec3f &p2 = mVertices[tri.vertexIndices[2]].position;
+            osg::Vec3f normal = (p1 - p0)^(p2 - p0);
+            if(normal.normalize() > 0)
+            {
+                Quadric q(normal, -(normal*p0));
+                for(size_t i = 0; i < 3; ++i)
+                {
+                    mVertices[tri.vertexIndices[i]].quadric += q;
+                }
+            }
+
+            for(size_t i = 0; i < 3; ++i)
+            {
+                mVertices[tri.vertexIndices[i]].triangles.push_back(t);
+            }
+        }
+
+        // lock vertices on UV seams and texture boundaries. all triangles around a vertex that may be removed must
+        //  agree on it's UVs and texture, so it's neighbours can take over it's UVs when it collapses onto them
+        for(size_t v = 0; v < mVertices.size(); ++v)
+        {
+            Vertex &vertex = mVertices[v];
+            for(size_t i = 1; i < vertex.triangles.size() && !vertex.locked; ++i)
+            {
+                const Triangle &first = mTriangles[vertex.triangles[0]];
+                const Triangle &current = mTriangles[vertex.triangles[i]];
+                size_t firstCorner = std::find(first.vertexIndices, first.vertexIndices + 3, v) - first.vertexIndices;
+                size_t currentCorner = std::find(current.vertexIndices, current.vertexIndices + 3, v) - current.vertexIndices;
+                vertex.locked = (first.texture != current.texture || first.uvCoords[firstCorner] != current.uvCoords[currentCorner]
+                        || first.doubleSided != current.doubleSided);
+            }
+        }
+
+        // lock vertices on the border of the mesh and on edges shared by more than two triangles
+        std::map<std::pair<size_t, size_t>, size_t> edgeUseCounts;
+        for(auto it = mTriangles.begin(); it != mTriangles.end(); ++it)
+        {
+            for(size_t i = 0; i < 3; ++i)
+            {
+                size_t a = it->vertexIndices[i];
+                size_t b = it->vertexIndices[(i+1)%3];
+                ++edgeUseCounts[std::make_pair(std::min(a, b), std::max(a, b))];
+            }
+        }
+
+        for(auto it = edgeUseCounts.begin(); it != edgeUseCounts.end(); ++it)
+        {
+            if(it->second != 2)
+            {
+                mVertices[it->first.first].locked = true;
+                mVertices[it->first.second].locked = true;
+            }
+        }
+
+        for(auto it = mBoneAffections.begin(); it != mBoneAffections.end(); ++it)
+        {
+            if(it->vertexIndex < mVertices.size())
+            {
+                mVertices[it->vertexIndex].bones.push_back(std::make_pair(it->jointIndex, it->vertexWeight));
+            }
+        }
+
+        for(auto it = mVertices.begin(); it != mVertices.end(); ++it)
+        {
+            std::sort(it->bones.begin(), it->bones.end());
+        }
+
+        for(size_t v = 0; v < mVertices.size(); ++v)
+        {
+            if(!mVertices[v].locked)
+            {
+                std::vector<size_t> neighbours;
+                _getNeighbours(v, neighbours);
+                for(auto it = neighbours.begin(); it != neighbours.end(); ++it)
+                {
+                    _pushCollapse(v, *it);
+                }
+            }
+        }
+    }
+
+    void MeshSimplifier::_pushCollapses(size_t vertexIndex)
+    {
+        std::vector<size_t> neighbours;
+        _getNeighbours(vertexIndex, neighbours);
+        for(auto it = neighbours.begin(); it != neighbours.end(); ++it)
+        {
+            if(!mVertices[vertexIndex].locked)
+            {
+                _pushCollapse(vertexIndex, *it);
+            }
+
+            if(!mVertices[*it].locked)
+            {
+                _pushCollapse(*it, vertexIndex);
+            }
+        }
+    }
+
+    void MeshSimplifier::_pushCollapse(size_t from, size_t to)
+    {
+        const Vertex &fromVertex = mVertices[from];
+        const Vertex &toVertex = mVertices[to];
+
+        Quadric q = fromVertex.quadric;
+        q += toVertex.quadric;
+
+        Collapse collapse;
+        collapse.cost = q.evaluate(toVertex.position);
+        collapse.from = from;
+        collapse.to = to;
+        collapse.fromVersion = fromVertex.version;
+        collapse.toVersion = toVertex.version;
+        mCollapses.push(collapse);
+    }
+
+    bool MeshSimplifier::_canCollapse(size_t from, size_t to, osg::Vec2f &newUv)
+    {
+        Vertex &fromVertex = mVertices[from];
+        Vertex &toVertex = mVertices[to];
+
+        if(!_bonesCompatible(fromVertex, toVertex))
+        {
+            return false;
+        }
+
+        // the triangles on the collapsed edge vanish. they tell us what UVs the target vertex has in the chart around
+        //  the removed vertex
+        size_t edgeTriangles = 0;
+        for(auto it = fromVertex.triangles.begin(); it != fromVertex.triangles.end(); ++it)
+        {
+            const Triangle &tri = mTriangles[*it];
+            size_t corner = std::find(tri.vertexIndices, tri.vertexIndices + 3, to) - tri.vertexIndices;
+            if(!tri.alive || corner == 3)
+            {
+                continue;
+            }
+
+            if(edgeTriangles > 0 && newUv != tri.uvCoords[corner])
+            {
+                return false;
+            }
+
+            newUv = tri.uvCoords[corner];
+            ++edgeTriangles;
+        }
+
+        if(edgeTriangles == 0)
+        {
+            return false;
+        }
+
+        // link condition: the only vertices adjacent to both ends may be the tips of the triangles on the edge.
+        //  otherwise, the collapse would pinch the mesh into a non-manifold shape
+        std::vector<size_t> fromNeighbours;
+        std::vector<size_t> toNeighbours;
+        _getNeighbours(from, fromNeighbours);
+        _getNeighbours(to, toNeighbours);
+        std::vector<size_t> common;
+        std::set_intersection(fromNeighbours.begin(), fromNeighbours.end(), toNeighbours.begin(), toNeighbours.end(), std::back_inserter(common));
+        if(common.size() != edgeTriangles)
+        {
+            return false;
+        }
+
+        for(auto it = fromVertex.triangles.begin(); it != fromVertex.triangles.end(); ++it)
+        {
+            const Triangle &tri = mTriangles[*it];
+            if(!tri.alive || std::find(tri.vertexIndices, tri.vertexIndices + 3, to) != tri.vertexIndices + 3)
+            {
+                continue;
+            }
+
+            osg::Vec3f before[3];
+            osg::Vec3f after[3];
+            for(size_t i = 0; i < 3; ++i)
+            {
+                before[i] = mVertices[tri.vertexIndices[i]].position;
+                after[i] = (tri.vertexIndices[i] == from) ? toVertex.position : before[i];
+            }
+
+            osg::Vec3f normalBefore = (before[1] - before[0])^(before[2] - before[0]);
+            osg::Vec3f normalAfter = (after[1] - after[0])^(after[2] - after[0]);
+            if(normalBefore.normalize() == 0)
+            {
+                continue; // was degenerate before. nothing to flip
+            }
+
+            if(normalAfter.normalize() == 0 || normalBefore*normalAfter < OD_SIMPLIFY_MIN_NORMAL_DOT)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool MeshSimplifier::_bonesCompatible(const Vertex &a, const Vertex &b)
+    {
+        // both lists are sorted by joint. walk them in parallel and compare weights, treating missing joints as 0
+        auto itA = a.bones.begin();
+        auto itB = b.bones.begin();
+        while(itA != a.bones.end() || itB != b.bones.end())
+        {
+            float weightA = 0;
+            float weightB = 0;
+            if(itB == b.bones.end() || (itA != a.bones.end() && itA->first < itB->first))
+            {
+                weightA = (itA++)->second;
+
+            }else if(itA == a.bones.end() || itB->first < itA->first)
+            {
+                weightB = (itB++)->second;
+
+            }else
+            {
+                weightA = (itA++)->second;
+                weightB = (itB++)->second;
+            }
+
+            if(std::abs(weightA - weightB) > OD_SIMPLIFY_MAX_WEIGHT_DELTA)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void MeshSimplifier::_collapse(size_t from, size_t to, const osg::Vec2f &newUv)
+    {
+        Vertex &fromVertex = mVertices[from];
+        Vertex &toVertex = mVertices[to];
+
+        for(auto it = fromVertex.triangles.begin(); it != fromVertex.triangles.end(); ++it)
+        {
+            Triangle &tri = mTriangles[*it];
+            if(!tri.alive)
+            {
+                continue;
+            }
+
+            if(std::find(tri.vertexIndices, tri.vertexIndices + 3, to) != tri.vertexIndices + 3)
+            {
+                tri.alive = false;
+                --mTriangleCount;
+                continue;
+            }
+
+            for(size_t i = 0; i < 3; ++i)
+            {
+                if(tri.vertexIndices[i] == from)
+                {
+                    tri.vertexIndices[i] = to;
+                    tri.uvCoords[i] = newUv;
+                }
+            }
+            toVertex.triangles.push_back(*it);
+        }
+
+        auto isDead = [this](size_t t){ return !mTriangles[t].alive; };
+        toVertex.triangles.erase(std::remove_if(toVertex.triangles.begin(), toVertex.triangles.end(), isDead), toVertex.triangles.end());
+
+        toVertex.quadric += fromVertex.quadric;
+        ++toVertex.version;
+
+        fromVertex.alive = false;
+        fromVertex.triangles.clear();
+    }
+
+    void MeshSimplifier::_getNeighbours(size_t vertexIndex, std::vector<size_t> &neighbours)
+    {
+        neighbours.clear();
+
+        const Vertex &vertex = mVertices[vertexIndex];
+        for(auto it = vertex.triangles.begin(); it != vertex.triangles.end(); ++it)
+        {
+            const Triangle &tri = mTriangles[*it];
+            if(!tri.alive)
+            {
+                continue;
+            }
+
+            for(size_t i = 0; i < 3; ++i)
+            {
+                if(tri.vertexIndices[i] != vertexIndex)
+                {
+                    neighbours.push_back(tri.vertexIndices[i]);
+                }
+            }
+        }
+
+        // sorted, so neighbour sets can be intersected
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+    }
+
+}
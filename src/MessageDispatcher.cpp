@@ -0,0 +1,125 @@
+/*
+ * MessageDispatcher.cpp
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#include "MessageDispatcher.h"
+
+#include <algorithm>
+
+#include "LevelObject.h"
+#include "Logger.h"
+#include "rfl/RflClass.h"
+
+// enough for every reasonable trigger chain, but keeps message storms from eating whole frames
+#define OD_MESSAGE_DEFAULT_BATCH_LIMIT 256
+
+namespace od
+{
+
+    MessageDispatcher::MessageDispatcher(UpdateScheduler &scheduler)
+    : mScheduler(scheduler)
+    , mNextSequence(0)
+    , mBatchLimit(OD_MESSAGE_DEFAULT_BATCH_LIMIT)
+    , mPostedSinceDispatch(0)
+    {
+        mStats.dispatchedLastFrame = 0;
+        mStats.postedLastFrame = 0;
+        mStats.queueDepth = 0;
+        mStats.maxQueueDepth = 0;
+        mStats.totalDispatched = 0;
+        mStats.totalCollapsed = 0;
+
+        mScheduler.add(this, UpdatePhase::Messaging);
+    }
+
+    MessageDispatcher::~MessageDispatcher()
+    {
+        mScheduler.remove(this);
+    }
+
+    void MessageDispatcher::post(LevelObject &sender, LevelObject &receiver, odRfl::RflMessage message)
+    {
+        ++mPostedSinceDispatch;
+
+        auto lastIt = mLastPending.find(&receiver);
+        if(lastIt != mLastPending.end() && lastIt->second.message == message)
+        {
+            odRfl::RflClass *receiverClass = receiver.getClassInstance();
+            if(receiverClass != nullptr && receiverClass->allowsMessageCollapsing(message))
+            {
+                // receiver will get the identical message anyway and nothing else is queued for it after that
+                ++mStats.totalCollapsed;
+                return;
+            }
+        }
+
+        PendingMessage pm;
+        pm.sender = &sender;
+        pm.receiver = &receiver;
+        pm.message = message;
+        pm.sequence = mNextSequence++;
+        mQueue.push_back(pm);
+
+        mLastPending[&receiver] = LastPending{message, pm.sequence};
+
+        mStats.queueDepth = mQueue.size();
+        if(mStats.queueDepth > mStats.maxQueueDepth)
+        {
+            mStats.maxQueueDepth = mStats.queueDepth;
+        }
+    }
+
+    void MessageDispatcher::clear()
+    {
+        mQueue.clear();
+        mLastPending.clear();
+        mStats.queueDepth = 0;
+    }
+
+    void MessageDispatcher::dumpStats(std::ostream &out) const
+    {
+        out << "Message dispatch stats:" << std::endl
+            << "  posted last frame:     " << mStats.postedLastFrame << std::endl
+            << "  dispatched last frame: " << mStats.dispatchedLastFrame << std::endl
+            << "  queue depth:           " << mStats.queueDepth << " (max " << mStats.maxQueueDepth << ")" << std::endl
+            << "  total dispatched:      " << mStats.totalDispatched << std::endl
+            << "  total collapsed:       " << mStats.totalCollapsed << std::endl;
+    }
+
+    void MessageDispatcher::update(double simTime, double relTime)
+    {
+        mStats.postedLastFrame = mPostedSinceDispatch;
+        mPostedSinceDispatch = 0;
+
+        // only deliver what was pending at the start of the batch. anything posted by receivers goes to next frame
+        size_t toDispatch = std::min(mQueue.size(), mBatchLimit);
+        if(toDispatch < mQueue.size())
+        {
+            Logger::debug() << "Message queue exceeds batch limit. Deferring " << (mQueue.size() - toDispatch) << " messages";
+        }
+
+        for(size_t i = 0; i < toDispatch; ++i)
+        {
+            // pop before delivering, as the receiver may post new messages
+            PendingMessage pm = mQueue.front();
+            mQueue.pop_front();
+
+            auto lastIt = mLastPending.find(pm.receiver.get());
+            if(lastIt != mLastPending.end() && lastIt->second.sequence == pm.sequence)
+            {
+                // that was the last message queued for this receiver
+                mLastPending.erase(lastIt);
+            }
+
+            pm.receiver->messageReceived(*pm.sender, pm.message);
+        }
+
+        mStats.dispatchedLastFrame = toDispatch;
+        mStats.totalDispatched += toDispatch;
+        mStats.queueDepth = mQueue.size();
+    }
+
+}
@@ -0,0 +1,246 @@
+/*
+ * ObjectStreamer.cpp
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#include "ObjectStreamer.h"
+
+#include <algorithm>
+
+#include "LevelObject.h"
+#include "Logger.h"
+#include "rfl/RflClass.h"
+#include "rfl/PrefetchProbe.h"
+
+// objects are usually a lot sparser than layer cells. 16 cells per grid cell keeps the grid small and the queries short
+#define OD_STREAMER_GRID_CELL_SIZE 16.0f
+
+namespace od
+{
+
+    ObjectStreamer::ObjectStreamer(osg::Group *objectGroup)
+    : mObjectGroup(objectGroup)
+    , mSpawnRadius(48.0f)
+    , mDespawnRadius(56.0f)
+    , mPrefetchRadius(72.0f)
+    , mLowFrequencyRadius(24.0f)
+    , mSpawnBudget(16)
+    , mPrefetchBudget(4)
+    , mGrid(OD_STREAMER_GRID_CELL_SIZE)
+    , mTotalSpawnCount(0)
+    , mTotalDespawnCount(0)
+    , mSpawnLatencySum(0)
+    , mMaxSpawnLatency(0)
+    {
+    }
+
+    ObjectStreamer::~ObjectStreamer()
+    {
+        despawnAll();
+    }
+
+    void ObjectStreamer::setRadii(float spawnRadius, float despawnRadius, float prefetchRadius)
+    {
+        mSpawnRadius = spawnRadius;
+        mDespawnRadius = std::max(spawnRadius, despawnRadius);
+        mPrefetchRadius = std::max(spawnRadius, prefetchRadius);
+    }
+
+    void ObjectStreamer::addObject(LevelObject *obj)
+    {
+        if(obj == nullptr)
+        {
+            return;
+        }
+
+        Entry e;
+        e.object = obj;
+        e.gridPosition = obj->getPosition();
+        e.requestTick = 0;
+        e.spawnQueued = false;
+        e.prefetchQueued = false;
+        e.prefetched = false;
+        e.lowFrequency = false;
+
+        mGrid.insert(mEntries.size(), e.gridPosition);
+        mEntries.push_back(e);
+    }
+
+    void ObjectStreamer::update(const osg::Vec3f &observerPosition)
+    {
+        float despawnRadiusSq = mDespawnRadius*mDespawnRadius;
+        float spawnRadiusSq = mSpawnRadius*mSpawnRadius;
+        float prefetchRadiusSq = mPrefetchRadius*mPrefetchRadius;
+        float lowFrequencyRadiusSq = mLowFrequencyRadius*mLowFrequencyRadius;
+
+        // despawn pass. only looks at spawned objects, so this is cheap as long as the spawn radius is sane
+        auto it = mSpawnedEntries.begin();
+        while(it != mSpawnedEntries.end())
+        {
+            Entry &e = mEntries[*it];
+            if(e.object->getState() == LevelObjectState::Destroyed)
+            {
+                // level already took care of removing it from the scenegraph
+                it = mSpawnedEntries.erase(it);
+                continue;
+            }
+
+            float distSq = (e.object->getPosition() - observerPosition).length2();
+            if(distSq > despawnRadiusSq)
+            {
+                _despawn(*it);
+                it = mSpawnedEntries.erase(it);
+                continue;
+            }
+
+            bool lowFrequency = distSq > lowFrequencyRadiusSq;
+            if(lowFrequency != e.lowFrequency)
+            {
+                e.object->setUpdateTier(lowFrequency ? UpdateTier::LowFrequency : UpdateTier::EveryFrame);
+                e.lowFrequency = lowFrequency;
+            }
+
+            ++it;
+        }
+
+        // find objects that came into range
+        osg::Timer_t now = osg::Timer::instance()->tick();
+        mGrid.query(observerPosition, mPrefetchRadius, [&](size_t index)
+        {
+            Entry &e = mEntries[index];
+            if(e.spawnQueued || e.object->getState() != LevelObjectState::Loaded)
+            {
+                return;
+            }
+
+            float distSq = (e.object->getPosition() - observerPosition).length2();
+            if(distSq <= spawnRadiusSq)
+            {
+                e.spawnQueued = true;
+                e.requestTick = now;
+                mSpawnQueue.push_back(index);
+
+            }else if(distSq <= prefetchRadiusSq && !e.prefetched && !e.prefetchQueued)
+            {
+                e.prefetchQueued = true;
+                mPrefetchQueue.push_back(index);
+            }
+        });
+
+        size_t spawnsLeft = mSpawnBudget;
+        while(!mSpawnQueue.empty() && spawnsLeft > 0)
+        {
+            size_t index = mSpawnQueue.front();
+            mSpawnQueue.pop_front();
+
+            Entry &e = mEntries[index];
+            e.spawnQueued = false;
+
+            // observer might have moved away again while this object was waiting in the queue
+            if(e.object->getState() != LevelObjectState::Loaded
+                    || (e.object->getPosition() - observerPosition).length2() > despawnRadiusSq)
+            {
+                continue;
+            }
+
+            _spawn(index);
+            --spawnsLeft;
+        }
+
+        size_t prefetchesLeft = mPrefetchBudget;
+        while(!mPrefetchQueue.empty() && prefetchesLeft > 0)
+        {
+            size_t index = mPrefetchQueue.front();
+            mPrefetchQueue.pop_front();
+
+            mEntries[index].prefetchQueued = false;
+            if(!mEntries[index].prefetched)
+            {
+                _prefetch(index);
+                --prefetchesLeft;
+            }
+        }
+    }
+
+    void ObjectStreamer::spawnAll()
+    {
+        mSpawnQueue.clear();
+
+        osg::Timer_t now = osg::Timer::instance()->tick();
+        for(size_t i = 0; i < mEntries.size(); ++i)
+        {
+            mEntries[i].spawnQueued = false;
+            if(mEntries[i].object->getState() == LevelObjectState::Loaded)
+            {
+                mEntries[i].requestTick = now;
+                _spawn(i);
+            }
+        }
+    }
+
+    void ObjectStreamer::despawnAll()
+    {
+        for(auto it = mSpawnedEntries.begin(); it != mSpawnedEntries.end(); ++it)
+        {
+            if(mEntries[*it].object->getState() == LevelObjectState::Spawned)
+            {
+                _despawn(*it);
+            }
+        }
+
+        mSpawnedEntries.clear();
+        mSpawnQueue.clear();
+    }
+
+    void ObjectStreamer::_spawn(size_t entryIndex)
+    {
+        Entry &e = mEntries[entryIndex];
+
+        if(!e.prefetched)
+        {
+            _prefetch(entryIndex);
+        }
+
+        mObjectGroup->addChild(e.object);
+        e.object->spawned();
+        e.lowFrequency = false; // spawning registers the update hook with the default tier
+        mSpawnedEntries.push_back(entryIndex);
+
+        double latency = osg::Timer::instance()->delta_s(e.requestTick, osg::Timer::instance()->tick());
+        mSpawnLatencySum += latency;
+        mMaxSpawnLatency = std::max(mMaxSpawnLatency, latency);
+        ++mTotalSpawnCount;
+    }
+
+    void ObjectStreamer::_despawn(size_t entryIndex)
+    {
+        Entry &e = mEntries[entryIndex];
+
+        e.object->despawned();
+        mObjectGroup->removeChild(e.object);
+        ++mTotalDespawnCount;
+
+        // object might have moved while it was spawned. keep grid in sync so we find it again at it's new position
+        osg::Vec3f newPosition = e.object->getPosition();
+        mGrid.move(entryIndex, e.gridPosition, newPosition);
+        e.gridPosition = newPosition;
+    }
+
+    void ObjectStreamer::_prefetch(size_t entryIndex)
+    {
+        Entry &e = mEntries[entryIndex];
+        e.prefetched = true;
+
+        odRfl::RflClass *rflClass = e.object->getClassInstance();
+        if(rflClass == nullptr || e.object->getClass() == nullptr)
+        {
+            return;
+        }
+
+        odRfl::PrefetchProbe probe(e.object->getClass()->getAssetProvider());
+        rflClass->probeFields(probe);
+    }
+
+}
@@ -0,0 +1,117 @@
+/*
+ * SceneStatsVisitor.cpp
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#include "SceneStatsVisitor.h"
+
+#include <osg/Geometry>
+
+namespace od
+{
+
+    static const char *getRenderClassName(SceneStatsVisitor::RenderClass rc)
+    {
+        switch(rc)
+        {
+        case SceneStatsVisitor::RenderClass::Opaque:      return "opaque";
+        case SceneStatsVisitor::RenderClass::AlphaTested: return "alpha tested";
+        case SceneStatsVisitor::RenderClass::Sorted:      return "depth sorted";
+        default:                                          return "unknown";
+        }
+    }
+
+
+    SceneStatsVisitor::SceneStatsVisitor()
+    : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN)
+    {
+        reset();
+    }
+
+    void SceneStatsVisitor::dumpStats(std::ostream &out) const
+    {
+        size_t totalDrawables = 0;
+        for(size_t i = 0; i < static_cast<size_t>(RenderClass::Count); ++i)
+        {
+            totalDrawables += mStats[i].drawables;
+        }
+
+        out << "Scene stats:" << std::endl;
+        for(size_t i = 0; i < static_cast<size_t>(RenderClass::Count); ++i)
+        {
+            out << "  " << getRenderClassName(static_cast<RenderClass>(i)) << ": "
+                << mStats[i].drawables << " drawables, " << mStats[i].primitives << " primitives" << std::endl;
+        }
+        out << "  total drawables: " << totalDrawables << std::endl;
+    }
+
+    void SceneStatsVisitor::reset()
+    {
+        mClassStack.clear();
+        mClassStack.push_back(RenderClass::Opaque);
+
+        for(size_t i = 0; i < static_cast<size_t>(RenderClass::Count); ++i)
+        {
+            mStats[i].drawables = 0;
+            mStats[i].primitives = 0;
+        }
+    }
+
+    void SceneStatsVisitor::apply(osg::Node &node)
+    {
+        mClassStack.push_back(_classify(node.getStateSet(), mClassStack.back()));
+        traverse(node);
+        mClassStack.pop_back();
+    }
+
+    void SceneStatsVisitor::apply(osg::Geode &geode)
+    {
+        RenderClass geodeClass = _classify(geode.getStateSet(), mClassStack.back());
+
+        // don't traverse. on newer OSG versions that would visit the drawables as nodes, too
+        for(size_t i = 0; i < geode.getNumDrawables(); ++i)
+        {
+            osg::Drawable *drawable = geode.getDrawable(i);
+            RenderClass rc = _classify(drawable->getStateSet(), geodeClass);
+            ClassStats &stats = mStats[static_cast<size_t>(rc)];
+            ++stats.drawables;
+
+            osg::Geometry *geometry = drawable->asGeometry();
+            if(geometry != nullptr)
+            {
+                for(size_t p = 0; p < geometry->getNumPrimitiveSets(); ++p)
+                {
+                    stats.primitives += geometry->getPrimitiveSet(p)->getNumPrimitives();
+                }
+            }
+        }
+    }
+
+    SceneStatsVisitor::RenderClass SceneStatsVisitor::_classify(const osg::StateSet *ss, RenderClass inherited) const
+    {
+        if(ss == nullptr)
+        {
+            return inherited;
+        }
+
+        bool sorted = (inherited == RenderClass::Sorted);
+        if(ss->getRenderBinMode() != osg::StateSet::INHERIT_RENDERBIN_DETAILS)
+        {
+            sorted = (ss->getBinName() == "DepthSortedBin");
+        }
+
+        if(sorted)
+        {
+            return RenderClass::Sorted;
+
+        }else if(ss->getMode(GL_ALPHA_TEST) & osg::StateAttribute::ON)
+        {
+            return RenderClass::AlphaTested;
+        }
+
+        return (inherited == RenderClass::Sorted) ? RenderClass::Opaque : inherited;
+    }
+
+}
@@ -145,12 +145,7 @@ namespace od
 			ggIt->geometry->setTexCoordArray(0, uvCoords);
 
 			osg::ref_ptr<Texture> textureImage = db.getTextureByRef(ggIt->texture);
-			if(textureImage->hasAlpha())
-			{
-				osg::StateSet *ss = ggIt->geometry->getOrCreateStateSet();
-				ss->setMode(GL_BLEND, osg::StateAttribute::ON);
-				ss->setRenderBinDetails(1, "DepthSortedBin");
-			}
+			textureImage->applyAlphaState(ggIt->geometry->getOrCreateStateSet());
 
 			osg::ref_ptr<osg::Texture2D> texture(new osg::Texture2D(textureImage));
 			texture->setWrap(osg::Texture::WRAP_S, osg::Texture::REPEAT); // this is the default for all drakan textures
@@ -0,0 +1,291 @@
+/*
+ * SrscExtractor.cpp
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#include "SrscExtractor.h"
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <fstream>
+
+#include "Logger.h"
+#include "Exception.h"
+#include "DbManager.h"
+#include "db/Database.h"
+#include "db/AssetProvider.h"
+#include "db/TextureFactory.h"
+#include "db/SoundFactory.h"
+#include "db/ModelFactory.h"
+
+// small enough to balance load between workers, big enough to keep the shared counter out of the profile
+#define OD_EXTRACT_BATCH_SIZE 8
+
+namespace od
+{
+
+    /**
+     * @brief Per-worker asset factories for converting records.
+     *
+     * Factories are created on first use and read through the worker's own handle to the container. Classes referenced
+     * by textures (materials) live in another container, so they are loaded through a database owned by this worker, if
+     * the container belongs to one.
+     */
+    class ExtractorAssets : public AssetProvider
+    {
+    public:
+
+        ExtractorAssets(Engine &engine, const FilePath &srscPath)
+        : mEngine(engine)
+        , mFile(srscPath)
+        , mDbManager(engine)
+        , mDatabase(nullptr)
+        {
+        }
+
+        inline SrscFile &getFile() { return mFile; }
+
+        /**
+         * @brief Converts the given record if it is a texture, sound or model. Returns false if the record can't be converted.
+         */
+        bool convertRecord(const SrscFile::DirEntry &entry, const std::string &prefix, uint64_t &bytesWritten)
+        {
+            std::ostringstream ss;
+            ss << prefix;
+
+            try
+            {
+                switch(static_cast<SrscRecordType>(entry.type))
+                {
+                case SrscRecordType::TEXTURE:
+                    {
+                        ss << "texture" << std::hex << entry.recordId << std::dec << ".png";
+
+                        if(mTextureFactory == nullptr)
+                        {
+                            mTextureFactory.reset(new TextureFactory(*this, mFile, mEngine));
+                        }
+
+                        osg::ref_ptr<Texture> texture = mTextureFactory->getAsset(entry.recordId);
+                        texture->exportToPng(FilePath(ss.str()));
+                    }
+                    break;
+
+                case SrscRecordType::SOUND:
+                    {
+                        ss << "sound" << std::hex << entry.recordId << std::dec << ".wav";
+
+                        if(mSoundFactory == nullptr)
+                        {
+                            mSoundFactory.reset(new SoundFactory(*this, mFile));
+                        }
+
+                        osg::ref_ptr<Sound> sound = mSoundFactory->getAsset(entry.recordId);
+                        sound->exportToWav(FilePath(ss.str()));
+                    }
+                    break;
+
+                case SrscRecordType::MODEL_NAME:
+                    {
+                        ss << "model" << std::hex << entry.recordId << std::dec << ".obj";
+
+                        if(mModelFactory == nullptr)
+                        {
+                            mModelFactory.reset(new ModelFactory(*this, mFile, mEngine));
+                        }
+
+                        // building the geometry would need the textures, which are in another container. OBJ does not need it
+                        osg::ref_ptr<Model> model = mModelFactory->loadModelRecords(entry.recordId);
+                        if(model == nullptr)
+                        {
+                            return false;
+                        }
+                        model->exportToObj(FilePath(ss.str()));
+                    }
+                    break;
+
+                default:
+                    return false;
+                }
+
+            }catch(Exception &e)
+            {
+                Logger::warn() << "Can't convert record " << std::hex << entry.recordId << " of type " << entry.type << std::dec
+                        << ". Extracting it as is (" << e.what() << ")";
+                return false;
+            }
+
+            std::ifstream written(ss.str(), std::ios::in | std::ios::binary | std::ios::ate);
+            bytesWritten = written.good() ? static_cast<uint64_t>(written.tellg()) : 0;
+
+            return true;
+        }
+
+        // implement AssetProvider
+        virtual Class *findClassByRef(const AssetRef &ref) override
+        {
+            if(mDatabase == nullptr)
+            {
+                FilePath dbPath = mFile.getFilePath().ext(".db").adjustCase();
+                if(!dbPath.exists())
+                {
+                    throw UnsupportedException("Container is not part of a database. Can't load classes");
+                }
+
+                mDatabase = &mDbManager.loadDb(dbPath);
+            }
+
+            return mDatabase->findClassByRef(ref);
+        }
+
+
+    private:
+
+        Engine &mEngine;
+        SrscFile mFile;
+        DbManager mDbManager;
+        Database *mDatabase;
+        std::unique_ptr<TextureFactory> mTextureFactory;
+        std::unique_ptr<SoundFactory> mSoundFactory;
+        std::unique_ptr<ModelFactory> mModelFactory;
+    };
+
+
+    SrscExtractor::SrscExtractor(Engine &engine, const FilePath &srscPath, const std::string &prefix, bool extractRaw)
+    : mEngine(engine)
+    , mSrscPath(srscPath)
+    , mPrefix(prefix)
+    , mExtractRaw(extractRaw)
+    , mConvertAssets(false)
+    , mThreadCount(0)
+    {
+        setThreadCount(0);
+    }
+
+    void SrscExtractor::setThreadCount(size_t threadCount)
+    {
+        if(threadCount == 0)
+        {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        mThreadCount = threadCount;
+    }
+
+    SrscExtractor::Stats SrscExtractor::extract(const std::vector<SrscFile::DirEntry> &entries)
+    {
+        auto startTime = std::chrono::steady_clock::now();
+
+        // visit records in file order so each worker mostly reads forward
+        std::vector<SrscFile::DirEntry> sortedEntries(entries);
+        std::sort(sortedEntries.begin(), sortedEntries.end(),
+                [](const SrscFile::DirEntry &a, const SrscFile::DirEntry &b){ return a.dataOffset < b.dataOffset; });
+
+        size_t threadCount = std::max<size_t>(1, std::min(mThreadCount, (sortedEntries.size() + OD_EXTRACT_BATCH_SIZE - 1)/OD_EXTRACT_BATCH_SIZE));
+
+        std::atomic<size_t> nextIndex(0);
+        std::atomic<bool> failed(false);
+        std::atomic<uint64_t> bytesRead(0);
+        std::atomic<uint64_t> bytesWritten(0);
+        std::atomic<size_t> convertedCount(0);
+        std::exception_ptr firstError;
+        std::mutex errorMutex;
+
+        auto worker = [&]()
+        {
+            try
+            {
+                ExtractorAssets assets(mEngine, mSrscPath);
+                std::vector<char> data;
+                uint64_t localRead = 0;
+                uint64_t localWritten = 0;
+                size_t localConverted = 0;
+
+                while(!failed)
+                {
+                    size_t begin = nextIndex.fetch_add(OD_EXTRACT_BATCH_SIZE);
+                    if(begin >= sortedEntries.size())
+                    {
+                        break;
+                    }
+
+                    size_t end = std::min(begin + OD_EXTRACT_BATCH_SIZE, sortedEntries.size());
+                    for(size_t i = begin; i < end; ++i)
+                    {
+                        uint64_t convertedSize = 0;
+                        if(mConvertAssets && assets.convertRecord(sortedEntries[i], mPrefix, convertedSize))
+                        {
+                            localRead += sortedEntries[i].dataSize;
+                            localWritten += convertedSize;
+                            ++localConverted;
+                            continue;
+                        }
+
+                        assets.getFile().readRecordData(sortedEntries[i], data);
+                        localRead += data.size();
+                        localWritten += SrscFile::writeRecordData(mPrefix, sortedEntries[i], data, mExtractRaw);
+                    }
+                }
+
+                bytesRead += localRead;
+                bytesWritten += localWritten;
+                convertedCount += localConverted;
+
+            }catch(...)
+            {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if(!failed.exchange(true))
+                {
+                    firstError = std::current_exception();
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for(size_t i = 1; i < threadCount; ++i)
+        {
+            threads.emplace_back(worker);
+        }
+        worker(); // calling thread does it's share, too
+
+        for(std::thread &t : threads)
+        {
+            t.join();
+        }
+
+        if(firstError)
+        {
+            std::rethrow_exception(firstError);
+        }
+
+        Stats stats;
+        stats.recordCount = sortedEntries.size();
+        stats.convertedCount = convertedCount;
+        stats.threadCount = threadCount;
+        stats.bytesRead = bytesRead;
+        stats.bytesWritten = bytesWritten;
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        return stats;
+    }
+
+    void SrscExtractor::printStats(const Stats &stats, std::ostream &out)
+    {
+        double mbRead = stats.bytesRead/(1024.0*1024.0);
+        double mbWritten = stats.bytesWritten/(1024.0*1024.0);
+        double seconds = std::max(stats.seconds, 1e-9);
+
+        out << "Extracted " << stats.recordCount << " records with " << stats.threadCount << " threads in " << stats.seconds << "s" << std::endl
+            << "  converted: " << stats.convertedCount << " textures, sounds and models" << std::endl
+            << "  read:      " << mbRead << " MiB (" << mbRead/seconds << " MiB/s)" << std::endl
+            << "  written:   " << mbWritten << " MiB (" << mbWritten/seconds << " MiB/s)" << std::endl;
+    }
+
+}
@@ -11,6 +11,7 @@
 #include <iomanip>
 #include <sstream>
 #include <streambuf>
+#include <zlib.h>
 
 #include "DataStream.h"
 #include "Exception.h"
@@ -20,16 +21,41 @@ namespace od
 
 	SrscFile::SrscFile(const FilePath &filePath)
 	: mFilePath(filePath)
+	, mVersion(0)
+	, mDirectoryOffset(0)
 	{
-		mInputStream.open(mFilePath.str().c_str(), std::ios::in | std::ios::binary);
-		if(mInputStream.fail())
+		std::unique_ptr<std::ifstream> in(new std::ifstream(mFilePath.str().c_str(), std::ios::in | std::ios::binary));
+		if(in->fail())
 		{
 			throw IoException("Could not open SRSC file '" + mFilePath.str() + "'");
 		}
 
+		mInputStream = std::move(in);
+
 		_readHeaderAndDirectory();
 	}
 
+	SrscFile::SrscFile(const FilePath &filePath, std::unique_ptr<std::istream> stream, uint16_t version, const std::vector<DirEntry> *directory)
+	: mFilePath(filePath)
+	, mInputStream(std::move(stream))
+	, mVersion(version)
+	, mDirectoryOffset(0)
+	{
+		if(mInputStream == nullptr || mInputStream->fail())
+		{
+			throw IoException("Could not open SRSC file '" + mFilePath.str() + "' from stream");
+		}
+
+		if(directory != nullptr)
+		{
+			mDirectory = *directory;
+
+		}else
+		{
+			_readHeaderAndDirectory();
+		}
+	}
+
 	SrscFile::~SrscFile()
 	{
 	}
@@ -91,47 +117,145 @@ namespace od
 
 	std::istream &SrscFile::getStreamForRecord(const SrscFile::DirEntry &dirEntry)
 	{
-		mInputStream.seekg(dirEntry.dataOffset);
+		mInputStream->seekg(dirEntry.dataOffset);
 
-		return mInputStream;
+		return *mInputStream;
+	}
+
+	void SrscFile::readRecordData(const DirEntry &dirEntry, std::vector<char> &data)
+	{
+		data.resize(dirEntry.dataSize);
+
+		mInputStream->clear();
+		mInputStream->seekg(dirEntry.dataOffset);
+		mInputStream->read(data.data(), data.size());
+		if(static_cast<size_t>(mInputStream->gcount()) != data.size())
+		{
+			throw IoException("Unexpected end of file while reading record from '" + mFilePath.str() + "'");
+		}
 	}
 
 	void SrscFile::decompressAll(const std::string &prefix, bool extractRaw)
 	{
-		for(DirEntry entry : mDirectory)
+		std::vector<char> data;
+		for(const DirEntry &entry : mDirectory)
 		{
-			decompressRecord(prefix, entry, extractRaw);
+			readRecordData(entry, data);
+			writeRecordData(prefix, entry, data, extractRaw);
 		}
 	}
 
 	void SrscFile::decompressRecord(const std::string &prefix, const DirEntry &dirEntry, bool extractRaw)
 	{
-		if(extractRaw)
+		std::vector<char> data;
+		readRecordData(dirEntry, data);
+		writeRecordData(prefix, dirEntry, data, extractRaw);
+	}
+
+	/**
+	 * Tries to inflate a zlib stream starting at \c data. On success, appends the inflated data to \c out and stores
+	 * the length of the compressed stream in \c consumed. On failure, \c out is left unchanged.
+	 */
+	static bool _inflateStreamAt(const char *data, size_t size, std::vector<char> &out, size_t &consumed)
+	{
+		if(size < 6) // header + adler32
 		{
-			std::string filename;
-			std::ostringstream ss;
-			ss << prefix << "rawrecord" << dirEntry.index << "-" << std::hex << dirEntry.type << "-" << dirEntry.recordId << "-" << dirEntry.groupId << std::dec << ".dat";
+			return false;
+		}
 
-			std::ofstream out(ss.str(), std::ios::out | std::ios::binary);
+		// cheap zlib header check first so we don't have to init a zlib stream at every byte
+		uint8_t cmf = data[0];
+		uint8_t flg = data[1];
+		if((cmf & 0x0f) != Z_DEFLATED || (cmf >> 4) > 7 || (flg & 0x20) || ((cmf << 8) | flg) % 31 != 0)
+		{
+			return false;
+		}
 
-			mInputStream.seekg(dirEntry.dataOffset);
+		z_stream zs;
+		zs.zalloc = Z_NULL;
+		zs.zfree = Z_NULL;
+		zs.opaque = Z_NULL;
+		zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+		zs.avail_in = size;
+		if(inflateInit(&zs) != Z_OK)
+		{
+			return false;
+		}
 
-			for(size_t i = 0; i < dirEntry.dataSize; ++i)
-			{
-				out.put(mInputStream.get());
-			}
+		size_t originalSize = out.size();
+		int ret = Z_OK;
+		while(ret == Z_OK)
+		{
+			size_t writePos = out.size();
+			out.resize(writePos + 64*1024);
+			zs.next_out = reinterpret_cast<Bytef*>(out.data() + writePos);
+			zs.avail_out = out.size() - writePos;
 
-			out.close();
+			ret = inflate(&zs, Z_NO_FLUSH);
+			out.resize(out.size() - zs.avail_out);
+		}
 
-		}else
+		inflateEnd(&zs);
+
+		if(ret != Z_STREAM_END)
+		{
+			out.resize(originalSize);
+			return false;
+		}
+
+		consumed = size - zs.avail_in;
+		return true;
+	}
+
+	size_t SrscFile::writeRecordData(const std::string &prefix, const DirEntry &dirEntry, const std::vector<char> &data, bool extractRaw)
+	{
+		std::ostringstream ss;
+		ss << prefix << (extractRaw ? "rawrecord" : "record") << dirEntry.index << "-" << std::hex << dirEntry.type << "-" << dirEntry.recordId << "-" << dirEntry.groupId << std::dec << ".dat";
+
+		std::ofstream out(ss.str(), std::ios::out | std::ios::binary);
+		if(out.fail())
 		{
-		    throw UnsupportedException("Can't decompress right now");
+			throw IoException("Could not open output file '" + ss.str() + "'");
 		}
+
+		if(extractRaw)
+		{
+			out.write(data.data(), data.size());
+			return data.size();
+		}
+
+		// the record formats don't tell us generically where compressed data is, so we scan for valid zlib streams.
+		//  inflating only succeeds if the adler32 checksum matches, so false positives are practically impossible
+		std::vector<char> decompressed;
+		std::vector<char> inflated;
+		decompressed.reserve(data.size());
+		size_t runStart = 0;
+		size_t i = 0;
+		while(i < data.size())
+		{
+			size_t consumed;
+			inflated.clear();
+			if(_inflateStreamAt(data.data() + i, data.size() - i, inflated, consumed))
+			{
+				decompressed.insert(decompressed.end(), data.begin() + runStart, data.begin() + i);
+				decompressed.insert(decompressed.end(), inflated.begin(), inflated.end());
+				i += consumed;
+				runStart = i;
+
+			}else
+			{
+				++i;
+			}
+		}
+		decompressed.insert(decompressed.end(), data.begin() + runStart, data.end());
+
+		out.write(decompressed.data(), decompressed.size());
+		return decompressed.size();
 	}
 
 	void SrscFile::_readHeaderAndDirectory()
 	{
-		DataReader in(mInputStream);
+		DataReader in(*mInputStream);
 
 		uint32_t magic;
 		in >> magic;
@@ -153,7 +277,7 @@ namespace od
 
 		mDirectory.resize(recordCount);
 
-		mInputStream.seekg(mDirectoryOffset);
+		mInputStream->seekg(mDirectoryOffset);
 
 		for(size_t i = 0; i < recordCount; ++i)
 		{
@@ -0,0 +1,272 @@
+/*
+ * TimerWheel.cpp
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#include "TimerWheel.h"
+
+#include <cmath>
+
+#include "Exception.h"
+
+namespace od
+{
+
+    const TimerHandle TimerWheel::INVALID_HANDLE;
+    const size_t TimerWheel::LEVEL_BITS;
+    const size_t TimerWheel::SLOT_COUNT;
+    const size_t TimerWheel::SLOT_MASK;
+    const size_t TimerWheel::LEVEL_COUNT;
+    const int32_t TimerWheel::NO_NODE;
+
+    TimerWheel::TimerWheel(double tickLength)
+    : mTickLength(tickLength)
+    , mCurrentTick(0)
+    , mPendingCount(0)
+    {
+        if(mTickLength <= 0.0)
+        {
+            throw InvalidArgumentException("Timer wheel tick length must be positive");
+        }
+
+        for(size_t level = 0; level < LEVEL_COUNT; ++level)
+        {
+            for(size_t slot = 0; slot < SLOT_COUNT; ++slot)
+            {
+                mSlots[level][slot] = NO_NODE;
+            }
+        }
+    }
+
+    TimerHandle TimerWheel::schedule(double simTime, const Callback &callback)
+    {
+        uint32_t index = _allocNode();
+        Node &node = mNodes[index];
+
+        // round up so we never fire early
+        double tick = std::ceil(simTime/mTickLength);
+        node.expiryTick = (tick > 0.0) ? static_cast<uint64_t>(tick) : 0;
+        node.callback = callback;
+        node.active = true;
+
+        _link(index);
+        ++mPendingCount;
+
+        return _makeHandle(index);
+    }
+
+    TimerHandle TimerWheel::scheduleIn(double delay, const Callback &callback)
+    {
+        return schedule(getCurrentTime() + delay, callback);
+    }
+
+    bool TimerWheel::cancel(TimerHandle handle)
+    {
+        if(!isPending(handle))
+        {
+            return false;
+        }
+
+        uint32_t index = static_cast<uint32_t>(handle & 0xffffffff);
+        _unlink(index);
+        _freeNode(index);
+
+        return true;
+    }
+
+    bool TimerWheel::isPending(TimerHandle handle) const
+    {
+        uint32_t index = static_cast<uint32_t>(handle & 0xffffffff);
+        uint32_t generation = static_cast<uint32_t>(handle >> 32);
+
+        return index < mNodes.size() && mNodes[index].active && mNodes[index].generation == generation;
+    }
+
+    void TimerWheel::advance(double simTime)
+    {
+        uint64_t targetTick = static_cast<uint64_t>(std::max(0.0, std::floor(simTime/mTickLength)));
+
+        while(mCurrentTick < targetTick)
+        {
+            if(mPendingCount == 0)
+            {
+                // nothing to cascade or fire. skip right to the target
+                mCurrentTick = targetTick;
+                break;
+            }
+
+            ++mCurrentTick;
+
+            // cascade higher levels whose slot boundary we just crossed, highest first so cascaded timers can trickle
+            //  all the way down in one tick
+            size_t highestLevel = 0;
+            while(highestLevel + 1 < LEVEL_COUNT && (mCurrentTick & ((1ull << (LEVEL_BITS*(highestLevel+1))) - 1)) == 0)
+            {
+                ++highestLevel;
+            }
+
+            for(size_t level = highestLevel; level > 0; --level)
+            {
+                _cascade(level, (mCurrentTick >> (LEVEL_BITS*level)) & SLOT_MASK);
+            }
+
+            // take all nodes out of the current slot before firing, as callbacks may modify the wheel
+            int32_t &head = mSlots[0][mCurrentTick & SLOT_MASK];
+            mExpiring.clear();
+            while(head != NO_NODE)
+            {
+                uint32_t index = head;
+                _unlink(index);
+
+                if(mNodes[index].expiryTick <= mCurrentTick)
+                {
+                    mExpiring.push_back(_makeHandle(index));
+
+                }else
+                {
+                    // only happens for timers that were too far in the future to fit into the wheel
+                    _link(index);
+                }
+            }
+
+            for(size_t i = 0; i < mExpiring.size(); ++i)
+            {
+                if(!isPending(mExpiring[i]))
+                {
+                    continue; // cancelled by an earlier callback. the node might already hold a new timer
+                }
+
+                uint32_t index = static_cast<uint32_t>(mExpiring[i] & 0xffffffff);
+
+                Callback callback;
+                std::swap(callback, mNodes[index].callback);
+                _freeNode(index);
+
+                callback();
+            }
+        }
+    }
+
+    void TimerWheel::update(double simTime, double relTime)
+    {
+        advance(simTime);
+    }
+
+    uint32_t TimerWheel::_allocNode()
+    {
+        if(!mFreeNodes.empty())
+        {
+            uint32_t index = mFreeNodes.back();
+            mFreeNodes.pop_back();
+            return index;
+        }
+
+        Node node;
+        node.expiryTick = 0;
+        node.generation = 1; // so no handle will ever be equal to INVALID_HANDLE
+        node.prev = NO_NODE;
+        node.next = NO_NODE;
+        node.level = -1;
+        node.slot = 0;
+        node.active = false;
+        mNodes.push_back(node);
+
+        return mNodes.size() - 1;
+    }
+
+    void TimerWheel::_freeNode(uint32_t index)
+    {
+        Node &node = mNodes[index];
+        node.active = false;
+        node.callback = nullptr;
+        ++node.generation;
+        if(node.generation == 0)
+        {
+            node.generation = 1;
+        }
+
+        mFreeNodes.push_back(index);
+        --mPendingCount;
+    }
+
+    TimerHandle TimerWheel::_makeHandle(uint32_t index) const
+    {
+        return (static_cast<TimerHandle>(mNodes[index].generation) << 32) | index;
+    }
+
+    void TimerWheel::_link(uint32_t index)
+    {
+        Node &node = mNodes[index];
+
+        // anything due now or in the past fires on the next tick
+        uint64_t expiry = std::max(node.expiryTick, mCurrentTick + 1);
+        uint64_t delta = expiry - mCurrentTick;
+
+        size_t level = 0;
+        while(level + 1 < LEVEL_COUNT && delta >= (1ull << (LEVEL_BITS*(level+1))))
+        {
+            ++level;
+        }
+
+        // timers beyond the range of the wheel are parked in the farthest slot of the top level and rescheduled from there
+        uint64_t maxDelta = (1ull << (LEVEL_BITS*LEVEL_COUNT)) - 1;
+        if(delta > maxDelta)
+        {
+            expiry = mCurrentTick + maxDelta;
+        }
+
+        node.level = level;
+        node.slot = (expiry >> (LEVEL_BITS*level)) & SLOT_MASK;
+        node.prev = NO_NODE;
+        node.next = mSlots[level][node.slot];
+        if(node.next != NO_NODE)
+        {
+            mNodes[node.next].prev = index;
+        }
+        mSlots[level][node.slot] = index;
+    }
+
+    void TimerWheel::_unlink(uint32_t index)
+    {
+        Node &node = mNodes[index];
+        if(node.level < 0)
+        {
+            return;
+        }
+
+        if(node.prev != NO_NODE)
+        {
+            mNodes[node.prev].next = node.next;
+
+        }else
+        {
+            mSlots[node.level][node.slot] = node.next;
+        }
+
+        if(node.next != NO_NODE)
+        {
+            mNodes[node.next].prev = node.prev;
+        }
+
+        node.prev = NO_NODE;
+        node.next = NO_NODE;
+        node.level = -1;
+    }
+
+    void TimerWheel::_cascade(size_t level, size_t slot)
+    {
+        int32_t index = mSlots[level][slot];
+        mSlots[level][slot] = NO_NODE;
+
+        while(index != NO_NODE)
+        {
+            int32_t next = mNodes[index].next;
+            mNodes[index].level = -1;
+            _link(index);
+            index = next;
+        }
+    }
+
+}
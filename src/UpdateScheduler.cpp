@@ -0,0 +1,209 @@
+/*
+ * UpdateScheduler.cpp
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#include "UpdateScheduler.h"
+
+#include <algorithm>
+
+#include "Logger.h"
+
+namespace od
+{
+
+    UpdateScheduler::UpdateScheduler()
+    : mLowFrequencyInterval(0.1)
+    , mFrameCount(0)
+    {
+        for(size_t i = 0; i < static_cast<size_t>(UpdatePhase::Count); ++i)
+        {
+            mPhases[i].needsCompaction = false;
+        }
+
+        resetStats();
+    }
+
+    void UpdateScheduler::add(Updatable *u, UpdatePhase phase, UpdateTier tier)
+    {
+        if(u == nullptr || phase == UpdatePhase::Count)
+        {
+            return;
+        }
+
+        if(isRegistered(u))
+        {
+            Logger::warn() << "Tried to register Updatable with update scheduler twice. Ignoring";
+            return;
+        }
+
+        Slot slot;
+        slot.updatable = u;
+        slot.tier = tier;
+        slot.lastUpdateTime = 0;
+        slot.firstUpdate = true;
+
+        size_t phaseIndex = static_cast<size_t>(phase);
+        Phase &p = mPhases[phaseIndex];
+        mSlotLocations[u] = SlotLocation{phaseIndex, p.slots.size()};
+        p.slots.push_back(slot);
+        ++p.stats.registered;
+    }
+
+    void UpdateScheduler::remove(Updatable *u)
+    {
+        auto it = mSlotLocations.find(u);
+        if(it == mSlotLocations.end())
+        {
+            return;
+        }
+
+        // only mark as removed. we might be in the middle of iterating over this phase
+        Phase &p = mPhases[it->second.phase];
+        p.slots[it->second.index].updatable = nullptr;
+        p.needsCompaction = true;
+        --p.stats.registered;
+
+        mSlotLocations.erase(it);
+    }
+
+    bool UpdateScheduler::isRegistered(Updatable *u) const
+    {
+        return const_cast<UpdateScheduler*>(this)->_findSlot(u) != nullptr;
+    }
+
+    void UpdateScheduler::setTier(Updatable *u, UpdateTier tier)
+    {
+        Slot *slot = _findSlot(u);
+        if(slot != nullptr)
+        {
+            slot->tier = tier;
+        }
+    }
+
+    void UpdateScheduler::update(double simTime)
+    {
+        osg::Timer *timer = osg::Timer::instance();
+
+        for(size_t i = 0; i < static_cast<size_t>(UpdatePhase::Count); ++i)
+        {
+            Phase &p = mPhases[i];
+            osg::Timer_t startTick = timer->tick();
+            size_t updated = 0;
+
+            // updatables added during this phase are appended, so fix the count before we start
+            size_t slotCount = p.slots.size();
+            for(size_t s = 0; s < slotCount; ++s)
+            {
+                // don't hold a reference here. the vector might get reallocated if update() adds to this phase
+                Slot slot = p.slots[s];
+                if(slot.updatable == nullptr || slot.tier == UpdateTier::Sleeping)
+                {
+                    continue;
+                }
+
+                if(slot.firstUpdate)
+                {
+                    // so we avoid massive jumps at first update
+                    slot.lastUpdateTime = simTime;
+                    p.slots[s].firstUpdate = false;
+
+                }else if(slot.tier == UpdateTier::LowFrequency && simTime - slot.lastUpdateTime < mLowFrequencyInterval)
+                {
+                    continue;
+                }
+
+                p.slots[s].lastUpdateTime = simTime;
+                slot.updatable->update(simTime, simTime - slot.lastUpdateTime);
+                ++updated;
+            }
+
+            if(p.needsCompaction)
+            {
+                _compact(i);
+            }
+
+            double phaseTime = timer->delta_m(startTick, timer->tick());
+            p.stats.updatedLastFrame = updated;
+            p.stats.lastFrameTime = phaseTime;
+            p.stats.totalTime += phaseTime;
+        }
+
+        ++mFrameCount;
+    }
+
+    void UpdateScheduler::resetStats()
+    {
+        for(size_t i = 0; i < static_cast<size_t>(UpdatePhase::Count); ++i)
+        {
+            PhaseStats &stats = mPhases[i].stats;
+            stats.registered = std::count_if(mPhases[i].slots.begin(), mPhases[i].slots.end(), [](const Slot &s){ return s.updatable != nullptr; });
+            stats.updatedLastFrame = 0;
+            stats.lastFrameTime = 0;
+            stats.totalTime = 0;
+        }
+
+        mFrameCount = 0;
+    }
+
+    void UpdateScheduler::dumpStats(std::ostream &out) const
+    {
+        out << "Update scheduler stats over " << mFrameCount << " frames:" << std::endl;
+
+        for(size_t i = 0; i < static_cast<size_t>(UpdatePhase::Count); ++i)
+        {
+            const PhaseStats &stats = mPhases[i].stats;
+            double avgTime = (mFrameCount > 0) ? stats.totalTime/mFrameCount : 0.0;
+
+            out << "  " << getPhaseName(static_cast<UpdatePhase>(i)) << ": "
+                << stats.registered << " registered, "
+                << stats.updatedLastFrame << " updated last frame, "
+                << stats.lastFrameTime << "ms last frame, "
+                << avgTime << "ms avg." << std::endl;
+        }
+    }
+
+    const char *UpdateScheduler::getPhaseName(UpdatePhase phase)
+    {
+        switch(phase)
+        {
+        case UpdatePhase::Input:     return "Input";
+        case UpdatePhase::Timers:    return "Timers";
+        case UpdatePhase::Rfl:       return "RFL";
+        case UpdatePhase::Messaging: return "Messaging";
+        case UpdatePhase::Animation: return "Animation";
+        case UpdatePhase::Physics:   return "Physics";
+        case UpdatePhase::Lighting:  return "Lighting";
+        case UpdatePhase::Camera:    return "Camera";
+        default:                     return "<invalid>";
+        }
+    }
+
+    UpdateScheduler::Slot *UpdateScheduler::_findSlot(Updatable *u)
+    {
+        auto it = mSlotLocations.find(u);
+        if(it == mSlotLocations.end())
+        {
+            return nullptr;
+        }
+
+        return &mPhases[it->second.phase].slots[it->second.index];
+    }
+
+    void UpdateScheduler::_compact(size_t phaseIndex)
+    {
+        Phase &phase = mPhases[phaseIndex];
+
+        auto pred = [](const Slot &s){ return s.updatable == nullptr; };
+        phase.slots.erase(std::remove_if(phase.slots.begin(), phase.slots.end(), pred), phase.slots.end());
+        phase.needsCompaction = false;
+
+        for(size_t i = 0; i < phase.slots.size(); ++i)
+        {
+            mSlotLocations[phase.slots[i].updatable].index = i;
+        }
+    }
+
+}
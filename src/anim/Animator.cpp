@@ -17,35 +17,9 @@
 namespace od
 {
 
-	class AnimatorUpdateCallback : public osg::NodeCallback
-	{
-	public:
-
-		AnimatorUpdateCallback(Animator &animator)
-		: mAnimator(animator)
-		{
-		}
-
-		virtual void operator()(osg::Node *node, osg::NodeVisitor *nv)
-		{
-			if(nv->getFrameStamp() != nullptr)
-			{
-				mAnimator.update(nv->getFrameStamp()->getSimulationTime());
-			}
-
-			traverse(node, nv);
-		}
-
-	private:
-
-		Animator &mAnimator;
-	};
-
-
-
-	Animator::Animator(osg::MatrixTransform *node)
-	: mNode(node)
-	, mUpdateCallback(new AnimatorUpdateCallback(*this))
+	Animator::Animator(UpdateScheduler &scheduler, osg::MatrixTransform *node)
+	: mScheduler(scheduler)
+	, mNode(node)
 	, mOriginalXform(mNode->getMatrix())
 	, mKeyframeCount(0)
 	, mPlaying(false)
@@ -60,12 +34,12 @@ namespace od
 	, mAccumulator(nullptr)
 	, mAccumulationFactors(1,1,1)
 	{
-		mNode->addUpdateCallback(mUpdateCallback);
+		mScheduler.add(this, UpdatePhase::Animation, UpdateTier::Sleeping);
 	}
 
 	Animator::~Animator()
 	{
-		mNode->removeUpdateCallback(mUpdateCallback);
+		mScheduler.remove(this);
 	}
 
 	void Animator::setKeyframes(KfIterator begin, KfIterator end, double startDelay)
@@ -107,7 +81,7 @@ namespace od
 
 	void Animator::play(bool looping)
 	{
-	    mPlaying = true;
+	    _setPlaying(true);
 	    mLooping = looping;
 
 	    mJustStarted = true;
@@ -115,10 +89,10 @@ namespace od
 
     void Animator::stop()
     {
-        mPlaying = false;
+        _setPlaying(false);
     }
 
-	void Animator::update(double simTime)
+	void Animator::update(double simTime, double relTime)
 	{
 	    if(!mPlaying || mKeyframeCount == 0)
 		{
@@ -138,7 +112,7 @@ namespace od
 		    {
 		        // FIXME: this ignores accumulating nodes when they only have one kf
 		        mNode->setMatrix(mCurrentFrame->xform * mOriginalXform);
-		        mPlaying = false;
+		        _setPlaying(false);
 		        return;
 		    }
 
@@ -170,7 +144,7 @@ namespace od
 
                 }else
                 {
-                    mPlaying = false;
+                    _setPlaying(false);
                 }
             }
 
@@ -218,4 +192,18 @@ namespace od
 		mLastInterpolatedRotation    = iRot;
 		mLastInterpolatedScale       = iScale;
 	}
+
+	void Animator::_setPlaying(bool b)
+	{
+		if(b == mPlaying)
+		{
+			return;
+		}
+
+		mPlaying = b;
+
+		// no need to wake up every frame if there is nothing to animate
+		mScheduler.setTier(this, mPlaying ? UpdateTier::EveryFrame : UpdateTier::Sleeping);
+	}
+
 }
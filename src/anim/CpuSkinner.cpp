@@ -0,0 +1,479 @@
+/*
+ * CpuSkinner.cpp
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#include "anim/CpuSkinner.h"
+
+#include <map>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <osg/Timer>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/LOD>
+#include <osg/NodeVisitor>
+
+#include "Exception.h"
+#include "OdDefines.h"
+#include "GeodeBuilder.h"
+
+// every x86-64 compiler provides SSE2. on other targets the scalar path is used
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define OD_SKIN_SSE
+#   include <xmmintrin.h>
+#endif
+
+// a few characters worth of vertices. keeps threads busy with uneven instance sizes without contending on the atomic
+#define OD_SKIN_CHUNK_SIZE 2048
+
+namespace od
+{
+
+    class CollectSkinnedGeometryVisitor : public osg::NodeVisitor
+    {
+    public:
+
+        CollectSkinnedGeometryVisitor()
+        : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+        {
+        }
+
+        virtual void apply(osg::LOD &node)
+        {
+            // only the full detail level is of interest
+            if(node.getNumChildren() > 0)
+            {
+                node.getChild(0)->accept(*this);
+            }
+        }
+
+        virtual void apply(osg::Geode &node)
+        {
+            for(size_t i = 0; i < node.getNumDrawables(); ++i)
+            {
+                osg::Geometry *geometry = node.getDrawable(i)->asGeometry();
+                if(geometry != nullptr && dynamic_cast<BonePalette*>(geometry->getUserData()) != nullptr)
+                {
+                    geometries.push_back(geometry);
+                }
+            }
+        }
+
+        std::vector<osg::Geometry*> geometries;
+    };
+
+
+    static osg::Vec4f _getElement(const osg::Array *array, size_t index)
+    {
+        // GeodeBuilder creates float arrays or, with the compact format, byte arrays. read them like the GL would
+        switch(array->getType())
+        {
+        case osg::Array::Vec3ArrayType:
+            {
+                const osg::Vec3f &v = static_cast<const osg::Vec3Array*>(array)->at(index);
+                return osg::Vec4f(v, 0);
+            }
+
+        case osg::Array::Vec4ArrayType:
+            return static_cast<const osg::Vec4Array*>(array)->at(index);
+
+        case osg::Array::Vec3bArrayType:
+            {
+                // only used for normals, which are always normalized
+                const osg::Vec3b &v = static_cast<const osg::Vec3bArray*>(array)->at(index);
+                return osg::Vec4f(v.x()/127.0f, v.y()/127.0f, v.z()/127.0f, 0);
+            }
+
+        case osg::Array::Vec4ubArrayType:
+            {
+                const osg::Vec4ub &v = static_cast<const osg::Vec4ubArray*>(array)->at(index);
+                float scale = array->getNormalize() ? 1/255.0f : 1.0f;
+                return osg::Vec4f(v.r()*scale, v.g()*scale, v.b()*scale, v.a()*scale);
+            }
+
+        default:
+            throw UnsupportedException("Unsupported vertex attribute array type for CPU skinning");
+        }
+    }
+
+
+
+    CpuSkinner::Mesh::Mesh(osg::Node *model)
+    : mJointCount(0)
+    {
+        CollectSkinnedGeometryVisitor csgv;
+        model->accept(csgv);
+
+        // geometries of one geode share their arrays. make sure shared vertices are only skinned once
+        std::map<std::pair<const osg::Array*, uint32_t>, uint32_t> vertexMap;
+        for(auto it = csgv.geometries.begin(); it != csgv.geometries.end(); ++it)
+        {
+            osg::Geometry *geometry = *it;
+            BonePalette *palette = static_cast<BonePalette*>(geometry->getUserData());
+            const osg::Array *vertices = geometry->getVertexArray();
+            const osg::Array *normals = geometry->getNormalArray();
+            const osg::Array *boneIndices = geometry->getVertexAttribArray(OD_ATTRIB_INFLUENCE_LOCATION);
+            const osg::Array *boneWeights = geometry->getVertexAttribArray(OD_ATTRIB_WEIGHT_LOCATION);
+            if(vertices == nullptr || normals == nullptr || boneIndices == nullptr || boneWeights == nullptr)
+            {
+                continue;
+            }
+
+            for(size_t p = 0; p < geometry->getNumPrimitiveSets(); ++p)
+            {
+                const osg::PrimitiveSet *primitives = geometry->getPrimitiveSet(p);
+                if(primitives->getMode() != osg::PrimitiveSet::TRIANGLES)
+                {
+                    continue;
+                }
+
+                for(size_t i = 0; i < primitives->getNumIndices(); ++i)
+                {
+                    uint32_t index = primitives->index(i);
+                    auto key = std::make_pair(vertices, index);
+                    auto mapped = vertexMap.find(key);
+                    if(mapped != vertexMap.end())
+                    {
+                        mIndices.push_back(mapped->second);
+                        continue;
+                    }
+
+                    osg::Vec4f position = _getElement(vertices, index);
+                    position.w() = 1;
+                    mPositions.push_back(position);
+                    mNormals.push_back(_getElement(normals, index));
+
+                    // store the influences with non-zero weight first so the skinning loop can stop early
+                    osg::Vec4f localJoints = _getElement(boneIndices, index);
+                    osg::Vec4f weights = _getElement(boneWeights, index);
+                    uint8_t influenceCount = 0;
+                    for(size_t b = 0; b < 4; ++b)
+                    {
+                        if(weights[b] <= 0)
+                        {
+                            continue;
+                        }
+
+                        size_t localJoint = std::round(localJoints[b]);
+                        if(localJoint >= palette->jointIndices.size())
+                        {
+                            throw Exception("Bone index of skinned vertex exceeds palette");
+                        }
+
+                        int32_t joint = palette->jointIndices[localJoint];
+                        mJoints.push_back(joint);
+                        mWeights.push_back(weights[b]);
+                        mJointCount = std::max(mJointCount, static_cast<size_t>(joint) + 1);
+                        ++influenceCount;
+                    }
+                    for(size_t b = influenceCount; b < 4; ++b)
+                    {
+                        mJoints.push_back(0);
+                        mWeights.push_back(0);
+                    }
+                    mInfluenceCounts.push_back(influenceCount);
+
+                    uint32_t newIndex = mPositions.size() - 1;
+                    vertexMap[key] = newIndex;
+                    mIndices.push_back(newIndex);
+                }
+            }
+        }
+    }
+
+
+
+    CpuSkinner::Instance::Instance(Mesh *mesh)
+    : mMesh(mesh)
+    , mBoneMatrices(mesh->getJointCount(), osg::Matrixf::identity())
+    {
+    }
+
+    void CpuSkinner::Instance::setBoneMatrices(const std::vector<osg::Matrixf> &matrices)
+    {
+        mBoneMatrices.assign(matrices.begin(), matrices.end());
+        if(mBoneMatrices.size() < mMesh->getJointCount())
+        {
+            mBoneMatrices.resize(mMesh->getJointCount(), osg::Matrixf::identity());
+        }
+    }
+
+    bool CpuSkinner::Instance::raycast(const osg::Vec3f &start, const osg::Vec3f &end, float &fraction, osg::Vec3f &normal) const
+    {
+        if(!mBoundingBox.valid() || mPositions.size() != mMesh->getVertexCount())
+        {
+            return false;
+        }
+
+        // most rays miss the character entirely. reject those with the bounding box before testing triangles
+        osg::Vec3f direction = end - start;
+        float tMin = 0;
+        float tMax = 1;
+        for(size_t axis = 0; axis < 3; ++axis)
+        {
+            if(std::abs(direction[axis]) < 1e-12f)
+            {
+                if(start[axis] < mBoundingBox._min[axis] || start[axis] > mBoundingBox._max[axis])
+                {
+                    return false;
+                }
+
+                continue;
+            }
+
+            float t1 = (mBoundingBox._min[axis] - start[axis])/direction[axis];
+            float t2 = (mBoundingBox._max[axis] - start[axis])/direction[axis];
+            tMin = std::max(tMin, std::min(t1, t2));
+            tMax = std::min(tMax, std::max(t1, t2));
+            if(tMin > tMax)
+            {
+                return false;
+            }
+        }
+
+        bool hit = false;
+        float closest = 1;
+        const std::vector<uint32_t> &indices = mMesh->getIndices();
+        for(size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            osg::Vec3f a = getPosition(indices[i]);
+            osg::Vec3f e1 = getPosition(indices[i+1]) - a;
+            osg::Vec3f e2 = getPosition(indices[i+2]) - a;
+
+            osg::Vec3f p = direction ^ e2;
+            float det = e1*p;
+            if(std::abs(det) < 1e-12f)
+            {
+                continue;
+            }
+            float invDet = 1/det;
+
+            osg::Vec3f s = start - a;
+            float u = (s*p)*invDet;
+            if(u < 0 || u > 1)
+            {
+                continue;
+            }
+
+            osg::Vec3f q = s ^ e1;
+            float v = (direction*q)*invDet;
+            if(v < 0 || u + v > 1)
+            {
+                continue;
+            }
+
+            float t = (e2*q)*invDet;
+            if(t < 0 || t > closest)
+            {
+                continue;
+            }
+
+            // same orientation as the normals GeodeBuilder generates for the CW model faces
+            closest = t;
+            normal = e2 ^ e1;
+            hit = true;
+        }
+
+        if(hit)
+        {
+            fraction = closest;
+            normal.normalize();
+        }
+
+        return hit;
+    }
+
+
+
+    CpuSkinner::CpuSkinner()
+    : mThreadCount(1)
+    {
+        resetStats();
+    }
+
+    void CpuSkinner::setThreadCount(size_t threadCount)
+    {
+        if(threadCount == 0)
+        {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        mThreadCount = threadCount;
+    }
+
+    void CpuSkinner::addInstance(Instance *instance)
+    {
+        mInstances.push_back(instance);
+    }
+
+    void CpuSkinner::removeInstance(Instance *instance)
+    {
+        auto it = std::find(mInstances.begin(), mInstances.end(), instance);
+        if(it != mInstances.end())
+        {
+            mInstances.erase(it);
+        }
+    }
+
+    void CpuSkinner::skin()
+    {
+        osg::Timer_t startTime = osg::Timer::instance()->tick();
+
+        mChunks.clear();
+        size_t vertexCount = 0;
+        for(auto it = mInstances.begin(); it != mInstances.end(); ++it)
+        {
+            Instance *instance = *it;
+            size_t instanceVertices = instance->mMesh->getVertexCount();
+            instance->mPositions.resize(instanceVertices);
+            instance->mNormals.resize(instanceVertices);
+            instance->mBoundingBox.init();
+
+            for(size_t begin = 0; begin < instanceVertices; begin += OD_SKIN_CHUNK_SIZE)
+            {
+                Chunk chunk;
+                chunk.instance = instance;
+                chunk.begin = begin;
+                chunk.end = std::min(begin + OD_SKIN_CHUNK_SIZE, instanceVertices);
+                mChunks.push_back(chunk);
+            }
+
+            vertexCount += instanceVertices;
+        }
+
+        size_t threadCount = std::max<size_t>(1, std::min(mThreadCount, mChunks.size()));
+
+        std::atomic<size_t> nextChunk(0);
+        auto worker = [&]()
+        {
+            size_t chunk;
+            while((chunk = nextChunk.fetch_add(1)) < mChunks.size())
+            {
+                _skinRange(mChunks[chunk]);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for(size_t i = 1; i < threadCount; ++i)
+        {
+            threads.emplace_back(worker);
+        }
+        worker();
+
+        for(std::thread &t : threads)
+        {
+            t.join();
+        }
+
+        for(auto it = mChunks.begin(); it != mChunks.end(); ++it)
+        {
+            it->instance->mBoundingBox.expandBy(it->box);
+        }
+
+        mStats.vertexCount += vertexCount;
+        mStats.seconds += osg::Timer::instance()->delta_s(startTime, osg::Timer::instance()->tick());
+    }
+
+    void CpuSkinner::resetStats()
+    {
+        mStats.vertexCount = 0;
+        mStats.seconds = 0;
+    }
+
+    void CpuSkinner::_skinRange(Chunk &chunk)
+    {
+        const Mesh &mesh = *chunk.instance->mMesh;
+        const float *matrices = chunk.instance->mBoneMatrices.empty() ? nullptr : chunk.instance->mBoneMatrices.front().ptr();
+        osg::Vec4f *positions = chunk.instance->mPositions.data();
+        osg::Vec4f *normals = chunk.instance->mNormals.data();
+
+#ifdef OD_SKIN_SSE
+        __m128 boxMin = _mm_set1_ps(std::numeric_limits<float>::max());
+        __m128 boxMax = _mm_set1_ps(-std::numeric_limits<float>::max());
+
+        for(size_t v = chunk.begin; v < chunk.end; ++v)
+        {
+            // blend the rows of the bone matrices. OSG matrices transform row vectors, so rows 0-2 are the images of the
+            //  axes and row 3 is the translation
+            const int32_t *joints = &mesh.mJoints[4*v];
+            const float *weights = &mesh.mWeights[4*v];
+            __m128 row0 = _mm_setzero_ps();
+            __m128 row1 = _mm_setzero_ps();
+            __m128 row2 = _mm_setzero_ps();
+            __m128 row3 = _mm_setzero_ps();
+            for(size_t i = 0; i < mesh.mInfluenceCounts[v]; ++i)
+            {
+                const float *m = matrices + 16*joints[i];
+                __m128 w = _mm_set1_ps(weights[i]);
+                row0 = _mm_add_ps(row0, _mm_mul_ps(w, _mm_loadu_ps(m)));
+                row1 = _mm_add_ps(row1, _mm_mul_ps(w, _mm_loadu_ps(m + 4)));
+                row2 = _mm_add_ps(row2, _mm_mul_ps(w, _mm_loadu_ps(m + 8)));
+                row3 = _mm_add_ps(row3, _mm_mul_ps(w, _mm_loadu_ps(m + 12)));
+            }
+
+            const osg::Vec4f &p = mesh.mPositions[v];
+            __m128 position = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row0, _mm_set1_ps(p.x())), _mm_mul_ps(row1, _mm_set1_ps(p.y()))),
+                                         _mm_add_ps(_mm_mul_ps(row2, _mm_set1_ps(p.z())), row3));
+
+            const osg::Vec4f &n = mesh.mNormals[v];
+            __m128 normal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row0, _mm_set1_ps(n.x())), _mm_mul_ps(row1, _mm_set1_ps(n.y()))),
+                                       _mm_mul_ps(row2, _mm_set1_ps(n.z())));
+
+            // normalize. the approximate reciprocal square root is plenty for hit normals
+            __m128 sq = _mm_mul_ps(normal, normal);
+            __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_shuffle_ps(sq, sq, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 1, 1, 1))),
+                                         _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 2, 2, 2)));
+            normal = _mm_mul_ps(normal, _mm_rsqrt_ps(_mm_max_ps(lengthSq, _mm_set1_ps(1e-12f))));
+
+            _mm_storeu_ps(positions[v].ptr(), position);
+            _mm_storeu_ps(normals[v].ptr(), normal);
+
+            boxMin = _mm_min_ps(boxMin, position);
+            boxMax = _mm_max_ps(boxMax, position);
+        }
+
+        if(chunk.end > chunk.begin)
+        {
+            float minValues[4];
+            float maxValues[4];
+            _mm_storeu_ps(minValues, boxMin);
+            _mm_storeu_ps(maxValues, boxMax);
+            chunk.box.set(minValues[0], minValues[1], minValues[2], maxValues[0], maxValues[1], maxValues[2]);
+        }
+
+#else
+        for(size_t v = chunk.begin; v < chunk.end; ++v)
+        {
+            const int32_t *joints = &mesh.mJoints[4*v];
+            const float *weights = &mesh.mWeights[4*v];
+            float blended[16] = { 0 };
+            for(size_t i = 0; i < mesh.mInfluenceCounts[v]; ++i)
+            {
+                const float *m = matrices + 16*joints[i];
+                for(size_t k = 0; k < 16; ++k)
+                {
+                    blended[k] += weights[i]*m[k];
+                }
+            }
+            osg::Matrixf xform(blended);
+
+            const osg::Vec4f &p = mesh.mPositions[v];
+            const osg::Vec4f &n = mesh.mNormals[v];
+            osg::Vec3f position = osg::Vec3f(p.x(), p.y(), p.z())*xform;
+            osg::Vec3f normal = osg::Matrixf::transform3x3(osg::Vec3f(n.x(), n.y(), n.z()), xform);
+            normal.normalize();
+
+            positions[v].set(position.x(), position.y(), position.z(), 1);
+            normals[v].set(normal.x(), normal.y(), normal.z(), 0);
+            chunk.box.expandBy(position);
+        }
+#endif
+    }
+
+}
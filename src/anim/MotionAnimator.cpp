@@ -10,61 +10,25 @@
 namespace od
 {
 
-	class MotionAnimatorUpdateCallback : public osg::NodeCallback
+	MotionAnimator::MotionAnimator(UpdateScheduler &scheduler, osg::PositionAttitudeTransform *node)
+	: mScheduler(scheduler)
+	, mNode(node)
 	{
-	public:
-
-		MotionAnimatorUpdateCallback(MotionAnimator &animator)
-		: mAnimator(animator)
-		{
-		}
-
-		virtual void operator()(osg::Node *node, osg::NodeVisitor *nv)
-		{
-			if(nv->getFrameStamp() != nullptr)
-			{
-				mAnimator.update(nv->getFrameStamp()->getSimulationTime());
-			}
-
-			traverse(node, nv);
-		}
-
-	private:
-
-		MotionAnimator &mAnimator;
-	};
-
-
-
-	MotionAnimator::MotionAnimator(osg::PositionAttitudeTransform *node)
-	: mNode(node)
-	, mUpdateCallback(new MotionAnimatorUpdateCallback(*this))
-	, mLastSimTime(-1)
-	{
-		mNode->addUpdateCallback(mUpdateCallback);
+		mScheduler.add(this, UpdatePhase::Animation);
 	}
 
 	MotionAnimator::~MotionAnimator()
 	{
-		mNode->removeUpdateCallback(mUpdateCallback);
+		mScheduler.remove(this);
 	}
 
-	void MotionAnimator::update(double simTime)
+	void MotionAnimator::update(double simTime, double relTime)
 	{
-		if(mLastSimTime < 0)
-		{
-			mLastSimTime = simTime;
-			return;
-		}
-
-		double relTime = simTime - mLastSimTime;
 		osg::Vec3 pos = mNode->getPosition();
 
 		pos += mVelocity * relTime;
 
 		mNode->setPosition(pos);
-
-		mLastSimTime = simTime;
 	}
 
 
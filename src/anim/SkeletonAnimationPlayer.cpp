@@ -14,6 +14,7 @@
 #include "Engine.h"
 #include "OdDefines.h"
 #include "db/Skeleton.h"
+#include "GeodeBuilder.h"
 
 namespace od
 {
@@ -21,8 +22,9 @@ namespace od
 	{
 	public:
 
-		CreateAnimatorsVisitor(std::vector<osg::ref_ptr<Animator>> &animatorList, TransformAccumulator *accumulator)
+		CreateAnimatorsVisitor(UpdateScheduler &scheduler, std::vector<osg::ref_ptr<Animator>> &animatorList, TransformAccumulator *accumulator)
         : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+		, mScheduler(scheduler)
 		, mAnimatorList(animatorList)
 		, mAccumulator(accumulator)
         {
@@ -33,7 +35,7 @@ namespace od
         	BoneNode *bn = dynamic_cast<BoneNode*>(&node);
         	if(bn != nullptr)
         	{
-				osg::ref_ptr<Animator> animator(new Animator(bn));
+				osg::ref_ptr<Animator> animator(new Animator(mScheduler, bn));
 				mAnimatorList.push_back(animator);
 
 				if(mAccumulator != nullptr && bn->isRoot())
@@ -49,6 +51,7 @@ namespace od
 
 	private:
 
+        UpdateScheduler &mScheduler;
         std::vector<osg::ref_ptr<Animator>> &mAnimatorList;
         TransformAccumulator *mAccumulator;
 	};
@@ -59,9 +62,9 @@ namespace od
 	{
 	public:
 
-		BoneUploadVisitor(osg::Uniform *boneMatrixArray)
+		BoneUploadVisitor(std::vector<osg::Matrixf> &boneMatrices)
         : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
-		, mBoneMatrixArray(boneMatrixArray)
+		, mBoneMatrices(boneMatrices)
 		, mCurrentMatrix(osg::Matrixd::identity())
         {
         }
@@ -74,7 +77,13 @@ namespace od
         	if(bn != nullptr)
         	{
         		mCurrentMatrix.preMult(bn->getMatrix() * bn->getInverseBindPoseXform());
-        		mBoneMatrixArray->setElement(bn->getJointInfoIndex(), mCurrentMatrix);
+
+        		size_t jointIndex = bn->getJointInfoIndex();
+        		if(jointIndex >= mBoneMatrices.size())
+        		{
+        		    mBoneMatrices.resize(jointIndex + 1, osg::Matrixf::identity());
+        		}
+        		mBoneMatrices[jointIndex] = mCurrentMatrix;
 
         	}else
         	{
@@ -90,7 +99,7 @@ namespace od
 
 	private:
 
-        osg::ref_ptr<osg::Uniform> mBoneMatrixArray;
+        std::vector<osg::Matrixf> &mBoneMatrices;
         osg::Matrixd mCurrentMatrix;
 	};
 
@@ -100,25 +109,81 @@ namespace od
 	{
 	public:
 
-		BoneUploadCallback(osg::Uniform *boneMatrixArray)
-		: mBoneMatrixArray(boneMatrixArray)
+		void addPalette(osg::Uniform *bones, BonePalette *palette)
 		{
+		    mPalettes.push_back(std::make_pair(osg::ref_ptr<osg::Uniform>(bones), osg::ref_ptr<BonePalette>(palette)));
 		}
 
+		inline size_t getPaletteCount() const { return mPalettes.size(); }
+		inline const std::vector<osg::Matrixf> &getBoneMatrices() const { return mBoneMatrices; }
+		inline void setSkinningInstance(CpuSkinner::Instance *instance) { mSkinningInstance = instance; }
+
 		virtual void operator()(osg::Node *node, osg::NodeVisitor *nv)
 		{
-			// first let update visitor traverse so all attached Animator object get updated
-			//  before we start to upload the new bone positions
+			// animators have already been updated by the scheduler at this point
 			traverse(node, nv);
 
-			BoneUploadVisitor buv(mBoneMatrixArray); // TODO: no need to create this everytime. maybe add as member and just call reset here
+			BoneUploadVisitor buv(mBoneMatrices); // TODO: no need to create this everytime. maybe add as member and just call reset here
 			node->accept(buv);
+
+			// each skinned geometry only gets the matrices of the bones it actually uses
+			for(auto it = mPalettes.begin(); it != mPalettes.end(); ++it)
+			{
+			    const std::vector<int32_t> &joints = it->second->jointIndices;
+			    for(size_t i = 0; i < joints.size(); ++i)
+			    {
+			        if(joints[i] >= 0 && static_cast<size_t>(joints[i]) < mBoneMatrices.size())
+			        {
+			            it->first->setElement(i, mBoneMatrices[joints[i]]);
+			        }
+			    }
+			}
+
+			if(mSkinningInstance != nullptr)
+			{
+			    mSkinningInstance->setBoneMatrices(mBoneMatrices);
+			}
 		}
 
 
 	private:
 
-		 osg::ref_ptr<osg::Uniform> mBoneMatrixArray;;
+		std::vector<osg::Matrixf> mBoneMatrices; // indexed by joint
+		osg::ref_ptr<CpuSkinner::Instance> mSkinningInstance;
+		std::vector<std::pair<osg::ref_ptr<osg::Uniform>, osg::ref_ptr<BonePalette>>> mPalettes;
+	};
+
+
+
+	class FindBonePalettesVisitor : public osg::NodeVisitor
+	{
+	public:
+
+	    FindBonePalettesVisitor(BoneUploadCallback &callback)
+	    : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+	    , mCallback(callback)
+	    {
+	    }
+
+	    virtual void apply(osg::Geode &node)
+	    {
+	        for(size_t i = 0; i < node.getNumDrawables(); ++i)
+	        {
+	            osg::Drawable *drawable = node.getDrawable(i);
+	            BonePalette *palette = dynamic_cast<BonePalette*>(drawable->getUserData());
+	            osg::StateSet *ss = drawable->getStateSet();
+	            osg::Uniform *bones = (ss != nullptr) ? ss->getUniform("bones") : nullptr;
+	            if(palette != nullptr && bones != nullptr)
+	            {
+	                mCallback.addPalette(bones, palette);
+	            }
+	        }
+	    }
+
+
+	private:
+
+	    BoneUploadCallback &mCallback;
 	};
 
 
@@ -128,11 +193,9 @@ namespace od
 	, mObjectRoot(objectRoot)
 	, mSkeletonRoot(skeletonRoot)
 	, mAccumulator(accumulator)
-	, mBoneMatrixArray(new osg::Uniform(osg::Uniform::FLOAT_MAT4, "bones", OD_MAX_BONE_COUNT))
-	, mUploadCallback(new BoneUploadCallback(mBoneMatrixArray))
 	{
 		// create one animator for each MatrixTransform child of group
-		CreateAnimatorsVisitor cav(mAnimators, mAccumulator);
+		CreateAnimatorsVisitor cav(mEngine.getUpdateScheduler(), mAnimators, mAccumulator);
 		mSkeletonRoot->accept(cav);
 
 		Logger::debug() << "Created SkeletonAnimation with " << mAnimators.size() << " animators";
@@ -143,24 +206,36 @@ namespace od
 		mRiggingProgram->addBindAttribLocation("influencingBones", OD_ATTRIB_INFLUENCE_LOCATION);
 		mRiggingProgram->addBindAttribLocation("vertexWeights", OD_ATTRIB_WEIGHT_LOCATION);
 		mObjectRoot->getOrCreateStateSet()->setAttribute(mRiggingProgram, osg::StateAttribute::ON);
-		mObjectRoot->getOrCreateStateSet()->addUniform(mBoneMatrixArray, osg::StateAttribute::ON);
 
-		// set all bones to identity to force bind pose
-		for(size_t i = 0; i < OD_MAX_BONE_COUNT; ++i)
+		// palette uniforms start out as identity, forcing bind pose until the first upload
+		osg::ref_ptr<BoneUploadCallback> uploadCallback(new BoneUploadCallback);
+		FindBonePalettesVisitor fbpv(*uploadCallback);
+		mObjectRoot->accept(fbpv);
+		if(uploadCallback->getPaletteCount() == 0)
 		{
-			mBoneMatrixArray->setElement(i, osg::Matrixf::identity());
+		    Logger::debug() << "Animated object has no skinned geometry with a bone palette";
 		}
 
+		mUploadCallback = uploadCallback;
 		mSkeletonRoot->addUpdateCallback(mUploadCallback);
 	}
 
 	SkeletonAnimationPlayer::~SkeletonAnimationPlayer()
 	{
 		mObjectRoot->getOrCreateStateSet()->removeAttribute(mRiggingProgram);
-		mObjectRoot->getOrCreateStateSet()->removeUniform(mBoneMatrixArray);
 		mSkeletonRoot->removeUpdateCallback(mUploadCallback);
 	}
 
+	const std::vector<osg::Matrixf> &SkeletonAnimationPlayer::getBoneMatrices() const
+	{
+	    return mUploadCallback->getBoneMatrices();
+	}
+
+	void SkeletonAnimationPlayer::setSkinningInstance(CpuSkinner::Instance *instance)
+	{
+	    mUploadCallback->setSkinningInstance(instance);
+	}
+
 	void SkeletonAnimationPlayer::setAnimation(osg::ref_ptr<Animation> anim, double startDelay)
 	{
 		if(anim->getModelNodeCount() != mAnimators.size())
@@ -0,0 +1,110 @@
+/*
+ * AudioSink.cpp
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#include "audio/AudioSink.h"
+
+#include "Exception.h"
+
+namespace od
+{
+
+    AudioSink::~AudioSink()
+    {
+    }
+
+    void AudioSink::close()
+    {
+    }
+
+    bool AudioSink::isBlocking() const
+    {
+        return false;
+    }
+
+
+    void NullAudioSink::open(uint32_t frequency)
+    {
+    }
+
+    void NullAudioSink::write(const int16_t *samples, size_t sampleCount)
+    {
+    }
+
+
+    WavFileAudioSink::WavFileAudioSink(const FilePath &path)
+    : mPath(path)
+    , mFrequency(0)
+    , mDataSize(0)
+    {
+    }
+
+    WavFileAudioSink::~WavFileAudioSink()
+    {
+        close();
+    }
+
+    void WavFileAudioSink::open(uint32_t frequency)
+    {
+        mOut.open(mPath.str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if(mOut.fail())
+        {
+            throw IoException("Could not open WAV file '" + mPath.str() + "' for writing");
+        }
+
+        mFrequency = frequency;
+        mDataSize = 0;
+        _writeHeader(); // placeholder. sizes get fixed up on close
+    }
+
+    void WavFileAudioSink::write(const int16_t *samples, size_t sampleCount)
+    {
+        // WAV is little endian, as is every platform we run on
+        mOut.write(reinterpret_cast<const char*>(samples), sampleCount*sizeof(int16_t));
+        mDataSize += sampleCount*sizeof(int16_t);
+    }
+
+    void WavFileAudioSink::close()
+    {
+        if(!mOut.is_open())
+        {
+            return;
+        }
+
+        mOut.seekp(0);
+        _writeHeader();
+        mOut.close();
+    }
+
+    template <typename T>
+    static void _writeLe(std::ostream &out, T v)
+    {
+        for(size_t i = 0; i < sizeof(T); ++i)
+        {
+            out.put(static_cast<char>((v >> (8*i)) & 0xff));
+        }
+    }
+
+    void WavFileAudioSink::_writeHeader()
+    {
+        const uint16_t channels = 1;
+        const uint16_t bitsPerSample = 16;
+
+        mOut.write("RIFF", 4);
+        _writeLe<uint32_t>(mOut, 36 + mDataSize);
+        mOut.write("WAVEfmt ", 8);
+        _writeLe<uint32_t>(mOut, 16); // fmt chunk size
+        _writeLe<uint16_t>(mOut, 1); // PCM
+        _writeLe<uint16_t>(mOut, channels);
+        _writeLe<uint32_t>(mOut, mFrequency);
+        _writeLe<uint32_t>(mOut, mFrequency*channels*bitsPerSample/8);
+        _writeLe<uint16_t>(mOut, channels*bitsPerSample/8);
+        _writeLe<uint16_t>(mOut, bitsPerSample);
+        mOut.write("data", 4);
+        _writeLe<uint32_t>(mOut, mDataSize);
+    }
+
+}
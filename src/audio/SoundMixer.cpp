@@ -0,0 +1,523 @@
+/*
+ * SoundMixer.cpp
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#include "audio/SoundMixer.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "Exception.h"
+#include "Logger.h"
+
+// samples mixed per block. at 22kHz this is about 23ms of latency
+#define OD_MIXER_BLOCK_SIZE 512
+
+// must be a power of two
+#define OD_MIXER_COMMAND_QUEUE_SIZE 1024
+
+// distance up to which positional voices play at full gain
+#define OD_MIXER_REFERENCE_DISTANCE 1.0f
+
+#define OD_MIXER_FIXED_ONE (static_cast<uint64_t>(1) << 32)
+
+namespace od
+{
+
+    const VoiceHandle SoundMixer::INVALID_VOICE;
+
+    SoundMixer::VoiceSettings::VoiceSettings()
+    : gain(1.0f)
+    , priority(0)
+    , looping(false)
+    , positional(false)
+    , dropoff(0.0f)
+    {
+    }
+
+
+    SoundMixer::SoundMixer(std::unique_ptr<AudioSink> sink, uint32_t outputFrequency, size_t voiceBudget)
+    : mSink(std::move(sink))
+    , mOutputFrequency(outputFrequency)
+    , mVoiceBudget(voiceBudget)
+    , mNextHandle(INVALID_VOICE + 1)
+    , mDroppedCommands(0)
+    , mCommands(OD_MIXER_COMMAND_QUEUE_SIZE)
+    , mCommandHead(0)
+    , mCommandTail(0)
+    , mAccumulator(OD_MIXER_BLOCK_SIZE)
+    , mScratch(OD_MIXER_BLOCK_SIZE)
+    , mActiveVoiceCount(0)
+    , mStolenVoiceCount(0)
+    , mRejectedVoiceCount(0)
+    , mRunning(false)
+    {
+        if(mSink == nullptr)
+        {
+            throw InvalidArgumentException("Sound mixer needs a sink");
+        }
+
+        if(mOutputFrequency == 0)
+        {
+            throw InvalidArgumentException("Output frequency of sound mixer must not be zero");
+        }
+
+        mVoices.reserve(mVoiceBudget);
+    }
+
+    SoundMixer::~SoundMixer()
+    {
+        stop();
+    }
+
+    SoundMixer::Stats SoundMixer::getStats() const
+    {
+        Stats stats;
+        stats.activeVoices = mActiveVoiceCount;
+        stats.stolenVoices = mStolenVoiceCount;
+        stats.rejectedVoices = mRejectedVoiceCount;
+        stats.droppedCommands = mDroppedCommands;
+
+        return stats;
+    }
+
+    void SoundMixer::start()
+    {
+        if(mRunning)
+        {
+            return;
+        }
+
+        mSink->open(mOutputFrequency);
+
+        mRunning = true;
+        mThread = std::thread(&SoundMixer::_threadMain, this);
+    }
+
+    void SoundMixer::stop()
+    {
+        if(!mRunning)
+        {
+            return;
+        }
+
+        mRunning = false;
+        mThread.join();
+
+        mSink->close();
+    }
+
+    VoiceHandle SoundMixer::play(Sound &sound, const osg::Vec3f &position, float gain)
+    {
+        VoiceSettings settings;
+        settings.gain = gain;
+        settings.priority = sound.getPriority();
+        settings.looping = sound.isLooping();
+        settings.positional = true;
+        settings.position = position;
+        settings.dropoff = sound.getDropoff();
+
+        return play(sound.getPcmBuffer(), sound.getFrequency(), settings);
+    }
+
+    VoiceHandle SoundMixer::playAmbient(Sound &sound, float gain)
+    {
+        VoiceSettings settings;
+        settings.gain = gain;
+        settings.priority = sound.getPriority();
+        settings.looping = sound.isLooping();
+
+        return play(sound.getPcmBuffer(), sound.getFrequency(), settings);
+    }
+
+    VoiceHandle SoundMixer::play(PcmBuffer *buffer, uint32_t frequency, const VoiceSettings &settings)
+    {
+        if(buffer == nullptr || buffer->getSamples().empty() || frequency == 0)
+        {
+            return INVALID_VOICE;
+        }
+
+        Command c;
+        c.type = CommandType::Play;
+        c.handle = mNextHandle++;
+        c.buffer = buffer;
+        c.frequency = frequency;
+        c.settings = settings;
+        if(mNextHandle == INVALID_VOICE)
+        {
+            ++mNextHandle;
+        }
+
+        return _pushCommand(c) ? c.handle : INVALID_VOICE;
+    }
+
+    void SoundMixer::stopVoice(VoiceHandle handle)
+    {
+        Command c;
+        c.type = CommandType::Stop;
+        c.handle = handle;
+        _pushCommand(c);
+    }
+
+    void SoundMixer::stopAllVoices()
+    {
+        Command c;
+        c.type = CommandType::StopAll;
+        _pushCommand(c);
+    }
+
+    void SoundMixer::setVoicePosition(VoiceHandle handle, const osg::Vec3f &position)
+    {
+        Command c;
+        c.type = CommandType::SetPosition;
+        c.handle = handle;
+        c.position = position;
+        _pushCommand(c);
+    }
+
+    void SoundMixer::setVoiceGain(VoiceHandle handle, float gain)
+    {
+        Command c;
+        c.type = CommandType::SetGain;
+        c.handle = handle;
+        c.gain = gain;
+        _pushCommand(c);
+    }
+
+    void SoundMixer::setListenerPosition(const osg::Vec3f &position)
+    {
+        Command c;
+        c.type = CommandType::SetListener;
+        c.position = position;
+        _pushCommand(c);
+    }
+
+    void SoundMixer::setVoiceBudget(size_t budget)
+    {
+        Command c;
+        c.type = CommandType::SetBudget;
+        c.budget = budget;
+        _pushCommand(c);
+    }
+
+    void SoundMixer::mix(int16_t *out, size_t sampleCount)
+    {
+        _processCommands();
+
+        while(sampleCount > 0)
+        {
+            size_t blockSize = std::min<size_t>(sampleCount, OD_MIXER_BLOCK_SIZE);
+            _mixBlock(out, blockSize);
+
+            out += blockSize;
+            sampleCount -= blockSize;
+        }
+    }
+
+    bool SoundMixer::_pushCommand(Command &c)
+    {
+        size_t tail = mCommandTail.load(std::memory_order_relaxed);
+        size_t head = mCommandHead.load(std::memory_order_acquire);
+        if(tail - head >= mCommands.size())
+        {
+            // mixer thread is stalled or not running. dropping is better than blocking the main thread
+            ++mDroppedCommands;
+            return false;
+        }
+
+        mCommands[tail & (mCommands.size() - 1)] = std::move(c);
+        mCommandTail.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    void SoundMixer::_processCommands()
+    {
+        size_t head = mCommandHead.load(std::memory_order_relaxed);
+        size_t tail = mCommandTail.load(std::memory_order_acquire);
+
+        for(; head != tail; ++head)
+        {
+            Command &c = mCommands[head & (mCommands.size() - 1)];
+
+            Voice *v;
+            switch(c.type)
+            {
+            case CommandType::Play:
+                _startVoice(c);
+                break;
+
+            case CommandType::Stop:
+                v = _findVoice(c.handle);
+                if(v != nullptr)
+                {
+                    v->finished = true;
+                }
+                break;
+
+            case CommandType::StopAll:
+                mVoices.clear();
+                break;
+
+            case CommandType::SetPosition:
+                v = _findVoice(c.handle);
+                if(v != nullptr)
+                {
+                    v->settings.position = c.position;
+                }
+                break;
+
+            case CommandType::SetGain:
+                v = _findVoice(c.handle);
+                if(v != nullptr)
+                {
+                    v->settings.gain = c.gain;
+                }
+                break;
+
+            case CommandType::SetListener:
+                mListenerPosition = c.position;
+                break;
+
+            case CommandType::SetBudget:
+                mVoiceBudget = c.budget;
+                if(mVoices.size() > mVoiceBudget)
+                {
+                    // keep the most important voices
+                    std::sort(mVoices.begin(), mVoices.end(), [](const Voice &a, const Voice &b)
+                            { return a.settings.priority > b.settings.priority
+                                    || (a.settings.priority == b.settings.priority && a.currentGain > b.currentGain); });
+                    mStolenVoiceCount += mVoices.size() - mVoiceBudget;
+                    mVoices.resize(mVoiceBudget);
+                }
+                break;
+            }
+
+            c.buffer = nullptr; // don't keep buffers alive just because they are still in the ring
+        }
+
+        mCommandHead.store(head, std::memory_order_release);
+        mActiveVoiceCount = mVoices.size();
+    }
+
+    void SoundMixer::_startVoice(Command &c)
+    {
+        Voice v;
+        v.handle = c.handle;
+        v.buffer = c.buffer;
+        v.cursor = 0;
+        v.step = (static_cast<uint64_t>(c.frequency) << 32)/mOutputFrequency;
+        v.settings = c.settings;
+        v.finished = false;
+        v.currentGain = _getTargetGain(v);
+
+        if(v.step == 0)
+        {
+            return;
+        }
+
+        if(mVoices.size() < mVoiceBudget)
+        {
+            mVoices.push_back(v);
+            return;
+        }
+
+        if(mVoices.empty())
+        {
+            ++mRejectedVoiceCount; // budget is zero
+            return;
+        }
+
+        auto victim = std::min_element(mVoices.begin(), mVoices.end(), [](const Voice &a, const Voice &b)
+                { return a.settings.priority < b.settings.priority
+                        || (a.settings.priority == b.settings.priority && a.currentGain < b.currentGain); });
+
+        if(v.settings.priority > victim->settings.priority
+                || (v.settings.priority == victim->settings.priority && v.currentGain > victim->currentGain))
+        {
+            *victim = v;
+            ++mStolenVoiceCount;
+
+        }else
+        {
+            ++mRejectedVoiceCount;
+        }
+    }
+
+    SoundMixer::Voice *SoundMixer::_findVoice(VoiceHandle handle)
+    {
+        // voice budget is small, so a linear search is fine
+        for(Voice &v : mVoices)
+        {
+            if(v.handle == handle)
+            {
+                return &v;
+            }
+        }
+
+        return nullptr;
+    }
+
+    float SoundMixer::_getTargetGain(const Voice &v) const
+    {
+        float gain = v.settings.gain;
+        if(v.settings.positional)
+        {
+            // inverse distance falloff, scaled by the sound's dropoff. a dropoff of 0 means no attenuation at all
+            float distance = (v.settings.position - mListenerPosition).length();
+            if(distance > OD_MIXER_REFERENCE_DISTANCE)
+            {
+                gain *= OD_MIXER_REFERENCE_DISTANCE/(OD_MIXER_REFERENCE_DISTANCE + v.settings.dropoff*(distance - OD_MIXER_REFERENCE_DISTANCE));
+            }
+        }
+
+        return gain;
+    }
+
+    size_t SoundMixer::_resample(Voice &v, float *out, size_t count)
+    {
+        const int16_t *data = v.buffer->getSamples().data();
+        uint64_t length = v.buffer->getSamples().size();
+        uint64_t lastSampleCursor = (length - 1) << 32;
+        const float fracScale = 1.0f/OD_MIXER_FIXED_ONE;
+
+        size_t i = 0;
+        while(i < count)
+        {
+            if((v.cursor >> 32) >= length)
+            {
+                if(!v.settings.looping)
+                {
+                    v.finished = true;
+                    break;
+                }
+
+                v.cursor -= length << 32;
+                continue;
+            }
+
+            // number of samples we can produce before interpolation would read past the last sample. this keeps the
+            //  inner loops free of bounds checks, so the compiler can vectorize them
+            size_t run = 0;
+            if(v.cursor < lastSampleCursor)
+            {
+                run = std::min<uint64_t>(count - i, (lastSampleCursor - v.cursor - 1)/v.step + 1);
+            }
+
+            if(run > 0)
+            {
+                float *o = out + i;
+                if(v.step == OD_MIXER_FIXED_ONE && (v.cursor & 0xffffffff) == 0)
+                {
+                    const int16_t *in = data + (v.cursor >> 32);
+                    for(size_t k = 0; k < run; ++k)
+                    {
+                        o[k] = in[k];
+                    }
+
+                }else
+                {
+                    uint64_t cursor = v.cursor;
+                    uint64_t step = v.step;
+                    for(size_t k = 0; k < run; ++k)
+                    {
+                        uint64_t c = cursor + k*step;
+                        size_t index = c >> 32;
+                        float frac = (c & 0xffffffff)*fracScale;
+                        float s0 = data[index];
+                        float s1 = data[index + 1];
+                        o[k] = s0 + frac*(s1 - s0);
+                    }
+                }
+
+                v.cursor += run*v.step;
+                i += run;
+
+            }else
+            {
+                // the last sample. interpolate towards the start if looping, else just hold it
+                size_t index = v.cursor >> 32;
+                float frac = (v.cursor & 0xffffffff)*fracScale;
+                float s0 = data[index];
+                float s1 = v.settings.looping ? data[0] : s0;
+                out[i++] = s0 + frac*(s1 - s0);
+                v.cursor += v.step;
+            }
+        }
+
+        return i;
+    }
+
+    void SoundMixer::_mixBlock(int16_t *out, size_t sampleCount)
+    {
+        float *acc = mAccumulator.data();
+        float *scratch = mScratch.data();
+        std::fill(acc, acc + sampleCount, 0.0f);
+
+        auto it = mVoices.begin();
+        while(it != mVoices.end())
+        {
+            Voice &v = *it;
+
+            size_t produced = v.finished ? 0 : _resample(v, scratch, sampleCount);
+
+            // ramp gain linearly across the block so moving voices don't click
+            float targetGain = _getTargetGain(v);
+            float gain = v.currentGain;
+            float gainStep = (targetGain - gain)/sampleCount;
+            for(size_t i = 0; i < produced; ++i)
+            {
+                acc[i] += scratch[i]*(gain + gainStep*i);
+            }
+            v.currentGain = targetGain;
+
+            if(v.finished)
+            {
+                // order of voices does not matter. swap and pop
+                std::swap(v, mVoices.back());
+                mVoices.pop_back();
+                continue;
+            }
+
+            ++it;
+        }
+
+        for(size_t i = 0; i < sampleCount; ++i)
+        {
+            out[i] = static_cast<int16_t>(std::min(std::max(acc[i], -32768.0f), 32767.0f));
+        }
+
+        mActiveVoiceCount = mVoices.size();
+    }
+
+    void SoundMixer::_threadMain()
+    {
+        std::vector<int16_t> block(OD_MIXER_BLOCK_SIZE);
+        auto blockDuration = std::chrono::duration<double>(static_cast<double>(OD_MIXER_BLOCK_SIZE)/mOutputFrequency);
+        auto nextBlockTime = std::chrono::steady_clock::now();
+
+        while(mRunning)
+        {
+            try
+            {
+                mix(block.data(), block.size());
+                mSink->write(block.data(), block.size());
+
+            }catch(std::exception &e)
+            {
+                Logger::error() << "Error in sound mixer thread: " << e.what() << ". Stopping all voices";
+                mVoices.clear();
+            }
+
+            if(!mSink->isBlocking())
+            {
+                nextBlockTime += std::chrono::duration_cast<std::chrono::steady_clock::duration>(blockDuration);
+                std::this_thread::sleep_until(nextBlockTime);
+            }
+        }
+    }
+
+}
@@ -11,6 +11,108 @@
 namespace od
 {
 
+    Texture *AssetProvider::getTextureByRef(const AssetRef &ref)
+    {
+        Texture *asset = this->findTextureByRef(ref);
+        if(asset == nullptr)
+        {
+            throw NotFoundException("Referenced texture not found in provider or its dependencies");
+        }
+
+        return asset;
+    }
+
+    Class *AssetProvider::getClassByRef(const AssetRef &ref)
+    {
+        Class *asset = this->findClassByRef(ref);
+        if(asset == nullptr)
+        {
+            throw NotFoundException("Referenced class not found in provider or its dependencies");
+        }
+
+        return asset;
+    }
+
+    Model *AssetProvider::getModelByRef(const AssetRef &ref)
+    {
+        Model *asset = this->findModelByRef(ref);
+        if(asset == nullptr)
+        {
+            throw NotFoundException("Referenced model not found in provider or its dependencies");
+        }
+
+        return asset;
+    }
+
+    Sequence *AssetProvider::getSequenceByRef(const AssetRef &ref)
+    {
+        Sequence *asset = this->findSequenceByRef(ref);
+        if(asset == nullptr)
+        {
+            throw NotFoundException("Referenced sequence not found in provider or its dependencies");
+        }
+
+        return asset;
+    }
+
+    Animation *AssetProvider::getAnimationByRef(const AssetRef &ref)
+    {
+        Animation *asset = this->findAnimationByRef(ref);
+        if(asset == nullptr)
+        {
+            throw NotFoundException("Referenced animation not found in provider or its dependencies");
+        }
+
+        return asset;
+    }
+
+    Sound *AssetProvider::getSoundByRef(const AssetRef &ref)
+    {
+        Sound *asset = this->findSoundByRef(ref);
+        if(asset == nullptr)
+        {
+            throw NotFoundException("Referenced sound not found in provider or its dependencies");
+        }
+
+        return asset;
+    }
+
+    template<>
+    Texture *AssetProvider::findAssetByRef<Texture>(const AssetRef &ref)
+    {
+        return this->findTextureByRef(ref);
+    }
+
+    template<>
+    Class *AssetProvider::findAssetByRef<Class>(const AssetRef &ref)
+    {
+        return this->findClassByRef(ref);
+    }
+
+    template<>
+    Model *AssetProvider::findAssetByRef<Model>(const AssetRef &ref)
+    {
+        return this->findModelByRef(ref);
+    }
+
+    template<>
+    Sequence *AssetProvider::findAssetByRef<Sequence>(const AssetRef &ref)
+    {
+        return this->findSequenceByRef(ref);
+    }
+
+    template<>
+    Animation *AssetProvider::findAssetByRef<Animation>(const AssetRef &ref)
+    {
+        return this->findAnimationByRef(ref);
+    }
+
+    template<>
+    Sound *AssetProvider::findAssetByRef<Sound>(const AssetRef &ref)
+    {
+        return this->findSoundByRef(ref);
+    }
+
     template<>
     Texture *AssetProvider::getAssetByRef<Texture>(const AssetRef &ref)
     {
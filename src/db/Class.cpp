@@ -36,14 +36,10 @@ namespace od
 
         if(mModelRef.assetId != 0)
         {
-            try
-            {
-                mModel = this->getAssetProvider().getModelByRef(mModelRef);
-
-            }catch(NotFoundException &e)
+            mModel = this->getAssetProvider().findModelByRef(mModelRef);
+            if(mModel == nullptr)
             {
                 Logger::warn() << "Model of class " << mClassName << " not found. Leaving invisible";
-                mModel = nullptr;
             }
         }
     }
@@ -52,26 +48,21 @@ namespace od
 	{
     	Logger::debug() << "Instantiating class '" << mClassName << "' (" << std::hex << getAssetId() << std::dec << ")";
 
-    	try
-        {
-        	odRfl::RflClassRegistrar &cr = odRfl::Rfl::getSingleton().getClassRegistrarById(mRflClassId);
-
-        	std::unique_ptr<odRfl::RflClass> newInstance = cr.createClassInstance();// FIXME: make sure this does not throw NotFoundException or cause unwanted catches
-        	mClassBuilder.resetIndexCounter(); // in case of throw, do this BEFORE building so counter is always fresh TODO: pretty unelegant
-        	newInstance->probeFields(mClassBuilder);
-
-        	return newInstance;
-
-
-        }catch(NotFoundException &e)
-        {
-        	// ignore these for now as there are way more RflClasses than we have implemented
-        	//Logger::warn() << "Tried to instantiate class with unknown RFLClass " << std::hex << mRflClassId << std::dec;
+    	// most RflClasses are not implemented yet, so a miss here is the common case. don't use exceptions for it
+    	odRfl::RflClassRegistrar *cr = odRfl::Rfl::getSingleton().findClassRegistrarById(mRflClassId);
+    	if(cr == nullptr)
+    	{
         	Logger::debug() << "RflClass type " << std::hex << mRflClassId << std::dec <<
         			" of class '" << mClassName << "' not found. Probably unimplemented";
-        }
+        	return nullptr;
+    	}
+
+    	std::unique_ptr<odRfl::RflClass> newInstance = cr->createClassInstance();
+    	mClassBuilder.resetIndexCounter(); // in case of throw, do this BEFORE building so counter is always fresh TODO: pretty unelegant
+    	newInstance->probeFields(mClassBuilder);
+    	mClassBuilder.markLayoutVerified(); // all further instances can skip the checks
 
-        return nullptr;
+    	return newInstance;
 	}
 
 }
@@ -39,11 +39,12 @@ namespace od
 		std::regex dependencyDefRegex("\\s*(\\d+)\\s+(.*)");
 		std::regex commentRegex("\\s*"); // allow empty lines. if we find something like a comment, add it here
 
-		std::ifstream in(mDbFilePath.str(), std::ios::in | std::ios::binary);
-		if(in.fail())
+		std::unique_ptr<std::istream> inPtr = mDbManager.openFile(mDbFilePath);
+		if(inPtr == nullptr)
 		{
 		    throw IoException("Could not open db definition file " + mDbFilePath.str());
 		}
+		std::istream &in = *inPtr;
 
 		std::string line;
 		bool readingDependencies = false;
@@ -133,16 +134,15 @@ namespace od
         // now that the database is loaded, create the various asset factories
 
         _tryOpeningAssetContainer(mClassFactory,    mClassContainer,    ".odb");
-        _tryOpeningAssetContainer(mModelFactory,    mModelContainer,    ".mod");
         _tryOpeningAssetContainer(mAnimFactory,     mAnimContainer,     ".adb");
         _tryOpeningAssetContainer(mSoundFactory,    mSoundContainer,    ".sdb");
         _tryOpeningAssetContainer(mSequenceFactory, mSequenceContainer, ".ssd");
 
-        // texture container is different. it needs an engine reference
+        // texture and model containers are different. they need an engine reference
         FilePath txdPath = mDbFilePath.ext(".txd");
-        if(txdPath.exists())
+        mTextureContainer = mDbManager.openSrscFile(txdPath);
+        if(mTextureContainer != nullptr)
         {
-            mTextureContainer.reset(new SrscFile(txdPath));
             mTextureFactory.reset(new TextureFactory(*this, *mTextureContainer, mDbManager.getEngine()));
 
             Logger::verbose() << "Opened database texture container " << txdPath.str();
@@ -151,105 +151,76 @@ namespace od
         {
             Logger::verbose() << "Database has no texture container";
         }
-	}
 
-	// TODO: the following methods look pretty redundant. find clever template interface for them
-	Texture *Database::getTextureByRef(const AssetRef &ref)
-	{
-		if(ref.dbIndex == 0)
-		{
-			return this->getTexture(ref.assetId);
-		}
+        FilePath modPath = mDbFilePath.ext(".mod");
+        mModelContainer = mDbManager.openSrscFile(modPath);
+        if(mModelContainer != nullptr)
+        {
+            mModelFactory.reset(new ModelFactory(*this, *mModelContainer, mDbManager.getEngine()));
 
-		auto it = mDependencyMap.find(ref.dbIndex);
-		if(it == mDependencyMap.end())
-		{
-			throw Exception("Database has no dependency with given index");
-		}
+            Logger::verbose() << "Opened database model container " << modPath.str();
 
-		return it->second.get().getTexture(ref.assetId);
+        }else
+        {
+            Logger::verbose() << "Database has no model container";
+        }
 	}
 
-	Class *Database::getClassByRef(const AssetRef &ref)
+	template <typename _AssetType>
+	_AssetType *Database::_findAssetByRef(const AssetRef &ref)
 	{
-		if(ref.dbIndex == 0)
+		Database *db = this;
+		if(ref.dbIndex != 0)
 		{
-			return this->getClass(ref.assetId);
-		}
+			auto it = mDependencyMap.find(ref.dbIndex);
+			if(it == mDependencyMap.end())
+			{
+				return nullptr;
+			}
 
-		auto it = mDependencyMap.find(ref.dbIndex);
-		if(it == mDependencyMap.end())
-		{
-			throw Exception("Database has no dependency with given index");
+			db = &it->second.get();
 		}
 
-		return it->second.get().getClass(ref.assetId);
-	}
-
-	Model *Database::getModelByRef(const AssetRef &ref)
-	{
-		if(ref.dbIndex == 0)
+		AssetFactory<_AssetType> *factory = db->getAssetFactory<_AssetType>();
+		if(factory == nullptr)
 		{
-			return this->getModel(ref.assetId);
+			return nullptr;
 		}
 
-		auto it = mDependencyMap.find(ref.dbIndex);
-		if(it == mDependencyMap.end())
-		{
-			throw Exception("Database has no dependency with given index");
-		}
+		osg::ref_ptr<_AssetType> asset = factory->findAsset(ref.assetId);
 
-		return it->second.get().getModel(ref.assetId);
+		return asset.release();
 	}
 
-    Sequence *Database::getSequenceByRef(const AssetRef &ref)
-    {
-        if(ref.dbIndex == 0)
-        {
-            return this->getSequence(ref.assetId);
-        }
-
-        auto it = mDependencyMap.find(ref.dbIndex);
-        if(it == mDependencyMap.end())
-        {
-            throw Exception("Database has no dependency with given index");
-        }
-
-        return it->second.get().getSequence(ref.assetId);
-    }
-
-    Animation *Database::getAnimationByRef(const AssetRef &ref)
-    {
-    	if(ref.dbIndex == 0)
-        {
-            return this->getAnimation(ref.assetId);
-        }
-
-        auto it = mDependencyMap.find(ref.dbIndex);
-        if(it == mDependencyMap.end())
-        {
-            throw Exception("Database has no dependency with given index");
-        }
+	Texture *Database::findTextureByRef(const AssetRef &ref)
+	{
+		return _findAssetByRef<Texture>(ref);
+	}
 
-        return it->second.get().getAnimation(ref.assetId);
-    }
+	Class *Database::findClassByRef(const AssetRef &ref)
+	{
+		return _findAssetByRef<Class>(ref);
+	}
 
-    Sound *Database::getSoundByRef(const AssetRef &ref)
-    {
-        if(ref.dbIndex == 0)
-        {
-            return this->getSound(ref.assetId);
-        }
+	Model *Database::findModelByRef(const AssetRef &ref)
+	{
+		return _findAssetByRef<Model>(ref);
+	}
 
-        auto it = mDependencyMap.find(ref.dbIndex);
-        if(it == mDependencyMap.end())
-        {
-            throw Exception("Database has no dependency with given index");
-        }
+	Sequence *Database::findSequenceByRef(const AssetRef &ref)
+	{
+		return _findAssetByRef<Sequence>(ref);
+	}
 
-        return it->second.get().getSound(ref.assetId);
-    }
+	Animation *Database::findAnimationByRef(const AssetRef &ref)
+	{
+		return _findAssetByRef<Animation>(ref);
+	}
 
+	Sound *Database::findSoundByRef(const AssetRef &ref)
+	{
+		return _findAssetByRef<Sound>(ref);
+	}
 
 	Texture *Database::getTexture(RecordId recordId)
 	{
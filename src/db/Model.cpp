@@ -9,6 +9,8 @@
 
 #include <algorithm>
 #include <limits>
+#include <sstream>
+#include <fstream>
 #include <osg/Geometry>
 #include <osg/LOD>
 #include <osg/FrontFace>
@@ -19,6 +21,8 @@
 #include "db/ModelFactory.h"
 #include "db/Texture.h"
 #include "db/Skeleton.h"
+#include "MeshSimplifier.h"
+#include "Logger.h"
 
 #define OD_POLYGON_FLAG_DOUBLESIDED 0x02
 
@@ -36,6 +40,8 @@ namespace od
 	, mVerticesLoaded(false)
 	, mTexturesLoaded(false)
 	, mPolygonsLoaded(false)
+	, mAutoLodDistance(0)
+	, mCompactVertexFormat(false)
 	{
 	}
 
@@ -435,6 +441,7 @@ namespace od
 				GeodeBuilder gb(it->lodName, this->getAssetProvider());
 				gb.setBuildSmoothNormals(mShadingType != ModelShadingType::Flat);
 				gb.setClampTextures(false);
+				gb.setCompactVertexFormat(mCompactVertexFormat);
 
 				// the count fields in the mesh info sometimes do not cover all vertices and polygons. gotta be something with those "LOD caps"
 				//  instead of using those values, use all vertices up until the next lod until we figure out how else to handle this
@@ -463,6 +470,14 @@ namespace od
 				lodNode->addChild(newGeode, minDistance, maxDistance);
 			}
 
+			// a single authored LOD is just the full detail mesh
+			if(mLodMeshInfos.size() == 1)
+			{
+			    LodMeshInfo &info = mLodMeshInfos.front();
+			    _addGeneratedLods(lodNode, mVertices.begin() + info.firstVertexIndex, mVertices.end(),
+			            mPolygons.begin() + info.firstPolygonIndex, mPolygons.end(), &info.boneAffections);
+			}
+
 			this->addChild(lodNode);
 
 		}else
@@ -470,6 +485,7 @@ namespace od
 			GeodeBuilder gb(mModelName, this->getAssetProvider());
 			gb.setBuildSmoothNormals(mShadingType != ModelShadingType::Flat);
 			gb.setClampTextures(false);
+			gb.setCompactVertexFormat(mCompactVertexFormat);
 			gb.setVertexVector(mVertices.begin(), mVertices.end());
 			gb.setPolygonVector(mPolygons.begin(), mPolygons.end());
 
@@ -478,11 +494,201 @@ namespace od
 
 			mCalculatedBoundingBox.expandBy(newGeode->getBoundingBox());
 
-			this->addChild(newGeode);
+			osg::ref_ptr<osg::LOD> lodNode(new osg::LOD);
+			lodNode->setRangeMode(osg::LOD::DISTANCE_FROM_EYE_POINT);
+			lodNode->setCenterMode(osg::LOD::USE_BOUNDING_SPHERE_CENTER);
+			lodNode->addChild(newGeode, 0, std::numeric_limits<float>::max());
+			if(_addGeneratedLods(lodNode, mVertices.begin(), mVertices.end(), mPolygons.begin(), mPolygons.end(), nullptr))
+			{
+			    this->addChild(lodNode);
+
+			}else
+			{
+			    lodNode->removeChildren(0, lodNode->getNumChildren());
+			    this->addChild(newGeode);
+			}
 		}
 
         // model faces are oriented CW for some reason
         this->getOrCreateStateSet()->setAttribute(new osg::FrontFace(osg::FrontFace::CLOCKWISE), osg::StateAttribute::ON);
 	}
-}
 
+	CpuSkinner::Mesh *Model::getCpuSkinningMesh()
+	{
+	    if(mCpuSkinningMesh == nullptr)
+	    {
+	        if(this->getNumChildren() == 0)
+	        {
+	            throw Exception("Must build geometry before extracting CPU skinning mesh");
+	        }
+
+	        mCpuSkinningMesh = new CpuSkinner::Mesh(this);
+	    }
+
+	    return mCpuSkinningMesh;
+	}
+
+	bool Model::_addGeneratedLods(osg::LOD *lodNode, std::vector<osg::Vec3f>::iterator verticesBegin, std::vector<osg::Vec3f>::iterator verticesEnd,
+	        std::vector<Polygon>::iterator polygonsBegin, std::vector<Polygon>::iterator polygonsEnd, std::vector<BoneAffection> *boneAffections)
+	{
+	    if(mAutoLodDistance <= 0 || lodNode->getNumChildren() != 1)
+	    {
+	        return false;
+	    }
+
+	    MeshSimplifier simplifier(mModelName);
+	    simplifier.setVertexVector(verticesBegin, verticesEnd);
+	    simplifier.setPolygonVector(polygonsBegin, polygonsEnd);
+	    if(boneAffections != nullptr)
+	    {
+	        simplifier.setBoneAffectionVector(boneAffections->begin(), boneAffections->end());
+	    }
+
+	    size_t originalCount = simplifier.getOriginalTriangleCount();
+	    if(originalCount < OD_MODEL_AUTO_LOD_MIN_TRIANGLES)
+	    {
+	        return false;
+	    }
+
+	    float radius = lodNode->getChild(0)->getBound().radius();
+	    float distance = std::max(mAutoLodDistance*radius, lodNode->getMinRange(0));
+	    size_t lastCount = originalCount;
+	    size_t generatedCount = 0;
+	    for(size_t level = 1; level <= OD_MODEL_AUTO_LOD_COUNT; ++level)
+	    {
+	        simplifier.simplify(originalCount >> level);
+
+	        // borders and seams can't be simplified. if that's most of the model, another level isn't worth it
+	        size_t count = simplifier.getTriangleCount();
+	        if(count > lastCount*OD_MODEL_AUTO_LOD_MIN_REDUCTION)
+	        {
+	            break;
+	        }
+	        lastCount = count;
+
+	        std::vector<osg::Vec3f> vertices;
+	        std::vector<Polygon> polygons;
+	        std::vector<BoneAffection> bones;
+	        simplifier.getResult(vertices, polygons, bones);
+
+	        std::ostringstream lodName;
+	        lodName << mModelName << " generated LOD " << level;
+
+	        GeodeBuilder gb(lodName.str(), this->getAssetProvider());
+	        gb.setBuildSmoothNormals(mShadingType != ModelShadingType::Flat);
+	        gb.setClampTextures(false);
+	        gb.setCompactVertexFormat(mCompactVertexFormat);
+	        gb.setVertexVector(vertices.begin(), vertices.end());
+	        gb.setPolygonVector(polygons.begin(), polygons.end());
+	        if(boneAffections != nullptr)
+	        {
+	            gb.setBoneAffectionVector(bones.begin(), bones.end());
+	        }
+
+	        osg::ref_ptr<osg::Geode> newGeode(new osg::Geode);
+	        gb.build(newGeode);
+
+	        // the previous level now ends where this one starts
+	        size_t previous = lodNode->getNumChildren() - 1;
+	        lodNode->setRange(previous, lodNode->getMinRange(previous), distance);
+	        lodNode->addChild(newGeode, distance, std::numeric_limits<float>::max());
+
+	        Logger::verbose() << "Generated LOD " << level << " for model '" << mModelName << "': " << originalCount << " -> " << count
+	                << " triangles (" << (100*count/originalCount) << "%), error " << simplifier.getError() << ", used beyond " << distance;
+
+	        ++generatedCount;
+	        distance *= 2;
+	    }
+
+	    return generatedCount > 0;
+	}
+
+	void Model::exportToObj(const FilePath &path)
+	{
+		if(!mTexturesLoaded || !mVerticesLoaded || !mPolygonsLoaded)
+		{
+			throw Exception("Must load at least vertices, textures and polygons before exporting");
+		}
+
+		Logger::verbose() << "Exporting model '" << mModelName << "' with " << mVertices.size() << " vertices and "
+				<< mPolygons.size() << " polygons to file '" << path.str() << "'";
+
+		std::ofstream out(path.str());
+		if(out.fail())
+		{
+			throw IoException("Could not open output file '" + path.str() + "'");
+		}
+
+		out << "# " << mModelName << std::endl;
+
+		for(auto it = mVertices.begin(); it != mVertices.end(); ++it)
+		{
+			out << "v " << it->x() << " " << it->y() << " " << it->z() << std::endl;
+		}
+
+		// UVs are stored per polygon corner, so every corner gets it's own texture coordinate
+		for(auto it = mPolygons.begin(); it != mPolygons.end(); ++it)
+		{
+			for(size_t i = 0; i < it->vertexCount; ++i)
+			{
+				out << "vt " << it->uvCoords[i].x() << " " << it->uvCoords[i].y() << std::endl;
+			}
+		}
+
+		// models without LOD info are written as a single LOD covering everything
+		std::vector<LodMeshInfo> lods(mLodMeshInfos);
+		if(lods.empty())
+		{
+			LodMeshInfo info;
+			info.lodName = mModelName;
+			info.firstVertexIndex = 0;
+			info.firstPolygonIndex = 0;
+			lods.push_back(info);
+		}
+
+		size_t uvIndex = 1;
+		for(auto it = lods.begin(); it != lods.end(); ++it)
+		{
+			// same ranges as in buildGeometry(). polygon vertex indices are relative to the LOD's first vertex
+			size_t polyEnd = (it+1 == lods.end()) ? mPolygons.size() : (it+1)->firstPolygonIndex;
+
+			out << "o " << it->lodName << std::endl;
+
+			AssetRef currentTexture = AssetRef::NULL_REF;
+			for(size_t p = it->firstPolygonIndex; p < polyEnd; ++p)
+			{
+				const Polygon &poly = mPolygons[p];
+				if(p == it->firstPolygonIndex || poly.texture != currentTexture)
+				{
+					out << "usemtl texture_" << std::hex << poly.texture.dbIndex << "_" << poly.texture.assetId << std::dec << std::endl;
+					currentTexture = poly.texture;
+				}
+
+				out << "f";
+				for(size_t i = 0; i < poly.vertexCount; ++i)
+				{
+					out << " " << (it->firstVertexIndex + poly.vertexIndices[i] + 1) << "/" << (uvIndex + i);
+				}
+				out << std::endl;
+
+				if(poly.doubleSided)
+				{
+					out << "f";
+					for(size_t i = poly.vertexCount; i > 0; --i)
+					{
+						out << " " << (it->firstVertexIndex + poly.vertexIndices[i-1] + 1) << "/" << (uvIndex + i - 1);
+					}
+					out << std::endl;
+				}
+
+				uvIndex += poly.vertexCount;
+			}
+		}
+
+		if(out.fail())
+		{
+			throw IoException("Error while writing model to '" + path.str() + "'");
+		}
+	}
+
+}
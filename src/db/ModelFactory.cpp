@@ -9,16 +9,18 @@
 
 #include "Exception.h"
 #include "SrscRecordTypes.h"
+#include "Engine.h"
 
 namespace od
 {
 
-	ModelFactory::ModelFactory(AssetProvider &ap, SrscFile &modelContainer)
+	ModelFactory::ModelFactory(AssetProvider &ap, SrscFile &modelContainer, Engine &engine)
 	: AssetFactory<Model>(ap, modelContainer)
+	, mEngine(engine)
 	{
 	}
 
-	osg::ref_ptr<Model> ModelFactory::loadAsset(RecordId id)
+	osg::ref_ptr<Model> ModelFactory::loadModelRecords(RecordId id)
 	{
 		SrscFile::DirIterator nameRecord = getSrscFile().getDirIteratorByTypeId(SrscRecordType::MODEL_NAME, id);
 		if(nameRecord == getSrscFile().getDirectoryEnd())
@@ -52,6 +54,19 @@ namespace od
 			model->loadBoundingData(*this, DataReader(getSrscFile().getStreamForRecord(boundingRecord)));
 		}
 
+		return model;
+	}
+
+	osg::ref_ptr<Model> ModelFactory::loadAsset(RecordId id)
+	{
+		osg::ref_ptr<Model> model = loadModelRecords(id);
+		if(model == nullptr)
+		{
+			return nullptr;
+		}
+
+		model->setAutoLodDistance(mEngine.getModelAutoLodDistance());
+		model->setCompactVertexFormat(mEngine.getCompactVertexFormat());
 		model->buildGeometry();
 
 		return model;
@@ -15,7 +15,6 @@
 #include <osg/Depth>
 
 #include "Exception.h"
-#include "OdDefines.h"
 
 namespace od
 {
@@ -119,11 +118,6 @@ namespace od
 
 	void SkeletonBuilder::addJointInfo(osg::Matrixf &boneXform, int32_t meshIndex, int32_t firstChildIndex, int32_t nextSiblingIndex)
 	{
-		if(mJointInfos.size() >= OD_MAX_BONE_COUNT)
-		{
-			throw Exception("Can't add more bones. Maximum bone count reached");
-		}
-
 		SkeletonJointInfo jointInfo;
 		jointInfo.boneXform = boneXform;
 		jointInfo.meshIndex = meshIndex;
@@ -7,11 +7,166 @@
 
 #include "db/Sound.h"
 
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+
 #include "Exception.h"
+#include "Logger.h"
+#include "db/SoundFactory.h"
+
+// big enough to keep seeks on the shared container stream rare, small enough to not matter memory-wise
+#define OD_SOUND_CHUNK_SIZE (64*1024)
 
 namespace od
 {
 
+    PcmBuffer::PcmBuffer()
+    {
+    }
+
+    PcmBuffer::PcmBuffer(std::vector<int16_t> &&samples)
+    : mSamples(std::move(samples))
+    {
+    }
+
+
+    SoundStream::SoundStream(Sound &sound)
+    : mSound(&sound)
+    , mInputOffset(0)
+    , mInputLeft(0)
+    , mSamplesLeft(0)
+    , mZStreamActive(false)
+    {
+        mZStream.zalloc = Z_NULL;
+        mZStream.zfree = Z_NULL;
+        mZStream.opaque = Z_NULL;
+
+        rewind();
+    }
+
+    SoundStream::~SoundStream()
+    {
+        if(mZStreamActive)
+        {
+            inflateEnd(&mZStream);
+        }
+    }
+
+    size_t SoundStream::read(int16_t *out, size_t maxSamples)
+    {
+        size_t bytesPerSample = mSound->mBits/8;
+        size_t samplesRequested = std::min(maxSamples, mSamplesLeft);
+
+        mByteBuffer.resize(samplesRequested*bytesPerSample);
+        size_t bytesRead = _readBytes(mByteBuffer.data(), mByteBuffer.size());
+
+        // a truncated record might end mid-sample. just drop the partial sample
+        size_t sampleCount = bytesRead/bytesPerSample;
+        mSamplesLeft = (sampleCount < samplesRequested) ? 0 : mSamplesLeft - sampleCount;
+
+        const uint8_t *in = mByteBuffer.data();
+        if(bytesPerSample == 1)
+        {
+            // convert from biased unsigned 8 bit to signed 16 bit. plain loop so the compiler can vectorize it
+            for(size_t i = 0; i < sampleCount; ++i)
+            {
+                out[i] = static_cast<int16_t>((in[i] << 8) - (1 << 15));
+            }
+
+        }else
+        {
+            // data is little endian, as is every platform we run on
+            std::memcpy(out, in, sampleCount*sizeof(int16_t));
+        }
+
+        return sampleCount;
+    }
+
+    void SoundStream::rewind()
+    {
+        mInputOffset = mSound->mDataOffset;
+        mInputLeft = mSound->isCompressed() ? mSound->mCompressedSize : mSound->mDecompressedSize;
+        mSamplesLeft = mSound->getSampleCount();
+
+        if(mSound->isCompressed())
+        {
+            if(mZStreamActive)
+            {
+                inflateEnd(&mZStream);
+                mZStreamActive = false;
+            }
+
+            mZStream.next_in = Z_NULL;
+            mZStream.avail_in = 0;
+            int ret = inflateInit(&mZStream);
+            if(ret != Z_OK)
+            {
+                throw Exception("Could not initialize zlib stream for sound");
+            }
+            mZStreamActive = true;
+
+            mInputBuffer.resize(OD_SOUND_CHUNK_SIZE);
+        }
+    }
+
+    size_t SoundStream::_readBytes(uint8_t *out, size_t maxBytes)
+    {
+        if(!mSound->isCompressed())
+        {
+            return _readInput(out, maxBytes);
+        }
+
+        mZStream.next_out = out;
+        mZStream.avail_out = maxBytes;
+        while(mZStream.avail_out > 0)
+        {
+            if(mZStream.avail_in == 0)
+            {
+                mZStream.avail_in = _readInput(mInputBuffer.data(), mInputBuffer.size());
+                mZStream.next_in = mInputBuffer.data();
+            }
+
+            int ret = inflate(&mZStream, Z_NO_FLUSH);
+            if(ret == Z_STREAM_END)
+            {
+                break;
+
+            }else if(ret == Z_BUF_ERROR && mZStream.avail_in == 0)
+            {
+                Logger::warn() << "Compressed data of sound '" << mSound->mSoundName << "' ended prematurely";
+                break;
+
+            }else if(ret != Z_OK)
+            {
+                throw IoException("Error while inflating sound data");
+            }
+        }
+
+        return maxBytes - mZStream.avail_out;
+    }
+
+    size_t SoundStream::_readInput(uint8_t *out, size_t maxBytes)
+    {
+        size_t toRead = std::min(maxBytes, mInputLeft);
+        if(toRead == 0)
+        {
+            return 0;
+        }
+
+        std::istream &in = mSound->mContainer->getStreamForRecord(mSound->mDirEntry);
+        in.clear();
+        in.seekg(mInputOffset);
+        in.read(reinterpret_cast<char*>(out), toRead);
+        size_t bytesRead = in.gcount();
+
+        mInputOffset += bytesRead;
+        mInputLeft = (bytesRead < toRead) ? 0 : mInputLeft - bytesRead;
+
+        return bytesRead;
+    }
+
+
 	Sound::Sound(AssetProvider &ap, RecordId id)
 	: Asset(ap, id)
 	, mSoundName("")
@@ -25,11 +180,17 @@ namespace od
 	, mDecompressedSize(0)
 	, mCompressionLevel(0)
 	, mCompressedSize(0)
+	, mContainer(nullptr)
+	, mDataOffset(0)
     {
     }
 
-    void Sound::loadFromRecord(DataReader &dr)
+    void Sound::loadFromRecord(SoundFactory &factory, const SrscFile::DirEntry &dirEntry)
     {
+        mContainer = &factory.getSrscFile();
+        mDirEntry = dirEntry;
+
+        DataReader dr(mContainer->getStreamForRecord(dirEntry));
         dr  >> mSoundName
 			>> mFlags
 			>> mChannels
@@ -52,28 +213,102 @@ namespace od
         	throw UnsupportedException("Only mono supported right now");
         }
 
-        mPcmBuffer.resize(mDecompressedSize);
+        // PCM data is decoded on demand. remember where it is for later
+        mDataOffset = dr.tell();
+    }
 
-        if(mCompressionLevel != 0)
+    osg::ref_ptr<PcmBuffer> Sound::getPcmBuffer()
+    {
+        osg::ref_ptr<PcmBuffer> buffer;
+        if(mPcmBuffer.lock(buffer))
         {
-        	throw Exception("Can't load compressed sounds right now");
+            return buffer;
         }
 
-        for(size_t i = 0; i < mDecompressedSize; ++i)
+        if(isStreamed())
         {
-        	if(mBits == 8)
-        	{
-        		uint8_t ateBit;
-        		dr >> ateBit;
+            Logger::debug() << "Fully decoding sound '" << mSoundName << "' which should be streamed";
+        }
 
-        		mPcmBuffer[i] = (ateBit << 8) - (1 << 15); // convert from biased unsigned 8 bit to signed 16 bit
+        buffer = new PcmBuffer;
+        buffer->mSamples.resize(getSampleCount());
 
-        	}else if(mBits == 16)
-        	{
-        		dr >> mPcmBuffer[i];
-        	}
-        }
+        SoundStream stream(*this);
+        size_t samplesRead = stream.read(buffer->mSamples.data(), buffer->mSamples.size());
+        buffer->mSamples.resize(samplesRead);
+
+        mPcmBuffer = buffer;
+
+        return buffer;
+    }
+
+    std::unique_ptr<SoundStream> Sound::openStream()
+    {
+        return std::unique_ptr<SoundStream>(new SoundStream(*this));
     }
-}
 
+    template <typename T>
+    static void _writeLittleEndian(std::ostream &out, T value)
+    {
+        // every platform we run on is little endian
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void Sound::exportToWav(const FilePath &path)
+    {
+        Logger::verbose() << "Exporting sound '" << mSoundName << "' with " << getSampleCount() << " samples to file '" << path.str() << "'";
+
+        std::ofstream out(path.str(), std::ios::out | std::ios::binary);
+        if(out.fail())
+        {
+            throw IoException("Could not open output file '" + path.str() + "'");
+        }
+
+        // we always decode to signed 16 bit, regardless of what is stored in the container
+        uint32_t dataSize = getSampleCount()*sizeof(int16_t);
+        uint16_t blockAlign = mChannels*sizeof(int16_t);
+
+        out.write("RIFF", 4);
+        _writeLittleEndian<uint32_t>(out, 36 + dataSize);
+        out.write("WAVE", 4);
 
+        out.write("fmt ", 4);
+        _writeLittleEndian<uint32_t>(out, 16);
+        _writeLittleEndian<uint16_t>(out, 1); // PCM
+        _writeLittleEndian<uint16_t>(out, mChannels);
+        _writeLittleEndian<uint32_t>(out, mFrequency);
+        _writeLittleEndian<uint32_t>(out, mFrequency*blockAlign);
+        _writeLittleEndian<uint16_t>(out, blockAlign);
+        _writeLittleEndian<uint16_t>(out, 16);
+
+        out.write("data", 4);
+        _writeLittleEndian<uint32_t>(out, dataSize);
+
+        SoundStream stream(*this);
+        std::vector<int16_t> samples(OD_SOUND_CHUNK_SIZE/sizeof(int16_t));
+        uint32_t bytesWritten = 0;
+        while(!stream.isAtEnd())
+        {
+            size_t sampleCount = stream.read(samples.data(), samples.size());
+            out.write(reinterpret_cast<const char*>(samples.data()), sampleCount*sizeof(int16_t));
+            bytesWritten += sampleCount*sizeof(int16_t);
+        }
+
+        if(bytesWritten != dataSize)
+        {
+            // truncated record. patch sizes in header so players don't read past the end
+            Logger::warn() << "Sound '" << mSoundName << "' has less data than stated in it's header";
+
+            out.seekp(4);
+            _writeLittleEndian<uint32_t>(out, 36 + bytesWritten);
+            out.seekp(40);
+            _writeLittleEndian<uint32_t>(out, bytesWritten);
+        }
+
+        if(out.fail())
+        {
+            throw IoException("Error while writing sound to '" + path.str() + "'");
+        }
+    }
+
+}
@@ -26,8 +26,7 @@ namespace od
         }
 
         osg::ref_ptr<Sound> sound(new Sound(getAssetProvider(), soundId));
-        DataReader dr(getSrscFile().getStreamForRecord(dirIt));
-        sound->loadFromRecord(dr);
+        sound->loadFromRecord(*this, *dirIt);
 
         return sound;
     }
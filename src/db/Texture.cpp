@@ -8,6 +8,7 @@
 #include "db/Texture.h"
 
 #include <functional>
+#include <osg/AlphaFunc>
 #include <osgDB/WriteFile>
 #include <osgDB/ReadFile>
 
@@ -29,6 +30,9 @@
 
 #define OD_TEX_OPAQUE_ALPHA 			0xff
 
+// cutout textures only contain 0 and 255, so any reference value in between works. middle is safest with filtering
+#define OD_TEX_ALPHA_TEST_REFERENCE     0.5
+
 namespace od
 {
 
@@ -46,7 +50,7 @@ namespace od
     , mUsageCount(0)
     , mCompressionLevel(0)
     , mCompressedSize(0)
-    , mHasAlphaChannel(false)
+    , mAlphaMode(AlphaMode::Opaque)
     {
 
     }
@@ -97,8 +101,6 @@ namespace od
         uint8_t keyGreen = (mColorKey & 0x00ff00) >> 8;
         uint8_t keyBlue  = (mColorKey & 0x0000ff);
 
-        mHasAlphaChannel = (mAlphaBitsPerPixel != 0) || hasColorKey;
-
         std::unique_ptr<ZStream> zstr;
         if(mCompressionLevel != 0)
         {
@@ -223,7 +225,10 @@ namespace od
         	 throw UnsupportedException("Can only load packed textures right now");
          }
 
-        // translate whatever is stored in texture into 8-bit RGBA format
+        // translate whatever is stored in texture into 8-bit RGBA format. while we're at it, find out what kind of alpha
+        //  values the texture contains, since a color key or an alpha channel alone doesn't mean there are any non-opaque pixels
+        bool hasTransparentPixels = false;
+        bool hasTranslucentPixels = false;
         unsigned char *pixBuffer = new unsigned char[mWidth*mHeight*4]; // no need for RAII, osg takes ownership
         for(size_t i = 0; i < mWidth*mHeight*4; i += 4)
         {
@@ -239,6 +244,9 @@ namespace od
             	alpha = 0;
             }
 
+            hasTransparentPixels |= (alpha == 0);
+            hasTranslucentPixels |= (alpha != 0 && alpha != OD_TEX_OPAQUE_ALPHA);
+
             pixBuffer[i]   = red;
             pixBuffer[i+1] = green;
             pixBuffer[i+2] = blue;
@@ -249,6 +257,19 @@ namespace od
             zstr->seekToEndOfZlib();
         }
 
+        if(hasTranslucentPixels)
+        {
+            mAlphaMode = AlphaMode::Translucent;
+
+        }else if(hasTransparentPixels)
+        {
+            mAlphaMode = AlphaMode::Cutout;
+
+        }else
+        {
+            mAlphaMode = AlphaMode::Opaque;
+        }
+
 
 
         this->setImage(mWidth, mHeight, 1, 4, GL_RGBA, GL_UNSIGNED_BYTE, pixBuffer, osg::Image::USE_NEW_DELETE);
@@ -273,6 +294,26 @@ namespace od
 		osgDB::writeImageFile(*this, path.str());
     }
 
+    void Texture::applyAlphaState(osg::StateSet *ss) const
+    {
+        switch(mAlphaMode)
+        {
+        case AlphaMode::Cutout:
+            // cutout surfaces write depth like opaque ones, so they can stay in the default bin and need no sorting
+            ss->setAttributeAndModes(new osg::AlphaFunc(osg::AlphaFunc::GREATER, OD_TEX_ALPHA_TEST_REFERENCE), osg::StateAttribute::ON);
+            break;
+
+        case AlphaMode::Translucent:
+            ss->setMode(GL_BLEND, osg::StateAttribute::ON);
+            ss->setRenderBinDetails(1, "DepthSortedBin");
+            break;
+
+        case AlphaMode::Opaque:
+        default:
+            break;
+        }
+    }
+
     unsigned char Texture::_filter16BitChannel(uint16_t color, uint16_t mask)
     {
     	// filtering algorithm:
@@ -32,6 +32,7 @@ namespace od
     , mInterfaceDb(engine.getDbManager().loadDb(FilePath(OD_INTERFACE_DB_PATH, engine.getEngineRootDir()).adjustCase()))
     , mMenuMode(false)
     {
+        _loadStrings();
         _setupGui();
 
         mWidgetIntersectVisitor = new WidgetIntersectVisitor(mWidgetToScreenSpaceXform, mScreenToWidgetSpaceXform);
@@ -148,39 +149,62 @@ namespace od
         mCursorWidget->setPosition(osg::Vec2(posWs.x(), posWs.y()));
     }
 
-    std::string GuiManager::localizeString(const std::string &s)
+    /**
+     * Parses a single hex digit. Returns -1 if \c c is not one.
+     */
+    static inline int _parseHexDigit(char c)
     {
-        if(s.size() < 8 || s[0] != '<' || s[1] != '0' || s[2] != 'x' || s[7] != '>') // probably still the fastest method
+        if(c >= '0' && c <= '9')
         {
-            return s;
+            return c - '0';
+
+        }else if(c >= 'a' && c <= 'f')
+        {
+            return c - 'a' + 10;
+
+        }else if(c >= 'A' && c <= 'F')
+        {
+            return c - 'A' + 10;
         }
 
-        RecordId stringId;
-        std::istringstream iss(s.substr(3, 4));
-        iss >> std::hex >> stringId;
-        if(iss.fail())
+        return -1;
+    }
+
+    const std::string &GuiManager::localizeString(const std::string &s)
+    {
+        if(s.size() < 8 || s[0] != '<' || s[1] != '0' || s[2] != 'x' || s[7] != '>') // probably still the fastest method
         {
             return s;
         }
 
-        Logger::debug() << "Localized string " << std::hex << stringId << " requested from RRC";
-
-        try
+        RecordId stringId = 0;
+        for(size_t i = 3; i < 7; ++i)
         {
-            return getStringById(stringId);
+            int digit = _parseHexDigit(s[i]);
+            if(digit < 0)
+            {
+                return s;
+            }
+
+            stringId = (stringId << 4) | digit;
+        }
 
-        }catch(NotFoundException &e)
+        const std::string *localized = findStringById(stringId);
+        if(localized != nullptr)
         {
+            return *localized;
         }
 
-        // string not found. return unlocalized one
-        return s.substr(8, std::string::npos);
+        // string not found. return unlocalized one. this is rare, so we don't mind allocating here
+        Logger::debug() << "Localized string " << std::hex << stringId << std::dec << " not found in RRC";
+
+        return *mUnlocalizedStrings.insert(s.substr(8, std::string::npos)).first;
     }
 
-    std::string GuiManager::getStringById(RecordId stringId)
+    const std::string &GuiManager::getStringById(RecordId stringId)
     {
-        auto dirIt = mRrcFile.getDirIteratorByTypeId(SrscRecordType::LOCALIZED_STRING, stringId);
-        if(dirIt == mRrcFile.getDirectoryEnd())
+        const std::string *str = findStringById(stringId);
+        if(str == nullptr)
         {
             std::ostringstream oss;
             oss << "String with ID 0x" << std::hex << stringId << std::dec << " not found";
@@ -188,22 +212,29 @@ namespace od
             throw NotFoundException(oss.str());
         }
 
-        if(dirIt->dataSize > 255)
+        return *str;
+    }
+
+    bool GuiManager::findStringById(RecordId stringId, std::string &str)
+    {
+        const std::string *found = findStringById(stringId);
+        if(found == nullptr)
         {
-            throw Exception("String buffer too small");
+            return false;
         }
 
-        std::istream &in = mRrcFile.getStreamForRecord(dirIt);
-
-        char str[256] = {0}; // should be big enough. might alloc it dynamically but can't be bothered right now
-        in.read(str, dirIt->dataSize);
-        size_t readBytes = in.gcount();
-
-        _decryptString(str, readBytes);
+        str = *found;
+        return true;
+    }
 
-        // TODO: Transcode from Latin-1 or what you got to UTF-8
+    const std::string *GuiManager::findStringById(RecordId stringId)
+    {
+        if(stringId >= mStringIndex.size() || mStringIndex[stringId] < 0)
+        {
+            return nullptr;
+        }
 
-        return std::string(str);
+        return &mStrings[mStringIndex[stringId]];
     }
 
     void GuiManager::dumpStrings()
@@ -216,59 +247,25 @@ namespace od
 
         out << "Strings found in Dragon.rrc:" << std::endl << std::endl;
 
-        auto dirIt = mRrcFile.getDirIteratorByType(SrscRecordType::LOCALIZED_STRING);
-        while(dirIt != mRrcFile.getDirectoryEnd())
-        {
-            std::istream &in = mRrcFile.getStreamForRecord(dirIt);
-
-            if(dirIt->dataSize > 255)
-            {
-                Logger::warn() << "String 0x" << dirIt->recordId << " too long for buffer. Skipping";
-
-            }else
-            {
-                char str[256] = {0};
-                in.read(str, dirIt->dataSize);
-                size_t readBytes = in.gcount();
-                _decryptString(str, readBytes);
-
-                out << "STR " << std::hex << std::setw(4) << dirIt->recordId << std::dec << ": " << str << std::endl;
-            }
-
-            dirIt = mRrcFile.getDirIteratorByType(SrscRecordType::LOCALIZED_STRING, dirIt+1);
-        }
-    }
-
-    void GuiManager::dumpTextures()
-    {
-        auto dirIt = mRrcFile.getDirIteratorByType(SrscRecordType::TEXTURE);
-        while(dirIt != mRrcFile.getDirectoryEnd())
+        for(size_t id = 0; id < mStringIndex.size(); ++id)
         {
-            std::ostringstream oss;
-            oss << "out/gui_tex_" << std::hex << dirIt->recordId << ".png";
-
-            try
+            if(mStringIndex[id] >= 0)
             {
-                osg::ref_ptr<Texture> tex = getTexture(dirIt->recordId);
-                tex->exportToPng(FilePath(oss.str()));
-
-            }catch(UnsupportedException &e)
-            {
-                Logger::warn() << "Can't dump texture " << oss.str() << " (" << e.what() << ")";
+                out << "STR " << std::hex << std::setw(4) << id << std::dec << ": " << mStrings[mStringIndex[id]] << std::endl;
             }
-
-            dirIt = mRrcFile.getDirIteratorByType(SrscRecordType::TEXTURE, dirIt+1);
         }
     }
 
-    Texture *GuiManager::getTextureByRef(const AssetRef &ref)
+    Texture *GuiManager::findTextureByRef(const AssetRef &ref)
     {
         if(ref.dbIndex != 0)
         {
             throw Exception("Tried to use GUI Manager to load texture from outside RRC");
         }
 
-        return getTexture(ref.assetId);
+        osg::ref_ptr<Texture> tex = mTextureFactory.findAsset(ref.assetId);
+
+        return tex.release();
     }
 
     Texture *GuiManager::getTexture(RecordId recordId)
@@ -289,6 +286,46 @@ namespace od
         }
     }
 
+    void GuiManager::_loadStrings()
+    {
+        RecordId maxId = 0;
+        size_t stringCount = 0;
+        for(const SrscFile::DirEntry &entry : mRrcFile.getDirectory())
+        {
+            if(entry.type == static_cast<RecordType>(SrscRecordType::LOCALIZED_STRING))
+            {
+                maxId = std::max(maxId, entry.recordId);
+                ++stringCount;
+            }
+        }
+
+        mStrings.clear();
+        mStrings.reserve(stringCount);
+        mStringIndex.assign(stringCount > 0 ? maxId + 1 : 0, -1);
+
+        std::vector<char> buffer;
+        for(const SrscFile::DirEntry &entry : mRrcFile.getDirectory())
+        {
+            if(entry.type != static_cast<RecordType>(SrscRecordType::LOCALIZED_STRING) || mStringIndex[entry.recordId] >= 0)
+            {
+                continue;
+            }
+
+            mRrcFile.readRecordData(entry, buffer);
+            _decryptString(buffer.data(), buffer.size());
+
+            // TODO: Transcode from Latin-1 or what you got to UTF-8
+
+            // strings are null-terminated within the record
+            auto end = std::find(buffer.begin(), buffer.end(), '\0');
+
+            mStringIndex[entry.recordId] = mStrings.size();
+            mStrings.emplace_back(buffer.begin(), end);
+        }
+
+        Logger::verbose() << "Loaded " << mStrings.size() << " localized strings from RRC";
+    }
+
     void GuiManager::_setupGui()
     {
         if(mViewer == nullptr)
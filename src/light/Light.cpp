@@ -16,8 +16,15 @@ namespace od
     : mLevelObject(obj)
     , mIntensity(1.0)
     , mRadius(1.0)
+    , mDynamic(false)
+    , mDirty(true)
+    , mSlot(-1)
     {
     }
 
-}
+    osg::Vec3f Light::getPosition() const
+    {
+        return mLevelObject->getPosition();
+    }
 
+}
@@ -0,0 +1,253 @@
+/*
+ * LightBaker.cpp
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#include "light/LightBaker.h"
+
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <osg/Timer>
+
+#include "Exception.h"
+
+// small enough to balance uneven light distribution across threads, big enough to keep the atomic out of the profile
+#define OD_BAKE_CHUNK_SIZE 1024
+
+// occlusion rays start a bit off the surface so they don't hit the triangle they start on
+#define OD_BAKE_SURFACE_OFFSET 0.01f
+
+namespace od
+{
+
+    LightBaker::LightBaker()
+    : mThreadCount(1)
+    , mAmbientColor(0.0, 0.0, 0.0, 1.0)
+    , mLightDirection(0.0, 1.0, 0.0)
+    , mLightColor(0.0, 0.0, 0.0, 1.0)
+    , mHasDropoff(false)
+    {
+        resetStats();
+    }
+
+    void LightBaker::setThreadCount(size_t threadCount)
+    {
+        if(threadCount == 0)
+        {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        mThreadCount = threadCount;
+    }
+
+    void LightBaker::setDirectionalLight(const osg::Vec3f &direction, const osg::Vec4 &color)
+    {
+        mLightDirection = direction;
+        mLightDirection.normalize();
+        mLightColor = color;
+    }
+
+    void LightBaker::setDirectionalDropoff(const osg::Vec3f &start, const osg::Vec3f &end)
+    {
+        osg::Vec3f axis = end - start;
+        float lengthSq = axis.length2();
+        if(lengthSq <= 0)
+        {
+            clearDirectionalDropoff();
+            return;
+        }
+
+        mHasDropoff = true;
+        mDropoffStart = start;
+        mDropoffAxis = axis/lengthSq;
+    }
+
+    void LightBaker::clearDirectionalDropoff()
+    {
+        mHasDropoff = false;
+    }
+
+    void LightBaker::addPointLight(const PointLight &light)
+    {
+        mPointLights.push_back(light);
+    }
+
+    void LightBaker::clearPointLights()
+    {
+        mPointLights.clear();
+    }
+
+    void LightBaker::bake(const osg::Vec3Array &vertices, const osg::Vec3Array &normals, const osg::Vec3f &offset, osg::Vec4Array &colors)
+    {
+        if(normals.size() != vertices.size())
+        {
+            throw InvalidArgumentException("Need exactly one normal per vertex for baking");
+        }
+
+        osg::Timer_t startTime = osg::Timer::instance()->tick();
+
+        colors.resize(vertices.size());
+        if(vertices.empty())
+        {
+            return;
+        }
+
+        // only consider lights reaching the bounding box of the vertices. most lights only touch one or two layers
+        osg::Vec3f boxMin = vertices[0];
+        osg::Vec3f boxMax = vertices[0];
+        for(size_t i = 1; i < vertices.size(); ++i)
+        {
+            for(size_t axis = 0; axis < 3; ++axis)
+            {
+                boxMin[axis] = std::min(boxMin[axis], vertices[i][axis]);
+                boxMax[axis] = std::max(boxMax[axis], vertices[i][axis]);
+            }
+        }
+        boxMin += offset;
+        boxMax += offset;
+
+        std::vector<const PointLight*> lights;
+        for(auto it = mPointLights.begin(); it != mPointLights.end(); ++it)
+        {
+            float distSq = 0;
+            for(size_t axis = 0; axis < 3; ++axis)
+            {
+                float d = std::max(boxMin[axis] - it->position[axis], std::max(0.0f, it->position[axis] - boxMax[axis]));
+                distSq += d*d;
+            }
+
+            if(distSq <= it->radius*it->radius)
+            {
+                lights.push_back(&(*it));
+            }
+        }
+
+        size_t chunkCount = (vertices.size() + OD_BAKE_CHUNK_SIZE - 1)/OD_BAKE_CHUNK_SIZE;
+        size_t threadCount = std::max<size_t>(1, std::min(mThreadCount, chunkCount));
+
+        std::atomic<size_t> nextChunk(0);
+        std::vector<Stats> threadStats(threadCount);
+        auto worker = [&](size_t threadIndex)
+        {
+            Stats &stats = threadStats[threadIndex];
+            stats.vertexCount = 0;
+            stats.lightTests = 0;
+            stats.occlusionTests = 0;
+            stats.occludedCount = 0;
+
+            // every thread gets it's own test so they don't need to be synchronized
+            OcclusionTest occlusionTest;
+            if(mOcclusionTestFactory)
+            {
+                occlusionTest = mOcclusionTestFactory();
+            }
+
+            size_t chunk;
+            while((chunk = nextChunk.fetch_add(1)) < chunkCount)
+            {
+                size_t begin = chunk*OD_BAKE_CHUNK_SIZE;
+                size_t end = std::min(begin + OD_BAKE_CHUNK_SIZE, vertices.size());
+                _bakeRange(vertices, normals, offset, lights, occlusionTest, begin, end, colors, stats);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for(size_t i = 1; i < threadCount; ++i)
+        {
+            threads.emplace_back(worker, i);
+        }
+        worker(0);
+
+        for(std::thread &t : threads)
+        {
+            t.join();
+        }
+
+        for(auto it = threadStats.begin(); it != threadStats.end(); ++it)
+        {
+            mStats.vertexCount += it->vertexCount;
+            mStats.lightTests += it->lightTests;
+            mStats.occlusionTests += it->occlusionTests;
+            mStats.occludedCount += it->occludedCount;
+        }
+        mStats.seconds += osg::Timer::instance()->delta_s(startTime, osg::Timer::instance()->tick());
+    }
+
+    void LightBaker::resetStats()
+    {
+        mStats.vertexCount = 0;
+        mStats.lightTests = 0;
+        mStats.occlusionTests = 0;
+        mStats.occludedCount = 0;
+        mStats.seconds = 0;
+    }
+
+    void LightBaker::_bakeRange(const osg::Vec3Array &vertices, const osg::Vec3Array &normals, const osg::Vec3f &offset,
+            const std::vector<const PointLight*> &lights, const OcclusionTest &occlusionTest, size_t begin, size_t end,
+            osg::Vec4Array &colors, Stats &stats)
+    {
+        for(size_t i = begin; i < end; ++i)
+        {
+            osg::Vec3f position = vertices[i] + offset;
+            const osg::Vec3f &normal = normals[i];
+
+            osg::Vec4 color = mAmbientColor;
+            float directional = std::max(0.0f, normal*mLightDirection);
+            if(mHasDropoff)
+            {
+                float along = (position - mDropoffStart)*mDropoffAxis;
+                directional *= 1.0f - std::min(1.0f, std::max(0.0f, along));
+            }
+            color += mLightColor*directional;
+
+            for(auto it = lights.begin(); it != lights.end(); ++it)
+            {
+                const PointLight &light = **it;
+                ++stats.lightTests;
+
+                osg::Vec3f toLight = light.position - position;
+                float dist = toLight.length();
+                if(dist >= light.radius)
+                {
+                    continue;
+                }
+
+                // same falloff as in the lighting shader, so baked and dynamically lit surfaces match
+                float cosTheta = (dist > 0) ? std::max(0.0f, (normal*toLight)/dist) : 1.0f;
+                float attenuation = 1.0f - dist/light.radius;
+                float factor = cosTheta*attenuation*attenuation*light.intensity;
+                if(factor <= 0)
+                {
+                    continue;
+                }
+
+                if(occlusionTest)
+                {
+                    ++stats.occlusionTests;
+
+                    if(occlusionTest(position + normal*OD_BAKE_SURFACE_OFFSET, light.position))
+                    {
+                        ++stats.occludedCount;
+                        continue;
+                    }
+                }
+
+                color += light.color*factor;
+            }
+
+            for(size_t c = 0; c < 3; ++c)
+            {
+                color[c] = std::min(1.0f, color[c]);
+            }
+            color.a() = 1.0;
+
+            colors[i] = color;
+        }
+
+        stats.vertexCount += end - begin;
+    }
+
+}
@@ -0,0 +1,225 @@
+/*
+ * LightGrid.cpp
+ *
+ *  Created on: 19 Oct 2018
+ *      Author: zal
+ */
+
+#include "light/LightGrid.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include "Exception.h"
+
+// lights spanning more cells than this go into the global list. keeps huge lights from bloating the grid
+#define OD_LIGHT_GRID_MAX_CELLS_PER_LIGHT 128
+
+namespace od
+{
+
+    void LightGrid::Cell::add(LightId id, const osg::Vec3f &center, float radius)
+    {
+        x.push_back(center.x());
+        y.push_back(center.y());
+        z.push_back(center.z());
+        radiusSq.push_back(radius*radius);
+        ids.push_back(id);
+    }
+
+    void LightGrid::Cell::remove(LightId id)
+    {
+        auto it = std::find(ids.begin(), ids.end(), id);
+        if(it == ids.end())
+        {
+            return;
+        }
+
+        // swap and pop in all arrays
+        size_t index = it - ids.begin();
+        x[index] = x.back(); x.pop_back();
+        y[index] = y.back(); y.pop_back();
+        z[index] = z.back(); z.pop_back();
+        radiusSq[index] = radiusSq.back(); radiusSq.pop_back();
+        ids[index] = ids.back(); ids.pop_back();
+    }
+
+
+    LightGrid::LightGrid(float cellSize)
+    : mCellSize(cellSize)
+    , mCurrentStamp(0)
+    {
+        if(mCellSize <= 0.0f)
+        {
+            throw InvalidArgumentException("Light grid cell size must be positive");
+        }
+    }
+
+    void LightGrid::insert(LightId id, const osg::Vec3f &center, float radius)
+    {
+        if(id >= mEntries.size())
+        {
+            Entry e;
+            e.radius = 0.0f;
+            e.inserted = false;
+            e.global = false;
+            mEntries.resize(id + 1, e);
+            mStamps.resize(id + 1, 0);
+        }
+
+        remove(id);
+
+        Entry &e = mEntries[id];
+        e.center = center;
+        e.radius = std::max(radius, 0.0f);
+        e.inserted = true;
+
+        osg::Vec3f extent(e.radius, e.radius, e.radius);
+        osg::Vec3f boxMin = center - extent;
+        osg::Vec3f boxMax = center + extent;
+
+        size_t cellCount = 1;
+        for(size_t axis = 0; axis < 3; ++axis)
+        {
+            cellCount *= _toCell(boxMax[axis]) - _toCell(boxMin[axis]) + 1;
+        }
+
+        e.global = cellCount > OD_LIGHT_GRID_MAX_CELLS_PER_LIGHT;
+        if(e.global)
+        {
+            mGlobalCell.add(id, center, e.radius);
+            return;
+        }
+
+        _forEachCell(boxMin, boxMax, [&](CellKey key)
+        {
+            mCells[key].add(id, center, e.radius);
+        });
+    }
+
+    void LightGrid::remove(LightId id)
+    {
+        if(!contains(id))
+        {
+            return;
+        }
+
+        Entry &e = mEntries[id];
+        e.inserted = false;
+
+        if(e.global)
+        {
+            mGlobalCell.remove(id);
+            return;
+        }
+
+        osg::Vec3f extent(e.radius, e.radius, e.radius);
+        _forEachCell(e.center - extent, e.center + extent, [&](CellKey key)
+        {
+            auto it = mCells.find(key);
+            if(it != mCells.end())
+            {
+                it->second.remove(id);
+                if(it->second.empty())
+                {
+                    mCells.erase(it);
+                }
+            }
+        });
+    }
+
+    bool LightGrid::contains(LightId id) const
+    {
+        return id < mEntries.size() && mEntries[id].inserted;
+    }
+
+    void LightGrid::query(const osg::Vec3f &boxMin, const osg::Vec3f &boxMax, std::vector<LightId> &ids)
+    {
+        // new stamp so lights found in multiple cells are reported only once
+        ++mCurrentStamp;
+        if(mCurrentStamp == 0)
+        {
+            std::fill(mStamps.begin(), mStamps.end(), 0);
+            mCurrentStamp = 1;
+        }
+
+        _testCell(mGlobalCell, boxMin, boxMax, ids);
+
+        _forEachCell(boxMin, boxMax, [&](CellKey key)
+        {
+            auto it = mCells.find(key);
+            if(it != mCells.end())
+            {
+                _testCell(it->second, boxMin, boxMax, ids);
+            }
+        });
+    }
+
+    LightGrid::CellKey LightGrid::_makeKey(int32_t x, int32_t y, int32_t z)
+    {
+        // 21 bits per axis is plenty for any level
+        const uint64_t mask = (1 << 21) - 1;
+        return ((static_cast<uint64_t>(x) & mask) << 42) | ((static_cast<uint64_t>(y) & mask) << 21) | (static_cast<uint64_t>(z) & mask);
+    }
+
+    template <typename F>
+    void LightGrid::_forEachCell(const osg::Vec3f &boxMin, const osg::Vec3f &boxMax, const F &f)
+    {
+        int32_t minX = _toCell(boxMin.x());
+        int32_t minY = _toCell(boxMin.y());
+        int32_t minZ = _toCell(boxMin.z());
+        int32_t maxX = _toCell(boxMax.x());
+        int32_t maxY = _toCell(boxMax.y());
+        int32_t maxZ = _toCell(boxMax.z());
+
+        for(int32_t x = minX; x <= maxX; ++x)
+        {
+            for(int32_t y = minY; y <= maxY; ++y)
+            {
+                for(int32_t z = minZ; z <= maxZ; ++z)
+                {
+                    f(_makeKey(x, y, z));
+                }
+            }
+        }
+    }
+
+    void LightGrid::_testCell(Cell &cell, const osg::Vec3f &boxMin, const osg::Vec3f &boxMax, std::vector<LightId> &ids)
+    {
+        size_t count = cell.ids.size();
+        if(count == 0)
+        {
+            return;
+        }
+
+        mHits.resize(count);
+
+        const float *x = cell.x.data();
+        const float *y = cell.y.data();
+        const float *z = cell.z.data();
+        const float *radiusSq = cell.radiusSq.data();
+        uint8_t *hits = mHits.data();
+        float minX = boxMin.x(), minY = boxMin.y(), minZ = boxMin.z();
+        float maxX = boxMax.x(), maxY = boxMax.y(), maxZ = boxMax.z();
+
+        // branch-free distance from sphere center to box. written so the compiler can vectorize it
+        for(size_t i = 0; i < count; ++i)
+        {
+            float dx = std::max(minX - x[i], 0.0f) + std::max(x[i] - maxX, 0.0f);
+            float dy = std::max(minY - y[i], 0.0f) + std::max(y[i] - maxY, 0.0f);
+            float dz = std::max(minZ - z[i], 0.0f) + std::max(z[i] - maxZ, 0.0f);
+            hits[i] = (dx*dx + dy*dy + dz*dz) <= radiusSq[i];
+        }
+
+        for(size_t i = 0; i < count; ++i)
+        {
+            LightId id = cell.ids[i];
+            if(hits[i] && mStamps[id] != mCurrentStamp)
+            {
+                mStamps[id] = mCurrentStamp;
+                ids.push_back(id);
+            }
+        }
+    }
+
+}
@@ -7,7 +7,16 @@
 
 #include "light/LightManager.h"
 
-#include <osg/Light>
+#include <algorithm>
+#include <iomanip>
+#include <osg/Timer>
+
+#include "Engine.h"
+#include "LevelObject.h"
+#include "Layer.h"
+
+// lights usually have a radius of a few lu, so one spans only a handful of cells of this size
+#define OD_LIGHT_GRID_CELL_SIZE 8.0f
 
 namespace od
 {
@@ -16,31 +25,337 @@ namespace od
     LightManager::LightManager(Engine &engine, osg::Group *sceneRoot)
     : mEngine(engine)
     , mSceneRoot(sceneRoot)
+    , mGrid(OD_LIGHT_GRID_CELL_SIZE)
+    , mLightGeneration(0)
     {
-        // attach a default light state to the root node.
-        //  since we are using shaders, we'd have to pass a separate uniform to directly enable/disable
-        //  individual lights. we might do this via a custom StateAttribute encapsulating the glLight calls, but for
-        //  now we just sat all lights to black.
+        mStats.assignmentTimeMs = 0.0;
+        mStats.litObjectCount = 0;
+        mStats.updatedObjectCount = 0;
+        std::fill(std::begin(mStats.lightsPerObject), std::end(mStats.lightsPerObject), 0);
+
+        // everything that is not a lit object (e.g. layers) gets no point lights and no directional light at all. those
+        //  have their lighting baked into the vertex colors, so full ambient light leaves them as they are
         osg::StateSet *ss = mSceneRoot->getOrCreateStateSet();
-        for(size_t i = 0; i < 8; ++i) // FIXME: get max number of lights
-        {
-            osg::ref_ptr<osg::Light> light = new osg::Light(i);
-            light->setDiffuse(osg::Vec4(0.0, 0.0, 0.0, 0.0));
-            light->setAmbient(osg::Vec4(0.0, 0.0, 0.0, 0.0));
-            light->setPosition(osg::Vec4(1.0, 0.0, 0.0, 0.0));
-            ss->setAttribute(light, osg::StateAttribute::ON);
-        }
+        ss->addUniform(new osg::Uniform("lightCount", 0));
+        ss->addUniform(new osg::Uniform("ambientColor", osg::Vec4(1.0, 1.0, 1.0, 1.0)));
+        ss->addUniform(new osg::Uniform("sunDirection", osg::Vec3f(0.0, 1.0, 0.0)));
+        ss->addUniform(new osg::Uniform("sunColor", osg::Vec4(0.0, 0.0, 0.0, 0.0)));
+
+        // until the level sets it's own, objects get a dim ambient and a bright directional light from above
+        osg::Vec3f defaultSunDirection(0.1, 0.9, 0.0);
+        defaultSunDirection.normalize();
+        mDefaultAmbientColor = new osg::Uniform("ambientColor", osg::Vec4(50.0/255.0, 50.0/255.0, 50.0/255.0, 1.0));
+        mDefaultSunDirection = new osg::Uniform("sunDirection", defaultSunDirection);
+        mDefaultSunColor = new osg::Uniform("sunColor", osg::Vec4(224.0/255.0, 223.0/255.0, 201.0/255.0, 0.0));
+
+        mEngine.getUpdateScheduler().add(this, UpdatePhase::Lighting);
+    }
+
+    LightManager::~LightManager()
+    {
+        mEngine.getUpdateScheduler().remove(this);
     }
 
     Light *LightManager::addLight(LevelObject *obj)
     {
         osg::ref_ptr<Light> newLight = new Light(obj);
 
-        mLights.push_back(newLight);
+        if(!mFreeSlots.empty())
+        {
+            newLight->mSlot = mFreeSlots.back();
+            mFreeSlots.pop_back();
+            mLights[newLight->mSlot] = newLight;
+
+        }else
+        {
+            newLight->mSlot = mLights.size();
+            mLights.push_back(newLight);
+        }
+
+        // will be binned on next update, once the caller had a chance to set it's radius
 
         return newLight;
     }
 
+    void LightManager::removeLight(Light *light)
+    {
+        if(light == nullptr || light->mSlot < 0 || mLights[light->mSlot] != light)
+        {
+            return;
+        }
+
+        mGrid.remove(light->mSlot);
+        mFreeSlots.push_back(light->mSlot);
+        mLights[light->mSlot] = nullptr;
+        light->mSlot = -1;
+
+        // objects compare against this before skipping their update, so none of them keeps the removed light
+        ++mLightGeneration;
+    }
+
+    void LightManager::addLitObject(LevelObject *obj)
+    {
+        for(LitObject &lo : mLitObjects)
+        {
+            if(lo.object == obj)
+            {
+                return;
+            }
+        }
+
+        LitObject lo;
+        lo.object = obj;
+        lo.lightCount = new osg::Uniform("lightCount", 0);
+        lo.lightPositions = new osg::Uniform(osg::Uniform::FLOAT_VEC4, "lightPositions", OD_MAX_LIGHTS_PER_OBJECT);
+        lo.lightColors = new osg::Uniform(osg::Uniform::FLOAT_VEC4, "lightColors", OD_MAX_LIGHTS_PER_OBJECT);
+        lo.ambientColor = new osg::Uniform("ambientColor", osg::Vec4());
+        lo.sunDirection = new osg::Uniform("sunDirection", osg::Vec3f());
+        lo.sunColor = new osg::Uniform("sunColor", osg::Vec4());
+        lo.lightingLayer = obj->getLightingLayer();
+        lo.lightGeneration = mLightGeneration;
+
+        osg::StateSet *ss = obj->getOrCreateStateSet();
+        ss->addUniform(lo.lightCount);
+        ss->addUniform(lo.lightPositions);
+        ss->addUniform(lo.lightColors);
+        ss->addUniform(lo.ambientColor);
+        ss->addUniform(lo.sunDirection);
+        ss->addUniform(lo.sunColor);
+
+        // objects without a valid bound don't get point lights assigned, but still need their directional light
+        osg::Matrix worldMatrix;
+        obj->getPositionAttitudeTransform()->computeLocalToWorldMatrix(worldMatrix, nullptr);
+        _updateDirectionalLight(lo, osg::Matrix::inverse(worldMatrix));
+
+        mLitObjects.push_back(lo);
+        _assignLights(mLitObjects.back(), true);
+    }
+
+    void LightManager::removeLitObject(LevelObject *obj)
+    {
+        for(auto it = mLitObjects.begin(); it != mLitObjects.end(); ++it)
+        {
+            if(it->object == obj)
+            {
+                osg::StateSet *ss = obj->getOrCreateStateSet();
+                ss->removeUniform(it->lightCount);
+                ss->removeUniform(it->lightPositions);
+                ss->removeUniform(it->lightColors);
+                ss->removeUniform(it->ambientColor);
+                ss->removeUniform(it->sunDirection);
+                ss->removeUniform(it->sunColor);
+
+                *it = mLitObjects.back();
+                mLitObjects.pop_back();
+                return;
+            }
+        }
+    }
+
+    void LightManager::setDefaultLighting(const osg::Vec4 &ambientColor, const osg::Vec3f &sunDirection, const osg::Vec4 &sunColor)
+    {
+        osg::Vec3f direction(sunDirection);
+        direction.normalize();
 
+        // instances use these directly, so apply the same alpha rules as for lit objects
+        osg::Vec4 ambient(ambientColor.r(), ambientColor.g(), ambientColor.b(), 1.0);
+        osg::Vec4 sun(sunColor.r(), sunColor.g(), sunColor.b(), 0.0);
+
+        mDefaultAmbientColor->set(ambient);
+        mDefaultSunDirection->set(direction);
+        mDefaultSunColor->set(sun);
+
+        for(LitObject &lo : mLitObjects)
+        {
+            if(lo.lightingLayer == nullptr)
+            {
+                _assignLights(lo, true);
+            }
+        }
+    }
+
+    void LightManager::addDefaultLightingUniforms(osg::StateSet *ss)
+    {
+        ss->addUniform(mDefaultAmbientColor);
+        ss->addUniform(mDefaultSunDirection);
+        ss->addUniform(mDefaultSunColor);
+    }
+
+    osg::Vec4 LightManager::sampleLight(const osg::Vec3f &point)
+    {
+        mCandidates.clear();
+        mGrid.query(point, point, mCandidates);
+
+        osg::Vec4 color(0.0, 0.0, 0.0, 0.0);
+        for(LightGrid::LightId id : mCandidates)
+        {
+            Light *light = mLights[id];
+            if(light->getRadius() <= 0.0f)
+            {
+                continue;
+            }
+
+            float attenuation = std::max(1.0f - (light->getPosition() - point).length()/light->getRadius(), 0.0f);
+            color += light->getDiffuseColor()*(light->getIntensity()*attenuation*attenuation);
+        }
+        color.a() = 0.0;
+
+        return color;
+    }
+
+    void LightManager::dumpStats(std::ostream &out) const
+    {
+        out << "Light assignment stats:" << std::endl
+            << "  assignment time: " << std::fixed << std::setprecision(3) << mStats.assignmentTimeMs << "ms" << std::endl
+            << "  lit objects:     " << mStats.litObjectCount << " (" << mStats.updatedObjectCount << " updated)" << std::endl
+            << "  lights per object:" << std::endl;
+
+        for(size_t i = 0; i < OD_MAX_LIGHTS_PER_OBJECT + 2; ++i)
+        {
+            out << "    " << std::setw(2) << i << ((i == OD_MAX_LIGHTS_PER_OBJECT + 1) ? "+" : " ") << ": " << mStats.lightsPerObject[i] << std::endl;
+        }
+    }
+
+    void LightManager::update(double simTime, double relTime)
+    {
+        osg::Timer_t startTick = osg::Timer::instance()->tick();
+
+        bool lightsChanged = false;
+        for(size_t slot = 0; slot < mLights.size(); ++slot)
+        {
+            Light *light = mLights[slot];
+            if(light == nullptr)
+            {
+                continue;
+            }
+
+            if(light->mDirty || light->mDynamic)
+            {
+                mGrid.insert(slot, light->getPosition(), light->getRadius());
+                light->mDirty = false;
+                lightsChanged = true;
+            }
+        }
+
+        if(lightsChanged)
+        {
+            ++mLightGeneration;
+        }
+
+        std::fill(std::begin(mStats.lightsPerObject), std::end(mStats.lightsPerObject), 0);
+        mStats.updatedObjectCount = 0;
+        for(LitObject &lo : mLitObjects)
+        {
+            if(lo.object->getState() == LevelObjectState::Spawned)
+            {
+                _assignLights(lo, lightsChanged);
+            }
+        }
+
+        mStats.litObjectCount = mLitObjects.size();
+        mStats.assignmentTimeMs = osg::Timer::instance()->delta_m(startTick, osg::Timer::instance()->tick());
+    }
+
+    void LightManager::_assignLights(LitObject &lo, bool force)
+    {
+        const osg::BoundingSphere &bound = lo.object->getBound();
+        if(!bound.valid())
+        {
+            return;
+        }
+
+        osg::Vec3f center = bound.center();
+        osg::Vec3f extent(bound.radius(), bound.radius(), bound.radius());
+        mCandidates.clear();
+        mGrid.query(center - extent, center + extent, mCandidates);
+
+        mStats.lightsPerObject[std::min<size_t>(mCandidates.size(), OD_MAX_LIGHTS_PER_OBJECT + 1)]++;
+
+        if(mCandidates.size() > OD_MAX_LIGHTS_PER_OBJECT)
+        {
+            // too many lights. keep the ones that contribute most at the object's center
+            auto score = [&](LightGrid::LightId id)
+            {
+                Light *light = mLights[id];
+                float distance = std::max((light->getPosition() - center).length() - bound.radius(), 0.0f);
+                if(light->getRadius() <= 0.0f)
+                {
+                    return 0.0f;
+                }
+
+                return light->getIntensity()*std::max(1.0f - distance/light->getRadius(), 0.0f);
+            };
+
+            std::partial_sort(mCandidates.begin(), mCandidates.begin() + OD_MAX_LIGHTS_PER_OBJECT, mCandidates.end(),
+                    [&](LightGrid::LightId a, LightGrid::LightId b){ return score(a) > score(b); });
+            mCandidates.resize(OD_MAX_LIGHTS_PER_OBJECT);
+        }
+
+        std::sort(mCandidates.begin(), mCandidates.end()); // so we can compare against last frame's list
+
+        osg::Matrix worldMatrix;
+        lo.object->getPositionAttitudeTransform()->computeLocalToWorldMatrix(worldMatrix, nullptr);
+        if(!force && lo.lightGeneration == mLightGeneration && mCandidates == lo.lights && worldMatrix == lo.lastWorldMatrix)
+        {
+            return;
+        }
+
+        lo.lights = mCandidates;
+        lo.lastWorldMatrix = worldMatrix;
+        lo.lightGeneration = mLightGeneration;
+
+        // the shader lights in model space. saves it from having to transform every vertex to world space
+        osg::Matrix worldToLocal = osg::Matrix::inverse(worldMatrix);
+        osg::Vec3f scale = lo.object->getScale();
+        float maxScale = std::max(std::max(scale.x(), scale.y()), scale.z());
+        float radiusScale = (maxScale > 0.0f) ? 1.0f/maxScale : 1.0f;
+
+        for(size_t i = 0; i < lo.lights.size(); ++i)
+        {
+            Light *light = mLights[lo.lights[i]];
+            osg::Vec3f localPosition = light->getPosition() * worldToLocal;
+            lo.lightPositions->setElement(i, osg::Vec4(localPosition, light->getRadius()*radiusScale));
+            osg::Vec4 color = light->getDiffuseColor()*light->getIntensity();
+            color.a() = 0.0; // lights must not change the object's transparency
+            lo.lightColors->setElement(i, color);
+        }
+        lo.lightCount->set(static_cast<int>(lo.lights.size()));
+
+        _updateDirectionalLight(lo, worldToLocal);
+
+        ++mStats.updatedObjectCount;
+    }
+
+    void LightManager::_updateDirectionalLight(LitObject &lo, const osg::Matrix &worldToLocal)
+    {
+        osg::Vec4 ambientColor;
+        osg::Vec3f sunDirection;
+        osg::Vec4 sunColor;
+        if(lo.lightingLayer != nullptr)
+        {
+            ambientColor = lo.lightingLayer->getAmbientColor();
+            sunDirection = lo.lightingLayer->getLightDirection();
+            sunColor = lo.lightingLayer->getLightColor();
+
+        }else
+        {
+            mDefaultAmbientColor->get(ambientColor);
+            mDefaultSunDirection->get(sunDirection);
+            mDefaultSunColor->get(sunColor);
+        }
+
+        // the shader multiplies the vertex color with the summed light. ambient alpha of 1 and zero alpha for all other
+        //  lights keep the object's transparency as it is
+        ambientColor.a() = 1.0;
+        sunColor.a() = 0.0;
+
+        // same space as the point lights. renormalize as the object may be scaled
+        sunDirection = osg::Matrix::transform3x3(sunDirection, worldToLocal);
+        sunDirection.normalize();
+
+        lo.ambientColor->set(ambientColor);
+        lo.sunDirection->set(sunDirection);
+        lo.sunColor->set(sunColor);
+    }
 
 }
@@ -7,7 +7,10 @@
 
 #include "physics/PhysicsManager.h"
 
+#include <algorithm>
+
 #include <BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
+#include <LinearMath/btAabbUtil2.h>
 #include <BulletCollision/CollisionDispatch/btDefaultCollisionConfiguration.h>
 #include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h>
 #include <BulletDynamics/Dynamics/btDiscreteDynamicsWorld.h>
@@ -26,53 +29,9 @@
 namespace od
 {
 
-	class PhysicsTickCallback : public osg::NodeCallback
-	{
-	public:
-
-		PhysicsTickCallback(PhysicsManager &pm)
-		: mPhysicsManager(pm)
-		, mFirstUpdate(true)
-		, mPrevTime(0)
-		{
-		}
-
-		virtual void operator()(osg::Node *node, osg::NodeVisitor *nv)
-		{
-			traverse(node, nv);
-
-			if(nv->getFrameStamp() != nullptr)
-			{
-				double simTime = nv->getFrameStamp()->getSimulationTime();
-
-				if(mFirstUpdate)
-				{
-					mPrevTime = simTime; // so we avoid massive jumps at first update
-					mFirstUpdate = false;
-				}
-
-				mPhysicsManager.stepSimulation(simTime - mPrevTime);
-
-				mPrevTime = simTime;
-			}
-		}
-
-
-	private:
-
-		PhysicsManager &mPhysicsManager;
-		bool mFirstUpdate;
-		double mPrevTime;
-
-	};
-
-
-
-
 	PhysicsManager::PhysicsManager(Level &level, osg::Group *levelRoot)
 	: mLevel(level)
 	, mLevelRoot(levelRoot)
-	, mTickCallback(new PhysicsTickCallback(*this))
 	{
 		mBroadphase.reset(new btDbvtBroadphase());
 		mCollisionConfiguration.reset(new btDefaultCollisionConfiguration());
@@ -83,8 +42,7 @@ namespace od
 
 		mDynamicsWorld->setGravity(btVector3(0, -1, 0));
 
-		// for now, hook physics simulation into update traversal. we might want to put this somewhere else once we do threading
-		mLevelRoot->addUpdateCallback(mTickCallback);
+		mLevel.getEngine().getUpdateScheduler().add(this, UpdatePhase::Physics);
 
 		mDebugDrawer.reset(new DebugDrawer(mLevelRoot, mDynamicsWorld.get()));
 		mDynamicsWorld->setDebugDrawer(mDebugDrawer.get());
@@ -97,7 +55,7 @@ namespace od
 
 	PhysicsManager::~PhysicsManager()
 	{
-		mLevelRoot->removeUpdateCallback(mTickCallback);
+		mLevel.getEngine().getUpdateScheduler().remove(this);
 		mDynamicsWorld->setDebugDrawer(nullptr);
 
 		Logger::debug() << "Physics Manager destroyed with " << mLevelObjectMap.size() + mLayerMap.size() << " rigid bodies left";
@@ -115,6 +73,11 @@ namespace od
 		mDebugDrawer->step();
 	}
 
+	void PhysicsManager::update(double simTime, double relTime)
+	{
+		stepSimulation(relTime);
+	}
+
 	bool PhysicsManager::toggleDebugDraw()
 	{
 		if(mDebugDrawer == nullptr)
@@ -137,12 +100,7 @@ namespace od
 	    btCollisionWorld::AllHitsRayResultCallback callback(bStart, bEnd);
 	    mDynamicsWorld->rayTest(bStart, bEnd, callback);
 
-	    if(!callback.hasHit())
-	    {
-	        return 0;
-	    }
-
-	    size_t hitObjectCount = callback.m_collisionObjects.size();
+	    size_t hitObjectCount = callback.hasHit() ? callback.m_collisionObjects.size() : 0;
 	    results.reserve(hitObjectCount);
 	    for(size_t i = 0; i < hitObjectCount; ++i)
 	    {
@@ -178,7 +136,24 @@ namespace od
 	        results.push_back(result);
 	    }
 
-	    return hitObjectCount;
+	    const std::vector<LevelObject*> &skinnedObjects = mLevel.getSkinnedObjects();
+	    for(auto it = skinnedObjects.begin(); it != skinnedObjects.end(); ++it)
+	    {
+	        RaycastResult result;
+	        float fraction;
+	        if(_raycastSkinnedObject(**it, start, end, result, fraction))
+	        {
+	            results.push_back(result);
+	        }
+	    }
+
+	    // bullet reports hits in no particular order
+	    std::sort(results.begin(), results.end(), [&start](const RaycastResult &a, const RaycastResult &b)
+	    {
+	        return (a.hitPoint - start).length2() < (b.hitPoint - start).length2();
+	    });
+
+	    return results.size();
 	}
 
 	bool PhysicsManager::raycastClosest(const osg::Vec3f &start, const osg::Vec3f &end, RaycastResult &result, LevelObject *exclude, int mask)
@@ -200,7 +175,31 @@ namespace od
 
 	    result.hitLayer = nullptr;
         result.hitLevelObject = nullptr;
-	    if(!callback.hasHit())
+
+        // animated objects are tested against their skinned mesh, which bullet knows nothing about
+        float closestFraction = callback.hasHit() ? callback.m_closestHitFraction : 1.0f;
+        bool skinnedHit = false;
+        if(mask & CollisionGroups::OBJECT)
+        {
+            const std::vector<LevelObject*> &skinnedObjects = mLevel.getSkinnedObjects();
+            for(auto it = skinnedObjects.begin(); it != skinnedObjects.end(); ++it)
+            {
+                RaycastResult skinnedResult;
+                float fraction;
+                if(*it != exclude && _raycastSkinnedObject(**it, start, end, skinnedResult, fraction) && fraction < closestFraction)
+                {
+                    closestFraction = fraction;
+                    result = skinnedResult;
+                    skinnedHit = true;
+                }
+            }
+        }
+
+        if(skinnedHit)
+        {
+            return true;
+
+        }else if(!callback.hasHit())
 	    {
 	        return false;
 	    }
@@ -232,6 +231,87 @@ namespace od
         return true;
 	}
 
+	bool PhysicsManager::_raycastSkinnedObject(LevelObject &obj, const osg::Vec3f &start, const osg::Vec3f &end, RaycastResult &result, float &fraction)
+	{
+	    CpuSkinner::Instance *instance = obj.getSkinningInstance();
+	    if(instance == nullptr)
+	    {
+	        return false;
+	    }
+
+	    // skinned positions are in model space. the transform is affine, so the hit fraction is the same in both spaces
+	    osg::Matrix localToWorld;
+	    obj.getPositionAttitudeTransform()->computeLocalToWorldMatrix(localToWorld, nullptr);
+	    osg::Matrix worldToLocal = osg::Matrix::inverse(localToWorld);
+
+	    osg::Vec3f normal;
+	    if(!instance->raycast(start*worldToLocal, end*worldToLocal, fraction, normal))
+	    {
+	        return false;
+	    }
+
+	    // normals transform with the inverse transpose
+	    normal = osg::Matrix::transform3x3(worldToLocal, normal);
+	    normal.normalize();
+
+	    result.hitBulletObject = nullptr;
+	    result.hitPoint = start + (end - start)*fraction;
+	    result.hitNormal = normal;
+	    result.hitLayer = nullptr;
+	    result.hitLevelObject = &obj;
+
+	    return true;
+	}
+
+	PhysicsManager::LayerRayTester::LayerRayTester(PhysicsManager &pm)
+	{
+	    mLayerBodies.reserve(pm.mLayerMap.size());
+	    for(auto it = pm.mLayerMap.begin(); it != pm.mLayerMap.end(); ++it)
+	    {
+	        btRigidBody *body = it->second.second.get();
+
+	        LayerBody layerBody;
+	        layerBody.object = body;
+	        body->getCollisionShape()->getAabb(body->getWorldTransform(), layerBody.aabbMin, layerBody.aabbMax);
+	        mLayerBodies.push_back(layerBody);
+	    }
+	}
+
+	bool PhysicsManager::LayerRayTester::hasHit(const osg::Vec3f &start, const osg::Vec3f &end) const
+	{
+	    btVector3 bStart = BulletAdapter::toBullet(start);
+	    btVector3 bEnd = BulletAdapter::toBullet(end);
+
+	    btTransform fromTransform;
+	    fromTransform.setIdentity();
+	    fromTransform.setOrigin(bStart);
+	    btTransform toTransform;
+	    toTransform.setIdentity();
+	    toTransform.setOrigin(bEnd);
+
+	    for(auto it = mLayerBodies.begin(); it != mLayerBodies.end(); ++it)
+	    {
+	        // most layers are nowhere near the segment. reject them before walking their triangle BVH
+	        btScalar param = 1.0;
+	        btVector3 aabbNormal;
+	        if(!btRayAabb(bStart, bEnd, it->aabbMin, it->aabbMax, param, aabbNormal))
+	        {
+	            continue;
+	        }
+
+	        // rayTestSingle only uses stack-local state and reads the shape, so this is safe to call concurrently
+	        btCollisionWorld::ClosestRayResultCallback callback(bStart, bEnd);
+	        btCollisionWorld::rayTestSingle(fromTransform, toTransform, it->object, it->object->getCollisionShape(),
+	                it->object->getWorldTransform(), callback);
+	        if(callback.hasHit())
+	        {
+	            return true;
+	        }
+	    }
+
+	    return false;
+	}
+
 	btRigidBody *PhysicsManager::addLayer(Layer &l)
 	{
 		btCollisionShape *cs = l.getCollisionShape();
@@ -20,11 +20,7 @@ namespace odRfl
 
     void PrefetchProbe::registerField(RflAssetRef &field, const char *fieldName)
     {
-        try
-        {
-            field.fetchAssets(mAssetProvider);
-
-        }catch(od::NotFoundException &e)
+        if(!field.findAssets(mAssetProvider))
         {
             Logger::warn() << "Field '" << fieldName << "' contains invalid asset reference";
         }
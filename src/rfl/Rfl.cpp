@@ -42,13 +42,24 @@ namespace odRfl
 
 	RflClassRegistrar &Rfl::getClassRegistrarById(RflClassId id)
 	{
-	    auto it = mRegistrarMap.find(id);
-		if(it == mRegistrarMap.end())
+	    RflClassRegistrar *registrar = findClassRegistrarById(id);
+		if(registrar == nullptr)
 		{
 			throw od::NotFoundException("Given class ID is not registered in RFL");
 		}
 
-		return it->second;
+		return *registrar;
+	}
+
+	RflClassRegistrar *Rfl::findClassRegistrarById(RflClassId id)
+	{
+	    auto it = mRegistrarMap.find(id);
+	    if(it == mRegistrarMap.end())
+	    {
+	        return nullptr;
+	    }
+
+	    return &it->second.get();
 	}
 
 	Rfl &Rfl::getSingleton()
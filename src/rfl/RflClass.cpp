@@ -37,4 +37,14 @@ namespace odRfl
 	{
 	}
 
+	bool RflClass::allowsMessageCollapsing(RflMessage message) const
+	{
+	    return false;
+	}
+
+	bool RflClass::allowsInstancing() const
+	{
+	    return true;
+	}
+
 }
@@ -10,6 +10,7 @@
 #include <algorithm>
 
 #include "Exception.h"
+#include "DataStream.h"
 #include "rfl/RflField.h"
 
 namespace odRfl
@@ -31,6 +32,12 @@ namespace odRfl
 
     RflClassBuilder::RflClassBuilder()
     : mRegistrationIndex(0)
+    , mLayoutVerified(false)
+    , mStoreNames(true)
+    {
+    }
+
+    RflClassBuilder::~RflClassBuilder()
     {
     }
 
@@ -38,7 +45,6 @@ namespace odRfl
     {
     	uint32_t fieldCount;
     	uint32_t dwordCount;
-    	std::vector<char> fieldData;
     	std::vector<uint16_t> fieldIndices;
     	dr >> fieldCount
 		   >> dwordCount;
@@ -51,29 +57,65 @@ namespace odRfl
     	mFieldData.resize(dwordCount*4);
     	dr.read(mFieldData.data(), mFieldData.size());
 
+    	mDataBuffer.reset(new od::MemBuffer(mFieldData.data(), mFieldData.data() + mFieldData.size()));
+    	mDataStream.reset(new std::istream(mDataBuffer.get()));
+    	mDataReader.reset(new od::DataReader(*mDataStream));
+
+    	size_t entryCount = fieldCount;
     	if(isObjectRecord)
     	{
     		fieldIndices.resize(fieldCount);
+    		entryCount = 0;
     		for(size_t i = 0; i < fieldCount; ++i)
     		{
     			dr >> fieldIndices[i];
+    			entryCount = std::max(entryCount, static_cast<size_t>(fieldIndices[i]) + 1);
     		}
     	}
 
-    	mFieldEntries.resize(fieldCount);
+#ifdef OD_RFL_CHECK_FIELD_NAMES
+    	mStoreNames = true;
+#else
+    	// object builders are used only once, so we'd never get to check the names anyway
+    	mStoreNames = !isObjectRecord;
+#endif
+
+    	FieldEntry noField;
+    	noField.fieldType = NO_FIELD;
+    	noField.isArray = false;
+    	noField.dataOffset = 0;
+    	noField.arrayLength = 0;
+    	mFieldEntries.assign(entryCount, noField);
+
+    	std::string name;
     	for(size_t i = 0; i < fieldCount; ++i)
     	{
     		uint32_t type;
-    		std::string name;
     		dr >> type
 			   >> name;
 
-    		mFieldEntries[i].fieldType = type & 0xff;
-    		mFieldEntries[i].fieldName = name;
-    		mFieldEntries[i].index = isObjectRecord ? fieldIndices[i] : i;
-    		mFieldEntries[i].dataOffset = i*4;
-    		mFieldEntries[i].isArray = (type & 0x1000) || (mFieldEntries[i].fieldType == RflField::STRING); // strings are stored exactly like arrays
+    		FieldEntry &entry = mFieldEntries[isObjectRecord ? fieldIndices[i] : i];
+    		entry.fieldType = type & 0xff;
+    		entry.isArray = (type & 0x1000) || (entry.fieldType == RflField::STRING); // strings are stored exactly like arrays
+    		entry.dataOffset = i*4;
+    		if(mStoreNames)
+    		{
+    			entry.fieldName = name;
+    		}
+
+    		if(entry.isArray)
+    		{
+    			// array header is (offset in dwords, length). resolve it now so filling can jump right to the elements
+    			uint16_t offset;
+    			mDataReader->seek(entry.dataOffset);
+    			*mDataReader >> offset
+							 >> entry.arrayLength;
+    			entry.dataOffset = offset*4;
+    		}
     	}
+
+    	mRegistrationIndex = 0;
+    	mLayoutVerified = false;
     }
 
     void RflClassBuilder::resetIndexCounter()
@@ -81,6 +123,11 @@ namespace odRfl
     	mRegistrationIndex = 0;
     }
 
+    void RflClassBuilder::markLayoutVerified()
+    {
+        mLayoutVerified = true;
+    }
+
     void RflClassBuilder::beginCategory(const char *categoryName)
     {
         // Class builder doesn't give a damn about categories
@@ -88,56 +135,55 @@ namespace odRfl
 
     void RflClassBuilder::registerField(RflField &field, const char *fieldName)
     {
-        auto pred = [this](FieldEntry &e){ return e.index == mRegistrationIndex; };
-        auto it = std::find_if(mFieldEntries.begin(), mFieldEntries.end(), pred); // FIXME: O(n) lookup. might split into classbuilder and objectbuilder, one with map and one with array
-        if(it == mFieldEntries.end())
+        size_t index = mRegistrationIndex++;
+        if(index >= mFieldEntries.size() || mFieldEntries[index].fieldType == NO_FIELD)
         {
-            mRegistrationIndex++;
             return; // FIXME: this should be an error when building a class
         }
 
-        if(it->fieldType != field.getFieldType())
+        FieldEntry &entry = mFieldEntries[index];
+
+#ifdef OD_RFL_CHECK_FIELD_NAMES
+        _checkField(entry, field, fieldName);
+#else
+        if(!mLayoutVerified)
         {
-            throw od::Exception("Type mismatch in RflClass. Field type as defined in RflClass does not match the one found in record.");
+            _checkField(entry, field, fieldName);
         }
+#endif
 
-        if(it->fieldName != fieldName) // TODO: costly comparison. might want to make this optional
+        // field seems reasonable. let's fill it
+        mDataReader->seek(entry.dataOffset);
+        if(!entry.isArray)
         {
-            Logger::error() << "Field name mismatch: Field in RflClass was named '" << fieldName << "' where field in record was named '" << it->fieldName << "'";
-            throw od::Exception("Field name mismatch in RflClass. Field name as defined in RflClass does not match the one found in record.");
-        }
+            field.fill(*mDataReader);
 
-        if(it->isArray != field.isArray())
+        }else
         {
-            Logger::error() << "Field array flag mismatch: Field '" << fieldName << "' was array in RFL or file while in the other it was not.";
-            throw od::Exception("Field as defined in RflClass does not match array state as found in record.");
+            field.fillArray(entry.arrayLength, *mDataReader);
         }
 
-        // field seems reasonable. let's fill it
-
-        od::MemBuffer buf(mFieldData.data(), mFieldData.data() + mFieldData.size());
-        std::istream dataStr(&buf);
-        od::DataReader dr(dataStr);
+        Logger::debug() << "Filled field '" << fieldName << "'";
+    }
 
-        dr.seek(it->dataOffset);
-        if(!it->isArray)
+    void RflClassBuilder::_checkField(const FieldEntry &entry, RflField &field, const char *fieldName)
+    {
+        if(entry.fieldType != field.getFieldType())
         {
-            field.fill(dr);
+            throw od::Exception("Type mismatch in RflClass. Field type as defined in RflClass does not match the one found in record.");
+        }
 
-        }else
+        if(mStoreNames && entry.fieldName != fieldName)
         {
-            uint16_t offset;
-            uint16_t length;
-            dr >> offset
-               >> length;
-
-            dr.seek(offset*4);
-            field.fillArray(length, dr);
+            Logger::error() << "Field name mismatch: Field in RflClass was named '" << fieldName << "' where field in record was named '" << entry.fieldName << "'";
+            throw od::Exception("Field name mismatch in RflClass. Field name as defined in RflClass does not match the one found in record.");
         }
 
-        Logger::debug() << "Filled field '" << fieldName << "'";
-
-        ++mRegistrationIndex;
+        if(entry.isArray != field.isArray())
+        {
+            Logger::error() << "Field array flag mismatch: Field '" << fieldName << "' was array in RFL or file while in the other it was not.";
+            throw od::Exception("Field as defined in RflClass does not match array state as found in record.");
+        }
     }
 
 
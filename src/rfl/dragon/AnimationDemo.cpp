@@ -35,6 +35,7 @@ namespace odRfl
         mAnimations.fetchAssets(obj->getClass()->getModel()->getAssetProvider());
 
         mAnimationPlayer = new od::SkeletonAnimationPlayer(engine, obj, obj->getSkeletonRoot(), nullptr);
+        obj->enableCpuSkinning(*mAnimationPlayer);
 
         obj->setEnableRflUpdateHook(true);
     }
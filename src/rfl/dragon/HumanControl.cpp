@@ -481,6 +481,9 @@ namespace odRfl
     		mCharacterController.reset(new od::CharacterController(obj, 0.05, 0.3));
 
 			mAnimationPlayer = new od::SkeletonAnimationPlayer(obj.getLevel().getEngine(), &obj, obj.getSkeletonRoot(), mCharacterController.get());
+
+			// raycasts against this character hit the animated mesh, and culling follows it
+			obj.enableCpuSkinning(*mAnimationPlayer);
     	}
     }
 
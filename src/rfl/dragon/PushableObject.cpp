@@ -77,6 +77,12 @@ namespace odRfl
     	obj.getLevel().getPhysicsManager().removeObject(obj);
     }
 
+    bool PushableObject::allowsInstancing() const
+    {
+        // gets moved by the physics engine all the time
+        return false;
+    }
+
     OD_REGISTER_RFL_CLASS(0x0010, "Pushable Object", PushableObject);
 
 }
@@ -47,6 +47,12 @@ namespace odRfl
         mLightHandle->setRadius(mRadius);
     }
 
+    void StaticLight::despawned(od::LevelObject &obj)
+    {
+        obj.getLevel().getEngine().getLightManager().removeLight(mLightHandle);
+        mLightHandle = nullptr;
+    }
+
 
     OD_REGISTER_RFL_CLASS(0x84, "Static Light", StaticLight);
 
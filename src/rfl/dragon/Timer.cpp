@@ -8,8 +8,11 @@
 
 #include "rfl/dragon/Timer.h"
 
+#include <algorithm>
+
 #include "rfl/Rfl.h"
 #include "LevelObject.h"
+#include "Engine.h"
 
 namespace odRfl
 {
@@ -22,9 +25,12 @@ namespace odRfl
 	, mTriggerMessage(RflMessage::On)
 	, mToggle(false)
 	, mDisableReenableMessage(RflMessage::Off)
+	, mTimerWheel(nullptr)
+	, mTimerHandle(od::TimerWheel::INVALID_HANDLE)
 	, mGotStartTrigger(false)
 	, mTimerRunning(false)
 	, mTimeElapsed(0.0)
+	, mTriggerTime(0.0)
 	{
 	}
 
@@ -48,43 +54,25 @@ namespace odRfl
 	        return;
 	    }
 
+	    mTimerWheel = &engine.getTimerWheel();
+
 	    obj->setSpawnStrategy(od::SpawnStrategy::Always);
 	}
 
 	void Timer::spawned(od::LevelObject &obj)
 	{
-	    obj.setEnableRflUpdateHook(true);
-
+	    // no update hook needed. the engine's timer wheel calls us back once we are due
 	    mTimerRunning = (mStartMode == TimerStartMode::RunInstantly);
-	}
-
-	void Timer::update(od::LevelObject &obj, double simTime, double relTime)
-	{
-	    if(!mTimerRunning)
+	    if(mTimerRunning)
 	    {
-	        return;
+	        _schedule(obj);
 	    }
+	}
 
-	    mTimeElapsed += relTime;
-
-	    if(mTimeElapsed >= mTimeUntilTrigger)
-	    {
-	        Logger::verbose() << "Timer " << obj.getObjectId() << " triggered at simTime=" << simTime << "s";
-
-	        obj.messageAllLinkedObjects(mTriggerMessage);
-
-	        mTimerRunning = false;
-
-	        if(mDestroyAfterTimeout)
-	        {
-	            obj.requestDestruction();
-
-	        }else if(mRepeat)
-	        {
-	            mTimerRunning = true;
-	            mTimeElapsed = 0.0;
-	        }
-	    }
+	void Timer::despawned(od::LevelObject &obj)
+	{
+	    // the wheel holds a reference to obj in it's callback. keep the elapsed time, though
+	    _unschedule();
 	}
 
 	void Timer::messageReceived(od::LevelObject &obj, od::LevelObject &sender, RflMessage message)
@@ -94,18 +82,77 @@ namespace odRfl
 	        // i assume any message will trigger the timer. there is no field that would indicate otherwise
 	        mTimerRunning = true;
 	        mGotStartTrigger = true;
+	        _schedule(obj);
 
 	        Logger::verbose() << "Timer " << obj.getObjectId() << " started by object " << sender.getObjectId();
 
 	    }else if(mToggle && message == mDisableReenableMessage)
 	    {
 	        mTimerRunning = !mTimerRunning;
+	        if(mTimerRunning)
+	        {
+	            _schedule(obj);
+
+	        }else
+	        {
+	            _unschedule();
+	        }
 
 	        Logger::verbose() << "Timer " << obj.getObjectId() << " " << (mTimerRunning ? "enabled" : "disabled")
 	                          << " by object " << sender.getObjectId();
 	    }
 	}
 
+	void Timer::_schedule(od::LevelObject &obj)
+	{
+	    if(mTimerWheel == nullptr)
+	    {
+	        return;
+	    }
+
+	    _unschedule();
+
+	    double timeLeft = std::max(0.0, mTimeUntilTrigger - mTimeElapsed);
+	    mTriggerTime = mTimerWheel->getCurrentTime() + timeLeft;
+	    mTimerHandle = mTimerWheel->schedule(mTriggerTime, [this, &obj](){ _triggered(obj); });
+	}
+
+	void Timer::_unschedule()
+	{
+	    if(mTimerWheel == nullptr || !mTimerWheel->isPending(mTimerHandle))
+	    {
+	        return;
+	    }
+
+	    // remember how far we got so a re-enabled timer picks up where it left off
+	    mTimeElapsed = std::max(0.0, mTimeUntilTrigger - (mTriggerTime - mTimerWheel->getCurrentTime()));
+
+	    mTimerWheel->cancel(mTimerHandle);
+	    mTimerHandle = od::TimerWheel::INVALID_HANDLE;
+	}
+
+	void Timer::_triggered(od::LevelObject &obj)
+	{
+	    mTimerHandle = od::TimerWheel::INVALID_HANDLE;
+
+	    Logger::verbose() << "Timer " << obj.getObjectId() << " triggered at simTime=" << mTimerWheel->getCurrentTime() << "s";
+
+	    obj.messageAllLinkedObjects(mTriggerMessage);
+
+	    mTimerRunning = false;
+	    mTimeElapsed = 0.0;
+
+	    if(mDestroyAfterTimeout)
+	    {
+	        obj.requestDestruction();
+
+	    }else if(mRepeat)
+	    {
+	        mTimerRunning = true;
+	        _schedule(obj);
+	    }
+	}
+
 	OD_REGISTER_RFL_CLASS(0x003e, "Timer", Timer);
 
 }
@@ -7,8 +7,6 @@
 
 #include "rfl/dragon/TrackingCamera.h"
 
-#include <osg/NodeCallback>
-
 #include "rfl/Rfl.h"
 #include "Level.h"
 #include "LevelObject.h"
@@ -19,19 +17,17 @@ namespace odRfl
 {
 
 
-    class CamUpdateCallback : public osg::NodeCallback
+    class CamUpdater : public od::Updatable
     {
     public:
 
-        CamUpdateCallback(TrackingCamera *cam)
+        CamUpdater(TrackingCamera *cam)
         : mCam(cam)
         {
         }
 
-        virtual void operator()(osg::Node* node, osg::NodeVisitor* nv)
+        virtual void update(double simTime, double relTime) override
         {
-            traverse(node, nv);
-
             mCam->updateCamera();
         }
 
@@ -90,16 +86,17 @@ namespace odRfl
 	        return;
 	    }
 
-	    // attach update callback to player so we always get updated after player
-	    mCamUpdateCallback = new CamUpdateCallback(this);
-	    mEngine->getPlayer()->getLevelObject().addUpdateCallback(mCamUpdateCallback);
+	    // camera phase runs after all RFL updates, so we always get updated after player
+	    mCamUpdater.reset(new CamUpdater(this));
+	    mEngine->getUpdateScheduler().add(mCamUpdater.get(), od::UpdatePhase::Camera);
 	}
 
 	void TrackingCamera::despawned(od::LevelObject &obj)
 	{
-	    if(mCamUpdateCallback != nullptr && mEngine->getPlayer() != nullptr)
+	    if(mCamUpdater != nullptr)
 	    {
-	        mEngine->getPlayer()->getLevelObject().removeUpdateCallback(mCamUpdateCallback);
+	        mEngine->getUpdateScheduler().remove(mCamUpdater.get());
+	        mCamUpdater.reset();
 	    }
 	}
 
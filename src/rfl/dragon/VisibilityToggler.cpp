@@ -74,6 +74,12 @@ namespace odRfl
         }
     }
 
+    bool VisibilityToggler::allowsMessageCollapsing(RflMessage message) const
+    {
+        // showing or hiding twice is the same as doing it once. toggling is not
+        return mTriggerMode == TriggerMode::DependsOnMessage;
+    }
+
 
     OD_REGISTER_RFL_CLASS(0x0079, "Visibility Toggler", VisibilityToggler);
 